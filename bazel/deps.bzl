@@ -91,6 +91,15 @@ def deps(repo_mapping = {}):
         repo_mapping = repo_mapping,
     )
 
+    maybe(
+        http_archive,
+        name = "com_github_google_benchmark",
+        url = "https://github.com/google/benchmark/archive/refs/tags/v1.6.1.tar.gz",
+        sha256 = "6132883bc8c9b0df5375b16ab520fac1a85dc9e4cf5be59480448ece74b278d4",
+        strip_prefix = "benchmark-1.6.1",
+        repo_mapping = repo_mapping,
+    )
+
     maybe(
         http_archive,
         name = "com_google_absl",
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <optional>
+#include <tuple>
+#include <type_traits>
+
+#include "eventuals/compose.h"
+#include "eventuals/reduce.h"
+#include "eventuals/terminal.h"
+#include "eventuals/then.h"
+#include "glog/logging.h"
+
+namespace eventuals::benchmarks {
+
+////////////////////////////////////////////////////////////////////////
+
+// Runs an eventual that completes synchronously on the calling
+// thread and returns its value.
+//
+// Unlike 'Run()' (i.e., 'operator*') this doesn't allocate a
+// 'Scheduler::Context' or go through a 'std::promise' and
+// 'std::future' so the measurement is (mostly) just the eventual.
+template <typename E>
+auto RunInline(E e) {
+  using Value = typename E::template ValueFrom<void, std::tuple<>>;
+
+  static_assert(
+      !std::is_void_v<Value>,
+      "'RunInline()' expects an eventual that produces a value");
+
+  std::optional<Value> value;
+
+  auto k = Build(
+      std::move(e)
+      >> Terminal()
+             .start([&value](auto&& v) {
+               value.emplace(std::forward<decltype(v)>(v));
+             })
+             .fail([](auto&&) {
+               LOG(FATAL) << "Unexpected failure";
+             })
+             .stop([]() {
+               LOG(FATAL) << "Unexpected stop";
+             }));
+
+  k.Start();
+
+  CHECK(value) << "eventual did not complete synchronously";
+
+  return std::move(*value);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Sums a stream of 'int's, i.e., "fans in" a stream into a single
+// value.
+inline auto Sum() {
+  return Reduce(
+      /* sum = */ 0,
+      [](int& sum) {
+        return Then([&](int i) {
+          sum += i;
+          return true;
+        });
+      });
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals::benchmarks
@@ -0,0 +1,108 @@
+#include "eventuals/event-loop.h"
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/benchmarks.h"
+#include "eventuals/promisify.h"
+#include "eventuals/then.h"
+
+namespace eventuals::benchmarks {
+namespace {
+
+// Constructs the default event loop for the duration of a benchmark.
+struct DefaultEventLoop final {
+  DefaultEventLoop() {
+    EventLoop::ConstructDefault();
+  }
+
+  ~DefaultEventLoop() {
+    EventLoop::DestructDefault();
+  }
+
+  EventLoop& operator*() {
+    return EventLoop::Default();
+  }
+};
+
+
+// Cost of 'EventLoop::Submit()' and then running the submitted
+// callback, all on the same thread.
+void BM_EventLoopSubmit(benchmark::State& state) {
+  DefaultEventLoop loop;
+
+  Scheduler::Context context(&*loop, "submit");
+
+  int count = 0;
+
+  for (auto _ : state) {
+    (*loop).Submit(
+        [&count]() {
+          count++;
+        },
+        context);
+
+    (*loop).RunUntilIdle();
+  }
+
+  CHECK_EQ(count, state.iterations());
+}
+
+BENCHMARK(BM_EventLoopSubmit);
+
+
+// Per-callback cost of 'EventLoop::Submit()' when many callbacks
+// are outstanding before the loop gets to run them.
+void BM_EventLoopSubmitBatch(benchmark::State& state) {
+  DefaultEventLoop loop;
+
+  const int n = state.range(0);
+
+  std::vector<std::unique_ptr<Scheduler::Context>> contexts;
+  for (int i = 0; i < n; i++) {
+    contexts.push_back(
+        std::make_unique<Scheduler::Context>(&*loop, "submit"));
+  }
+
+  int count = 0;
+
+  for (auto _ : state) {
+    for (auto& context : contexts) {
+      (*loop).Submit(
+          [&count]() {
+            count++;
+          },
+          *context);
+    }
+
+    (*loop).RunUntilIdle();
+  }
+
+  CHECK_EQ(count, state.iterations() * n);
+
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_EventLoopSubmitBatch)->Arg(16)->Arg(256)->Arg(4096);
+
+
+// Cost of 'EventLoop::Schedule()' from outside of the event loop
+// (which goes through 'EventLoop::Submit()') and waiting for the
+// result, i.e., what a caller pays to hop onto the loop.
+void BM_EventLoopSchedule(benchmark::State& state) {
+  DefaultEventLoop loop;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        *(*loop).Schedule(
+            Then([]() {
+              return 42;
+            })));
+  }
+}
+
+BENCHMARK(BM_EventLoopSchedule);
+
+} // namespace
+} // namespace eventuals::benchmarks
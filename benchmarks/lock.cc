@@ -0,0 +1,79 @@
+#include "eventuals/lock.h"
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/benchmarks.h"
+#include "eventuals/concurrent.h"
+#include "eventuals/just.h"
+#include "eventuals/map.h"
+#include "eventuals/promisify.h"
+#include "eventuals/range.h"
+#include "eventuals/static-thread-pool.h"
+#include "eventuals/then.h"
+
+namespace eventuals::benchmarks {
+namespace {
+
+// Cost of an uncontended 'Acquire()' and 'Release()'.
+void BM_AcquireRelease(benchmark::State& state) {
+  Lock lock;
+
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(i);
+    benchmark::DoNotOptimize(
+        RunInline(
+            Just(i)
+            >> Acquire(&lock)
+            >> Then([](int i) {
+                 return i + 1;
+               })
+            >> Release(&lock)));
+  }
+}
+
+BENCHMARK(BM_AcquireRelease);
+
+
+// Cost of 'Acquire()' and 'Release()' when every worker of the
+// default 'StaticThreadPool' is contending for the same lock, which
+// includes waiting and being rescheduled by whoever releases it.
+void BM_AcquireReleaseContended(benchmark::State& state) {
+  StaticThreadPool& pool = StaticThreadPool::Scheduler();
+
+  const int n = state.range(0);
+
+  std::vector<StaticThreadPool::Requirements> requirements;
+  requirements.reserve(n);
+  for (int i = 0; i < n; i++) {
+    requirements.emplace_back(
+        "contended",
+        Pinned::ExactCPU(i % pool.concurrency));
+  }
+
+  Lock lock;
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        *(Range(n)
+          >> Concurrent([&]() {
+              return Map([&](int i) {
+                return pool.Schedule(
+                    &requirements[i],
+                    Acquire(&lock)
+                        >> Then([i]() {
+                            return i + 1;
+                          })
+                        >> Release(&lock));
+              });
+            })
+          >> Sum()));
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_AcquireReleaseContended)->Arg(64)->UseRealTime();
+
+} // namespace
+} // namespace eventuals::benchmarks
@@ -0,0 +1,76 @@
+#include "eventuals/map.h"
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/benchmarks.h"
+#include "eventuals/concurrent-ordered.h"
+#include "eventuals/concurrent.h"
+#include "eventuals/promisify.h"
+#include "eventuals/range.h"
+#include "eventuals/then.h"
+
+namespace eventuals::benchmarks {
+namespace {
+
+// Per-element cost of a stream, i.e., 'Range' -> 'Map' -> 'Reduce'.
+void BM_Map(benchmark::State& state) {
+  const int n = state.range(0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        RunInline(
+            Range(n)
+            >> Map([](int i) {
+                 return i + 1;
+               })
+            >> Sum()));
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_Map)->Arg(1)->Arg(64)->Arg(4096);
+
+
+// Per-element cost of fanning out into 'Concurrent' (which runs
+// each element in its own fiber) and back in again, all on the
+// calling thread.
+//
+// NOTE: using 'Run()' (i.e., 'operator*') rather than 'RunInline()'
+// because 'Concurrent' needs a 'Scheduler::Context' to clone for
+// each of its fibers.
+void BM_Concurrent(benchmark::State& state) {
+  const int n = state.range(0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        *(Range(n)
+          >> Concurrent([]() {
+              return Map([](int i) {
+                return i + 1;
+              });
+            })
+          >> Sum()));
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_Concurrent)->Arg(1)->Arg(64)->Arg(4096);
+
+
+// Like 'BM_Concurrent' but also pays for reordering the results.
+void BM_ConcurrentOrdered(benchmark::State& state) {
+  const int n = state.range(0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        *(Range(n)
+          >> ConcurrentOrdered([]() {
+              return Map([](int i) {
+                return i + 1;
+              });
+            })
+          >> Sum()));
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_ConcurrentOrdered)->Arg(1)->Arg(64)->Arg(4096);
+
+} // namespace
+} // namespace eventuals::benchmarks
@@ -0,0 +1,134 @@
+#include "eventuals/static-thread-pool.h"
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/benchmarks.h"
+#include "eventuals/concurrent.h"
+#include "eventuals/loop.h"
+#include "eventuals/map.h"
+#include "eventuals/promisify.h"
+#include "eventuals/range.h"
+#include "eventuals/repeat.h"
+#include "eventuals/then.h"
+#include "eventuals/until.h"
+
+namespace eventuals::benchmarks {
+namespace {
+
+// Round trip from a thread outside of the pool to a worker and
+// back, i.e., 'StaticThreadPool::Schedule()' plus waking up both the
+// worker and the calling thread.
+void BM_Schedule(benchmark::State& state) {
+  StaticThreadPool& pool = StaticThreadPool::Scheduler();
+
+  StaticThreadPool::Requirements requirements(
+      "schedule",
+      Pinned::ExactCPU(0));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        *pool.Schedule(
+            &requirements,
+            Then([]() {
+              return 42;
+            })));
+  }
+}
+
+BENCHMARK(BM_Schedule)->UseRealTime();
+
+
+// Per-message cost of a stream whose producer and consumer are
+// pinned to different workers so that every element hops between
+// threads twice (once to produce it, once to consume it).
+void BM_PingPong(benchmark::State& state) {
+  StaticThreadPool& pool = StaticThreadPool::Scheduler();
+
+  if (pool.concurrency < 2) {
+    state.SkipWithError("requires at least 2 CPUs");
+    return;
+  }
+
+  struct Streamer : public StaticThreadPool::Schedulable {
+    Streamer(int n)
+      : StaticThreadPool::Schedulable(Pinned::ExactCPU(0)),
+        n(n) {}
+
+    auto Stream() {
+      return Repeat()
+          >> Until([this]() {
+               return Schedule(Then([this]() {
+                 return count == n;
+               }));
+             })
+          >> Schedule(Map([this]() {
+               return count++;
+             }));
+    }
+
+    const int n;
+    int count = 0;
+  };
+
+  struct Listener : public StaticThreadPool::Schedulable {
+    Listener()
+      : StaticThreadPool::Schedulable(Pinned::ExactCPU(1)) {}
+
+    auto Listen() {
+      return Schedule(Map([](int i) {
+               return i + 1;
+             }))
+          >> Sum();
+    }
+  };
+
+  const int n = state.range(0);
+
+  for (auto _ : state) {
+    Streamer streamer(n);
+    Listener listener;
+    benchmark::DoNotOptimize(*(streamer.Stream() >> listener.Listen()));
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_PingPong)->Arg(1024)->UseRealTime();
+
+
+// Per-element cost of fanning out a stream across every worker of
+// the pool with 'Concurrent' and fanning back in again.
+void BM_FanOutFanIn(benchmark::State& state) {
+  StaticThreadPool& pool = StaticThreadPool::Scheduler();
+
+  const int n = state.range(0);
+
+  std::vector<StaticThreadPool::Requirements> requirements;
+  requirements.reserve(n);
+  for (int i = 0; i < n; i++) {
+    requirements.emplace_back(
+        "fan-out",
+        Pinned::ExactCPU(i % pool.concurrency));
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        *(Range(n)
+          >> Concurrent([&]() {
+              return Map([&](int i) {
+                return pool.Schedule(
+                    &requirements[i],
+                    Then([i]() {
+                      return i + 1;
+                    }));
+              });
+            })
+          >> Sum()));
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_FanOutFanIn)->Arg(64)->Arg(1024)->UseRealTime();
+
+} // namespace
+} // namespace eventuals::benchmarks
@@ -0,0 +1,77 @@
+#include "eventuals/task.h"
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/benchmarks.h"
+#include "eventuals/just.h"
+#include "eventuals/then.h"
+
+namespace eventuals::benchmarks {
+namespace {
+
+// Baseline for 'BM_Task', the same eventual without type erasure.
+void BM_TaskBaseline(benchmark::State& state) {
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(i);
+    benchmark::DoNotOptimize(
+        RunInline(
+            Just(i)
+            >> Then([](int i) {
+                 return i + 1;
+               })));
+  }
+}
+
+BENCHMARK(BM_TaskBaseline);
+
+
+// Cost of type erasing an eventual with 'Task', i.e., storing the
+// callable, dispatching to it and allocating its continuation.
+void BM_Task(benchmark::State& state) {
+  auto e = [](int i) -> Task::Of<int> {
+    return [i]() {
+      return Just(i)
+          >> Then([](int i) {
+               return i + 1;
+             });
+    };
+  };
+
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(i);
+    benchmark::DoNotOptimize(RunInline(e(i)));
+  }
+}
+
+BENCHMARK(BM_Task);
+
+
+// Cost of a 'Task' composed with other eventuals, which requires
+// its continuation to be type erased too.
+void BM_TaskComposed(benchmark::State& state) {
+  auto e = [](int i) -> Task::Of<int> {
+    return [i]() {
+      return Just(i);
+    };
+  };
+
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(i);
+    benchmark::DoNotOptimize(
+        RunInline(
+            e(i)
+            >> Then([](int i) {
+                 return i + 1;
+               })
+            >> Then([&](int i) {
+                 return e(i);
+               })));
+  }
+}
+
+BENCHMARK(BM_TaskComposed);
+
+} // namespace
+} // namespace eventuals::benchmarks
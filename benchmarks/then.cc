@@ -0,0 +1,60 @@
+#include "eventuals/then.h"
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/benchmarks.h"
+#include "eventuals/just.h"
+
+namespace eventuals::benchmarks {
+namespace {
+
+// Returns an eventual of 'N' 'Then's each adding one to the value
+// produced by the previous one.
+template <size_t N>
+auto Thens(int i) {
+  if constexpr (N == 0) {
+    return Just(i);
+  } else {
+    return Thens<N - 1>(i)
+        >> Then([](int i) {
+             return i + 1;
+           });
+  }
+}
+
+// Per-hop cost of composing synchronous continuations; divide by the
+// reported 'items_per_second' to get the cost of a single 'Then'.
+template <size_t N>
+void BM_Then(benchmark::State& state) {
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(i);
+    benchmark::DoNotOptimize(RunInline(Thens<N>(i)));
+  }
+  state.SetItemsProcessed(state.iterations() * N);
+}
+
+BENCHMARK_TEMPLATE(BM_Then, 1);
+BENCHMARK_TEMPLATE(BM_Then, 8);
+BENCHMARK_TEMPLATE(BM_Then, 64);
+
+
+// Cost of a 'Then' whose callable returns another eventual which
+// must be composed and started at runtime.
+void BM_ThenEventual(benchmark::State& state) {
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(i);
+    benchmark::DoNotOptimize(
+        RunInline(
+            Just(i)
+            >> Then([](int i) {
+                 return Just(i + 1);
+               })));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ThenEventual);
+
+} // namespace
+} // namespace eventuals::benchmarks
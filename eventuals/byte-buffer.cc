@@ -0,0 +1,236 @@
+#include "eventuals/byte-buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+ByteBuffer::Slice::Slice(std::string&& data) {
+  // NOTE: we need to take the pointer to the bytes _after_ moving the
+  // string into the owner since a moved string that uses the small
+  // string optimization has its bytes copied.
+  auto owner = std::make_shared<const std::string>(std::move(data));
+  data_ = owner->data();
+  size_ = owner->size();
+  owner_ = std::move(owner);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+ByteBuffer::Slice ByteBuffer::Slice::Sub(size_t offset, size_t size) const {
+  offset = std::min(offset, size_);
+  size = std::min(size, size_ - offset);
+  return Slice(owner_, data_ + offset, size);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void ByteBuffer::Append(Slice slice) {
+  if (!slice.empty()) {
+    size_ += slice.size();
+    slices_.push_back(std::move(slice));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void ByteBuffer::Append(const ByteBuffer& that) {
+  // NOTE: 'that' might be us, e.g., 'buffer.Append(buffer)', in which
+  // case inserting a range of our own slices is undefined so instead
+  // we reserve space up front (so nothing gets reallocated while we're
+  // copying) and copy as many slices as we had to begin with.
+  size_t count = that.slices_.size();
+  slices_.reserve(slices_.size() + count);
+  for (size_t i = 0; i < count; i++) {
+    slices_.push_back(that.slices_[i]);
+  }
+  size_ += that.size_;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void ByteBuffer::Append(ByteBuffer&& that) {
+  if (this == &that) {
+    // Can't move our own slices, copy them instead (which is cheap
+    // since the bytes are shared).
+    Append(static_cast<const ByteBuffer&>(that));
+  } else if (slices_.empty()) {
+    *this = std::move(that);
+  } else {
+    slices_.insert(
+        slices_.end(),
+        std::make_move_iterator(that.slices_.begin()),
+        std::make_move_iterator(that.slices_.end()));
+    size_ += that.size_;
+    that.slices_.clear();
+    that.size_ = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+ByteBuffer ByteBuffer::Sub(size_t offset, size_t size) const {
+  ByteBuffer buffer;
+  for (const Slice& slice : slices_) {
+    if (size == 0) {
+      break;
+    } else if (offset >= slice.size()) {
+      offset -= slice.size();
+    } else {
+      buffer.Append(slice.Sub(offset, size));
+      size -= std::min(size, slice.size() - offset);
+      offset = 0;
+    }
+  }
+  return buffer;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void ByteBuffer::Consume(size_t size) {
+  size = std::min(size, size_);
+  size_ -= size;
+
+  auto it = slices_.begin();
+  while (size > 0 && size >= it->size()) {
+    size -= it->size();
+    ++it;
+  }
+
+  if (size > 0) {
+    *it = it->Sub(size);
+  }
+
+  slices_.erase(slices_.begin(), it);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+size_t ByteBuffer::CopyTo(char* destination, size_t size, size_t offset)
+    const {
+  size_t copied = 0;
+  for (const Slice& slice : slices_) {
+    if (copied == size) {
+      break;
+    } else if (offset >= slice.size()) {
+      offset -= slice.size();
+    } else {
+      size_t n = std::min(size - copied, slice.size() - offset);
+      std::memcpy(destination + copied, slice.data() + offset, n);
+      copied += n;
+      offset = 0;
+    }
+  }
+  return copied;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+std::string ByteBuffer::ToString() const {
+  std::string data;
+  data.reserve(size_);
+  for (const Slice& slice : slices_) {
+    data.append(slice.data(), slice.size());
+  }
+  return data;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool ByteBuffer::operator==(const ByteBuffer& that) const {
+  if (size_ != that.size_) {
+    return false;
+  }
+
+  // Compare without flattening either buffer since the slices of
+  // each buffer won't necessarily line up.
+  size_t offset = 0;
+  for (const Slice& slice : slices_) {
+    size_t compared = 0;
+    for (const Slice& other : that.Sub(offset, slice.size()).slices_) {
+      if (std::memcmp(slice.data() + compared, other.data(), other.size())
+          != 0) {
+        return false;
+      }
+      compared += other.size();
+    }
+    offset += slice.size();
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool ByteBuffer::operator==(std::string_view that) const {
+  if (size_ != that.size()) {
+    return false;
+  }
+
+  size_t offset = 0;
+  for (const Slice& slice : slices_) {
+    if (slice.view() != that.substr(offset, slice.size())) {
+      return false;
+    }
+    offset += slice.size();
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<ByteBufferPool> ByteBufferPool::Create(
+    size_t block_size,
+    size_t capacity) {
+  // NOTE: can't use 'std::make_shared()' with a private constructor.
+  return std::shared_ptr<ByteBufferPool>(
+      new ByteBufferPool(block_size, capacity));
+}
+
+////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<char> ByteBufferPool::Acquire() {
+  std::unique_ptr<char[]> block;
+
+  {
+    std::scoped_lock lock(mutex_);
+    if (!blocks_.empty()) {
+      block = std::move(blocks_.back());
+      blocks_.pop_back();
+    }
+  }
+
+  if (!block) {
+    block.reset(new char[block_size_]);
+  }
+
+  // NOTE: the deleter holds on to the pool so that it outlives all of
+  // its blocks.
+  return std::shared_ptr<char>(
+      block.release(),
+      [pool = shared_from_this()](char* block) {
+        pool->Release(block);
+      });
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void ByteBufferPool::Release(char* block) {
+  std::unique_ptr<char[]> owned(block);
+
+  std::scoped_lock lock(mutex_);
+  if (blocks_.size() < capacity_) {
+    blocks_.push_back(std::move(owned));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
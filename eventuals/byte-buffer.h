@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstddef> // For 'size_t'.
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+// A refcounted sequence of bytes made up of a chain of immutable
+// slices (i.e., an iovec chain) each of which shares ownership of the
+// memory it points into. Copying a buffer, taking a range of it, or
+// appending one buffer to another never copies any bytes, which lets
+// data move between files, HTTP, and gRPC without being copied at
+// each hop.
+//
+// The slices can be used directly for scatter/gather I/O, e.g., as an
+// array of 'uv_buf_t' or 'iovec', see 'slices()'.
+//
+// NOTE: like 'std::shared_ptr' a buffer can be copied and destructed
+// from different threads, but the bytes it points to are immutable
+// once they've been put in a buffer.
+class ByteBuffer final {
+ public:
+  static constexpr size_t npos = size_t(-1);
+
+  // A contiguous range of bytes kept alive by an owner.
+  class Slice final {
+   public:
+    Slice() = default;
+
+    // Takes ownership of 'data' without copying the bytes.
+    explicit Slice(std::string&& data);
+
+    // Shares ownership of 'size' bytes at 'data' with 'owner', e.g.,
+    // memory owned by a library that has its own reference counting.
+    Slice(std::shared_ptr<const void> owner, const char* data, size_t size)
+      : owner_(std::move(owner)),
+        data_(data),
+        size_(size) {}
+
+    const char* data() const {
+      return data_;
+    }
+
+    size_t size() const {
+      return size_;
+    }
+
+    bool empty() const {
+      return size_ == 0;
+    }
+
+    std::string_view view() const {
+      return std::string_view(data_, size_);
+    }
+
+    // Returns (at most) 'size' bytes starting at 'offset' which share
+    // ownership with this slice.
+    Slice Sub(size_t offset, size_t size = npos) const;
+
+   private:
+    std::shared_ptr<const void> owner_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+  };
+
+  ByteBuffer() = default;
+
+  // Takes ownership of 'data' without copying the bytes.
+  explicit ByteBuffer(std::string&& data)
+    : ByteBuffer(Slice(std::move(data))) {}
+
+  explicit ByteBuffer(Slice slice) {
+    Append(std::move(slice));
+  }
+
+  ByteBuffer(const ByteBuffer&) = default;
+  ByteBuffer(ByteBuffer&& that) noexcept
+    : slices_(std::move(that.slices_)),
+      size_(that.size_) {
+    that.slices_.clear();
+    that.size_ = 0;
+  }
+
+  ByteBuffer& operator=(const ByteBuffer&) = default;
+  ByteBuffer& operator=(ByteBuffer&& that) noexcept {
+    if (this != &that) {
+      slices_ = std::move(that.slices_);
+      size_ = that.size_;
+      that.slices_.clear();
+      that.size_ = 0;
+    }
+    return *this;
+  }
+
+  // Returns a buffer with a copy of 'data'.
+  static ByteBuffer Copy(std::string_view data) {
+    return ByteBuffer(std::string(data));
+  }
+
+  // Total number of bytes across all slices.
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  // NOTE: never contains empty slices.
+  const std::vector<Slice>& slices() const {
+    return slices_;
+  }
+
+  void Append(Slice slice);
+
+  void Append(const ByteBuffer& that);
+
+  void Append(ByteBuffer&& that);
+
+  // Returns (at most) 'size' bytes starting at 'offset' which share
+  // ownership with this buffer.
+  ByteBuffer Sub(size_t offset, size_t size = npos) const;
+
+  // Removes (at most) the first 'size' bytes.
+  void Consume(size_t size);
+
+  // Copies (at most) 'size' bytes starting at 'offset' into
+  // 'destination' returning the number of bytes copied.
+  size_t CopyTo(char* destination, size_t size, size_t offset = 0) const;
+
+  // Returns a copy of all of the bytes as a single string.
+  std::string ToString() const;
+
+  bool operator==(const ByteBuffer& that) const;
+
+  bool operator!=(const ByteBuffer& that) const {
+    return !(*this == that);
+  }
+
+  bool operator==(std::string_view that) const;
+
+  bool operator!=(std::string_view that) const {
+    return !(*this == that);
+  }
+
+ private:
+  std::vector<Slice> slices_;
+  size_t size_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+inline bool operator==(std::string_view left, const ByteBuffer& right) {
+  return right == left;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+inline bool operator!=(std::string_view left, const ByteBuffer& right) {
+  return right != left;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+inline std::ostream& operator<<(
+    std::ostream& stream,
+    const ByteBuffer& buffer) {
+  for (const ByteBuffer::Slice& slice : buffer.slices()) {
+    stream << slice.view();
+  }
+  return stream;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// A pool of fixed size blocks of memory which are meant to be filled
+// in (e.g., by reading from a file) and then handed off as slices of
+// a 'ByteBuffer'. Once the last slice of a block is destructed the
+// block goes back to the pool (unless it already has 'capacity'
+// blocks) so streaming lots of chunks doesn't need to keep going to
+// the system allocator.
+//
+// NOTE: blocks may be released from any thread, and a pool stays
+// alive until all of its blocks have been released.
+class ByteBufferPool final
+  : public std::enable_shared_from_this<ByteBufferPool> {
+ public:
+  static std::shared_ptr<ByteBufferPool> Create(
+      size_t block_size,
+      size_t capacity);
+
+  ByteBufferPool(const ByteBufferPool&) = delete;
+  ByteBufferPool(ByteBufferPool&&) = delete;
+
+  // Returns a block of 'block_size()' bytes.
+  std::shared_ptr<char> Acquire();
+
+  size_t block_size() const {
+    return block_size_;
+  }
+
+  // Number of blocks in the pool waiting to be acquired.
+  size_t cached() {
+    std::scoped_lock lock(mutex_);
+    return blocks_.size();
+  }
+
+ private:
+  ByteBufferPool(size_t block_size, size_t capacity)
+    : block_size_(block_size),
+      capacity_(capacity) {}
+
+  void Release(char* block);
+
+  const size_t block_size_;
+  const size_t capacity_;
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -1,8 +1,11 @@
 #pragma once
 
-#include <map>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <tuple>
+#include <vector>
 
 #include "eventuals/callback.h"
 #include "eventuals/compose.h"
@@ -20,11 +23,187 @@ namespace eventuals {
 
 /////////////////////////////////////////////////////////////////////
 
+// Bounds how far ahead of the oldest value that hasn't been fully
+// emitted downstream (the "head") 'ConcurrentOrdered()' can get. It's
+// shared between 'SequenceAdaptor()', which numbers each value before
+// it gets to 'Concurrent()' and stops asking upstream for more values
+// when the window is full, and 'ReorderAdaptor()', which makes room
+// in the window every time it has emitted everything for the head.
+//
+// NOTE: 'SequenceAdaptor()' and 'ReorderAdaptor()' might be executing
+// on different threads so everything here is atomic.
+class _ReorderWindow final {
+ public:
+  explicit _ReorderWindow(size_t size)
+    : size_(size) {
+    CHECK_GT(size_, 0u) << "reorder window must be positive";
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  void Begin(TypeErasedStream& upstream) {
+    upstream_ = &upstream;
+  }
+
+  // Returns the sequence number for the next value from upstream,
+  // starting at 1 (see 'ConcurrentOrdered()').
+  int64_t Started() {
+    return ++started_;
+  }
+
+  // Asks upstream for the next value if there is room in the window,
+  // otherwise defers asking until 'Emitted()' or 'Open()'.
+  void Next() {
+    if (!HasRoom()) {
+      waiting_.store(true);
+
+      // Need to check again in case room was made before we set
+      // 'waiting_' and nobody else will ask upstream.
+      if (!HasRoom() || !waiting_.exchange(false)) {
+        return;
+      }
+    }
+
+    CHECK_NOTNULL(upstream_)->Next();
+  }
+
+  // Makes room in the window after everything for the head has been
+  // emitted downstream.
+  void Emitted() {
+    ++emitted_;
+    Wake();
+  }
+
+  // Stops bounding the window, e.g., because something failed or
+  // downstream is done and we need upstream to find out.
+  void Open() {
+    open_.store(true);
+    Wake();
+  }
+
+ private:
+  bool HasRoom() const {
+    return open_.load() || started_.load() - emitted_.load() < (int64_t) size_;
+  }
+
+  void Wake() {
+    if (HasRoom() && waiting_.exchange(false)) {
+      CHECK_NOTNULL(upstream_)->Next();
+    }
+  }
+
+  const size_t size_;
+
+  TypeErasedStream* upstream_ = nullptr;
+
+  std::atomic<int64_t> started_ = 0;
+  std::atomic<int64_t> emitted_ = 0;
+
+  std::atomic<bool> waiting_ = false;
+  std::atomic<bool> open_ = false;
+};
+
+/////////////////////////////////////////////////////////////////////
+
+// Numbers each value from upstream and applies backpressure once the
+// reorder window is full.
+struct _SequenceAdaptor final {
+  template <typename K_>
+  struct Continuation final : public TypeErasedStream {
+    Continuation(K_ k, std::shared_ptr<_ReorderWindow> window)
+      : window_(std::move(window)),
+        k_(std::move(k)) {}
+
+    Continuation(Continuation&& that) noexcept = default;
+
+    ~Continuation() override = default;
+
+    void Begin(TypeErasedStream& stream) {
+      upstream_ = &stream;
+      window_->Begin(stream);
+      k_.Begin(*this);
+    }
+
+    template <typename Value>
+    void Body(Value&& value) {
+      k_.Body(std::make_tuple(window_->Started(), std::forward<Value>(value)));
+    }
+
+    template <typename Error>
+    void Fail(Error&& error) {
+      k_.Fail(std::forward<Error>(error));
+    }
+
+    void Register(Interrupt& interrupt) {
+      k_.Register(interrupt);
+    }
+
+    void Stop() {
+      k_.Stop();
+    }
+
+    void Ended() {
+      k_.Ended();
+    }
+
+    void Next() override {
+      window_->Next();
+    }
+
+    void Done() override {
+      upstream_->Done();
+    }
+
+    std::shared_ptr<_ReorderWindow> window_;
+
+    TypeErasedStream* upstream_ = nullptr;
+
+    // NOTE: we store 'k_' as the _last_ member so it will be
+    // destructed _first_ and thus we won't have any use-after-delete
+    // issues during destruction of 'k_' if it holds any references or
+    // pointers to any (or within any) of the above members.
+    K_ k_;
+  };
+
+  struct Composable final {
+    template <typename Arg, typename Errors>
+    using ValueFrom = std::tuple<int64_t, std::decay_t<Arg>>;
+
+    template <typename Arg, typename Errors>
+    using ErrorsFrom = Errors;
+
+    template <typename Arg, typename Errors, typename K>
+    auto k(K k) && {
+      return Continuation<K>(std::move(k), std::move(window_));
+    }
+
+    template <typename Downstream>
+    static constexpr bool CanCompose = Downstream::ExpectsStream;
+
+    using Expects = StreamOfValues;
+
+    std::shared_ptr<_ReorderWindow> window_;
+  };
+};
+
+/////////////////////////////////////////////////////////////////////
+
+[[nodiscard]] inline auto SequenceAdaptor(
+    std::shared_ptr<_ReorderWindow> window) {
+  return _SequenceAdaptor::Composable{std::move(window)};
+}
+
+/////////////////////////////////////////////////////////////////////
+
 struct _ReorderAdaptor final {
   template <typename K_, typename Value_>
   struct Continuation final : public TypeErasedStream {
-    Continuation(K_ k)
-      : k_(std::move(k)) {}
+    Continuation(K_ k, std::shared_ptr<_ReorderWindow> window)
+      : window_(std::move(window)),
+        slots_(window_->size()),
+        k_(std::move(k)) {}
 
     Continuation(Continuation&& that) noexcept = default;
 
@@ -38,18 +217,17 @@ struct _ReorderAdaptor final {
     // Propagates the received value or
     // store it and 'ask' a next value from a stream.
     template <typename Value>
-    void Body(std::tuple<int, std::optional<Value>>&& tuple) {
+    void Body(std::tuple<int64_t, std::optional<Value>>&& tuple) {
       CHECK(!done_);
-      int i = std::get<0>(tuple);
+      int64_t i = std::get<0>(tuple);
       if (i < 0) {
-        ended_[i * -1] = true;
+        SlotFor(i * -1).ended = true;
         Next();
       } else if (index_ == i) {
-        CHECK(buffer_[i].empty());
+        CHECK(SlotFor(i).empty());
         k_.Body(std::move(std::get<1>(tuple).value()));
       } else {
-        CHECK(index_ < i);
-        buffer_[i].push_back(std::move(std::get<1>(tuple).value()));
+        SlotFor(i).values.push_back(std::move(std::get<1>(tuple).value()));
         upstream_->Next();
       }
     }
@@ -74,13 +252,17 @@ struct _ReorderAdaptor final {
     // Calls 'Next' on 'upstream' in case when there are no stored
     // values, propagate a value from buffer to 'Body' otherwise.
     void Next() override {
-      if (!buffer_[index_].empty()) {
-        auto value = buffer_[index_].front();
-        buffer_[index_].pop_front();
-        k_.Body(std::move(value));
-      } else if (ended_[index_]) {
-        CHECK(buffer_[index_].empty());
+      Slot& slot = SlotFor(index_);
+      if (!slot.empty()) {
+        k_.Body(std::move(slot.values[slot.next++]));
+      } else if (slot.ended) {
+        // NOTE: 'clear()' keeps the capacity so that reusing this
+        // slot for a later index won't need to allocate.
+        slot.values.clear();
+        slot.next = 0;
+        slot.ended = false;
         index_++;
+        window_->Emitted();
         Next();
       } else {
         upstream_->Next();
@@ -89,18 +271,47 @@ struct _ReorderAdaptor final {
 
     void Done() override {
       done_ = true;
-      buffer_.clear();
-      ended_.clear();
+      slots_.clear();
+
+      // NOTE: keeping a reference to the window in case calling
+      // 'Done()' on upstream causes us to get destructed.
+      std::shared_ptr<_ReorderWindow> window = window_;
+
       upstream_->Done();
+
+      // Need to let upstream find out that we're done in case it's
+      // waiting for room in the window.
+      window->Open();
     }
 
-    TypeErasedStream* upstream_ = nullptr;
+    // Values (and whether or not all of them have been received) for
+    // a single index, stored in 'slots_' at 'index % slots_.size()'.
+    struct Slot {
+      bool empty() const {
+        return next == values.size();
+      }
 
-    std::map<int, std::deque<Value_>> buffer_;
+      std::vector<Value_> values;
+      size_t next = 0;
+      bool ended = false;
+    };
+
+    Slot& SlotFor(int64_t i) {
+      // NOTE: 'SequenceAdaptor()' guarantees we never get a value for
+      // an index that is a full window ahead of 'index_'.
+      CHECK_LE(index_, i);
+      CHECK_LT(i - index_, (int64_t) slots_.size());
+      return slots_[i % slots_.size()];
+    }
+
+    std::shared_ptr<_ReorderWindow> window_;
+
+    TypeErasedStream* upstream_ = nullptr;
 
-    int index_ = 1;
+    // Fixed size ring of slots, one for each index in the window.
+    std::vector<Slot> slots_;
 
-    std::map<int, bool> ended_;
+    int64_t index_ = 1;
 
     bool done_ = false;
 
@@ -112,8 +323,8 @@ struct _ReorderAdaptor final {
   };
 
   // Arg there will be received from 'Concurrent::ConcurrentOrderedAdaptor'
-  // that equals to 'std::tuple<int, std::optional<Value>>' and we need to
-  // extract `Value`.
+  // that equals to 'std::tuple<int64_t, std::optional<Value>>' and we need
+  // to extract `Value`.
   struct Composable final {
     template <typename Arg, typename Errors>
     using ValueFrom = typename std::tuple_element<1, Arg>::type::value_type;
@@ -125,20 +336,25 @@ struct _ReorderAdaptor final {
     auto k(K k) && {
       return Continuation<
           K,
-          typename std::tuple_element<1, Arg>::type::value_type>(std::move(k));
+          typename std::tuple_element<1, Arg>::type::value_type>(
+          std::move(k),
+          std::move(window_));
     }
 
     template <typename Downstream>
     static constexpr bool CanCompose = Downstream::ExpectsStream;
 
     using Expects = StreamOfValues;
+
+    std::shared_ptr<_ReorderWindow> window_;
   };
 };
 
 /////////////////////////////////////////////////////////////////////
 
-[[nodiscard]] inline auto ReorderAdaptor() {
-  return _ReorderAdaptor::Composable{};
+[[nodiscard]] inline auto ReorderAdaptor(
+    std::shared_ptr<_ReorderWindow> window) {
+  return _ReorderAdaptor::Composable{std::move(window)};
 }
 
 /////////////////////////////////////////////////////////////////////
@@ -149,11 +365,15 @@ struct _ReorderAdaptor final {
 // saves upstream and on `Next` tries to get a next value from upstream,
 // if not ended, otherwise it calls 'Ended'. So 'Next' is both ending and
 // getting next values function.
+//
+// If a 'window' is provided it gets opened on a failure or stop so that
+// 'Concurrent()' can find out from upstream that it should be done.
 struct _ConcurrentOrderedAdaptor final {
   template <typename K_>
   struct Continuation final : public TypeErasedStream {
-    Continuation(K_ k)
-      : k_(std::move(k)) {}
+    Continuation(K_ k, _ReorderWindow* window)
+      : window_(window),
+        k_(std::move(k)) {}
 
     ~Continuation() override = default;
 
@@ -164,10 +384,10 @@ struct _ConcurrentOrderedAdaptor final {
     }
 
     template <typename Value>
-    void Body(std::tuple<int, Value>&& tuple) {
+    void Body(std::tuple<int64_t, Value>&& tuple) {
       // NOTE: Either this is the first value we've received on this stream
       // or the index, should be the same as the value we received before.
-      int i = std::get<0>(tuple);
+      int64_t i = std::get<0>(tuple);
 
       CHECK(!index_ || index_.value() == i);
 
@@ -179,7 +399,14 @@ struct _ConcurrentOrderedAdaptor final {
 
     template <typename Error>
     void Fail(Error&& error) {
+      // NOTE: opening the window _after_ failing so that 'Concurrent()'
+      // has already recorded the error by the time upstream is asked
+      // for another value.
+      _ReorderWindow* window = window_;
       k_.Fail(std::forward<Error>(error));
+      if (window != nullptr) {
+        window->Open();
+      }
     }
 
     void Register(Interrupt& interrupt) {
@@ -187,7 +414,11 @@ struct _ConcurrentOrderedAdaptor final {
     }
 
     void Stop() {
+      _ReorderWindow* window = window_;
       k_.Stop();
+      if (window != nullptr) {
+        window->Open();
+      }
     }
 
     void Ended() {
@@ -208,9 +439,11 @@ struct _ConcurrentOrderedAdaptor final {
       upstream_->Done();
     }
 
+    _ReorderWindow* window_ = nullptr;
+
     bool ended_ = false;
 
-    std::optional<int> index_;
+    std::optional<int64_t> index_;
 
     TypeErasedStream* upstream_ = nullptr;
 
@@ -224,7 +457,7 @@ struct _ConcurrentOrderedAdaptor final {
   struct Composable final {
     template <typename Arg, typename Errors>
     using ValueFrom = std::tuple<
-        int,
+        int64_t,
         std::optional<typename std::tuple_element<1, Arg>::type>>;
 
     template <typename Arg, typename Errors>
@@ -232,33 +465,49 @@ struct _ConcurrentOrderedAdaptor final {
 
     template <typename Arg, typename Errors, typename K>
     auto k(K k) && {
-      return Continuation<K>(std::move(k));
+      return Continuation<K>(std::move(k), window_);
     }
 
     template <typename Downstream>
     static constexpr bool CanCompose = Downstream::ExpectsStream;
 
     using Expects = StreamOfValues;
+
+    _ReorderWindow* window_ = nullptr;
   };
 };
 
 /////////////////////////////////////////////////////////////////////
 
-[[nodiscard]] inline auto ConcurrentOrderedAdaptor() {
-  return _ConcurrentOrderedAdaptor::Composable{};
+[[nodiscard]] inline auto ConcurrentOrderedAdaptor(
+    _ReorderWindow* window = nullptr) {
+  return _ConcurrentOrderedAdaptor::Composable{window};
 }
 
 /////////////////////////////////////////////////////////////////////
 
+// Default number of values that can be outstanding in
+// 'ConcurrentOrdered()' at a time.
+inline constexpr size_t CONCURRENT_ORDERED_DEFAULT_WINDOW = 128;
+
+/////////////////////////////////////////////////////////////////////
+
+// Like 'Concurrent()' except values are emitted downstream in the
+// same order as upstream emitted them. Values that are ready out of
+// order are buffered, but at most 'window' values from upstream can
+// be outstanding at a time (i.e., started but not yet emitted
+// downstream), after which we stop asking upstream for more values
+// until the oldest one has been emitted. This bounds how much gets
+// buffered when one value takes a lot longer than the rest.
 template <typename F>
-[[nodiscard]] inline auto ConcurrentOrdered(F f) {
-  // NOTE: Starting our index 'i' at 1 because we signal the end of that
-  // tranche of values via '-i' which means we can't start at 0.
-  return Map([i = 1](auto&& value) mutable {
-           return std::make_tuple(i++, std::forward<decltype(value)>(value));
-         })
-      >> Concurrent([f = std::move(f)]() {
-           return FlatMap([&f, j = 1](auto&& tuple) mutable {
+[[nodiscard]] inline auto ConcurrentOrdered(size_t window, F f) {
+  auto reorder = std::make_shared<_ReorderWindow>(window);
+
+  // NOTE: sequence numbers start at 1 because we signal the end of
+  // that tranche of values via '-i' which means we can't start at 0.
+  return SequenceAdaptor(reorder)
+      >> Concurrent([f = std::move(f), reorder = reorder.get()]() {
+           return FlatMap([&f, reorder, j = int64_t(1)](auto&& tuple) mutable {
              j = std::get<0>(tuple);
              return Iterate({std::move(std::get<1>(tuple))})
                  >> f()
@@ -269,11 +518,19 @@ template <typename F>
                  // the case when 'f()' has ended so we can propagate down to
                  // 'ReorderAdaptor()' that all elements for the 'i'th tranche
                  // of values has been emitted.
-                 >> ConcurrentOrderedAdaptor();
+                 >> ConcurrentOrderedAdaptor(reorder);
            });
          })
       // Handles the reordering of values by the propagated indexes.
-      >> ReorderAdaptor();
+      >> ReorderAdaptor(std::move(reorder));
+}
+
+/////////////////////////////////////////////////////////////////////
+
+// Uses a window of 'CONCURRENT_ORDERED_DEFAULT_WINDOW' values.
+template <typename F>
+[[nodiscard]] inline auto ConcurrentOrdered(F f) {
+  return ConcurrentOrdered(CONCURRENT_ORDERED_DEFAULT_WINDOW, std::move(f));
 }
 
 /////////////////////////////////////////////////////////////////////
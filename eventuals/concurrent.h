@@ -10,6 +10,7 @@
 #include "eventuals/loop.h"
 #include "eventuals/map.h"
 #include "eventuals/repeat.h"
+#include "eventuals/static-thread-pool.h"
 #include "eventuals/task.h"
 #include "eventuals/terminal.h"
 #include "eventuals/then.h"
@@ -24,11 +25,16 @@ namespace eventuals {
 // Uses the eventual returned from calling the specified function 'f'
 // to handle each value in the stream concurrently.
 //
+// By default there is no limit to how many values are handled
+// concurrently, see the overload that takes 'max_concurrency' for
+// applying backpressure to upstream instead.
+//
 // Concurrent here means that every eventual returned from calling 'f'
 // will have it's own scheduler context but it will use the default
 // scheduler which is preemptive, i.e., no threads or other execution
 // resources will be used. We call each eventual with it's own
-// scheduling context a "fiber".
+// scheduling context a "fiber". See 'ParallelConcurrent()' for
+// running fibers in parallel.
 //
 // The eventual returned from calling 'f' should be a generator, i.e.,
 // it can compose with an "upstream" stream and itself is a stream
@@ -47,6 +53,32 @@ namespace eventuals {
 template <typename F>
 [[nodiscard]] auto Concurrent(F f);
 
+// Like 'Concurrent()' except at most 'max_concurrency' values are
+// handled at a time, after which we stop asking upstream for more
+// values until one of the fibers finishes. This bounds the number of
+// fibers (and the memory they use) regardless of how fast upstream
+// can produce values.
+template <typename F>
+[[nodiscard]] auto Concurrent(size_t max_concurrency, F f);
+
+// Like 'Concurrent()' except every fiber runs on 'pool' (placed on a
+// CPU per the pool's placement policy each time a fiber is started)
+// so that CPU bound eventuals actually run in parallel. At most
+// 'max_in_flight' fibers run at a time, after which we stop asking
+// upstream for more values until a fiber finishes.
+//
+// Values, failures, stops, and interrupts are otherwise propagated
+// exactly like 'Concurrent()'.
+//
+// NOTE: values are emitted downstream from whichever thread their
+// fiber ran on, so use 'Reschedule()' or 'Schedule()' after this if
+// downstream must run somewhere in particular.
+template <typename F>
+[[nodiscard]] auto ParallelConcurrent(
+    StaticThreadPool& pool,
+    size_t max_in_flight,
+    F f);
+
 ////////////////////////////////////////////////////////////////////////
 
 struct _Concurrent final {
@@ -63,14 +95,14 @@ struct _Concurrent final {
     // continuation is stored in 'Adaptor::Fiber' below because it
     // requires template types.
     //
-    // Each fiber is part of a linked list of fibers that gets pruned
-    // or appended to during runtime as new fibers are needed. We use
-    // a linked list rather than an existing collection because it
-    // nicely matches our algorithm for being able to reuse fibers
-    // that have completed but haven't yet been pruned (see
-    // 'CreateOrReuseFiber()').
+    // Each fiber is part of a linked list of all fibers that gets
+    // appended to during runtime as new fibers are needed. Fibers that
+    // are done are also part of a FIFO "free list" so that we can
+    // usually reuse a fiber in constant time rather than having to
+    // search all fibers for one (see 'CreateOrReuseFiber()').
     struct TypeErasedFiber {
       void Reuse() {
+        CHECK(next_free == nullptr);
         done = false;
         // Need to reinitialize the interrupt so that the
         // previous eventual that registered with this
@@ -81,6 +113,15 @@ struct _Concurrent final {
 
       virtual ~TypeErasedFiber() = default;
 
+      // Returns true if the fiber is done and nothing is still
+      // executing within its context, i.e., it's safe to reuse or
+      // delete. A fiber is marked done from within its own
+      // continuation, which may still be unwinding (possibly on
+      // another thread when using a 'StaticThreadPool').
+      bool Reusable() {
+        return done && (!context || context->borrows() == 0);
+      }
+
       // A fiber indicates it is done with this boolean.
       bool done = false;
 
@@ -91,8 +132,15 @@ struct _Concurrent final {
       // Each fiber forms a linked list of currently created fibers.
       std::unique_ptr<TypeErasedFiber> next;
 
+      // Next fiber in the free list (if this fiber is in it).
+      TypeErasedFiber* next_free = nullptr;
+
       // Need to store a cloned context in which would be stored callback.
       std::optional<Scheduler::Context> context;
+
+      // Where to run when using a 'StaticThreadPool', which must
+      // outlive 'context' since it refers to it.
+      std::optional<StaticThreadPool::Requirements> requirements;
     };
 
     // Returns the fiber created from the templated class 'Adaptor'
@@ -111,16 +159,7 @@ struct _Concurrent final {
     // 'Synchronized()').
     bool FibersDone() {
       CHECK(lock().OwnedByCurrentSchedulerContext());
-      bool done = true;
-      TypeErasedFiber* fiber = fibers_.get();
-      while (fiber != nullptr) {
-        if (!fiber->done) {
-          done = false;
-          break;
-        }
-        fiber = fiber->next.get();
-      }
-      return done;
+      return fibers_in_flight_ == 0;
     }
 
     // Returns true if a fiber had to be interrupted (i.e., not all
@@ -163,54 +202,100 @@ struct _Concurrent final {
         stout::borrowed_ref<
             std::optional<
                 std::variant<Stopped, Errors...>>>&& stopped_or_error) {
-      return Synchronized(Then(
-          [this, stopped_or_error = std::move(stopped_or_error)]() {
+      return Synchronized(
+          Wait([this, stopped_or_error = stopped_or_error.reborrow()](
+                   auto notify) mutable {
+            notify_ingress_ = std::move(notify);
+            return [this, &stopped_or_error]() {
+              // Wait for a fiber to finish if we've reached the most
+              // fibers we can have in flight (unless we're about to
+              // tell upstream we're done anyway).
+              return max_in_flight_ > 0
+                  && fibers_in_flight_ >= max_in_flight_
+                  && !(downstream_done_
+                       || interrupted_ || stopped_or_error->has_value());
+            };
+          })
+          >> Then([this, stopped_or_error = std::move(stopped_or_error)]() {
+            // NOTE: this 'Wait()' is done so it can't be notified.
+            notify_ingress_ = Callback<void()>();
+
             // As long as downstream isn't done, or we've been interrupted,
-            // or have encountered an error, then add a new fiber if none
-            // exist, otherwise trim done fibers from the front, then look
-            // for a done fiber to reuse, or if all fibers are not done add
-            // a new one.
+            // or have encountered an error, then reuse the fiber that has
+            // been done the longest that nothing is still executing
+            // within, otherwise add a new one.
+            //
+            // NOTE: fibers usually become reusable in the order they
+            // were marked done so the first one in the free list is
+            // almost always reusable, but we still skip past any that
+            // are still unwinding rather than creating a new fiber.
             TypeErasedFiber* fiber = nullptr;
 
             if (!(downstream_done_
                   || interrupted_ || stopped_or_error->has_value())) {
-              do {
-                if (!fibers_) {
-                  fibers_.reset(CreateFiber());
-                  fiber = fibers_.get();
-                } else if (fibers_->done) {
-                  // Need to release next before we reset so it
-                  // doesn't get deallocated as part of reset.
-                  fibers_.reset(fibers_->next.release());
+              TypeErasedFiber* previous = nullptr;
+              fiber = free_;
+              while (fiber != nullptr && !fiber->Reusable()) {
+                previous = fiber;
+                fiber = fiber->next_free;
+              }
+
+              if (fiber != nullptr) {
+                if (previous == nullptr) {
+                  free_ = fiber->next_free;
+                } else {
+                  previous->next_free = fiber->next_free;
+                }
+                if (free_tail_ == fiber) {
+                  free_tail_ = previous;
+                }
+                fiber->next_free = nullptr;
+                fiber->Reuse();
+              } else {
+                fiber = CreateFiber();
+                if (fibers_tail_ == nullptr) {
+                  fibers_.reset(fiber);
                 } else {
-                  fiber = fibers_.get();
-                  CHECK_NOTNULL(fiber);
-                  for (;;) {
-                    if (fiber->done) {
-                      fiber->Reuse();
-                      break;
-                    } else if (!fiber->next) {
-                      fiber->next.reset(CreateFiber());
-                      fiber = fiber->next.get();
-                      break;
-                    } else {
-                      fiber = fiber->next.get();
-                    }
-                  }
-                  CHECK_NOTNULL(fiber);
+                  fibers_tail_->next.reset(fiber);
                 }
-              } while (fiber == nullptr);
+                fibers_tail_ = fiber;
+              }
 
               CHECK_NOTNULL(fiber);
 
               // Mark fibers not done since we're starting one.
               fibers_done_ = false;
+
+              fibers_in_flight_++;
             }
 
             return fiber;
           }));
     }
 
+    // Marks 'fiber' as done and adds it to the free list, notifying
+    // ingress in case it is waiting for a fiber to finish.
+    //
+    // NOTE: expects to be called while holding the lock associated
+    // with this instance (i.e., to be called from within
+    // 'Synchronized()').
+    void FiberDone(TypeErasedFiber* fiber) {
+      CHECK(lock().OwnedByCurrentSchedulerContext());
+      CHECK(!fiber->done);
+      fiber->done = true;
+      CHECK_GT(fibers_in_flight_, 0u);
+      fibers_in_flight_--;
+      if (free_tail_ == nullptr) {
+        free_ = fiber;
+      } else {
+        free_tail_->next_free = fiber;
+      }
+      free_tail_ = fiber;
+      if (notify_ingress_) {
+        notify_ingress_();
+      }
+    }
+
     // Returns an eventual to handle when the upstream stream has
     // ended. At this point we may still have fibers that are not
     // completed but we know that we won't be getting any more values
@@ -290,7 +375,7 @@ struct _Concurrent final {
           Eventual<void>()
               .context(std::move(stopped_or_error))
               .start([this, fiber](auto& /* stopped_or_error */, auto& k) {
-                fiber->done = true;
+                FiberDone(fiber);
 
                 fibers_done_ = FibersDone();
 
@@ -305,7 +390,7 @@ struct _Concurrent final {
                         auto& stopped_or_error,
                         auto& k,
                         auto&& error) {
-                fiber->done = true;
+                FiberDone(fiber);
 
                 if (!stopped_or_error->has_value()) {
                   stopped_or_error->emplace(
@@ -322,7 +407,7 @@ struct _Concurrent final {
                 k.Start(); // Exits the synchronized block!
               })
               .stop([this, fiber](auto& stopped_or_error, auto& k) {
-                fiber->done = true;
+                FiberDone(fiber);
 
                 if (!stopped_or_error->has_value()) {
                   stopped_or_error->emplace(eventuals::Stopped());
@@ -350,6 +435,10 @@ struct _Concurrent final {
 
                fibers_done_ = !InterruptFibers();
 
+               if (notify_ingress_) {
+                 notify_ingress_();
+               }
+
                if (upstream_done_ && fibers_done_) {
                  notify_egress_();
                  notify_done_();
@@ -411,6 +500,10 @@ struct _Concurrent final {
 
                fibers_done_ = !InterruptFibers();
 
+               if (notify_ingress_) {
+                 notify_ingress_();
+               }
+
                if (upstream_done_ && fibers_done_) {
                  notify_done_();
                }
@@ -435,8 +528,26 @@ struct _Concurrent final {
           >> Terminal();
     }
 
-    // Head of linked list of fibers.
+    // Head and tail of linked list of fibers.
     std::unique_ptr<TypeErasedFiber> fibers_;
+    TypeErasedFiber* fibers_tail_ = nullptr;
+
+    // Head and tail of the free list of fibers that are done.
+    TypeErasedFiber* free_ = nullptr;
+    TypeErasedFiber* free_tail_ = nullptr;
+
+    // Pool to run fibers on, or nullptr to use the default scheduler.
+    StaticThreadPool* pool_ = nullptr;
+
+    // Most fibers that may be in flight at a time, or 0 for no limit.
+    size_t max_in_flight_ = 0;
+
+    // Number of fibers that have been started but are not done.
+    size_t fibers_in_flight_ = 0;
+
+    // Callback associated with waiting for a fiber to finish when we
+    // have 'max_in_flight_' fibers in flight.
+    Callback<void()> notify_ingress_;
 
     // Callback associated with waiting for "egress", i.e., values
     // from each fiber.
@@ -517,8 +628,22 @@ struct _Concurrent final {
 
       // TODO(benh): differentiate the names of the fibers for
       // easier debugging!
-      fiber->context.emplace(
-          Scheduler::Context::Get()->name() + " [concurrent fiber]");
+      std::string name =
+          Scheduler::Context::Get()->name() + " [concurrent fiber]";
+
+      if (pool_ != nullptr) {
+        // NOTE: placing the fiber every time it's started (rather than
+        // once when it's created) so that reused fibers get spread
+        // across the pool based on the current load.
+        fiber->context.reset();
+        fiber->requirements.emplace(name, pool_->Place());
+        fiber->context.emplace(
+            pool_,
+            std::move(name),
+            &fiber->requirements.value());
+      } else {
+        fiber->context.emplace(std::move(name));
+      }
 
       fiber->context->scheduler()->Submit(
           [fiber]() {
@@ -637,16 +762,22 @@ struct _Concurrent final {
   template <typename K_, typename F_, typename Arg_, typename Errors_>
   struct Continuation final : public TypeErasedStream {
     // NOTE: explicit constructor because inheriting 'TypeErasedStream'.
-    Continuation(K_ k, F_ f)
+    Continuation(K_ k, F_ f, StaticThreadPool* pool, size_t max_in_flight)
       : adaptor_(std::move(f), stopped_or_error_.Borrow()),
-        k_(std::move(k)) {}
+        k_(std::move(k)) {
+      adaptor_.pool_ = pool;
+      adaptor_.max_in_flight_ = max_in_flight;
+    }
 
     // NOTE: explicit move-constructor because of 'std::atomic_flag'.
     Continuation(Continuation&& that) noexcept
       : adaptor_(std::move(that.adaptor_.f_), stopped_or_error_.Borrow()),
         interrupt_(std::move(that.interrupt_)),
         handler_(std::move(that.handler_)),
-        k_(std::move(that.k_)) {}
+        k_(std::move(that.k_)) {
+      adaptor_.pool_ = that.adaptor_.pool_;
+      adaptor_.max_in_flight_ = that.adaptor_.max_in_flight_;
+    }
 
     ~Continuation() override = default;
 
@@ -821,7 +952,7 @@ struct _Concurrent final {
           K,
           F_,
           Arg,
-          Errors>(std::move(k), std::move(f_));
+          Errors>(std::move(k), std::move(f_), pool_, max_in_flight_);
     }
 
     template <typename Downstream>
@@ -830,6 +961,9 @@ struct _Concurrent final {
     using Expects = StreamOfValues;
 
     F_ f_;
+
+    StaticThreadPool* pool_ = nullptr;
+    size_t max_in_flight_ = 0;
   };
 };
 
@@ -846,6 +980,35 @@ template <typename F>
 
 ////////////////////////////////////////////////////////////////////////
 
+template <typename F>
+[[nodiscard]] auto Concurrent(size_t max_concurrency, F f) {
+  static_assert(
+      std::is_invocable_v<F>,
+      "Concurrent expects callable that takes no arguments");
+
+  CHECK_GT(max_concurrency, 0u) << "'max_concurrency' must be positive";
+
+  return _Concurrent::Composable<F>{std::move(f), nullptr, max_concurrency};
+}
+
+////////////////////////////////////////////////////////////////////////
+
+template <typename F>
+[[nodiscard]] auto ParallelConcurrent(
+    StaticThreadPool& pool,
+    size_t max_in_flight,
+    F f) {
+  static_assert(
+      std::is_invocable_v<F>,
+      "ParallelConcurrent expects callable that takes no arguments");
+
+  CHECK_GT(max_in_flight, 0u) << "'max_in_flight' must be positive";
+
+  return _Concurrent::Composable<F>{std::move(f), &pool, max_in_flight};
+}
+
+////////////////////////////////////////////////////////////////////////
+
 } // namespace eventuals
 
 ////////////////////////////////////////////////////////////////////////
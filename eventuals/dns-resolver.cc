@@ -0,0 +1,720 @@
+#include "eventuals/dns-resolver.h"
+
+#include <algorithm>
+#include <cctype> // For 'std::tolower'.
+#include <cstring> // For 'std::memcpy'.
+#include <limits>
+#include <random>
+
+#include "glog/logging.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+// See RFC 1035 and RFC 3596 for the details of the DNS wire format.
+static constexpr uint16_t DNS_TYPE_A = 1;
+static constexpr uint16_t DNS_TYPE_AAAA = 28;
+static constexpr uint16_t DNS_CLASS_IN = 1;
+static constexpr uint16_t DNS_FLAG_RESPONSE = 0x8000;
+static constexpr uint16_t DNS_FLAG_AUTHORITATIVE = 0x0400;
+static constexpr uint16_t DNS_FLAG_RECURSION_DESIRED = 0x0100;
+static constexpr uint16_t DNS_FLAG_RECURSION_AVAILABLE = 0x0080;
+static constexpr uint16_t DNS_RCODE_MASK = 0x000F;
+static constexpr uint16_t DNS_RCODE_NXDOMAIN = 3;
+static constexpr size_t DNS_HEADER_SIZE = 12;
+
+////////////////////////////////////////////////////////////////////////
+
+static void AppendUint16(std::string& packet, uint16_t value) {
+  packet.push_back(static_cast<char>(value >> 8));
+  packet.push_back(static_cast<char>(value & 0xFF));
+}
+
+////////////////////////////////////////////////////////////////////////
+
+static uint16_t ReadUint16(const unsigned char* data) {
+  return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+static uint32_t ReadUint32(const unsigned char* data) {
+  return (uint32_t(data[0]) << 24)
+      | (uint32_t(data[1]) << 16)
+      | (uint32_t(data[2]) << 8)
+      | uint32_t(data[3]);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns a query for 'type' records of 'name', or nothing if 'name'
+// isn't a valid domain name.
+static std::optional<std::string> EncodeQuery(
+    uint16_t id,
+    const std::string& name,
+    uint16_t type) {
+  std::string packet;
+
+  AppendUint16(packet, id);
+  AppendUint16(packet, DNS_FLAG_RECURSION_DESIRED);
+  AppendUint16(packet, 1); // Questions.
+  AppendUint16(packet, 0); // Answers.
+  AppendUint16(packet, 0); // Authorities.
+  AppendUint16(packet, 0); // Additionals.
+
+  // Encode the name as a sequence of length prefixed labels, ignoring
+  // a trailing '.' if the name is fully qualified.
+  size_t start = 0;
+  while (start < name.size()) {
+    size_t end = name.find('.', start);
+    if (end == std::string::npos) {
+      end = name.size();
+    }
+
+    size_t length = end - start;
+    if (length == 0 || length > 63) {
+      return std::nullopt;
+    }
+
+    packet.push_back(static_cast<char>(length));
+    packet.append(name, start, length);
+
+    start = end + 1;
+  }
+
+  packet.push_back('\0');
+
+  if (packet.size() - DNS_HEADER_SIZE > 255 || name.empty()) {
+    return std::nullopt;
+  }
+
+  AppendUint16(packet, type);
+  AppendUint16(packet, DNS_CLASS_IN);
+
+  return packet;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns the offset just past the (possibly compressed) name that
+// starts at 'offset', or nothing if it's malformed.
+static std::optional<size_t> SkipName(
+    const unsigned char* data,
+    size_t size,
+    size_t offset) {
+  while (offset < size) {
+    unsigned char length = data[offset];
+    if ((length & 0xC0) == 0xC0) {
+      // A pointer to the rest of the name, which ends this name.
+      return offset + 2 <= size ? std::optional<size_t>(offset + 2)
+                                : std::nullopt;
+    } else if (length == 0) {
+      return offset + 1;
+    } else {
+      offset += length + 1;
+    }
+  }
+  return std::nullopt;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns the offset just past the (uncompressed) name that starts at
+// 'offset' if it's 'name' (ignoring case and a trailing '.'), or
+// nothing if it's a different name or malformed.
+static std::optional<size_t> MatchName(
+    const unsigned char* data,
+    size_t size,
+    size_t offset,
+    const std::string& name) {
+  size_t start = 0;
+  while (offset < size) {
+    size_t length = data[offset];
+    if (length == 0) {
+      return start >= name.size() ? std::optional<size_t>(offset + 1)
+                                  : std::nullopt;
+    } else if (length > 63 || offset + 1 + length > size) {
+      return std::nullopt;
+    } else if (start >= name.size()) {
+      return std::nullopt;
+    }
+
+    size_t end = name.find('.', start);
+    if (end == std::string::npos) {
+      end = name.size();
+    }
+
+    if (end - start != length) {
+      return std::nullopt;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+      if (std::tolower(data[offset + 1 + i])
+          != std::tolower(static_cast<unsigned char>(name[start + i]))) {
+        return std::nullopt;
+      }
+    }
+
+    offset += length + 1;
+    start = end + 1;
+  }
+  return std::nullopt;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Storage for the A and AAAA queries of a name sent to a DNS server.
+// Deletes itself once both of its handles have been closed.
+struct DnsResolver::Query final {
+  DnsResolver* resolver = nullptr;
+  std::string name;
+
+  uv_udp_t udp = {};
+  uv_timer_t timer = {};
+
+  // Number of handles that still need to be closed.
+  int handles = 0;
+
+  // The A and AAAA queries respectively.
+  std::string packets[2];
+  uv_udp_send_t sends[2] = {};
+  uint16_t ids[2] = {0, 0};
+  bool answered[2] = {false, false};
+
+  // What each query was answered with: any addresses, whether the
+  // name doesn't exist, or why it failed otherwise (e.g., SERVFAIL).
+  // The lookup only fails if neither query has any addresses since
+  // it's common for a server to fail one of them, e.g., AAAA queries
+  // on IPv4 only resolvers.
+  std::vector<std::string> addresses[2];
+  bool nxdomain[2] = {false, false};
+  std::optional<std::string> failures[2];
+
+  uint32_t ttl = std::numeric_limits<uint32_t>::max();
+
+  // Set if we stopped waiting for answers, e.g., because of a timeout
+  // or a socket error.
+  std::optional<std::string> error;
+
+  bool completed = false;
+
+  char buffer[4096];
+
+  // Parses a response, returning false if it's not for this query.
+  bool Parse(const unsigned char* data, size_t size);
+
+  // Completes the lookup (if it hasn't been already) and closes the
+  // handles.
+  void Complete();
+};
+
+////////////////////////////////////////////////////////////////////////
+
+bool DnsResolver::Query::Parse(const unsigned char* data, size_t size) {
+  if (size < DNS_HEADER_SIZE) {
+    return false;
+  }
+
+  uint16_t id = ReadUint16(data);
+  uint16_t flags = ReadUint16(data + 2);
+
+  if ((flags & DNS_FLAG_RESPONSE) == 0) {
+    return false;
+  }
+
+  size_t index = 0;
+  if (id == ids[0] && !answered[0]) {
+    index = 0;
+  } else if (id == ids[1] && !answered[1]) {
+    index = 1;
+  } else {
+    return false;
+  }
+
+  uint16_t questions = ReadUint16(data + 4);
+  uint16_t answers = ReadUint16(data + 6);
+
+  // The (first) question must be for our name, which also makes sure
+  // that an NXDOMAIN is about our name.
+  auto matched = questions > 0
+      ? MatchName(data, size, DNS_HEADER_SIZE, name)
+      : std::nullopt;
+
+  if (!matched.has_value() || *matched + 4 > size) {
+    return false;
+  }
+
+  answered[index] = true;
+
+  uint16_t rcode = flags & DNS_RCODE_MASK;
+
+  if (rcode == DNS_RCODE_NXDOMAIN) {
+    // NOTE: the name only doesn't exist if the server is authoritative
+    // for it or is a recursive resolver that asked a server that is,
+    // otherwise we treat it like any other failure.
+    if (flags & (DNS_FLAG_AUTHORITATIVE | DNS_FLAG_RECURSION_AVAILABLE)) {
+      nxdomain[index] = true;
+    } else {
+      failures[index] = uv_err_name(UV_EAI_FAIL);
+    }
+    return true;
+  } else if (rcode != 0) {
+    failures[index] = uv_err_name(UV_EAI_FAIL);
+    return true;
+  }
+
+  size_t offset = *matched + 4; // Type and class.
+
+  for (uint16_t i = 1; i < questions; i++) {
+    auto skipped = SkipName(data, size, offset);
+    if (!skipped.has_value() || *skipped + 4 > size) {
+      failures[index] = uv_err_name(UV_EAI_FAIL);
+      return true;
+    }
+    offset = *skipped + 4; // Type and class.
+  }
+
+  for (uint16_t i = 0; i < answers; i++) {
+    auto skipped = SkipName(data, size, offset);
+    if (!skipped.has_value() || *skipped + 10 > size) {
+      failures[index] = uv_err_name(UV_EAI_FAIL);
+      return true;
+    }
+
+    offset = *skipped;
+
+    uint16_t type = ReadUint16(data + offset);
+    uint16_t klass = ReadUint16(data + offset + 2);
+    uint32_t record_ttl = ReadUint32(data + offset + 4);
+    uint16_t length = ReadUint16(data + offset + 8);
+
+    offset += 10;
+
+    if (offset + length > size) {
+      failures[index] = uv_err_name(UV_EAI_FAIL);
+      return true;
+    }
+
+    // NOTE: other records (e.g., CNAMEs) are skipped, any addresses
+    // of the canonical name are included in the answers too.
+    if (klass == DNS_CLASS_IN
+        && ((type == DNS_TYPE_A && length == 4)
+            || (type == DNS_TYPE_AAAA && length == 16))) {
+      char ip[64] = {'\0'};
+      int af = type == DNS_TYPE_A ? AF_INET : AF_INET6;
+      if (uv_inet_ntop(af, data + offset, ip, sizeof(ip)) == 0) {
+        addresses[type == DNS_TYPE_A ? 0 : 1].emplace_back(ip);
+        ttl = std::min(ttl, record_ttl);
+      }
+    }
+
+    offset += length;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void DnsResolver::Query::Complete() {
+  if (completed) {
+    return;
+  }
+
+  completed = true;
+
+  uv_udp_recv_stop(&udp);
+  uv_timer_stop(&timer);
+
+  Result result;
+
+  // NOTE: using the answer to one query even if the other one failed
+  // or we stopped waiting for it.
+  for (size_t i = 0; i < 2; i++) {
+    if (failures[i].has_value() || nxdomain[i]) {
+      addresses[i].clear();
+    }
+
+    result.addresses.insert(
+        result.addresses.end(),
+        addresses[i].begin(),
+        addresses[i].end());
+  }
+
+  if (result.addresses.empty()) {
+    if (error.has_value()) {
+      result.error = std::move(error);
+    } else if (nxdomain[0] || nxdomain[1]) {
+      result.error = uv_err_name(UV_EAI_NONAME);
+    } else if (failures[0].has_value()) {
+      result.error = std::move(failures[0]);
+    } else if (failures[1].has_value()) {
+      result.error = std::move(failures[1]);
+    } else {
+      // Neither query had any addresses.
+      result.error = uv_err_name(UV_EAI_NONAME);
+    }
+  }
+
+  resolver->Complete(
+      name,
+      std::move(result),
+      std::chrono::seconds(
+          ttl == std::numeric_limits<uint32_t>::max() ? 0 : ttl));
+
+  auto close = [](uv_handle_t* handle) {
+    auto* query = static_cast<Query*>(handle->data);
+    if (--query->handles == 0) {
+      delete query;
+    }
+  };
+
+  uv_close(reinterpret_cast<uv_handle_t*>(&udp), close);
+  uv_close(reinterpret_cast<uv_handle_t*>(&timer), close);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+DnsResolver::DnsResolver(EventLoop& loop)
+  : DnsResolver(loop, Options()) {}
+
+////////////////////////////////////////////////////////////////////////
+
+DnsResolver::DnsResolver(EventLoop& loop, const Options& options)
+  : loop_(loop),
+    options_(options),
+    id_(static_cast<uint16_t>(std::random_device()())) {}
+
+////////////////////////////////////////////////////////////////////////
+
+DnsResolver::~DnsResolver() {
+  CHECK(lookups_.empty()) << "destructing with outstanding lookups";
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void DnsResolver::Lookup(const std::string& name, Waiter* waiter) {
+  CHECK(loop_.InThisEventLoop());
+
+  auto entry = cache_.find(name);
+  if (entry != cache_.end()) {
+    if (entry->second.expires > loop_.clock().Now()) {
+      statistics_.hits++;
+      waiter->callback(Result{entry->second.addresses});
+      return;
+    } else {
+      cache_.erase(entry);
+    }
+  }
+
+  auto lookup = lookups_.find(name);
+  if (lookup != lookups_.end()) {
+    statistics_.coalesced++;
+    lookup->second.push_back(waiter);
+    return;
+  }
+
+  statistics_.misses++;
+
+  lookups_[name].push_back(waiter);
+
+  if (options_.server.has_value()) {
+    Send(name);
+  } else {
+    GetAddrInfo(name);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void DnsResolver::Cancel(const std::string& name, Waiter* waiter) {
+  CHECK(loop_.InThisEventLoop());
+
+  auto lookup = lookups_.find(name);
+  CHECK(lookup != lookups_.end());
+
+  auto& waiters = lookup->second;
+
+  auto it = std::find(waiters.begin(), waiters.end(), waiter);
+  CHECK(it != waiters.end());
+
+  // NOTE: keeping the lookup even if nobody is waiting for it anymore
+  // since it's still outstanding and 'Complete()' expects it.
+  waiters.erase(it);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void DnsResolver::GetAddrInfo(const std::string& name) {
+  struct Request {
+    DnsResolver* resolver;
+    std::string name;
+    uv_getaddrinfo_t request;
+  };
+
+  auto* request = new Request{this, name};
+  request->request.data = request;
+
+  // NOTE: only asking for TCP so we get each address once rather than
+  // once for each type of socket.
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+
+  int error = uv_getaddrinfo(
+      loop_,
+      &request->request,
+      [](uv_getaddrinfo_t* r, int status, addrinfo* addrinfo) {
+        std::unique_ptr<Request> request(static_cast<Request*>(r->data));
+
+        Result result;
+
+        if (status < 0) {
+          result.error = uv_err_name(status);
+        } else {
+          std::vector<std::string> addresses[2];
+
+          for (auto* info = addrinfo; info != nullptr; info = info->ai_next) {
+            char ip[64] = {'\0'};
+            if (info->ai_family == AF_INET) {
+              uv_ip4_name(
+                  reinterpret_cast<sockaddr_in*>(info->ai_addr),
+                  ip,
+                  sizeof(ip));
+              addresses[0].emplace_back(ip);
+            } else if (info->ai_family == AF_INET6) {
+              uv_ip6_name(
+                  reinterpret_cast<sockaddr_in6*>(info->ai_addr),
+                  ip,
+                  sizeof(ip));
+              addresses[1].emplace_back(ip);
+            }
+          }
+
+          uv_freeaddrinfo(addrinfo);
+
+          for (auto& addresses : addresses) {
+            for (auto& address : addresses) {
+              if (std::find(
+                      result.addresses.begin(),
+                      result.addresses.end(),
+                      address)
+                  == result.addresses.end()) {
+                result.addresses.push_back(std::move(address));
+              }
+            }
+          }
+        }
+
+        request->resolver->Complete(
+            request->name,
+            std::move(result),
+            request->resolver->options_.ttl);
+      },
+      request->name.c_str(),
+      nullptr,
+      &hints);
+
+  if (error) {
+    delete request;
+    Complete(name, Result{{}, uv_err_name(error)}, std::chrono::seconds(0));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void DnsResolver::Send(const std::string& name) {
+  // Names that are already addresses don't need to be resolved.
+  unsigned char address[16];
+  if (uv_inet_pton(AF_INET, name.c_str(), address) == 0
+      || uv_inet_pton(AF_INET6, name.c_str(), address) == 0) {
+    Complete(name, Result{{name}}, options_.max_ttl);
+    return;
+  }
+
+  sockaddr_storage server = {};
+  sockaddr_storage any = {};
+  if (uv_ip4_addr(
+          options_.server->c_str(),
+          options_.port,
+          reinterpret_cast<sockaddr_in*>(&server))
+          != 0
+      && uv_ip6_addr(
+             options_.server->c_str(),
+             options_.port,
+             reinterpret_cast<sockaddr_in6*>(&server))
+          != 0) {
+    Complete(
+        name,
+        Result{{}, "Invalid DNS server address '" + *options_.server + "'"},
+        std::chrono::seconds(0));
+    return;
+  }
+
+  // NOTE: we need to bind to the wildcard address of the same family
+  // as the server otherwise libuv binds to the IPv4 one and we'd never
+  // be able to talk to an IPv6 server.
+  if (server.ss_family == AF_INET6) {
+    CHECK_EQ(
+        uv_ip6_addr("::", 0, reinterpret_cast<sockaddr_in6*>(&any)),
+        0);
+  } else {
+    CHECK_EQ(
+        uv_ip4_addr("0.0.0.0", 0, reinterpret_cast<sockaddr_in*>(&any)),
+        0);
+  }
+
+  auto* query = new Query();
+  query->resolver = this;
+  query->name = name;
+
+  const uint16_t types[2] = {DNS_TYPE_A, DNS_TYPE_AAAA};
+
+  for (size_t i = 0; i < 2; i++) {
+    query->ids[i] = id_++;
+    auto packet = EncodeQuery(query->ids[i], name, types[i]);
+    if (!packet.has_value()) {
+      delete query;
+      Complete(
+          name,
+          Result{{}, uv_err_name(UV_EAI_NONAME)},
+          std::chrono::seconds(0));
+      return;
+    }
+    query->packets[i] = std::move(*packet);
+  }
+
+  CHECK_EQ(uv_udp_init(loop_, &query->udp), 0);
+  CHECK_EQ(uv_timer_init(loop_, &query->timer), 0);
+
+  query->handles = 2;
+  query->udp.data = query;
+  query->timer.data = query;
+
+  // NOTE: from here on out 'Complete()' must be called on 'query'
+  // which closes the handles and eventually deletes it.
+
+  int error = uv_udp_bind(
+      &query->udp,
+      reinterpret_cast<const sockaddr*>(&any),
+      0);
+
+  if (error == 0) {
+    error = uv_udp_recv_start(
+        &query->udp,
+        [](uv_handle_t* handle, size_t, uv_buf_t* buffer) {
+          auto* query = static_cast<Query*>(handle->data);
+          *buffer = uv_buf_init(query->buffer, sizeof(query->buffer));
+        },
+        [](uv_udp_t* udp,
+           ssize_t nread,
+           const uv_buf_t* buffer,
+           const sockaddr* addr,
+           unsigned flags) {
+          auto* query = static_cast<Query*>(udp->data);
+          if (nread < 0) {
+            query->error = uv_err_name(nread);
+            query->Complete();
+          } else if (nread > 0 && !query->completed) {
+            // NOTE: ignoring anything that's not a response to one of
+            // our queries.
+            query->Parse(
+                reinterpret_cast<const unsigned char*>(buffer->base),
+                nread);
+
+            if (query->answered[0] && query->answered[1]) {
+              query->Complete();
+            }
+          }
+        });
+  }
+
+  for (size_t i = 0; error == 0 && i < 2; i++) {
+    uv_buf_t buffer = uv_buf_init(
+        query->packets[i].data(),
+        query->packets[i].size());
+
+    error = uv_udp_send(
+        &query->sends[i],
+        &query->udp,
+        &buffer,
+        1,
+        reinterpret_cast<const sockaddr*>(&server),
+        [](uv_udp_send_t* send, int status) {
+          auto* query = static_cast<Query*>(send->handle->data);
+          if (status < 0 && status != UV_ECANCELED) {
+            query->error = uv_err_name(status);
+            query->Complete();
+          }
+        });
+  }
+
+  if (error == 0) {
+    error = uv_timer_start(
+        &query->timer,
+        [](uv_timer_t* timer) {
+          auto* query = static_cast<Query*>(timer->data);
+          query->error = uv_err_name(UV_EAI_AGAIN);
+          query->Complete();
+        },
+        options_.timeout.count(),
+        0);
+  }
+
+  if (error != 0) {
+    query->error = uv_err_name(error);
+    query->Complete();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void DnsResolver::Complete(
+    const std::string& name,
+    Result&& result,
+    std::chrono::seconds ttl) {
+  ttl = std::min(ttl, options_.max_ttl);
+
+  if (!result.error.has_value() && ttl.count() > 0) {
+    auto now = loop_.clock().Now();
+
+    // Erase any expired entries whenever the cache reaches 'sweep_'
+    // entries so that names that are never looked up again don't
+    // accumulate. Growing 'sweep_' to twice the entries that are left
+    // keeps this amortized constant time for each insert.
+    if (cache_.size() >= sweep_) {
+      for (auto entry = cache_.begin(); entry != cache_.end();) {
+        if (entry->second.expires <= now) {
+          entry = cache_.erase(entry);
+        } else {
+          ++entry;
+        }
+      }
+      sweep_ = std::max(sweep_, 2 * cache_.size());
+    }
+
+    cache_[name] = Entry{result.addresses, now + ttl};
+  }
+
+  // NOTE: removing the waiters before invoking them since they might
+  // lookup the same name again.
+  auto lookup = lookups_.find(name);
+  CHECK(lookup != lookups_.end());
+
+  std::vector<Waiter*> waiters = std::move(lookup->second);
+  lookups_.erase(lookup);
+
+  for (Waiter* waiter : waiters) {
+    waiter->callback(result);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -1,7 +1,22 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef> // For 'size_t'.
+#include <cstdint> // For 'uint16_t'.
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "eventuals/callback.h"
 #include "eventuals/event-loop.h"
 #include "eventuals/eventual.h"
+#include "eventuals/interrupt.h"
+#include "eventuals/scheduler.h"
+#include "eventuals/type-traits.h"
+#include "stout/borrowable.h"
 
 ////////////////////////////////////////////////////////////////////////
 
@@ -12,7 +27,7 @@ namespace eventuals {
 [[nodiscard]] inline auto DomainNameResolve(
     const std::string& address,
     const std::string& port,
-    EventLoop& loop = EventLoop::Default()) {
+    EventLoop& loop = EventLoop::Current()) {
   struct Data {
     EventLoop& loop;
     std::string address;
@@ -76,6 +91,353 @@ namespace eventuals {
 
 ////////////////////////////////////////////////////////////////////////
 
+// Resolves names to _all_ of their IPv4 and IPv6 addresses, caching
+// the results so that repeatedly connecting to the same host doesn't
+// keep resolving it, and coalescing concurrent lookups of the same
+// name into a single lookup.
+//
+// By default lookups use 'getaddrinfo()' on libuv's threadpool, which
+// doesn't tell us how long the results are valid for, so results are
+// cached for 'Options::ttl'. Alternatively, if 'Options::server' is
+// set then A and AAAA queries are sent directly to that DNS server
+// (e.g., a caching resolver running on the local host) over UDP from
+// the event loop, bypassing the threadpool entirely, and results are
+// cached for as long as the TTLs of the answers (up to
+// 'Options::max_ttl'). Such a lookup only fails if neither the A nor
+// the AAAA query results in any addresses.
+//
+// Expiry is based on the event loop's clock, so it respects pausing
+// and advancing the clock in tests. Expired results are erased the
+// next time their name is looked up, or when the cache grows enough
+// that it gets swept, so names that are never looked up again don't
+// accumulate.
+//
+// Interrupting 'Resolve()' stops waiting for the result, but the
+// lookup itself keeps going so that the result can still be cached
+// (and other lookups of the same name aren't affected).
+//
+// NOTE: 'Options::timeout' is measured with a libuv timer rather than
+// the event loop's clock, so it is _not_ affected by pausing or
+// advancing the clock.
+//
+// NOTE: not thread-safe, must only be used from (eventuals scheduled
+// on) its event loop, and must not be destructed while there are any
+// outstanding lookups, including those whose 'Resolve()' has been
+// interrupted.
+class DnsResolver final {
+ public:
+  struct Options final {
+    // How long to cache results from 'getaddrinfo()'.
+    std::chrono::seconds ttl = std::chrono::seconds(60);
+
+    // Most amount of time to cache any result, regardless of its TTL.
+    std::chrono::seconds max_ttl = std::chrono::seconds(300);
+
+    // Address (IPv4 or IPv6) of a DNS server to send queries to over
+    // UDP instead of using 'getaddrinfo()'.
+    std::optional<std::string> server;
+    int port = 53;
+
+    // How long to wait for the DNS server to answer.
+    std::chrono::milliseconds timeout = std::chrono::milliseconds(2000);
+  };
+
+  // Counters to help determine how effective the cache is.
+  struct Statistics {
+    // Lookups answered from the cache.
+    size_t hits = 0;
+
+    // Lookups that required resolving the name.
+    size_t misses = 0;
+
+    // Lookups that waited for an outstanding lookup of the same name.
+    size_t coalesced = 0;
+  };
+
+  explicit DnsResolver(EventLoop& loop);
+
+  DnsResolver(EventLoop& loop, const Options& options);
+
+  DnsResolver(const DnsResolver&) = delete;
+  DnsResolver(DnsResolver&&) = delete;
+
+  ~DnsResolver();
+
+  // Returns every IPv4 address followed by every IPv6 address of
+  // 'name' formatted as strings.
+  [[nodiscard]] auto Resolve(const std::string& name);
+
+  // Forgets all cached results.
+  void Clear() {
+    cache_.clear();
+  }
+
+  // Number of cached results, including any that have expired but
+  // haven't been erased yet.
+  size_t size() const {
+    return cache_.size();
+  }
+
+  const Statistics& statistics() const {
+    return statistics_;
+  }
+
+  EventLoop& loop() {
+    return loop_;
+  }
+
+ private:
+  // Outcome of resolving a name.
+  struct Result final {
+    std::vector<std::string> addresses;
+    std::optional<std::string> error;
+  };
+
+  // Storage for someone waiting on the result of resolving a name,
+  // which must remain valid until 'callback' is invoked.
+  struct Waiter final {
+    Callback<void(const Result&)> callback;
+  };
+
+  struct Entry final {
+    std::vector<std::string> addresses;
+    std::chrono::nanoseconds expires;
+  };
+
+  struct Query;
+
+  struct _Resolve final {
+    template <typename K_>
+    struct Continuation final
+      : public stout::enable_borrowable_from_this<Continuation<K_>> {
+      Continuation(K_ k, DnsResolver& resolver, std::string&& name)
+        : resolver_(resolver),
+          name_(std::move(name)),
+          context_(&resolver.loop(), "DnsResolver::Resolve (start/fail/stop)"),
+          interrupt_context_(
+              &resolver.loop(),
+              "DnsResolver::Resolve (interrupt)"),
+          k_(std::move(k)) {}
+
+      Continuation(Continuation&& that) noexcept
+        : resolver_(that.resolver_),
+          name_(std::move(that.name_)),
+          context_(
+              &that.resolver_.loop(),
+              "DnsResolver::Resolve (start/fail/stop)"),
+          interrupt_context_(
+              &that.resolver_.loop(),
+              "DnsResolver::Resolve (interrupt)"),
+          k_(std::move(that.k_)) {
+        CHECK(!that.started_ || !that.completed_) << "moving after starting";
+        CHECK(!handler_);
+      }
+
+      ~Continuation() {
+        CHECK(!started_ || completed_);
+
+        // NOTE: we need to destruct any possible handler because it
+        // has a borrow that needs to be relinquished.
+        handler_.reset();
+
+        this->WaitUntilBorrowsEquals(0);
+      }
+
+      void Start() {
+        if (handler_.has_value() && !handler_->Install()) {
+          // Interrupt has already been triggered.
+          loop().Submit(
+              this->Borrow([this]() {
+                if (!completed_) {
+                  completed_ = true;
+                  k_.Stop();
+                }
+              }),
+              context_);
+        } else {
+          loop().Submit(
+              this->Borrow([this]() {
+                if (!completed_) {
+                  CHECK(!started_);
+                  started_ = true;
+
+                  waiter_.callback = [this](const Result& result) {
+                    CHECK(!completed_);
+                    completed_ = true;
+                    if (result.error.has_value()) {
+                      k_.Fail(RuntimeError(*result.error));
+                    } else {
+                      k_.Start(std::vector<std::string>(result.addresses));
+                    }
+                  };
+
+                  resolver_.Lookup(name_, &waiter_);
+                }
+              }),
+              context_);
+        }
+      }
+
+      template <typename Error>
+      void Fail(Error&& error) {
+        // TODO(benh): avoid allocating on heap by storing args in
+        // pre-allocated buffer based on composing with Errors.
+        using Tuple = std::tuple<decltype(this), Error>;
+        auto tuple = std::make_unique<Tuple>(
+            this,
+            std::forward<Error>(error));
+
+        // Submitting to event loop to avoid race with interrupt.
+        loop().Submit(
+            this->Borrow([tuple = std::move(tuple)]() {
+              std::apply(
+                  [](auto* continuation, auto&&... args) {
+                    if (!continuation->completed_) {
+                      CHECK(!continuation->started_);
+                      continuation->completed_ = true;
+                      auto& k_ = continuation->k_;
+                      k_.Fail(std::forward<decltype(args)>(args)...);
+                    }
+                  },
+                  std::move(*tuple));
+            }),
+            context_);
+      }
+
+      void Stop() {
+        // Submitting to event loop to avoid race with interrupt.
+        loop().Submit(
+            this->Borrow([this]() {
+              if (!completed_) {
+                CHECK(!started_);
+                completed_ = true;
+                k_.Stop();
+              }
+            }),
+            context_);
+      }
+
+      void Register(class Interrupt& interrupt) {
+        k_.Register(interrupt);
+
+        handler_.emplace(&interrupt, [this]() {
+          loop().Submit(
+              this->Borrow([this]() {
+                if (!completed_) {
+                  completed_ = true;
+                  if (started_) {
+                    resolver_.Cancel(name_, &waiter_);
+                  }
+                  k_.Stop();
+                }
+              }),
+              interrupt_context_);
+        });
+      }
+
+     private:
+      EventLoop& loop() {
+        return resolver_.loop();
+      }
+
+      DnsResolver& resolver_;
+      std::string name_;
+
+      Waiter waiter_;
+
+      bool started_ = false;
+      bool completed_ = false;
+
+      // NOTE: we use 'context_' in each of 'Start()', 'Fail()', and
+      // 'Stop()' because only one of them will called at runtime.
+      Scheduler::Context context_;
+      Scheduler::Context interrupt_context_;
+
+      std::optional<Interrupt::Handler> handler_;
+
+      // NOTE: we store 'k_' as the _last_ member so it will be
+      // destructed _first_ and thus we won't have any use-after-delete
+      // issues during destruction of 'k_' if it holds any references or
+      // pointers to any (or within any) of the above members.
+      K_ k_;
+    };
+
+    struct Composable final {
+      template <typename Arg, typename Errors>
+      using ValueFrom = std::vector<std::string>;
+
+      template <typename Arg, typename Errors>
+      using ErrorsFrom = tuple_types_union_t<
+          Errors,
+          std::tuple<RuntimeError>>;
+
+      template <typename Downstream>
+      static constexpr bool CanCompose = Downstream::ExpectsValue;
+
+      using Expects = SingleValue;
+
+      template <typename Arg, typename Errors, typename K>
+      auto k(K k) && {
+        return Continuation<K>(std::move(k), resolver_, std::move(name_));
+      }
+
+      DnsResolver& resolver_;
+      std::string name_;
+    };
+  };
+
+  // Invokes 'waiter' with the result of resolving 'name', either
+  // immediately if it's cached or once it has been resolved.
+  void Lookup(const std::string& name, Waiter* waiter);
+
+  // Stops 'waiter' from being invoked with the result of resolving
+  // 'name', e.g., because it was interrupted. The lookup itself keeps
+  // going so its result can still be cached.
+  void Cancel(const std::string& name, Waiter* waiter);
+
+  // Resolves 'name' via 'getaddrinfo()'.
+  void GetAddrInfo(const std::string& name);
+
+  // Resolves 'name' by querying 'Options::server'.
+  void Send(const std::string& name);
+
+  // Caches the result (if it can be) for at most 'ttl' and invokes
+  // everyone waiting for it.
+  void Complete(
+      const std::string& name,
+      Result&& result,
+      std::chrono::seconds ttl);
+
+  EventLoop& loop_;
+
+  Options options_;
+
+  std::map<std::string, Entry> cache_;
+
+  // Size of 'cache_' at which expired entries are next erased, see
+  // 'Complete()'.
+  size_t sweep_ = 64;
+
+  // Names being resolved and who's waiting for them.
+  std::map<std::string, std::vector<Waiter*>> lookups_;
+
+  // Identifier for the next DNS query.
+  uint16_t id_ = 0;
+
+  Statistics statistics_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+[[nodiscard]] inline auto DnsResolver::Resolve(const std::string& name) {
+  // NOTE: we use a 'RescheduleAfter()' to ensure we use current
+  // scheduling context to invoke the continuation after the name has
+  // been resolved (or the lookup was interrupted).
+  return RescheduleAfter(_Resolve::Composable{*this, name});
+}
+
+////////////////////////////////////////////////////////////////////////
+
 } // namespace eventuals
 
 ////////////////////////////////////////////////////////////////////////
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <memory>
+#include <new>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <variant>
 
+#include "glog/logging.h"
+
 ////////////////////////////////////////////////////////////////////////
 
 namespace eventuals {
@@ -95,6 +102,93 @@ class TypeErasedError final : public Error {
   std::shared_ptr<Error> e_;
 };
 
+// Storage for a single error for continuations that need to hold on
+// to an error while they hop to another scheduler or wait for a lock.
+// It's sized and aligned for the largest of 'Errors_' (a 'std::tuple'
+// of the errors that an eventual may fail with) so that failing with
+// any of them never needs to allocate on the heap. Only an error that
+// doesn't fit, e.g., a larger subtype of one of 'Errors_', gets
+// allocated on the heap.
+template <typename Errors_>
+class ErrorStorage;
+
+template <typename... Errors_>
+class ErrorStorage<std::tuple<Errors_...>> final {
+ public:
+  ErrorStorage() = default;
+
+  // NOTE: continuations are only moved before they are started so
+  // there should never be an error stored when moving.
+  ErrorStorage(ErrorStorage&& that) {
+    CHECK(that.destroy_ == nullptr) << "moving after storing an error";
+  }
+
+  ~ErrorStorage() {
+    if (destroy_ != nullptr) {
+      destroy_(&storage_);
+    }
+  }
+
+  template <typename Error>
+  void Emplace(Error&& error) {
+    CHECK(destroy_ == nullptr) << "already storing an error";
+
+    using E = std::decay_t<Error>;
+
+    if constexpr (Inline<E>) {
+      new (&storage_) E(std::forward<Error>(error));
+
+      destroy_ = [](void* storage) {
+        static_cast<E*>(storage)->~E();
+      };
+    } else {
+      new (&storage_) E*(new E(std::forward<Error>(error)));
+
+      destroy_ = [](void* storage) {
+        delete *static_cast<E**>(storage);
+      };
+    }
+  }
+
+  // Moves out the stored error, which must have been emplaced as an
+  // 'Error', leaving the storage empty so it can be reused.
+  template <typename Error>
+  std::decay_t<Error> Extract() {
+    CHECK(destroy_ != nullptr) << "not storing an error";
+
+    using E = std::decay_t<Error>;
+
+    destroy_ = nullptr;
+
+    if constexpr (Inline<E>) {
+      E* e = std::launder(reinterpret_cast<E*>(&storage_));
+      E error = std::move(*e);
+      e->~E();
+      return error;
+    } else {
+      std::unique_ptr<E> e(*std::launder(reinterpret_cast<E**>(&storage_)));
+      return std::move(*e);
+    }
+  }
+
+ private:
+  static constexpr size_t kSize =
+      std::max({sizeof(void*), sizeof(Errors_)...});
+
+  static constexpr size_t kAlignment =
+      std::max({alignof(void*), alignof(Errors_)...});
+
+  template <typename E>
+  static constexpr bool Inline =
+      sizeof(E) <= kSize && alignof(E) <= kAlignment;
+
+  alignas(kAlignment) std::byte storage_[kSize];
+
+  void (*destroy_)(void*) = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////
+
 template <typename... Errors>
 inline std::string What(const std::variant<Errors...>& error) {
   return std::visit(
@@ -0,0 +1,113 @@
+#include "eventuals/event-loop-group.h"
+
+#include "eventuals/os.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoopGroup::EventLoopGroup()
+  : EventLoopGroup(GetAllowedCPUs()) {}
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoopGroup::EventLoopGroup(unsigned int size)
+  : EventLoopGroup(GetAllowedCPUs(size)) {}
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoopGroup::EventLoopGroup(std::vector<unsigned int> cpus) {
+  CHECK_GT(cpus.size(), 0u) << "a group requires at least one CPU";
+
+  members_.reserve(cpus.size());
+
+  for (unsigned int cpu : cpus) {
+    Member& member = *members_.emplace_back(std::make_unique<Member>());
+
+    member.thread = std::thread([this, &member]() {
+      // NOTE: we construct each loop from its own thread so as to
+      // hopefully get memory local to the CPU.
+      member.loop = std::make_unique<EventLoop>();
+
+      member.ready.Signal();
+
+      // NOTE: 'RunOnce()' blocks waiting for I/O (the loop is always
+      // alive because of its async handle) so we rely on
+      // 'Interrupt()' to wake it up when we're stopping.
+      while (!stopping_.load()) {
+        member.loop->RunOnce();
+      }
+    });
+
+    SetAffinity(member.thread, cpu);
+  }
+
+  for (auto& member : members_) {
+    member->ready.Wait();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoopGroup::~EventLoopGroup() {
+  stopping_.store(true);
+
+  for (auto& member : members_) {
+    member->loop->Interrupt();
+  }
+
+  for (auto& member : members_) {
+    member->thread.join();
+  }
+
+  // NOTE: we destruct the loops only after all threads have stopped
+  // since an eventual running on one loop might reference another.
+  for (auto& member : members_) {
+    member->loop.reset();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoop& EventLoopGroup::LeastLoaded() {
+  size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+
+  Member* least = nullptr;
+
+  for (size_t i = 0; i < members_.size(); i++) {
+    Member& member = *members_[(start + i) % members_.size()];
+    if (least == nullptr
+        || member.load.load(std::memory_order_relaxed)
+            < least->load.load(std::memory_order_relaxed)) {
+      least = &member;
+    }
+  }
+
+  return *least->loop;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+size_t EventLoopGroup::load(EventLoop& loop) {
+  return member(loop).load.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoopGroup::Member& EventLoopGroup::member(EventLoop& loop) {
+  for (auto& member : members_) {
+    if (member->loop.get() == &loop) {
+      return *member;
+    }
+  }
+
+  LOG(FATAL) << "event loop is not part of this group";
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
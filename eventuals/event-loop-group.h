@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <functional> // For 'std::hash'.
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "eventuals/compose.h"
+#include "eventuals/event-loop.h"
+#include "eventuals/semaphore.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+// A group of event loops each run by its own thread pinned to a CPU,
+// for spreading I/O across cores rather than funneling it all through
+// 'EventLoop::Default()'.
+//
+// An operation picks a loop either by key via 'Hashed()' (so that,
+// e.g., everything for the same connection stays on the same loop) or
+// via 'LeastLoaded()', and then runs on it via 'Schedule()'. Since
+// operations that take an optional 'EventLoop&' default to
+// 'EventLoop::Current()', anything composed while running on the
+// chosen loop (e.g., timers, filesystem, DNS, or HTTP returned from a
+// 'Then()' within 'Schedule()') stays on that loop.
+class EventLoopGroup final {
+ public:
+  // Creates a group with a loop for each of the allowed CPUs.
+  EventLoopGroup();
+
+  // Creates a group of 'size' loops, wrapping around the allowed CPUs
+  // if there are not enough of them.
+  explicit EventLoopGroup(unsigned int size);
+
+  // Creates a group with a loop for each CPU in 'cpus'.
+  explicit EventLoopGroup(std::vector<unsigned int> cpus);
+
+  EventLoopGroup(const EventLoopGroup&) = delete;
+  EventLoopGroup(EventLoopGroup&&) = delete;
+
+  ~EventLoopGroup();
+
+  size_t size() const {
+    return members_.size();
+  }
+
+  EventLoop& operator[](size_t i) {
+    return *members_[i]->loop;
+  }
+
+  // Returns the loop for 'key', which is always the same loop for
+  // the same key.
+  template <typename Key>
+  EventLoop& Hashed(const Key& key) {
+    return *members_[std::hash<Key>()(key) % members_.size()]->loop;
+  }
+
+  // Returns the loop with the fewest eventuals currently scheduled on
+  // it via this group, breaking ties round-robin.
+  EventLoop& LeastLoaded();
+
+  // Returns the number of eventuals currently scheduled on 'loop'
+  // via this group.
+  size_t load(EventLoop& loop);
+
+  // Schedules 'e' on the least loaded loop (as of when 'Schedule()'
+  // is called, not when the eventual gets started).
+  template <typename E>
+  [[nodiscard]] auto Schedule(E e) {
+    return Schedule(LeastLoaded(), std::move(e));
+  }
+
+  // Schedules 'e' on 'loop' which must be one of this group's loops,
+  // e.g., as returned from 'Hashed()'.
+  template <typename E>
+  [[nodiscard]] auto Schedule(EventLoop& loop, E e) {
+    std::atomic<size_t>& load = member(loop).load;
+    return _Load::Composable{&load, size_t(1)}
+        >> loop.Schedule(std::move(e))
+        >> _Load::Composable{&load, size_t(-1)};
+  }
+
+ private:
+  // Adjusts a member's load as an eventual passes through.
+  struct _Load final {
+    template <typename K_>
+    struct Continuation final {
+      template <typename... Args>
+      void Start(Args&&... args) {
+        load_->fetch_add(delta_, std::memory_order_relaxed);
+        k_.Start(std::forward<Args>(args)...);
+      }
+
+      template <typename Error>
+      void Fail(Error&& error) {
+        load_->fetch_add(delta_, std::memory_order_relaxed);
+        k_.Fail(std::forward<Error>(error));
+      }
+
+      void Stop() {
+        load_->fetch_add(delta_, std::memory_order_relaxed);
+        k_.Stop();
+      }
+
+      void Register(Interrupt& interrupt) {
+        k_.Register(interrupt);
+      }
+
+      std::atomic<size_t>* load_;
+      size_t delta_;
+      K_ k_;
+    };
+
+    struct Composable final {
+      template <typename Arg, typename Errors>
+      using ValueFrom = Arg;
+
+      template <typename Arg, typename Errors>
+      using ErrorsFrom = Errors;
+
+      template <typename Arg, typename Errors, typename K>
+      auto k(K k) && {
+        return Continuation<K>{load_, delta_, std::move(k)};
+      }
+
+      template <typename Downstream>
+      static constexpr bool CanCompose = Downstream::ExpectsValue;
+
+      using Expects = SingleValue;
+
+      std::atomic<size_t>* load_;
+      // NOTE: unsigned so that -1 wraps around to decrement.
+      size_t delta_;
+    };
+  };
+
+  struct Member final {
+    std::unique_ptr<EventLoop> loop;
+    std::atomic<size_t> load = 0;
+    std::thread thread;
+    Semaphore ready;
+  };
+
+  Member& member(EventLoop& loop);
+
+  std::vector<std::unique_ptr<Member>> members_;
+
+  std::atomic<bool> stopping_ = false;
+
+  // Where 'LeastLoaded()' starts looking so that ties get spread out.
+  std::atomic<size_t> next_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
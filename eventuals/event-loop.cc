@@ -46,8 +46,8 @@ void EventLoop::Clock::Resume() {
 
   std::scoped_lock lock(mutex_);
 
-  for (Pending& pending : pending_) {
-    pending.callback(pending.nanoseconds - advanced_);
+  for (auto& [nanoseconds, callback] : pending_) {
+    callback(nanoseconds - advanced_);
   }
 
   pending_.clear();
@@ -69,19 +69,15 @@ void EventLoop::Clock::Advance(const std::chrono::nanoseconds& nanoseconds) {
 
   std::scoped_lock lock(mutex_);
 
-  pending_.erase(
-      std::remove_if(
-          pending_.begin(),
-          pending_.end(),
-          [this](Pending& pending) {
-            if (advanced_ >= pending.nanoseconds) {
-              pending.callback(std::chrono::nanoseconds(0));
-              return true;
-            } else {
-              return false;
-            }
-          }),
-      pending_.end());
+  // Since 'pending_' is ordered we only need to look at the callbacks
+  // that are now due rather than all of them.
+  auto end = pending_.upper_bound(advanced_);
+
+  for (auto it = pending_.begin(); it != end; ++it) {
+    it->second(std::chrono::nanoseconds(0));
+  }
+
+  pending_.erase(pending_.begin(), end);
 
   // Now interrupt the event loop in the event any waiters were
   // enqueued and should be invoked due to the clock having been
@@ -91,6 +87,125 @@ void EventLoop::Clock::Advance(const std::chrono::nanoseconds& nanoseconds) {
 
 ////////////////////////////////////////////////////////////////////////
 
+void EventLoop::Clock::SetResolution(
+    const std::chrono::milliseconds& resolution) {
+  CHECK_GT(resolution.count(), 0) << "resolution must be at least 1ms";
+
+  CHECK(wheel_.empty())
+      << "changing the resolution with outstanding timers is unsupported";
+
+  resolution_ = resolution;
+
+  // Ticks have a different length now so get the wheel to catch up
+  // rather than go backwards (or be far behind).
+  wheel_.Advance(std::max(wheel_.now(), Tick()));
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void EventLoop::Clock::Initialize() {
+  CHECK_EQ(0, uv_timer_init(loop_, &timer_));
+
+  timer_.data = this;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void EventLoop::Clock::Close() {
+  CHECK(wheel_.empty()) << "closing clock with outstanding timers";
+
+  CHECK(!armed_);
+
+  uv_close((uv_handle_t*) &timer_, nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+uint64_t EventLoop::Clock::Tick() {
+  return uv_now(loop_) / resolution_.count();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void EventLoop::Clock::Insert(
+    TimerWheel::Timeout* timeout,
+    const std::chrono::nanoseconds& nanoseconds) {
+  CHECK(loop_.InThisEventLoop());
+
+  // Nothing to expire so the wheel can jump directly to now.
+  if (wheel_.empty()) {
+    wheel_.Advance(std::max(wheel_.now(), Tick()));
+  }
+
+  auto milliseconds =
+      std::chrono::duration_cast<std::chrono::milliseconds>(nanoseconds);
+
+  uint64_t deadline = uv_now(loop_) + milliseconds.count();
+
+  uint64_t resolution = resolution_.count();
+
+  // Round up to the next tick so that a timer never fires early.
+  wheel_.Insert(timeout, (deadline + resolution - 1) / resolution);
+
+  Arm();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void EventLoop::Clock::Cancel(TimerWheel::Timeout* timeout) {
+  CHECK(loop_.InThisEventLoop());
+
+  wheel_.Cancel(timeout);
+
+  // NOTE: we don't bother restarting 'timer_' for a later tick if
+  // the wheel isn't empty, worst case it fires and finds nothing to
+  // do, but we do need to stop it if it's empty so that it doesn't
+  // keep the event loop alive.
+  if (wheel_.empty()) {
+    Arm();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void EventLoop::Clock::Arm() {
+  std::optional<uint64_t> next = wheel_.Next();
+
+  if (!next) {
+    if (armed_) {
+      uv_timer_stop(&timer_);
+      armed_.reset();
+    }
+    return;
+  }
+
+  // Only restart the timer if it needs to fire sooner, otherwise
+  // every insert would need to touch libuv's timer heap.
+  if (armed_ && *armed_ <= *next) {
+    return;
+  }
+
+  armed_ = *next;
+
+  uint64_t deadline = *next * resolution_.count();
+  uint64_t now = uv_now(loop_);
+
+  CHECK_EQ(
+      0,
+      uv_timer_start(
+          &timer_,
+          [](uv_timer_t* timer) {
+            auto& clock = *(Clock*) timer->data;
+            clock.armed_.reset();
+            clock.wheel_.Advance(std::max(clock.wheel_.now(), clock.Tick()));
+            clock.Arm();
+          },
+          deadline > now ? deadline - now : 0,
+          /* repeat = */ 0));
+}
+
+////////////////////////////////////////////////////////////////////////
+
 // NOTE: If loop is nullptr then memory isn't initialized.
 static int8_t loop_memory[sizeof(EventLoop)] = {};
 static EventLoop* loop = nullptr;
@@ -162,6 +277,10 @@ EventLoop::EventLoop()
   });
 
   uv_async_init(&loop_, &async_, nullptr);
+
+  clock_.Initialize();
+
+  io_uring_ = IoUring::Create(&loop_);
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -251,6 +370,18 @@ EventLoop::~EventLoop() {
     }
   } while (alive);
 
+  // NOTE: we only close the clock's timer (and the io_uring handles)
+  // once the loop is no longer alive so that any outstanding timers
+  // (and io_uring operations) still complete, the handles are only
+  // referenced while there is something outstanding.
+  clock_.Close();
+
+  if (io_uring_) {
+    io_uring_->CloseHandles();
+  }
+
+  while (uv_run(&loop_, UV_RUN_NOWAIT) != 0) {}
+
   CHECK_EQ(uv_loop_close(&loop_), 0);
 }
 
@@ -269,7 +400,7 @@ void EventLoop::Interrupt() {
 ////////////////////////////////////////////////////////////////////////
 
 bool EventLoop::Continuable(const Scheduler::Context& context) {
-  return InEventLoop();
+  return InThisEventLoop();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -297,39 +428,61 @@ void EventLoop::Submit(Callback<void()> callback, Context& context) {
       std::memory_order_release,
       std::memory_order_relaxed)) {}
 
-  Interrupt();
+  // NOTE: only the first submission after 'Check()' has taken the
+  // waiters needs to wake up the loop, bursts of submissions (e.g.,
+  // a thread pool fanning results back into the loop) get run in a
+  // single batch from a single wakeup. This must be sequentially
+  // consistent with the push above and with the reset in 'Check()'
+  // so that either 'Check()' sees our waiter or we see that we need
+  // to wake it up.
+  if (!wakeup_pending_.exchange(true)) {
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+    Interrupt();
+  } else {
+    coalesced_.fetch_add(1, std::memory_order_relaxed);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////
 
 void EventLoop::Check() {
-  Waiter* waiter = nullptr;
-  do {
-  load:
-    waiter = waiters_.load(std::memory_order_relaxed);
-
-    if (waiter != nullptr) {
-      if (waiter->next == nullptr) {
-        if (!waiters_.compare_exchange_weak(
-                waiter,
-                nullptr,
-                std::memory_order_release,
-                std::memory_order_relaxed)) {
-          goto load; // Try again.
-        }
-      } else {
-        while (waiter->next->next != nullptr) {
-          waiter = waiter->next;
-        }
+  while (true) {
+    wakeup_pending_.store(false);
+
+    // Take all of the waiters at once rather than one at a time so
+    // that draining 'n' waiters is O(n) rather than O(n^2) and
+    // doesn't contend with submitters on each one.
+    Waiter* waiter = waiters_.exchange(nullptr, std::memory_order_acquire);
+
+    if (waiter == nullptr) {
+      break;
+    }
 
-        CHECK(waiter->next != nullptr);
+    // 'waiters_' is a stack, reverse it so we run callbacks in the
+    // order they were submitted.
+    Waiter* reversed = nullptr;
+    size_t size = 0;
+    while (waiter != nullptr) {
+      Waiter* next = waiter->next;
+      waiter->next = reversed;
+      reversed = waiter;
+      waiter = next;
+      size++;
+    }
 
-        auto* next = waiter->next;
-        waiter->next = nullptr;
-        waiter = next;
-      }
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    batched_.fetch_add(size, std::memory_order_relaxed);
+    if (size > largest_.load(std::memory_order_relaxed)) {
+      largest_.store(size, std::memory_order_relaxed);
+    }
 
-      CHECK_NOTNULL(waiter);
+    waiter = reversed;
+
+    while (waiter != nullptr) {
+      // NOTE: need to unlink 'waiter' before invoking its callback
+      // since the callback might submit it again.
+      Waiter* next = waiter->next;
+      waiter->next = nullptr;
 
       Context* context = CHECK_NOTNULL(waiter->context.get());
 
@@ -350,8 +503,22 @@ void EventLoop::Check() {
       ////////////////////////////////////////////////////
 
       CHECK_EQ(context, Context::Switch(std::move(previous)).get());
+
+      waiter = next;
     }
-  } while (waiter != nullptr);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+EventLoop::Statistics EventLoop::statistics() const {
+  Statistics statistics;
+  statistics.batches = batches_.load(std::memory_order_relaxed);
+  statistics.waiters = batched_.load(std::memory_order_relaxed);
+  statistics.largest = largest_.load(std::memory_order_relaxed);
+  statistics.wakeups = wakeups_.load(std::memory_order_relaxed);
+  statistics.coalesced = coalesced_.load(std::memory_order_relaxed);
+  return statistics;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -4,18 +4,21 @@
 #include <atomic>
 #include <chrono>
 #include <future>
-#include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <tuple>
+#include <utility>
 
 #include "eventuals/callback.h"
 #include "eventuals/closure.h"
+#include "eventuals/io-uring.h"
 #include "eventuals/lazy.h"
 #include "eventuals/stream.h"
 #include "eventuals/then.h"
+#include "eventuals/timer-wheel.h"
 #include "eventuals/type-traits.h"
 #include "stout/borrowed_ptr.h"
 #include "uv.h"
@@ -151,6 +154,11 @@ class EventLoop final : public Scheduler {
     uv_buf_t buffer_ = {};
   };
 
+  // Timers are multiplexed onto a single 'uv_timer_t' per event loop
+  // using a 'TimerWheel' so that starting and interrupting a timer
+  // doesn't need to initialize, start, stop and close a libuv handle
+  // each time. Timers expire at the granularity of the clock's
+  // resolution, see 'SetResolution()'.
   class Clock final : public stout::enable_borrowable_from_this<Clock> {
    public:
     Clock(const Clock&) = delete;
@@ -174,6 +182,19 @@ class EventLoop final : public Scheduler {
 
     void Advance(const std::chrono::nanoseconds& nanoseconds);
 
+    // Sets the length of a tick of the timer wheel (defaults to 1ms,
+    // the granularity of the libuv clock). A timer never fires early
+    // but may fire up to one tick late, so a coarser resolution trades
+    // precision for fewer wakeups of the event loop.
+    //
+    // NOTE: must be called from the event loop (or before it runs)
+    // while there are no outstanding timers.
+    void SetResolution(const std::chrono::milliseconds& resolution);
+
+    std::chrono::milliseconds resolution() const {
+      return resolution_;
+    }
+
     // Submits the given callback to be invoked when the clock is not
     // paused or the specified number of nanoseconds have been
     // advanced from the paused time.
@@ -184,8 +205,7 @@ class EventLoop final : public Scheduler {
         callback(nanoseconds);
       } else {
         std::scoped_lock lock(mutex_);
-        pending_.emplace_back(
-            Pending{nanoseconds + advanced_, std::move(callback)});
+        pending_.emplace(nanoseconds + advanced_, std::move(callback));
       }
     }
 
@@ -204,6 +224,7 @@ class EventLoop final : public Scheduler {
             std::chrono::nanoseconds nanoseconds)
           : clock_(std::move(clock)),
             nanoseconds_(nanoseconds),
+            timeout_([this]() { Expired(); }),
             context_(&clock_->loop(), "Timer (start/fail/stop)"),
             interrupt_context_(&clock_->loop(), "Timer (interrupt)"),
             k_(std::move(k)) {}
@@ -211,6 +232,7 @@ class EventLoop final : public Scheduler {
         Continuation(Continuation&& that) noexcept
           : clock_(std::move(that.clock_)),
             nanoseconds_(std::move(that.nanoseconds_)),
+            timeout_([this]() { Expired(); }),
             context_(&clock_->loop(), "Timer (start/fail/stop)"),
             interrupt_context_(&clock_->loop(), "Timer (interrupt)"),
             k_(std::move(that.k_)) {
@@ -219,7 +241,7 @@ class EventLoop final : public Scheduler {
         }
 
         ~Continuation() {
-          CHECK(!started_ || closed_);
+          CHECK(!started_ || completed_);
 
           // NOTE: we need to destruct any possible handler because it
           // has a borrow that needs to be relinquished.
@@ -257,110 +279,15 @@ class EventLoop final : public Scheduler {
                             if (!completed_) {
                               CHECK(!started_);
                               started_ = true;
-                              CHECK_EQ(0, uv_timer_init(loop(), timer()));
-
-                              uv_handle_set_data(handle(), this);
-
-                              auto timeout = std::chrono::duration_cast<
-                                  std::chrono::milliseconds>(nanoseconds_);
-
-                              CHECK(!error_);
-                              error_ = uv_timer_start(
-                                  timer(),
-                                  [](uv_timer_t* timer) {
-                                    auto& continuation =
-                                        *(Continuation*) timer->data;
-                                    CHECK_EQ(timer, continuation.timer());
-                                    CHECK_EQ(
-                                        &continuation,
-                                        continuation.handle()->data);
-                                    if (!continuation.completed_) {
-                                      continuation.completed_ = true;
-                                      CHECK(!continuation.error_);
-                                      continuation.error_ =
-                                          uv_timer_stop(continuation.timer());
-                                      uv_close(
-                                          continuation.handle(),
-                                          [](uv_handle_t* handle) {
-                                            auto& continuation =
-                                                *(Continuation*) handle->data;
-                                            continuation.closed_ = true;
-                                            if (!continuation.error_) {
-                                              continuation.k_.Start();
-                                            } else {
-                                              continuation.k_.Fail(
-                                                  RuntimeError(
-                                                      uv_strerror(
-                                                          continuation
-                                                              .error_)));
-                                            }
-                                          });
-                                    }
-                                  },
-                                  timeout.count(),
-                                  /* repeat = */ 0);
-
-                              // NOTE: even if the timeout is 0 we still
-                              // call into libuv so that we can unwind this
-                              // stack because otherwise we can get into
-                              // situations where we might deadlock on a
-                              // destructing a 'Scheduler::Context' that was
-                              // borrowed.
-                              //
-                              // TODO(benh): this might get fixed once we
-                              // stop using a 'Scheduler::Context' after
-                              // it's blocked, but we also might want to
-                              // consider an alternative where we don't call
-                              // into libuv but instead (re)submit a
-                              // callback so that we do some unwinding.
-
-                              CHECK(!error_);
-                              error_ = uv_timer_start(
-                                  timer(),
-                                  [](uv_timer_t* timer) {
-                                    auto& continuation =
-                                        *(Continuation*) timer->data;
-                                    CHECK_EQ(timer, continuation.timer());
-                                    CHECK_EQ(
-                                        &continuation,
-                                        continuation.handle()->data);
-                                    if (!continuation.completed_) {
-                                      continuation.completed_ = true;
-                                      CHECK(!continuation.error_);
-                                      continuation.error_ =
-                                          uv_timer_stop(continuation.timer());
-                                      uv_close(
-                                          continuation.handle(),
-                                          [](uv_handle_t* handle) {
-                                            auto& continuation =
-                                                *(Continuation*) handle->data;
-                                            continuation.closed_ = true;
-                                            if (!continuation.error_) {
-                                              continuation.k_.Start();
-                                            } else {
-                                              continuation.k_.Fail(
-                                                  RuntimeError(
-                                                      uv_strerror(
-                                                          continuation
-                                                              .error_)));
-                                            }
-                                          });
-                                    }
-                                  },
-                                  timeout.count(),
-                                  /* repeat = */ 0);
-                              if (error_) {
-                                completed_ = true;
-                                CHECK_EQ(this, handle()->data);
-                                uv_close(handle(), [](uv_handle_t* handle) {
-                                  auto& continuation =
-                                      *(Continuation*) handle->data;
-                                  continuation.closed_ = true;
-                                  CHECK(continuation.error_);
-                                  continuation.k_.Fail(RuntimeError(
-                                      uv_strerror(continuation.error_)));
-                                });
-                              }
+
+                              // NOTE: even if the timeout is 0 the timer
+                              // will expire from a later iteration of the
+                              // event loop, not from within 'Insert()',
+                              // so that we unwind this stack because
+                              // otherwise we can get into situations
+                              // where we might deadlock on destructing a
+                              // 'Scheduler::Context' that was borrowed.
+                              clock_->Insert(&timeout_, nanoseconds_);
                             }
                           }),
                           context_);
@@ -418,28 +345,12 @@ class EventLoop final : public Scheduler {
             // we used 'RescheduleAfter()' in 'EventLoop::Close::Timer()'.
             loop().Submit(
                 this->Borrow([this]() {
-                  if (!started_) {
-                    CHECK(!completed_);
-                    completed_ = true;
-                    k_.Stop();
-                  } else if (!completed_) {
-                    CHECK(started_);
+                  if (!completed_) {
                     completed_ = true;
-                    CHECK(!error_);
-                    if (uv_is_active(handle())) {
-                      error_ = uv_timer_stop(timer());
+                    if (started_) {
+                      clock_->Cancel(&timeout_);
                     }
-                    CHECK_EQ(this, handle()->data);
-                    uv_close(handle(), [](uv_handle_t* handle) {
-                      auto& continuation = *(Continuation*) handle->data;
-                      continuation.closed_ = true;
-                      if (!continuation.error_) {
-                        continuation.k_.Stop();
-                      } else {
-                        continuation.k_.Fail(RuntimeError(
-                            uv_strerror(continuation.error_)));
-                      }
-                    });
+                    k_.Stop();
                   }
                 }),
                 interrupt_context_);
@@ -451,25 +362,21 @@ class EventLoop final : public Scheduler {
           return clock_->loop();
         }
 
-        // Adaptors to libuv functions.
-        uv_timer_t* timer() {
-          return &timer_;
-        }
-
-        uv_handle_t* handle() {
-          return reinterpret_cast<uv_handle_t*>(&timer_);
+        // Invoked from the event loop by the clock's timer wheel.
+        void Expired() {
+          CHECK(started_);
+          CHECK(!completed_);
+          completed_ = true;
+          k_.Start();
         }
 
         stout::borrowed_ref<Clock> clock_;
         std::chrono::nanoseconds nanoseconds_ = std::chrono::nanoseconds(0);
 
-        uv_timer_t timer_ = {};
+        TimerWheel::Timeout timeout_;
 
         bool started_ = false;
         bool completed_ = false;
-        bool closed_ = false;
-
-        int error_ = 0;
 
         // NOTE: we use 'context_' in each of 'Start()', 'Fail()', and
         // 'Stop()' because only one of them will called at runtime.
@@ -489,6 +396,10 @@ class EventLoop final : public Scheduler {
         template <typename Arg, typename Errors>
         using ValueFrom = void;
 
+        // NOTE: a timer can no longer fail on its own now that it
+        // doesn't have its own 'uv_timer_t' but we still include
+        // 'RuntimeError' so that the types of existing compositions
+        // don't change.
         template <typename Arg, typename Errors>
         using ErrorsFrom = tuple_types_union_t<
             Errors,
@@ -512,21 +423,54 @@ class EventLoop final : public Scheduler {
       };
     };
 
+    friend class EventLoop;
+
+    // Initializes and closes 'timer_', invoked by 'EventLoop' since
+    // the clock gets constructed before the libuv loop is initialized.
+    void Initialize();
+    void Close();
+
+    // Inserts/cancels a timeout on the timer wheel, must be called
+    // from the event loop.
+    void Insert(
+        TimerWheel::Timeout* timeout,
+        const std::chrono::nanoseconds& nanoseconds);
+
+    void Cancel(TimerWheel::Timeout* timeout);
+
+    // Current tick of the timer wheel according to the libuv clock.
+    uint64_t Tick();
+
+    // (Re)starts 'timer_' for the next tick of the wheel, or stops it
+    // if there aren't any more timeouts so that it doesn't keep the
+    // event loop alive.
+    void Arm();
+
     EventLoop& loop_;
 
+    TimerWheel wheel_;
+
+    uv_timer_t timer_ = {};
+
+    // Tick that 'timer_' was last started for, if it's active.
+    std::optional<uint64_t> armed_;
+
+    std::chrono::milliseconds resolution_ = std::chrono::milliseconds(1);
+
     // Stores paused time, no time means clock is not paused.
     std::optional<std::chrono::nanoseconds> paused_;
     std::chrono::nanoseconds advanced_ = std::chrono::nanoseconds(0);
 
-    struct Pending final {
-      std::chrono::nanoseconds nanoseconds = std::chrono::nanoseconds(0);
-      Callback<void(const std::chrono::nanoseconds&)> callback;
-    };
-
     // NOTE: using "blocking" synchronization here as pausing the
     // clock should only be done in tests.
     std::mutex mutex_;
-    std::list<Pending> pending_;
+
+    // Callbacks waiting for the paused clock to be advanced (or
+    // resumed), ordered by when they should be invoked.
+    std::multimap<
+        std::chrono::nanoseconds,
+        Callback<void(const std::chrono::nanoseconds&)>>
+        pending_;
   };
 
   // Getter/Resetter for default event loop.
@@ -549,13 +493,13 @@ class EventLoop final : public Scheduler {
         std::memory_order_relaxed))
         << "Another thread is already running the event loop!";
 
-    in_event_loop_ = true;
+    EventLoop* previous = std::exchange(current_, this);
 
     do {
       uv_run(&loop_, UV_RUN_ONCE);
     } while (waiters_.load() != nullptr);
 
-    in_event_loop_ = false;
+    current_ = previous;
 
     CHECK(running_.exchange(false));
   }
@@ -569,7 +513,7 @@ class EventLoop final : public Scheduler {
         std::memory_order_relaxed))
         << "Another thread is already running the event loop!";
 
-    in_event_loop_ = true;
+    EventLoop* previous = std::exchange(current_, this);
 
     do {
       // NOTE: We use 'UV_RUN_NOWAIT' because we don't want to block
@@ -577,7 +521,7 @@ class EventLoop final : public Scheduler {
       uv_run(&loop_, UV_RUN_NOWAIT);
     } while (waiters_.load() != nullptr);
 
-    in_event_loop_ = false;
+    current_ = previous;
 
     CHECK(running_.exchange(false));
   }
@@ -589,6 +533,27 @@ class EventLoop final : public Scheduler {
 
   bool Continuable(const Scheduler::Context& context) override;
 
+  struct Statistics final {
+    // Number of times the loop ran a batch of submitted callbacks.
+    size_t batches = 0;
+
+    // Number of submitted callbacks run across all batches, i.e.,
+    // 'waiters / batches' is the average batch size.
+    size_t waiters = 0;
+
+    // Size of the largest batch.
+    size_t largest = 0;
+
+    // Number of times a submission had to wake up the loop.
+    size_t wakeups = 0;
+
+    // Number of times a submission didn't need to wake up the loop
+    // because a wakeup was already pending.
+    size_t coalesced = 0;
+  };
+
+  Statistics statistics() const;
+
   void Submit(Callback<void()> callback, Scheduler::Context& context) override;
 
   void Clone(Context& child) override {}
@@ -608,8 +573,23 @@ class EventLoop final : public Scheduler {
     return running_.load();
   }
 
+  // Returns true if the calling thread is running an event loop.
   static bool InEventLoop() {
-    return in_event_loop_;
+    return current_ != nullptr;
+  }
+
+  // Returns true if the calling thread is running this event loop.
+  bool InThisEventLoop() const {
+    return current_ == this;
+  }
+
+  // Returns the event loop the calling thread is running, or the
+  // default event loop if it isn't running one. Operations that take
+  // an optional 'EventLoop&' use this so that when they're started
+  // from an event loop (e.g., one of an 'EventLoopGroup') they stay
+  // on that loop.
+  static EventLoop& Current() {
+    return current_ != nullptr ? *current_ : Default();
   }
 
   operator uv_loop_t*() {
@@ -620,6 +600,12 @@ class EventLoop final : public Scheduler {
     return clock_;
   }
 
+  // Returns this loop's io_uring, or nullptr if io_uring is not
+  // available in which case filesystem operations use libuv.
+  IoUring* io_uring() {
+    return io_uring_.get();
+  }
+
   auto WaitForSignal(int signum);
 
   // Returns a stream of 'PollEvents' for each invocation of stream
@@ -1172,11 +1158,27 @@ class EventLoop final : public Scheduler {
 
   std::atomic<bool> running_ = false;
 
-  static inline thread_local bool in_event_loop_ = false;
+  // The event loop, if any, that the calling thread is running.
+  static inline thread_local EventLoop* current_ = nullptr;
 
+  // Stack of submitted callbacks, see 'Submit()' and 'Check()'.
   std::atomic<Waiter*> waiters_ = nullptr;
 
+  // Whether or not a submission has already woken up the loop and
+  // the loop hasn't yet taken 'waiters_', in which case subsequent
+  // submissions don't need to wake it up again.
+  std::atomic<bool> wakeup_pending_ = false;
+
+  // See 'Statistics'.
+  std::atomic<size_t> batches_ = 0;
+  std::atomic<size_t> batched_ = 0;
+  std::atomic<size_t> largest_ = 0;
+  std::atomic<size_t> wakeups_ = 0;
+  std::atomic<size_t> coalesced_ = 0;
+
   Clock clock_;
+
+  std::unique_ptr<IoUring> io_uring_;
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -1213,7 +1215,7 @@ struct _EventLoopSchedule final {
           !std::is_void_v<Arg_> || sizeof...(args) == 0,
           "'Schedule' only supports 0 or 1 argument");
 
-      if (loop()->InEventLoop()) {
+      if (loop()->InThisEventLoop()) {
         Adapt();
         auto previous = Scheduler::Context::Switch(context_->Borrow());
         adapted_->Start(std::forward<Args>(args)...);
@@ -1243,29 +1245,19 @@ struct _EventLoopSchedule final {
       // to support the use case where code wants to "catch" a failure
       // inside of a 'Schedule()' in order to either recover or
       // propagate a different failure.
-      if (loop()->InEventLoop()) {
+      if (loop()->InThisEventLoop()) {
         Adapt();
         auto previous = Scheduler::Context::Switch(context_->Borrow());
         adapted_->Fail(std::forward<Error>(error));
         previous = Scheduler::Context::Switch(std::move(previous));
         CHECK_EQ(previous.get(), context_.get());
       } else {
-        // TODO(benh): avoid allocating on heap by storing args in
-        // pre-allocated buffer based on composing with Errors.
-        using Tuple = std::tuple<decltype(this), Error>;
-        auto tuple = std::make_unique<Tuple>(
-            this,
-            std::forward<Error>(error));
+        error_.Emplace(std::forward<Error>(error));
 
         loop()->Submit(
-            this->Borrow([tuple = std::move(tuple)]() mutable {
-              std::apply(
-                  [](auto* schedule, auto&&... args) {
-                    schedule->Adapt();
-                    schedule->adapted_->Fail(
-                        std::forward<decltype(args)>(args)...);
-                  },
-                  std::move(*tuple));
+            this->Borrow([this]() {
+              Adapt();
+              adapted_->Fail(error_.template Extract<Error>());
             }),
             *context_);
       }
@@ -1277,7 +1269,7 @@ struct _EventLoopSchedule final {
       // stop inside of a 'Schedule()' in order to do something
       // different.
 
-      if (loop()->InEventLoop()) {
+      if (loop()->InThisEventLoop()) {
         Adapt();
         auto previous = Scheduler::Context::Switch(context_->Borrow());
         adapted_->Stop();
@@ -1331,6 +1323,9 @@ struct _EventLoopSchedule final {
         std::conditional_t<!std::is_void_v<Arg_>, Arg_, Undefined>>
         arg_;
 
+    // Used to hold on to an error while we hop to 'loop()'.
+    ErrorStorage<Errors_> error_;
+
     // Need to store context using '_Lazy' because we need to be able to move
     // this class _before_ it's started and 'Context' is not movable.
     Lazy::Of<Scheduler::Context>::Args<
@@ -1399,9 +1394,9 @@ template <typename E>
 
 ////////////////////////////////////////////////////////////////////////
 
-// Returns the default event loop's clock.
+// Returns the current event loop's clock, see 'EventLoop::Current()'.
 [[nodiscard]] inline EventLoop::Clock& Clock() {
-  return EventLoop::Default().clock();
+  return EventLoop::Current().clock();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -1,10 +1,24 @@
 #pragma once
 
 #include <filesystem> // std::filesystem::path
+#include <limits>
+#include <memory>
 #include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
 
+#include "eventuals/byte-buffer.h"
+#include "eventuals/compose.h"
+#include "eventuals/errors.h"
 #include "eventuals/event-loop.h"
 #include "eventuals/eventual.h"
+#include "eventuals/interrupt.h"
+#include "eventuals/io-uring.h"
+#include "eventuals/scheduler.h"
+#include "eventuals/then.h"
+#include "eventuals/type-erased-stream.h"
+#include "eventuals/type-traits.h"
 #include "uv.h"
 
 ////////////////////////////////////////////////////////////////////////
@@ -85,8 +99,11 @@ class File final {
   File(const File& that) = delete;
 
   File(File&& that) noexcept
-    : descriptor_(that.descriptor_) {
+    : descriptor_(that.descriptor_),
+      io_uring_(that.io_uring_),
+      fixed_(that.fixed_) {
     that.descriptor_.reset();
+    that.fixed_.reset();
   }
 
   File& operator=(const File& that) = delete;
@@ -97,19 +114,26 @@ class File final {
     }
 
     if (descriptor_.has_value()) {
+      Unregister();
+
       // No callback allows us to synchronously use this function,
       // loop is not needed in this variant.
       uv_fs_close(nullptr, Request(), *descriptor_, NULL);
     }
 
     descriptor_ = that.descriptor_;
+    io_uring_ = that.io_uring_;
+    fixed_ = that.fixed_;
     that.descriptor_.reset();
+    that.fixed_.reset();
 
     return *this;
   }
 
   ~File() {
     if (descriptor_.has_value()) {
+      Unregister();
+
       // No callback allows us to synchronously use this function,
       // loop is not needed in this variant.
       uv_fs_close(nullptr, Request(), *descriptor_, NULL);
@@ -130,10 +154,40 @@ class File final {
   // optional eases the ownership control.
   std::optional<uv_file> descriptor_;
 
+  // The io_uring the file was opened with (if any) and its index if
+  // it was registered as a fixed file, which must be unregistered
+  // before the file gets closed.
+  //
+  // NOTE: a file opened with io_uring must not outlive its loop.
+  IoUring* io_uring_ = nullptr;
+  std::optional<unsigned int> fixed_;
+
   // Takes ownership of the descriptor.
   File(const uv_file& descriptor)
     : descriptor_(descriptor) {}
 
+  // Takes ownership of the descriptor and registers it as a fixed
+  // file with 'io_uring' if possible.
+  File(const uv_file& descriptor, IoUring* io_uring)
+    : descriptor_(descriptor),
+      io_uring_(io_uring) {
+    if (io_uring_ != nullptr) {
+      fixed_ = io_uring_->RegisterFile(descriptor);
+    }
+  }
+
+  // Returns the fixed file index to use with 'io_uring', if any.
+  std::optional<unsigned int> fixed(IoUring* io_uring) const {
+    return io_uring == io_uring_ ? fixed_ : std::nullopt;
+  }
+
+  void Unregister() {
+    if (fixed_.has_value()) {
+      io_uring_->UnregisterFile(*fixed_);
+      fixed_.reset();
+    }
+  }
+
   void MarkAsClosed() {
     descriptor_.reset();
   }
@@ -145,6 +199,21 @@ class File final {
       EventLoop& loop);
 
   friend auto CloseFile(File&& file, EventLoop& loop);
+
+  friend auto ReadFile(
+      const File& file,
+      const size_t& bytes_to_read,
+      const size_t& offset,
+      EventLoop& loop);
+
+  friend auto WriteFile(
+      const File& file,
+      ByteBuffer data,
+      const size_t& offset,
+      EventLoop& loop);
+
+  friend struct _ReadFileStream;
+  friend struct _WriteFileStream;
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -153,7 +222,7 @@ class File final {
     const std::filesystem::path& path,
     const int& flags,
     const int& mode,
-    EventLoop& loop = EventLoop::Default()) {
+    EventLoop& loop = EventLoop::Current()) {
   struct Data {
     EventLoop& loop;
     int flags;
@@ -161,6 +230,7 @@ class File final {
     std::filesystem::path path;
 
     Request request;
+    IoUring::Operation operation;
     void* k = nullptr;
   };
 
@@ -175,6 +245,28 @@ class File final {
             data.k = &k;
             data.request->data = &data;
 
+            // NOTE: both io_uring and libuv complete with the result
+            // of the system call or a negative errno on failure.
+            data.operation.callback = [&data](int result) {
+              auto& k = *static_cast<K*>(data.k);
+              if (result >= 0) {
+                k.Start(File(result, data.loop.io_uring()));
+              } else {
+                k.Fail(RuntimeError(uv_strerror(result)));
+              }
+            };
+
+            IoUring* io_uring = data.loop.io_uring();
+
+            if (io_uring != nullptr
+                && io_uring->Open(
+                    &data.operation,
+                    data.path,
+                    data.flags,
+                    data.mode)) {
+              return;
+            }
+
             auto error = uv_fs_open(
                 data.loop,
                 data.request,
@@ -183,17 +275,11 @@ class File final {
                 data.mode,
                 [](uv_fs_t* request) {
                   auto& data = *static_cast<Data*>(request->data);
-                  auto& k = *static_cast<K*>(data.k);
-                  if (request->result >= 0) {
-                    k.Start(File(request->result));
-                  } else {
-                    k.Fail(RuntimeError(uv_strerror(request->result)));
-                  }
+                  data.operation.callback(request->result);
                 });
 
             if (error) {
-              static_cast<K*>(data.k)->Fail(
-                  RuntimeError(uv_strerror(error)));
+              data.operation.callback(error);
             }
           }));
 }
@@ -202,11 +288,12 @@ class File final {
 
 [[nodiscard]] inline auto CloseFile(
     File&& file,
-    EventLoop& loop = EventLoop::Default()) {
+    EventLoop& loop = EventLoop::Current()) {
   struct Data {
     EventLoop& loop;
     File file;
     Request request;
+    IoUring::Operation operation;
 
     void* k = nullptr;
   };
@@ -222,24 +309,38 @@ class File final {
             data.k = &k;
             data.request->data = &data;
 
+            data.operation.callback = [&data](int result) {
+              auto& k = *static_cast<K*>(data.k);
+              if (result == 0) {
+                data.file.MarkAsClosed();
+                k.Start();
+              } else {
+                k.Fail(RuntimeError(uv_strerror(result)));
+              }
+            };
+
+            // NOTE: the file needs to be unregistered before closing
+            // it otherwise io_uring keeps it open.
+            data.file.Unregister();
+
+            IoUring* io_uring = data.loop.io_uring();
+
+            if (io_uring != nullptr
+                && io_uring->Close(&data.operation, data.file)) {
+              return;
+            }
+
             auto error = uv_fs_close(
                 data.loop,
                 data.request,
                 data.file,
                 [](uv_fs_t* request) {
                   auto& data = *static_cast<Data*>(request->data);
-                  auto& k = *static_cast<K*>(data.k);
-                  if (request->result == 0) {
-                    data.file.MarkAsClosed();
-                    k.Start();
-                  } else {
-                    k.Fail(RuntimeError(uv_strerror(request->result)));
-                  };
+                  data.operation.callback(request->result);
                 });
 
             if (error) {
-              static_cast<K*>(data.k)->Fail(
-                  RuntimeError(uv_strerror(error)));
+              data.operation.callback(error);
             }
           }));
 }
@@ -250,14 +351,20 @@ class File final {
     const File& file,
     const size_t& bytes_to_read,
     const size_t& offset,
-    EventLoop& loop = EventLoop::Default()) {
+    EventLoop& loop = EventLoop::Current()) {
   struct Data {
     EventLoop& loop;
     const File& file;
     size_t bytes_to_read;
     size_t offset;
-    EventLoop::Buffer buffer;
+
+    // What we read into, unless we're reading into one of the
+    // io_uring's registered buffers.
+    std::string buffer;
+    std::optional<unsigned int> registered;
+
     Request request;
+    IoUring::Operation operation;
 
     void* k = nullptr;
   };
@@ -266,50 +373,136 @@ class File final {
       "ReadFile",
       Eventual<std::string>()
           .raises<RuntimeError>()
-          .context(Data{loop, file, bytes_to_read, offset, bytes_to_read})
+          .context(Data{loop, file, bytes_to_read, offset})
           .start([](Data& data, auto& k) mutable {
             using K = std::decay_t<decltype(k)>;
 
             data.k = &k;
             data.request->data = &data;
 
+            data.operation.callback = [&data](int result) {
+              auto& k = *static_cast<K*>(data.k);
+
+              if (data.registered.has_value()) {
+                IoUring* io_uring = data.loop.io_uring();
+                if (result >= 0) {
+                  data.buffer.assign(
+                      io_uring->buffer(*data.registered),
+                      result);
+                }
+                io_uring->ReleaseBuffer(*data.registered);
+                data.registered.reset();
+              } else if (result >= 0) {
+                // NOTE: we might have read less than requested.
+                data.buffer.resize(result);
+              }
+
+              if (result >= 0) {
+                k.Start(std::move(data.buffer));
+              } else {
+                k.Fail(RuntimeError(uv_strerror(result)));
+              }
+            };
+
+            IoUring* io_uring = data.loop.io_uring();
+
+            if (io_uring != nullptr
+                && data.bytes_to_read
+                    <= std::numeric_limits<unsigned int>::max()) {
+              // Small reads go into a registered buffer (if one is
+              // available) so the kernel doesn't have to map the
+              // buffer for each read, bigger reads go directly into
+              // the string we return.
+              if (data.bytes_to_read <= io_uring->buffer_size()) {
+                data.registered = io_uring->AcquireBuffer();
+              }
+
+              char* buffer = nullptr;
+              if (data.registered.has_value()) {
+                buffer = io_uring->buffer(*data.registered);
+              } else {
+                data.buffer.resize(data.bytes_to_read);
+                buffer = data.buffer.data();
+              }
+
+              if (io_uring->Read(
+                      &data.operation,
+                      data.file,
+                      data.file.fixed(io_uring),
+                      buffer,
+                      data.bytes_to_read,
+                      data.offset,
+                      data.registered)) {
+                return;
+              }
+
+              if (data.registered.has_value()) {
+                io_uring->ReleaseBuffer(*data.registered);
+                data.registered.reset();
+              }
+            }
+
+            data.buffer.resize(data.bytes_to_read);
+
+            uv_buf_t buffer = uv_buf_init(
+                data.buffer.data(),
+                data.buffer.size());
+
             auto error = uv_fs_read(
                 data.loop,
                 data.request,
                 data.file,
-                data.buffer,
+                &buffer,
                 1,
                 data.offset,
                 [](uv_fs_t* request) {
                   auto& data = *static_cast<Data*>(request->data);
-                  auto& k = *static_cast<K*>(data.k);
-                  if (request->result >= 0) {
-                    k.Start(data.buffer.Extract());
-                  } else {
-                    k.Fail(RuntimeError(uv_strerror(request->result)));
-                  };
+                  data.operation.callback(request->result);
                 });
 
             if (error) {
-              static_cast<K*>(data.k)->Fail(
-                  RuntimeError(uv_strerror(error)));
+              data.operation.callback(error);
             }
           }));
 }
 
 ////////////////////////////////////////////////////////////////////////
 
+// Like 'ReadFile()' but returns what was read as a 'ByteBuffer' (without
+// copying) so it can be passed along, e.g., to 'WriteFile()' or as the
+// body of an HTTP request.
+[[nodiscard]] inline auto ReadFileBuffer(
+    const File& file,
+    const size_t& bytes_to_read,
+    const size_t& offset,
+    EventLoop& loop = EventLoop::Current()) {
+  return ReadFile(file, bytes_to_read, offset, loop)
+      >> Then([](std::string&& data) {
+           return ByteBuffer(std::move(data));
+         });
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Writes all of the slices of 'data' with a single gather write
+// (i.e., 'pwritev(2)') rather than copying them into one buffer.
 [[nodiscard]] inline auto WriteFile(
     const File& file,
-    const std::string& data,
+    ByteBuffer data,
     const size_t& offset,
-    EventLoop& loop = EventLoop::Default()) {
+    EventLoop& loop = EventLoop::Current()) {
   struct Data {
     EventLoop& loop;
     const File& file;
-    EventLoop::Buffer buffer;
+    ByteBuffer data;
     size_t offset;
+
+    // One for each slice of 'data', must remain valid until the write
+    // completes.
+    std::vector<uv_buf_t> buffers;
+
     Request request;
+    IoUring::Operation operation;
 
     void* k = nullptr;
   };
@@ -318,47 +511,92 @@ class File final {
       "WriteFile",
       Eventual<void>()
           .raises<RuntimeError>()
-          .context(Data{loop, file, data, offset})
+          .context(Data{loop, file, std::move(data), offset})
           .start([](Data& data, auto& k) mutable {
             using K = std::decay_t<decltype(k)>;
 
             data.k = &k;
             data.request->data = &data;
 
+            data.operation.callback = [&data](int result) {
+              auto& k = *static_cast<K*>(data.k);
+              if (result >= 0) {
+                k.Start();
+              } else {
+                k.Fail(RuntimeError(uv_strerror(result)));
+              }
+            };
+
+            // NOTE: libuv doesn't write to the buffers so it's safe to
+            // cast away the const.
+            data.buffers.reserve(data.data.slices().size());
+            for (const ByteBuffer::Slice& slice : data.data.slices()) {
+              data.buffers.push_back(uv_buf_init(
+                  const_cast<char*>(slice.data()),
+                  slice.size()));
+            }
+
+            // libuv requires at least one buffer even when there's
+            // nothing to write.
+            if (data.buffers.empty()) {
+              data.buffers.push_back(uv_buf_init(nullptr, 0));
+            }
+
+            IoUring* io_uring = data.loop.io_uring();
+
+            // NOTE: the kernel rejects more than 'IOV_MAX' (1024)
+            // buffers for a single write whereas libuv splits them up.
+            if (io_uring != nullptr
+                && data.buffers.size() <= 1024
+                && io_uring->Write(
+                    &data.operation,
+                    data.file,
+                    data.file.fixed(io_uring),
+                    data.buffers.data(),
+                    data.buffers.size(),
+                    data.offset)) {
+              return;
+            }
+
             auto error = uv_fs_write(
                 data.loop,
                 data.request,
                 data.file,
-                data.buffer,
-                1,
+                data.buffers.data(),
+                data.buffers.size(),
                 data.offset,
                 [](uv_fs_t* request) {
                   auto& data = *static_cast<Data*>(request->data);
-                  auto& k = *static_cast<K*>(data.k);
-                  if (request->result >= 0) {
-                    k.Start();
-                  } else {
-                    k.Fail(RuntimeError(uv_strerror(request->result)));
-                  };
+                  data.operation.callback(request->result);
                 });
 
             if (error) {
-              static_cast<K*>(data.k)->Fail(
-                  RuntimeError(uv_strerror(error)));
+              data.operation.callback(error);
             }
           }));
 }
 
 ////////////////////////////////////////////////////////////////////////
 
+[[nodiscard]] inline auto WriteFile(
+    const File& file,
+    const std::string& data,
+    const size_t& offset,
+    EventLoop& loop = EventLoop::Current()) {
+  return WriteFile(file, ByteBuffer::Copy(data), offset, loop);
+}
+
+////////////////////////////////////////////////////////////////////////
+
 [[nodiscard]] inline auto UnlinkFile(
     const std::filesystem::path& path,
-    EventLoop& loop = EventLoop::Default()) {
+    EventLoop& loop = EventLoop::Current()) {
   struct Data {
     EventLoop& loop;
     std::filesystem::path path;
 
     Request request;
+    IoUring::Operation operation;
     void* k = nullptr;
   };
 
@@ -373,23 +611,33 @@ class File final {
             data.k = &k;
             data.request->data = &data;
 
+            data.operation.callback = [&data](int result) {
+              auto& k = *static_cast<K*>(data.k);
+              if (result == 0) {
+                k.Start();
+              } else {
+                k.Fail(RuntimeError(uv_strerror(result)));
+              }
+            };
+
+            IoUring* io_uring = data.loop.io_uring();
+
+            if (io_uring != nullptr
+                && io_uring->Unlink(&data.operation, data.path)) {
+              return;
+            }
+
             auto error = uv_fs_unlink(
                 data.loop,
                 data.request,
                 data.path.string().c_str(),
                 [](uv_fs_t* request) {
                   auto& data = *static_cast<Data*>(request->data);
-                  auto& k = *static_cast<K*>(data.k);
-                  if (request->result == 0) {
-                    k.Start();
-                  } else {
-                    k.Fail(RuntimeError(uv_strerror(request->result)));
-                  }
+                  data.operation.callback(request->result);
                 });
 
             if (error) {
-              static_cast<K*>(data.k)->Fail(
-                  RuntimeError(uv_strerror(error)));
+              data.operation.callback(error);
             }
           }));
 }
@@ -399,13 +647,14 @@ class File final {
 [[nodiscard]] inline auto MakeDirectory(
     const std::filesystem::path& path,
     const int& mode,
-    EventLoop& loop = EventLoop::Default()) {
+    EventLoop& loop = EventLoop::Current()) {
   struct Data {
     EventLoop& loop;
     std::filesystem::path path;
     int mode;
 
     Request request;
+    IoUring::Operation operation;
     void* k = nullptr;
   };
 
@@ -420,6 +669,25 @@ class File final {
             data.k = &k;
             data.request->data = &data;
 
+            data.operation.callback = [&data](int result) {
+              auto& k = *static_cast<K*>(data.k);
+              if (result == 0) {
+                k.Start();
+              } else {
+                k.Fail(RuntimeError(uv_strerror(result)));
+              }
+            };
+
+            IoUring* io_uring = data.loop.io_uring();
+
+            if (io_uring != nullptr
+                && io_uring->MakeDirectory(
+                    &data.operation,
+                    data.path,
+                    data.mode)) {
+              return;
+            }
+
             auto error = uv_fs_mkdir(
                 data.loop,
                 data.request,
@@ -427,17 +695,11 @@ class File final {
                 data.mode,
                 [](uv_fs_t* request) {
                   auto& data = *static_cast<Data*>(request->data);
-                  auto& k = *static_cast<K*>(data.k);
-                  if (request->result == 0) {
-                    k.Start();
-                  } else {
-                    k.Fail(RuntimeError(uv_strerror(request->result)));
-                  }
+                  data.operation.callback(request->result);
                 });
 
             if (error) {
-              static_cast<K*>(data.k)->Fail(
-                  RuntimeError(uv_strerror(error)));
+              data.operation.callback(error);
             }
           }));
 }
@@ -446,12 +708,13 @@ class File final {
 
 [[nodiscard]] inline auto RemoveDirectory(
     const std::filesystem::path& path,
-    EventLoop& loop = EventLoop::Default()) {
+    EventLoop& loop = EventLoop::Current()) {
   struct Data {
     EventLoop& loop;
     std::filesystem::path path;
 
     Request request;
+    IoUring::Operation operation;
     void* k = nullptr;
   };
 
@@ -466,23 +729,33 @@ class File final {
             data.k = &k;
             data.request->data = &data;
 
+            data.operation.callback = [&data](int result) {
+              auto& k = *static_cast<K*>(data.k);
+              if (result == 0) {
+                k.Start();
+              } else {
+                k.Fail(RuntimeError(uv_strerror(result)));
+              }
+            };
+
+            IoUring* io_uring = data.loop.io_uring();
+
+            if (io_uring != nullptr
+                && io_uring->RemoveDirectory(&data.operation, data.path)) {
+              return;
+            }
+
             auto error = uv_fs_rmdir(
                 data.loop,
                 data.request,
                 data.path.string().c_str(),
                 [](uv_fs_t* request) {
                   auto& data = *static_cast<Data*>(request->data);
-                  auto& k = *static_cast<K*>(data.k);
-                  if (request->result == 0) {
-                    k.Start();
-                  } else {
-                    k.Fail(RuntimeError(uv_strerror(request->result)));
-                  }
+                  data.operation.callback(request->result);
                 });
 
             if (error) {
-              static_cast<K*>(data.k)->Fail(
-                  RuntimeError(uv_strerror(error)));
+              data.operation.callback(error);
             }
           }));
 }
@@ -493,7 +766,7 @@ class File final {
     const std::filesystem::path& src,
     const std::filesystem::path& dst,
     const int& flags,
-    EventLoop& loop = EventLoop::Default()) {
+    EventLoop& loop = EventLoop::Current()) {
   struct Data {
     EventLoop& loop;
     std::filesystem::path src;
@@ -543,13 +816,14 @@ class File final {
 [[nodiscard]] inline auto RenameFile(
     const std::filesystem::path& src,
     const std::filesystem::path& dst,
-    EventLoop& loop = EventLoop::Default()) {
+    EventLoop& loop = EventLoop::Current()) {
   struct Data {
     EventLoop& loop;
     std::filesystem::path src;
     std::filesystem::path dst;
 
     Request request;
+    IoUring::Operation operation;
     void* k = nullptr;
   };
 
@@ -564,6 +838,22 @@ class File final {
             data.k = &k;
             data.request->data = &data;
 
+            data.operation.callback = [&data](int result) {
+              auto& k = *static_cast<K*>(data.k);
+              if (result == 0) {
+                k.Start();
+              } else {
+                k.Fail(RuntimeError(uv_strerror(result)));
+              }
+            };
+
+            IoUring* io_uring = data.loop.io_uring();
+
+            if (io_uring != nullptr
+                && io_uring->Rename(&data.operation, data.src, data.dst)) {
+              return;
+            }
+
             auto error = uv_fs_rename(
                 data.loop,
                 data.request,
@@ -571,23 +861,928 @@ class File final {
                 data.dst.string().c_str(),
                 [](uv_fs_t* request) {
                   auto& data = *static_cast<Data*>(request->data);
-                  auto& k = *static_cast<K*>(data.k);
-                  if (request->result == 0) {
-                    k.Start();
-                  } else {
-                    k.Fail(RuntimeError(uv_strerror(request->result)));
-                  }
+                  data.operation.callback(request->result);
                 });
 
             if (error) {
-              static_cast<K*>(data.k)->Fail(
-                  RuntimeError(uv_strerror(error)));
+              data.operation.callback(error);
             }
           }));
 }
 
 ////////////////////////////////////////////////////////////////////////
 
+struct ReadFileStreamOptions final {
+  // Number of bytes read for each chunk.
+  size_t chunk_size = 64 * 1024;
+
+  // Number of reads to keep in flight ahead of the downstream.
+  size_t read_ahead = 4;
+
+  // Total number of bytes to read, by default until the end of file.
+  size_t bytes = std::numeric_limits<size_t>::max();
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Stream for 'ReadFileStream()' which produces the contents of a file
+// as a stream of 'ByteBuffer' chunks.
+//
+// Up to 'read_ahead' reads of consecutive chunks are kept in flight so
+// that the next chunk has (hopefully) already been read by the time
+// the downstream asks for it. Each chunk is read into a block from a
+// 'ByteBufferPool' which gets reused for a later chunk once the
+// downstream is done with it.
+struct _ReadFileStream final {
+  template <typename K_, typename Errors_>
+  struct Continuation final : public TypeErasedStream {
+    Continuation(
+        K_ k,
+        EventLoop& loop,
+        const File& file,
+        size_t offset,
+        const ReadFileStreamOptions& options)
+      : loop_(loop),
+        file_(file),
+        offset_(offset),
+        remaining_(options.bytes),
+        options_(options),
+        context_(&loop_, "ReadFileStream (start/fail/stop/next/done)"),
+        interrupt_context_(&loop_, "ReadFileStream (interrupt)"),
+        k_(std::move(k)) {
+      CHECK_GT(options_.chunk_size, 0u);
+      CHECK_LE(
+          options_.chunk_size,
+          std::numeric_limits<unsigned int>::max());
+      CHECK_GT(options_.read_ahead, 0u);
+    }
+
+    Continuation(Continuation&& that) noexcept
+      : loop_(that.loop_),
+        file_(that.file_),
+        offset_(that.offset_),
+        remaining_(that.remaining_),
+        options_(that.options_),
+        context_(&that.loop_, "ReadFileStream (start/fail/stop/next/done)"),
+        interrupt_context_(&that.loop_, "ReadFileStream (interrupt)"),
+        k_(std::move(that.k_)) {
+      CHECK(!that.started_ && !that.completed_) << "moving after starting";
+      CHECK(!handler_);
+    }
+
+    ~Continuation() override {
+      CHECK(!started_ || finished_);
+    }
+
+    void Start() {
+      CHECK(!started_ && !completed_);
+
+      if (handler_.has_value() && !handler_->Install()) {
+        // Interrupt has already been triggered.
+        loop_.Submit(
+            [this]() {
+              if (!completed_) {
+                completed_ = true;
+                k_.Stop();
+              }
+            },
+            context_);
+      } else {
+        loop_.Submit(
+            [this]() {
+              if (!completed_) {
+                started_ = true;
+
+                pool_ = ByteBufferPool::Create(
+                    options_.chunk_size,
+                    options_.read_ahead);
+
+                // NOTE: the slots must not move once any reads have
+                // been started since their callbacks refer to them.
+                slots_ = std::make_unique<Slot[]>(options_.read_ahead);
+
+                for (size_t i = 0; i < options_.read_ahead; i++) {
+                  Slot& slot = slots_[i];
+                  slot.continuation = this;
+                }
+
+                Issue();
+
+                k_.Begin(*this);
+              }
+            },
+            context_);
+      }
+    }
+
+    template <typename Error>
+    void Fail(Error&& error) {
+      error_.Emplace(std::forward<Error>(error));
+
+      // Submitting to event loop to avoid race with interrupt.
+      loop_.Submit(
+          [this]() {
+            completed_ = true;
+            k_.Fail(error_.template Extract<Error>());
+          },
+          context_);
+    }
+
+    void Stop() {
+      // Submitting to event loop to avoid race with interrupt.
+      loop_.Submit(
+          [this]() {
+            completed_ = true;
+            k_.Stop();
+          },
+          context_);
+    }
+
+    void Register(Interrupt& interrupt) {
+      k_.Register(interrupt);
+
+      handler_.emplace(&interrupt, [this]() {
+        loop_.Submit(
+            [this]() {
+              if (!started_) {
+                if (!completed_) {
+                  completed_ = true;
+                  k_.Stop();
+                }
+              } else if (!completed_) {
+                Complete(Ending::Stopped);
+              }
+            },
+            interrupt_context_);
+      });
+    }
+
+    void Next() override {
+      loop_.Submit(
+          [this]() {
+            if (!completed_) {
+              requested_ = true;
+              Progress();
+            }
+          },
+          context_);
+    }
+
+    void Done() override {
+      loop_.Submit(
+          [this]() {
+            if (!completed_) {
+              Complete(Ending::Ended);
+            }
+          },
+          context_);
+    }
+
+   private:
+    // Storage for one of the reads that are kept in flight.
+    struct Slot final {
+      Continuation* continuation = nullptr;
+
+      Request request;
+      IoUring::Operation operation;
+
+      std::shared_ptr<char> block;
+      size_t offset = 0;
+      size_t size = 0;
+
+      // Set once the read has completed.
+      std::optional<int> result;
+    };
+
+    enum class Ending {
+      Ended,
+      Failed,
+      Stopped,
+    };
+
+    // Starts reads of the next chunks until 'read_ahead' are either
+    // in flight or waiting for the downstream.
+    void Issue() {
+      issuing_ = true;
+
+      while (!completed_
+             && !eof_
+             && remaining_ > 0
+             && issued_ < options_.read_ahead) {
+        Slot& slot = slots_[(head_ + issued_) % options_.read_ahead];
+
+        slot.block = pool_->Acquire();
+        slot.offset = offset_;
+        slot.size = std::min(options_.chunk_size, remaining_);
+        slot.result.reset();
+
+        offset_ += slot.size;
+        remaining_ -= slot.size;
+
+        issued_++;
+        outstanding_++;
+
+        Read(slot);
+      }
+
+      issuing_ = false;
+    }
+
+    void Read(Slot& slot) {
+      // NOTE: the callback gets moved out when it's invoked so we need
+      // to set it for every read.
+      slot.operation.callback = [&slot](int result) {
+        slot.continuation->Completed(slot, result);
+      };
+
+      IoUring* io_uring = loop_.io_uring();
+
+      if (io_uring != nullptr
+          && io_uring->Read(
+              &slot.operation,
+              file_,
+              file_.fixed(io_uring),
+              slot.block.get(),
+              slot.size,
+              slot.offset)) {
+        return;
+      }
+
+      // NOTE: using a new request for each read so that the previous
+      // one gets cleaned up.
+      slot.request = Request();
+      slot.request->data = &slot;
+
+      uv_buf_t buffer = uv_buf_init(slot.block.get(), slot.size);
+
+      auto error = uv_fs_read(
+          loop_,
+          slot.request,
+          file_,
+          &buffer,
+          1,
+          slot.offset,
+          [](uv_fs_t* request) {
+            auto& slot = *static_cast<Slot*>(request->data);
+            slot.operation.callback(request->result);
+          });
+
+      if (error) {
+        slot.operation.callback(error);
+      }
+    }
+
+    void Completed(Slot& slot, int result) {
+      CHECK_GT(outstanding_, 0u);
+      outstanding_--;
+
+      slot.result = result;
+
+      // A short read (or an error) means there isn't anything more to
+      // read so we stop starting new reads.
+      if (result < 0 || size_t(result) < slot.size) {
+        eof_ = true;
+      }
+
+      // NOTE: a read that fails immediately completes while we're
+      // still in 'Issue()' in which case we'll make progress later.
+      if (!issuing_) {
+        Progress();
+      }
+    }
+
+    // Emits the next chunk if the downstream has asked for it and it
+    // has been read, or ends the stream if there aren't any more.
+    void Progress() {
+      if (completed_) {
+        Finish();
+        return;
+      }
+
+      if (!requested_) {
+        return;
+      }
+
+      if (issued_ == 0) {
+        Complete(Ending::Ended);
+        return;
+      }
+
+      Slot& slot = slots_[head_];
+
+      if (!slot.result.has_value()) {
+        return; // Wait for the read to complete.
+      }
+
+      int result = *slot.result;
+
+      head_ = (head_ + 1) % options_.read_ahead;
+      issued_--;
+
+      if (result < 0) {
+        failure_ = uv_strerror(result);
+        Complete(Ending::Failed);
+      } else if (result == 0) {
+        Complete(Ending::Ended);
+      } else {
+        requested_ = false;
+
+        const char* data = slot.block.get();
+
+        ByteBuffer chunk(
+            ByteBuffer::Slice(std::move(slot.block), data, result));
+
+        // Keep the reads going while the downstream is busy.
+        Issue();
+
+        k_.Body(std::move(chunk));
+      }
+    }
+
+    // Ends the stream once all outstanding reads have completed since
+    // they refer to this continuation.
+    void Complete(Ending ending) {
+      CHECK(!completed_);
+      completed_ = true;
+      ending_ = ending;
+      Finish();
+    }
+
+    void Finish() {
+      CHECK(completed_);
+
+      if (finished_ || outstanding_ > 0) {
+        return;
+      }
+
+      finished_ = true;
+
+      for (size_t i = 0; i < options_.read_ahead; i++) {
+        slots_[i].block.reset();
+      }
+
+      switch (ending_) {
+        case Ending::Ended:
+          k_.Ended();
+          break;
+        case Ending::Failed:
+          k_.Fail(RuntimeError(std::move(failure_)));
+          break;
+        case Ending::Stopped:
+          k_.Stop();
+          break;
+      }
+    }
+
+    EventLoop& loop_;
+    const File& file_;
+
+    // Offset of the next chunk to read and how many bytes are left to
+    // be read after it.
+    size_t offset_ = 0;
+    size_t remaining_ = 0;
+
+    ReadFileStreamOptions options_;
+
+    std::shared_ptr<ByteBufferPool> pool_;
+
+    // Ring of slots, starting at 'head_', of which 'issued_' are
+    // either being read or waiting for the downstream.
+    std::unique_ptr<Slot[]> slots_;
+    size_t head_ = 0;
+    size_t issued_ = 0;
+
+    // Number of reads that haven't completed.
+    size_t outstanding_ = 0;
+
+    bool started_ = false;
+    bool issuing_ = false;
+
+    // Whether or not the downstream has asked for the next chunk.
+    bool requested_ = false;
+
+    // Whether or not a read came up short, i.e., hit the end of file.
+    bool eof_ = false;
+
+    // Whether or not the stream is ending and how, and whether or not
+    // it has ended (which only happens once all reads completed).
+    bool completed_ = false;
+    bool finished_ = false;
+    Ending ending_ = Ending::Ended;
+    std::string failure_;
+
+    // NOTE: only one of 'Start()', 'Fail()', 'Stop()', 'Next()', or
+    // 'Done()' is ever outstanding at a time so they can all share
+    // 'context_'.
+    Scheduler::Context context_;
+    Scheduler::Context interrupt_context_;
+
+    std::optional<Interrupt::Handler> handler_;
+
+    // Used to hold on to an error while we hop to the event loop.
+    ErrorStorage<Errors_> error_;
+
+    // NOTE: we store 'k_' as the _last_ member so it will be
+    // destructed _first_ and thus we won't have any use-after-delete
+    // issues during destruction of 'k_' if it holds any references or
+    // pointers to any (or within any) of the above members.
+    K_ k_;
+  };
+
+  struct Composable final {
+    template <typename Arg, typename Errors>
+    using ValueFrom = ByteBuffer;
+
+    template <typename Arg, typename Errors>
+    using ErrorsFrom = tuple_types_union_t<
+        Errors,
+        std::tuple<RuntimeError>>;
+
+    template <typename Arg, typename Errors, typename K>
+    auto k(K k) && {
+      return Continuation<K, Errors>(
+          std::move(k),
+          loop_,
+          file_,
+          offset_,
+          options_);
+    }
+
+    template <typename Downstream>
+    static constexpr bool CanCompose = Downstream::ExpectsStream;
+
+    using Expects = SingleValue;
+
+    EventLoop& loop_;
+    const File& file_;
+    size_t offset_;
+    ReadFileStreamOptions options_;
+  };
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns a stream of the contents of 'file' starting at 'offset' as
+// 'ByteBuffer' chunks, see 'ReadFileStreamOptions'.
+//
+// NOTE: 'file' must outlive the stream.
+[[nodiscard]] inline auto ReadFileStream(
+    const File& file,
+    const size_t& offset = 0,
+    const ReadFileStreamOptions& options = ReadFileStreamOptions(),
+    EventLoop& loop = EventLoop::Current()) {
+  return _ReadFileStream::Composable{loop, file, offset, options};
+}
+
+////////////////////////////////////////////////////////////////////////
+
+struct WriteFileStreamOptions final {
+  // Number of writes to keep in flight while waiting for the upstream
+  // to produce more chunks.
+  size_t writes_in_flight = 4;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Eventual for 'WriteFileStream()' which writes each chunk of an
+// upstream stream to a file, one after another, and then produces the
+// total number of bytes written.
+//
+// The next chunk is requested from the upstream as soon as the write
+// of the previous one has started (rather than completed) so long as
+// fewer than 'writes_in_flight' writes are outstanding. Each write is
+// a single gather write of all of the slices of a chunk.
+struct _WriteFileStream final {
+  template <typename K_, typename Errors_>
+  struct Continuation final {
+    Continuation(
+        K_ k,
+        EventLoop& loop,
+        const File& file,
+        size_t offset,
+        const WriteFileStreamOptions& options)
+      : loop_(loop),
+        file_(file),
+        offset_(offset),
+        options_(options),
+        context_(&loop_, "WriteFileStream (begin/body/ended/fail/stop)"),
+        interrupt_context_(&loop_, "WriteFileStream (interrupt)"),
+        k_(std::move(k)) {
+      CHECK_GT(options_.writes_in_flight, 0u);
+    }
+
+    Continuation(Continuation&& that) noexcept
+      : loop_(that.loop_),
+        file_(that.file_),
+        offset_(that.offset_),
+        options_(that.options_),
+        context_(&that.loop_, "WriteFileStream (begin/body/ended/fail/stop)"),
+        interrupt_context_(&that.loop_, "WriteFileStream (interrupt)"),
+        k_(std::move(that.k_)) {
+      CHECK(!that.started_ && !that.completed_) << "moving after starting";
+      CHECK(!handler_);
+    }
+
+    ~Continuation() {
+      CHECK_EQ(outstanding_, 0u);
+    }
+
+    void Begin(TypeErasedStream& stream) {
+      CHECK(!started_ && !completed_);
+
+      stream_ = &stream;
+
+      if (handler_.has_value() && !handler_->Install()) {
+        // Interrupt has already been triggered.
+        loop_.Submit(
+            [this]() {
+              if (!completed_) {
+                completed_ = true;
+                stopped_ = true;
+                stream_->Done();
+              }
+            },
+            context_);
+      } else {
+        loop_.Submit(
+            [this]() {
+              if (!completed_) {
+                started_ = true;
+
+                // NOTE: the slots must not move once any writes have
+                // been started since their callbacks refer to them.
+                slots_ = std::make_unique<Slot[]>(options_.writes_in_flight);
+
+                for (size_t i = 0; i < options_.writes_in_flight; i++) {
+                  Slot& slot = slots_[i];
+                  slot.continuation = this;
+                }
+
+                RequestNext();
+              }
+            },
+            context_);
+      }
+    }
+
+    template <typename Chunk>
+    void Body(Chunk&& chunk) {
+      // NOTE: the event loop won't touch 'chunk_' until after we've
+      // submitted below and we only ever ask for one chunk at a time
+      // so it's safe to update it here.
+      if constexpr (std::is_convertible_v<Chunk, ByteBuffer>) {
+        chunk_ = std::forward<Chunk>(chunk);
+      } else {
+        chunk_ = ByteBuffer(std::string(std::forward<Chunk>(chunk)));
+      }
+
+      loop_.Submit(
+          [this]() {
+            requested_ = false;
+            if (!completed_) {
+              Write(std::move(chunk_));
+              RequestNext();
+            } else {
+              // We asked for this chunk before we failed (or were
+              // interrupted), now we can tell the upstream that we're
+              // done.
+              chunk_ = ByteBuffer();
+              stream_->Done();
+            }
+          },
+          context_);
+    }
+
+    void Ended() {
+      loop_.Submit(
+          [this]() {
+            ended_ = true;
+            Finish();
+          },
+          context_);
+    }
+
+    template <typename Error>
+    void Fail(Error&& error) {
+      error_.Emplace(std::forward<Error>(error));
+
+      // Submitting to event loop to avoid race with interrupt.
+      loop_.Submit(
+          [this]() {
+            // NOTE: we can't propagate the failure until all of the
+            // outstanding writes have completed so 'error_' holds on
+            // to it until 'Finish()'.
+            upstream_ = [this]() {
+              k_.Fail(error_.template Extract<Error>());
+            };
+
+            completed_ = true;
+            ended_ = true;
+            Finish();
+          },
+          context_);
+    }
+
+    void Stop() {
+      // Submitting to event loop to avoid race with interrupt.
+      loop_.Submit(
+          [this]() {
+            completed_ = true;
+            stopped_ = true;
+            ended_ = true;
+            Finish();
+          },
+          context_);
+    }
+
+    void Register(Interrupt& interrupt) {
+      k_.Register(interrupt);
+
+      handler_.emplace(&interrupt, [this]() {
+        loop_.Submit(
+            [this]() {
+              if (!completed_) {
+                completed_ = true;
+                stopped_ = true;
+
+                // Tell the upstream we're done (or that we will be
+                // once we get the chunk we asked for), we'll stop
+                // once it has ended.
+                if (!requested_ && !ended_) {
+                  stream_->Done();
+                }
+              }
+            },
+            interrupt_context_);
+      });
+    }
+
+   private:
+    // Storage for one of the writes that are kept in flight.
+    struct Slot final {
+      Continuation* continuation = nullptr;
+
+      Request request;
+      IoUring::Operation operation;
+
+      bool busy = false;
+
+      // What's being written, which must remain valid until the write
+      // completes, along with a buffer for each of its slices.
+      ByteBuffer data;
+      std::vector<uv_buf_t> buffers;
+    };
+
+    // Asks the upstream for the next chunk if there is a slot to write
+    // it with.
+    void RequestNext() {
+      if (!completed_
+          && !ended_
+          && !requested_
+          && outstanding_ < options_.writes_in_flight) {
+        requested_ = true;
+        stream_->Next();
+      }
+    }
+
+    void Write(ByteBuffer&& data) {
+      if (data.empty()) {
+        return;
+      }
+
+      Slot* slot = nullptr;
+      for (size_t i = 0; i < options_.writes_in_flight; i++) {
+        if (!slots_[i].busy) {
+          slot = &slots_[i];
+          break;
+        }
+      }
+
+      CHECK_NOTNULL(slot);
+
+      slot->busy = true;
+      slot->data = std::move(data);
+
+      // NOTE: libuv doesn't write to the buffers so it's safe to cast
+      // away the const.
+      slot->buffers.clear();
+      for (const ByteBuffer::Slice& slice : slot->data.slices()) {
+        slot->buffers.push_back(uv_buf_init(
+            const_cast<char*>(slice.data()),
+            slice.size()));
+      }
+
+      size_t offset = offset_;
+      offset_ += slot->data.size();
+
+      outstanding_++;
+
+      // NOTE: the callback gets moved out when it's invoked so we need
+      // to set it for every write.
+      slot->operation.callback = [slot](int result) {
+        slot->continuation->Completed(*slot, result);
+      };
+
+      IoUring* io_uring = loop_.io_uring();
+
+      // NOTE: the kernel rejects more than 'IOV_MAX' (1024) buffers
+      // for a single write whereas libuv splits them up.
+      if (io_uring != nullptr
+          && slot->buffers.size() <= 1024
+          && io_uring->Write(
+              &slot->operation,
+              file_,
+              file_.fixed(io_uring),
+              slot->buffers.data(),
+              slot->buffers.size(),
+              offset)) {
+        return;
+      }
+
+      // NOTE: using a new request for each write so that the previous
+      // one gets cleaned up.
+      slot->request = Request();
+      slot->request->data = slot;
+
+      auto error = uv_fs_write(
+          loop_,
+          slot->request,
+          file_,
+          slot->buffers.data(),
+          slot->buffers.size(),
+          offset,
+          [](uv_fs_t* request) {
+            auto& slot = *static_cast<Slot*>(request->data);
+            slot.operation.callback(request->result);
+          });
+
+      if (error) {
+        slot->operation.callback(error);
+      }
+    }
+
+    void Completed(Slot& slot, int result) {
+      CHECK_GT(outstanding_, 0u);
+      outstanding_--;
+
+      size_t size = slot.data.size();
+
+      slot.busy = false;
+      slot.data = ByteBuffer();
+
+      if (result >= 0 && size_t(result) == size) {
+        written_ += size;
+      } else if (!failure_.has_value()) {
+        // NOTE: a short write means that something is wrong, e.g.,
+        // the disk is full, so we fail rather than try again.
+        failure_ = result < 0
+            ? std::string(uv_strerror(result))
+            : std::string("Failed to write entire chunk");
+
+        if (!completed_) {
+          completed_ = true;
+          if (!requested_ && !ended_) {
+            stream_->Done();
+          }
+        }
+      }
+
+      RequestNext();
+      Finish();
+    }
+
+    // Continues with the outcome once the upstream has ended _and_
+    // all of the outstanding writes have completed.
+    void Finish() {
+      if (!ended_ || outstanding_ > 0 || finished_) {
+        return;
+      }
+
+      finished_ = true;
+      completed_ = true;
+
+      if (upstream_) {
+        upstream_();
+      } else if (failure_.has_value()) {
+        k_.Fail(RuntimeError(std::move(*failure_)));
+      } else if (stopped_) {
+        k_.Stop();
+      } else {
+        k_.Start(written_);
+      }
+    }
+
+    EventLoop& loop_;
+    const File& file_;
+
+    // Offset of the next chunk to write.
+    size_t offset_ = 0;
+
+    WriteFileStreamOptions options_;
+
+    TypeErasedStream* stream_ = nullptr;
+
+    ByteBuffer chunk_;
+
+    std::unique_ptr<Slot[]> slots_;
+
+    // Number of writes that haven't completed.
+    size_t outstanding_ = 0;
+
+    // Total number of bytes written.
+    size_t written_ = 0;
+
+    bool started_ = false;
+
+    // Whether or not we've asked the upstream for the next chunk.
+    bool requested_ = false;
+
+    // Whether or not the upstream has ended (or failed or stopped).
+    bool ended_ = false;
+
+    // Whether or not we're done writing chunks, and whether or not
+    // we've continued with the outcome.
+    bool completed_ = false;
+    bool finished_ = false;
+
+    bool stopped_ = false;
+    std::optional<std::string> failure_;
+
+    // Propagates a failure from the upstream, if any, which is held
+    // in 'error_' until then.
+    Callback<void()> upstream_;
+    ErrorStorage<Errors_> error_;
+
+    // NOTE: the upstream only ever has one of 'Begin()', 'Body()',
+    // 'Ended()', 'Fail()', or 'Stop()' outstanding at a time so they
+    // can all share 'context_'.
+    Scheduler::Context context_;
+    Scheduler::Context interrupt_context_;
+
+    std::optional<Interrupt::Handler> handler_;
+
+    // NOTE: we store 'k_' as the _last_ member so it will be
+    // destructed _first_ and thus we won't have any use-after-delete
+    // issues during destruction of 'k_' if it holds any references or
+    // pointers to any (or within any) of the above members.
+    K_ k_;
+  };
+
+  struct Composable final {
+    template <typename Arg, typename Errors>
+    using ValueFrom = size_t;
+
+    template <typename Arg, typename Errors>
+    using ErrorsFrom = tuple_types_union_t<
+        Errors,
+        std::tuple<RuntimeError>>;
+
+    template <typename Arg, typename Errors, typename K>
+    auto k(K k) && {
+      static_assert(
+          std::is_convertible_v<Arg, std::string>
+              || std::is_convertible_v<Arg, ByteBuffer>,
+          "'WriteFileStream()' expects a stream of 'std::string' or "
+          "'ByteBuffer' chunks");
+
+      return Continuation<K, Errors>(
+          std::move(k),
+          loop_,
+          file_,
+          offset_,
+          options_);
+    }
+
+    template <typename Downstream>
+    static constexpr bool CanCompose = Downstream::ExpectsValue;
+
+    using Expects = StreamOfValues;
+
+    EventLoop& loop_;
+    const File& file_;
+    size_t offset_;
+    WriteFileStreamOptions options_;
+  };
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns an eventual that expects a stream of 'std::string' (or
+// 'ByteBuffer') chunks which get written one after another to 'file'
+// starting at 'offset' and then results in the total number of bytes
+// written, see 'WriteFileStreamOptions'.
+//
+// NOTE: 'file' must outlive the eventual.
+[[nodiscard]] inline auto WriteFileStream(
+    const File& file,
+    const size_t& offset = 0,
+    const WriteFileStreamOptions& options = WriteFileStreamOptions(),
+    EventLoop& loop = EventLoop::Current()) {
+  return _WriteFileStream::Composable{loop, file, offset, options};
+}
+
+////////////////////////////////////////////////////////////////////////
+
 } // namespace filesystem
 } // namespace eventuals
 
@@ -6,6 +6,7 @@
 #include <variant>
 
 #include "eventuals/finally.h"
+#include "eventuals/recycler.h"
 #include "eventuals/stream.h"
 #include "eventuals/task.h"
 #include "eventuals/terminal.h"
@@ -214,7 +215,7 @@ struct _Generator final {
                   std::is_void_v<From>,
                   std::monostate,
                   From>>&&,
-          std::unique_ptr<void, Callback<void(void*)>>&,
+          TypeErasedStorage&,
           Interrupt&,
           GeneratorBeginCallback&&,
           GeneratorFailCallback<Raises>&&,
@@ -330,7 +331,7 @@ struct _Generator final {
 
     DispatchCallback<From_, To_, Catches_, Raises_, Args_...> dispatch_;
 
-    std::unique_ptr<void, Callback<void(void*)>> e_;
+    TypeErasedStorage e_;
     Interrupt* interrupt_ = nullptr;
 
     // NOTE: we store 'k_' as the _last_ member so it will be
@@ -460,7 +461,7 @@ struct _Generator final {
                               std::is_void_v<From_>,
                               std::monostate,
                               From_>>&& arg,
-                      std::unique_ptr<void, Callback<void(void*)>>& e_,
+                      TypeErasedStorage& e_,
                       Interrupt& interrupt,
                       GeneratorBeginCallback&& begin,
                       GeneratorFailCallback<Raises_>&& fail,
@@ -468,21 +469,15 @@ struct _Generator final {
                       GeneratorBodyCallback<To_>&& body,
                       GeneratorEndedCallback&& ended) mutable {
         if (!e_) {
-          e_ = std::unique_ptr<void, Callback<void(void*)>>(
-              new HeapGenerator<
+          // NOTE: the continuation is stored inline within 'e_' if it
+          // fits, otherwise it's allocated from the 'Recycler'.
+          e_.template Emplace<
+              HeapGenerator<
                   E,
                   From_,
                   To_,
                   Catches_,
-                  Raises_>(f(args...)),
-              [](void* e) {
-                delete static_cast<HeapGenerator<
-                    E,
-                    From_,
-                    To_,
-                    Catches_,
-                    Raises_>*>(e);
-              });
+                  Raises_>>(f(args...));
         }
 
         auto* e = static_cast<
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "eventuals/byte-buffer.h"
+#include "grpcpp/support/byte_buffer.h"
+#include "grpcpp/support/slice.h"
+#include "grpcpp/support/status.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+namespace grpc {
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns a '::grpc::ByteBuffer' with a slice for each of the slices
+// of 'buffer' without copying any bytes, each keeps the memory it
+// points into alive until gRPC is done with it.
+inline ::grpc::ByteBuffer ToGrpcByteBuffer(const ByteBuffer& buffer) {
+  std::vector<::grpc::Slice> slices;
+  slices.reserve(buffer.slices().size());
+
+  for (const ByteBuffer::Slice& slice : buffer.slices()) {
+    // NOTE: gRPC never writes to the memory of a slice created with
+    // a destroy function so it's safe to cast away the const.
+    slices.emplace_back(
+        const_cast<char*>(slice.data()),
+        slice.size(),
+        +[](void* user_data) {
+          delete static_cast<ByteBuffer::Slice*>(user_data);
+        },
+        new ByteBuffer::Slice(slice));
+  }
+
+  return ::grpc::ByteBuffer(slices.data(), slices.size());
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns a 'ByteBuffer' with a slice for each of the slices of
+// 'buffer' without copying any bytes (gRPC's slices are reference
+// counted so we just hold on to a reference for each).
+inline ByteBuffer FromGrpcByteBuffer(const ::grpc::ByteBuffer& buffer) {
+  ByteBuffer result;
+
+  std::vector<::grpc::Slice> slices;
+  if (buffer.Valid() && buffer.Dump(&slices).ok()) {
+    for (::grpc::Slice& slice : slices) {
+      auto owner = std::make_shared<::grpc::Slice>(std::move(slice));
+      const char* data = reinterpret_cast<const char*>(owner->begin());
+      size_t size = owner->size();
+      result.Append(ByteBuffer::Slice(std::move(owner), data, size));
+    }
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace grpc
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
+
+// Lets 'eventuals::ByteBuffer' be used wherever gRPC serializes
+// messages, e.g., for "raw" calls that proxy bytes without parsing.
+template <>
+class grpc::SerializationTraits<eventuals::ByteBuffer> {
+ public:
+  static ::grpc::Status Serialize(
+      const eventuals::ByteBuffer& buffer,
+      ::grpc::ByteBuffer* result,
+      bool* own_buffer) {
+    *result = eventuals::grpc::ToGrpcByteBuffer(buffer);
+    *own_buffer = true;
+    return ::grpc::Status::OK;
+  }
+
+  static ::grpc::Status Deserialize(
+      ::grpc::ByteBuffer* buffer,
+      eventuals::ByteBuffer* result) {
+    *result = eventuals::grpc::FromGrpcByteBuffer(*buffer);
+    buffer->Clear();
+    return ::grpc::Status::OK;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////
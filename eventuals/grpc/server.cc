@@ -56,25 +56,37 @@ auto Server::RequestCall(
 auto Server::Lookup(ServerContext* context) {
   // NOTE: 'context' is stored in a 'Closure()' so safe to capture as
   // a reference here.
-  return Synchronized(Then([this, context]() {
-    Endpoint* endpoint = nullptr;
-
-    auto iterator = endpoints_.find(
-        std::make_pair(context->method(), context->host()));
-
-    if (iterator != endpoints_.end()) {
-      endpoint = iterator->second.get();
-    } else {
-      iterator = endpoints_.find(
-          std::make_pair(context->method(), "*"));
-
-      if (iterator != endpoints_.end()) {
-        endpoint = iterator->second.get();
-      }
-    }
+  return Then([this, context]() {
+    // NOTE: endpoints are sharded by path so the endpoint for the
+    // specific host and the one for any host ("*") are in the same
+    // shard. We can't determine the shard until now because we don't
+    // know the path until a call has been requested.
+    size_t shard = Shard(context->method());
+
+    return Synchronized(
+        shard,
+        Then([this, context, shard]() {
+          auto& endpoints = endpoints_[shard];
+
+          Endpoint* endpoint = nullptr;
+
+          auto iterator = endpoints.find(
+              std::make_pair(context->method(), context->host()));
+
+          if (iterator != endpoints.end()) {
+            endpoint = iterator->second.get();
+          } else {
+            iterator = endpoints.find(
+                std::make_pair(context->method(), "*"));
+
+            if (iterator != endpoints.end()) {
+              endpoint = iterator->second.get();
+            }
+          }
 
-    return endpoint;
-  }));
+          return endpoint;
+        }));
+  });
 }
 
 ////////////////////////////////////////////////////////////////////////
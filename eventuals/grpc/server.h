@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cassert>
 #include <chrono>
 #include <deque>
@@ -25,6 +26,7 @@
 #include "eventuals/loop.h"
 #include "eventuals/map.h"
 #include "eventuals/pipe.h"
+#include "eventuals/range.h"
 #include "eventuals/repeat.h"
 #include "eventuals/task.h"
 #include "eventuals/then.h"
@@ -540,7 +542,10 @@ using BorrowedOrOwnedCompletionThreadPool =
 
 ////////////////////////////////////////////////////////////////////////
 
-class Server : public Synchronizable {
+// NOTE: endpoints are partitioned by path across the shards of a
+// 'StripedSynchronizable' so that dispatching calls for different
+// methods doesn't contend on a single lock.
+class Server : public StripedSynchronizable<16> {
  public:
   ~Server();
 
@@ -617,9 +622,14 @@ class Server : public Synchronizable {
 
   std::vector<std::unique_ptr<Worker>> workers_;
 
-  absl::flat_hash_map<
-      std::pair<std::string, std::string>,
-      std::unique_ptr<Endpoint>>
+  // Endpoints keyed by path and host, one map for each shard (see
+  // 'Shard()') which must only be accessed while holding the lock
+  // for that shard.
+  std::array<
+      absl::flat_hash_map<
+          std::pair<std::string, std::string>,
+          std::unique_ptr<Endpoint>>,
+      shards()>
       endpoints_;
 };
 
@@ -701,14 +711,17 @@ auto Server::Validate(const std::string& name) {
 ////////////////////////////////////////////////////////////////////////
 
 inline auto Server::Insert(std::unique_ptr<Endpoint>&& endpoint) {
+  size_t shard = Shard(endpoint->path());
   return Synchronized(
+      shard,
       Eventual<void>()
           .raises<RuntimeError>()
-          .start([this, endpoint = std::move(endpoint)](auto& k) mutable {
+          .start([this, shard, endpoint = std::move(endpoint)](
+                     auto& k) mutable {
             auto key = std::make_pair(endpoint->path(), endpoint->host());
 
             auto [_, inserted] =
-                endpoints_.try_emplace(key, std::move(endpoint));
+                endpoints_[shard].try_emplace(key, std::move(endpoint));
 
             if (!inserted) {
               k.Fail(RuntimeError(
@@ -728,14 +741,20 @@ inline auto Server::Insert(std::unique_ptr<Endpoint>&& endpoint) {
 ////////////////////////////////////////////////////////////////////////
 
 inline auto Server::ShutdownEndpoints() {
-  return Synchronized(Then([this]() {
-    return Iterate(endpoints_)
-        >> Map([](auto& entry) {
-             auto& [_, endpoint] = entry;
-             return endpoint->Shutdown();
-           })
-        >> Loop();
-  }));
+  return Range(shards())
+      >> Map([this](int shard) {
+           return Synchronized(
+               shard,
+               Then([this, shard]() {
+                 return Iterate(endpoints_[shard])
+                     >> Map([](auto& entry) {
+                          auto& [_, endpoint] = entry;
+                          return endpoint->Shutdown();
+                        })
+                     >> Loop();
+               }));
+         })
+      >> Loop();
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -1,5 +1,10 @@
 #include "eventuals/http.h"
 
+#include <algorithm>
+#include <sstream>
+
+#include "absl/strings/ascii.h"
+
 ////////////////////////////////////////////////////////////////////////
 
 namespace {
@@ -24,3 +29,604 @@ const CURLGlobalInitializer initializer_;
 } // namespace
 
 ////////////////////////////////////////////////////////////////////////
+
+namespace eventuals::http {
+
+////////////////////////////////////////////////////////////////////////
+
+std::optional<std::string> Easy::Initialize(Request& request) {
+  CHECK(!easy_) << "already initialized";
+
+  // If applicable, PEM encode any certificate now before we start
+  // anything and can easily propagate an error.
+  std::optional<std::string> pem_certificate;
+
+  auto certificate = request.certificate();
+  if (certificate) {
+    auto encoded = pem::Encode(x509::Certificate(*certificate));
+
+    if (!encoded) {
+      return "Failed to PEM encode certificate";
+    }
+
+    pem_certificate = std::move(*encoded);
+  }
+
+  easy_.reset(CHECK_NOTNULL(curl_easy_init()));
+
+  if (pem_certificate) {
+    curl_blob blob = {};
+    blob.data = pem_certificate->data();
+    blob.len = pem_certificate->size();
+    blob.flags = CURL_BLOB_COPY;
+    CHECK_EQ(
+        curl_easy_setopt(
+            easy_.get(),
+            CURLOPT_CAINFO_BLOB,
+            &blob),
+        CURLE_OK);
+  }
+
+  if (request.verify_peer()) {
+    CHECK_EQ(
+        curl_easy_setopt(
+            easy_.get(),
+            CURLOPT_SSL_VERIFYPEER,
+            request.verify_peer().value()),
+        CURLE_OK);
+  }
+
+  switch (request.method()) {
+    case Method::GET:
+      CHECK_EQ(
+          curl_easy_setopt(
+              easy_.get(),
+              CURLOPT_HTTPGET,
+              1),
+          CURLE_OK);
+      break;
+    case Method::POST:
+      // Converting PostFields, if any (there's no query to get
+      // otherwise, e.g., for 'Client::Upload()').
+      if (!request.fields().empty()) {
+        std::unique_ptr<
+            CURLU,
+            decltype(&curl_url_cleanup)>
+            curl_url_handle(
+                curl_url(),
+                &curl_url_cleanup);
+        CHECK_EQ(
+            curl_url_set(
+                curl_url_handle.get(),
+                CURLUPART_URL,
+                request.uri().c_str(),
+                0),
+            CURLUE_OK);
+        for (const auto& field : request.fields()) {
+          std::string combined =
+              field.first
+              + '='
+              + field.second;
+          CHECK_EQ(
+              curl_url_set(
+                  curl_url_handle.get(),
+                  CURLUPART_QUERY,
+                  combined.c_str(),
+                  CURLU_APPENDQUERY | CURLU_URLENCODE),
+              CURLUE_OK);
+        }
+        char* url_string = nullptr;
+        CHECK_EQ(
+            curl_url_get(
+                curl_url_handle.get(),
+                CURLUPART_QUERY,
+                &url_string,
+                0),
+            CURLUE_OK);
+        fields_.reset(url_string);
+      }
+      // End of conversion.
+
+      CHECK_EQ(
+          curl_easy_setopt(
+              easy_.get(),
+              CURLOPT_HTTPPOST,
+              1),
+          CURLE_OK);
+      CHECK_EQ(
+          curl_easy_setopt(
+              easy_.get(),
+              CURLOPT_POSTFIELDS,
+              fields_.get()),
+          CURLE_OK);
+
+      break;
+  }
+
+  // Transform 'Request' headers to curl's linked list.
+  curl_slist* list = nullptr;
+
+  for (const auto& [key, value] : request.headers()) {
+    // TODO(folming): use fmt library to append strings.
+    // https://github.com/fmtlib/fmt
+    std::string header = key;
+    header.append(": ");
+    header.append(value);
+
+    // 'curl_slist_append()' copies 'header' so we don't
+    //  have to worry about its lifetime.
+    list = CHECK_NOTNULL(curl_slist_append(list, header.c_str()));
+  }
+
+  headers_.reset(list);
+
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+
+  CHECK_EQ(
+      curl_easy_setopt(
+          easy_.get(),
+          CURLOPT_HTTPHEADER,
+          headers_.get()),
+      CURLE_OK);
+  CHECK_EQ(
+      curl_easy_setopt(
+          easy_.get(),
+          CURLOPT_URL,
+          request.uri().c_str()),
+      CURLE_OK);
+  // Option to follow redirects.
+  CHECK_EQ(
+      curl_easy_setopt(
+          easy_.get(),
+          CURLOPT_FOLLOWLOCATION,
+          1),
+      CURLE_OK);
+  // The internal mechanism of libcurl to provide timeout
+  // support.
+  // Not accurate at very low values.
+  // 0 means that transfer can run indefinitely.
+  CHECK_EQ(
+      curl_easy_setopt(
+          easy_.get(),
+          CURLOPT_TIMEOUT_MS,
+          static_cast<long>(
+              duration_cast<milliseconds>(request.timeout()).count())),
+      CURLE_OK);
+  // If onoff is 1, libcurl will not use any functions that
+  // install signal handlers or any functions that cause signals
+  // to be sent to the process. This option is here to allow
+  // multi-threaded unix applications to still set/use all
+  // timeout options etc, without risking getting signals.
+  // More here: https://curl.se/libcurl/c/CURLOPT_NOSIGNAL.html
+  CHECK_EQ(
+      curl_easy_setopt(
+          easy_.get(),
+          CURLOPT_NOSIGNAL,
+          1),
+      CURLE_OK);
+
+  return std::nullopt;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+Headers ParseHeaders(std::string&& buffer) {
+  std::stringstream stream(std::move(buffer));
+  Headers headers;
+
+  while (!stream.eof()) {
+    std::string line;
+    std::getline(stream, line);
+
+    // Find where ':' is.
+    auto column_iterator = std::find(
+        line.cbegin(),
+        line.cend(),
+        ':');
+
+    // Skip lines like 'HTTP/1.1 200' that aren't headers.
+    if (column_iterator == line.cend()) {
+      continue;
+    }
+
+    // Assign key and value.
+    std::string key(line.cbegin(), column_iterator);
+    std::string value(column_iterator + 1, line.cend());
+
+    // Remove leading and trailing spaces.
+    key = absl::StripAsciiWhitespace(key);
+    value = absl::StripAsciiWhitespace(value);
+
+    // Add key and value to the map.
+    // RFC 7230, section 3.2.2:
+    // A recipient MAY combine multiple header fields with the same
+    // field name into one "field-name: field-value" pair, without
+    // changing the semantics of the message, by appending each
+    // subsequent field value to the combined field value in order,
+    // separated by a comma. The order in which header fields with
+    // the same field name are received is therefore significant to
+    // the interpretation of the combined field value; a proxy MUST
+    // NOT change the order of these field values when forwarding a
+    // message.
+    //
+    // NOTE: If user tries to add an already existing header,
+    // append the new one to the old one using comma.
+    // Example:
+    // Cookie: cookie1=value1, cookie2=value2
+    auto iterator = headers.find(key);
+    if (iterator == headers.end()) {
+      // Header doesn't exist yet.
+      headers.emplace(std::move(key), std::move(value));
+    } else {
+      // Header already exists.
+      iterator->second += ", ";
+      iterator->second += value;
+    }
+  }
+
+  return headers;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+Pool::Pool(EventLoop& loop, const Limits& limits)
+  : loop_(loop),
+    share_(CHECK_NOTNULL(curl_share_init()), &curl_share_cleanup),
+    multi_(CHECK_NOTNULL(curl_multi_init()), &curl_multi_cleanup) {
+  // NOTE: no need for 'CURLSHOPT_LOCKFUNC' since the share handle is
+  // only ever used from within the event loop.
+  CHECK_EQ(
+      curl_share_setopt(
+          share_.get(),
+          CURLSHOPT_SHARE,
+          CURL_LOCK_DATA_DNS),
+      CURLSHE_OK);
+  CHECK_EQ(
+      curl_share_setopt(
+          share_.get(),
+          CURLSHOPT_SHARE,
+          CURL_LOCK_DATA_SSL_SESSION),
+      CURLSHE_OK);
+
+  CHECK_EQ(
+      curl_multi_setopt(
+          multi_.get(),
+          CURLMOPT_SOCKETDATA,
+          this),
+      CURLM_OK);
+  CHECK_EQ(
+      curl_multi_setopt(
+          multi_.get(),
+          CURLMOPT_SOCKETFUNCTION,
+          &Pool::SocketFunction),
+      CURLM_OK);
+  CHECK_EQ(
+      curl_multi_setopt(
+          multi_.get(),
+          CURLMOPT_TIMERDATA,
+          this),
+      CURLM_OK);
+  CHECK_EQ(
+      curl_multi_setopt(
+          multi_.get(),
+          CURLMOPT_TIMERFUNCTION,
+          &Pool::TimerFunction),
+      CURLM_OK);
+
+  if (limits.max_idle_connections) {
+    CHECK_EQ(
+        curl_multi_setopt(
+            multi_.get(),
+            CURLMOPT_MAXCONNECTS,
+            limits.max_idle_connections.value()),
+        CURLM_OK);
+  }
+
+  if (limits.max_connections_per_host) {
+    CHECK_EQ(
+        curl_multi_setopt(
+            multi_.get(),
+            CURLMOPT_MAX_HOST_CONNECTIONS,
+            limits.max_connections_per_host.value()),
+        CURLM_OK);
+  }
+
+  if (limits.max_connections) {
+    CHECK_EQ(
+        curl_multi_setopt(
+            multi_.get(),
+            CURLMOPT_MAX_TOTAL_CONNECTIONS,
+            limits.max_connections.value()),
+        CURLM_OK);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+Pool::~Pool() {
+  CHECK_EQ(transfers_, 0u) << "destructing pool with outstanding transfers";
+  CHECK(timer_ == nullptr && polls_.empty());
+
+  // Don't let libcurl call back into us while it closes any idle
+  // connections.
+  CHECK_EQ(
+      curl_multi_setopt(
+          multi_.get(),
+          CURLMOPT_SOCKETFUNCTION,
+          nullptr),
+      CURLM_OK);
+  CHECK_EQ(
+      curl_multi_setopt(
+          multi_.get(),
+          CURLMOPT_TIMERFUNCTION,
+          nullptr),
+      CURLM_OK);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void Pool::Add(CURL* easy, Transfer* transfer) {
+  CHECK(EventLoop::InEventLoop());
+
+  CHECK_EQ(
+      curl_easy_setopt(easy, CURLOPT_SHARE, share_.get()),
+      CURLE_OK);
+  CHECK_EQ(
+      curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer),
+      CURLE_OK);
+
+  // NOTE: incrementing before adding since adding will likely invoke
+  // 'TimerFunction()' which only starts a timer if we have transfers.
+  transfers_++;
+
+  CHECK_EQ(curl_multi_add_handle(multi_.get(), easy), CURLM_OK);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void Pool::Remove(CURL* easy) {
+  Detach(easy);
+  CloseIfIdle();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void Pool::Detach(CURL* easy) {
+  CHECK(EventLoop::InEventLoop());
+  CHECK_GT(transfers_, 0u);
+
+  CHECK_EQ(curl_multi_remove_handle(multi_.get(), easy), CURLM_OK);
+
+  // Don't keep a reference to the share handle around in the event
+  // the easy handle outlives this pool.
+  CHECK_EQ(
+      curl_easy_setopt(easy, CURLOPT_SHARE, nullptr),
+      CURLE_OK);
+
+  transfers_--;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void Pool::Action(curl_socket_t socket, int flags) {
+  // Keep ourselves alive in case a completed transfer drops the last
+  // reference to this pool.
+  std::shared_ptr<Pool> self = shared_from_this();
+
+  // Stores the amount of running easy handles. Unused since there
+  // might be transfers that finished and we have to check for all
+  // of them regardless.
+  int running_handles = 0;
+
+  curl_multi_socket_action(multi_.get(), socket, flags, &running_handles);
+
+  // Stores the amount of remaining messages in multi handle. Unused.
+  int messages = 0;
+
+  while (CURLMsg* message = curl_multi_info_read(multi_.get(), &messages)) {
+    if (message->msg != CURLMSG_DONE) {
+      continue;
+    }
+
+    // NOTE: 'message' is invalid after removing the easy handle so
+    // we need to copy out everything we need first.
+    CURL* easy = message->easy_handle;
+    CURLcode code = message->data.result;
+
+    Transfer* transfer = nullptr;
+    CHECK_EQ(
+        curl_easy_getinfo(easy, CURLINFO_PRIVATE, &transfer),
+        CURLE_OK);
+
+    Detach(easy);
+
+    // NOTE: the transfer might add another transfer (or be
+    // destructed) so we don't touch it after this.
+    CHECK_NOTNULL(transfer)->Completed(code);
+  }
+
+  CloseIfIdle();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void Pool::CloseIfIdle() {
+  // NOTE: we can't close a poll until libcurl stops tracking its
+  // socket (see 'CURL_POLL_REMOVE' in 'SocketFunction()') since
+  // libcurl only tells us about a socket when what it's waiting for
+  // changes, so the timer stays open as long as there are any polls
+  // in case libcurl needs it for them, e.g., to time out a shutdown.
+  if (transfers_ > 0 || !polls_.empty()) {
+    return;
+  }
+
+  if (timer_ != nullptr) {
+    // We don't have to check uv_is_active for timer since
+    // libuv checks it by itself.
+    // Return value is always 0.
+    uv_timer_stop(timer_);
+    uv_close(
+        (uv_handle_t*) timer_,
+        [](uv_handle_t* handle) {
+          delete (uv_timer_t*) handle;
+        });
+    timer_ = nullptr;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+int Pool::SocketFunction(
+    CURL* easy,
+    curl_socket_t socket,
+    int what,
+    void* data,
+    void* poll) {
+  Pool& pool = *static_cast<Pool*>(data);
+
+  static auto poll_callback = [](uv_poll_t* handle, int status, int events) {
+    Pool& pool = *static_cast<Pool*>(handle->data);
+
+    int flags = 0;
+    if (status < 0) {
+      flags = CURL_CSELECT_ERR;
+    }
+    if (status == 0 && (events & UV_READABLE)) {
+      flags |= CURL_CSELECT_IN;
+    }
+    if (status == 0 && (events & UV_WRITABLE)) {
+      flags |= CURL_CSELECT_OUT;
+    }
+
+    // Getting underlying socket desriptor from poll handle.
+    uv_os_fd_t socket_descriptor;
+    uv_fileno((uv_handle_t*) handle, &socket_descriptor);
+
+    // Perform an action for the particular socket which is the one
+    // we are currently working with. We don't want to perform an
+    // action on every socket inside libcurl - only that one.
+    pool.Action((curl_socket_t) socket_descriptor, flags);
+  };
+
+  switch (what) {
+    case CURL_POLL_IN:
+    case CURL_POLL_OUT:
+    case CURL_POLL_INOUT: {
+      int events = 0;
+      if (what & CURL_POLL_IN) {
+        events |= UV_READABLE;
+      }
+      if (what & CURL_POLL_OUT) {
+        events |= UV_WRITABLE;
+      }
+
+      // If no poll handle is assigned to this socket.
+      if (poll == nullptr) {
+        // Keep ourselves alive while we have any polls since they
+        // can only be closed from within the event loop.
+        if (pool.polls_.empty()) {
+          pool.self_ = pool.shared_from_this();
+        }
+
+        poll = new uv_poll_t();
+        pool.polls_.push_back((uv_poll_t*) poll);
+
+        CHECK_EQ(
+            uv_poll_init_socket(pool.loop_, (uv_poll_t*) poll, socket),
+            0);
+
+        uv_handle_set_data((uv_handle_t*) poll, &pool);
+
+        // Assign created poll handle so that in the future we can get
+        // it through the 'poll' argument.
+        CHECK_EQ(
+            curl_multi_assign(pool.multi_.get(), socket, poll),
+            CURLM_OK);
+      }
+
+      // Stops poll handle if it was started.
+      if (uv_is_active((uv_handle_t*) poll)) {
+        CHECK_EQ(uv_poll_stop((uv_poll_t*) poll), 0);
+      }
+
+      CHECK_EQ(
+          uv_poll_start((uv_poll_t*) poll, events, poll_callback),
+          0);
+      break;
+    }
+    case CURL_POLL_REMOVE:
+      if (poll != nullptr) {
+        uv_poll_stop((uv_poll_t*) poll);
+        uv_close(
+            (uv_handle_t*) poll,
+            [](uv_handle_t* handle) {
+              delete (uv_poll_t*) handle;
+            });
+
+        pool.polls_.erase(
+            std::find(pool.polls_.begin(), pool.polls_.end(), poll));
+
+        // Remove assignment of poll handle to this socket.
+        CHECK_EQ(
+            curl_multi_assign(pool.multi_.get(), socket, nullptr),
+            CURLM_OK);
+
+        // NOTE: whoever called into libcurl, e.g., 'Action()' or a
+        // transfer calling 'Remove()', still holds a reference so
+        // this won't destruct us.
+        if (pool.polls_.empty()) {
+          pool.self_.reset();
+        }
+      }
+      break;
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+int Pool::TimerFunction(CURLM* multi, long timeout_ms, void* data) {
+  Pool& pool = *static_cast<Pool*>(data);
+
+  if (timeout_ms < 0) {
+    // Request to delete the timer.
+    if (pool.timer_ != nullptr) {
+      uv_timer_stop(pool.timer_);
+    }
+    return 0;
+  }
+
+  // Don't (re)create the timer for an idle pool, there is nothing
+  // for libcurl to do until the next transfer gets added.
+  if (pool.transfers_ == 0 && pool.polls_.empty()) {
+    return 0;
+  }
+
+  if (pool.timer_ == nullptr) {
+    pool.timer_ = new uv_timer_t();
+    CHECK_EQ(0, uv_timer_init(pool.loop_, pool.timer_));
+    uv_handle_set_data((uv_handle_t*) pool.timer_, &pool);
+  }
+
+  uv_timer_start(
+      pool.timer_,
+      [](uv_timer_t* handle) {
+        Pool& pool = *static_cast<Pool*>(handle->data);
+
+        // Called with CURL_SOCKET_TIMEOUT to perform an action with
+        // each and every socket currently in use by libcurl.
+        pool.Action(CURL_SOCKET_TIMEOUT, 0);
+      },
+      timeout_ms,
+      0);
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals::http
+
+////////////////////////////////////////////////////////////////////////
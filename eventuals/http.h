@@ -2,13 +2,17 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
-#include "absl/strings/ascii.h"
 #include "curl/curl.h"
+#include "eventuals/byte-buffer.h"
+#include "eventuals/errors.h"
 #include "eventuals/event-loop.h"
 #include "eventuals/scheduler.h"
+#include "eventuals/type-erased-stream.h"
 #include "eventuals/x509.h"
 
 ////////////////////////////////////////////////////////////////////////
@@ -297,24 +301,225 @@ struct Response final {
     return headers_;
   }
 
-  const std::string& body() const {
+  // NOTE: the body is made up of the chunks as they were received
+  // so that it doesn't need to be copied into one contiguous string,
+  // use 'ByteBuffer::ToString()' if that's what you need.
+  const ByteBuffer& body() const {
     return body_;
   }
 
  private:
   friend struct _HTTP;
+  friend struct _HTTPUpload;
 
   Response(
       long code,
       Headers&& headers,
-      std::string&& body)
+      ByteBuffer&& body)
     : code_(code),
       headers_(std::move(headers)),
       body_(std::move(body)) {}
 
   long code_ = 0;
   Headers headers_;
-  std::string body_;
+  ByteBuffer body_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Error for a response with a code >= 400 from 'Client::Stream()',
+// which otherwise has no way of surfacing the response code and
+// headers.
+class ResponseError final : public Error {
+ public:
+  ResponseError(long code, Headers&& headers)
+    : code_(code),
+      headers_(std::move(headers)),
+      what_("HTTP response code " + std::to_string(code)) {}
+
+  const long& code() const {
+    return code_;
+  }
+
+  const Headers& headers() const {
+    return headers_;
+  }
+
+  const char* what() const noexcept override {
+    return what_.c_str();
+  }
+
+ private:
+  long code_ = 0;
+  Headers headers_;
+  std::string what_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// A libcurl easy handle along with everything it references that has
+// to outlive a transfer, e.g., the converted 'PostFields' and the list
+// of headers.
+class Easy final {
+ public:
+  Easy()
+    : easy_(nullptr, &curl_easy_cleanup),
+      fields_(nullptr, &curl_free),
+      headers_(nullptr, &curl_slist_free_all) {}
+
+  Easy(Easy&&) = default;
+
+  // Creates an easy handle configured for everything in 'request',
+  // i.e., the method, URI, headers, timeout, and peer verification,
+  // but _not_ how the response gets written (or how the request body
+  // gets read). Returns an error if 'request' can't be configured,
+  // e.g., because its certificate could not be PEM encoded.
+  std::optional<std::string> Initialize(Request& request);
+
+  // Cleans up the easy handle, must be called from within the event
+  // loop if the handle was added to a 'Pool'.
+  void Reset() {
+    easy_.reset();
+    fields_.reset();
+    headers_.reset();
+  }
+
+  CURL* get() {
+    return easy_.get();
+  }
+
+  explicit operator bool() const {
+    return easy_ != nullptr;
+  }
+
+ private:
+  std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> easy_;
+
+  // Stores converted PostFields as a C string.
+  std::unique_ptr<char, decltype(&curl_free)> fields_;
+
+  std::unique_ptr<curl_slist, decltype(&curl_slist_free_all)> headers_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Parses the headers received from libcurl (via 'CURLOPT_HEADERFUNCTION')
+// which look like this:
+// --------------------------------
+// HTTP/1.1 200
+// SomeHeaderKey1: SomeHeaderValue1
+// SomeHeaderKey2: SomeHeaderValue2
+// --------------------------------
+Headers ParseHeaders(std::string&& buffer);
+
+////////////////////////////////////////////////////////////////////////
+
+// Shared state for all of the transfers from a 'Client' on a
+// particular 'EventLoop'.
+//
+// A single libcurl "multi" handle is used for every transfer so that
+// connections are kept alive and reused across requests rather than
+// doing a fresh TCP (and TLS) handshake each time, and a libcurl
+// "share" handle caches DNS lookups and TLS sessions so that even new
+// connections can skip resolving and do an abbreviated handshake.
+//
+// The libuv handles (the timer and one poll per socket) are only
+// kept open while there are outstanding transfers (or sockets that
+// libcurl is still tracking, e.g., while shutting down a connection)
+// so that an idle pool doesn't keep the event loop alive and can be
+// destructed from any thread. Everything else must be done from
+// within the event loop.
+class Pool final : public std::enable_shared_from_this<Pool> {
+ public:
+  // Implemented by each transfer added to a pool.
+  class Transfer {
+   public:
+    virtual ~Transfer() = default;
+
+    // Invoked from within the event loop once the transfer has
+    // completed (successfully or not) and its easy handle has been
+    // removed from the pool.
+    virtual void Completed(CURLcode code) = 0;
+  };
+
+  // Limits on the connections of a pool, any that aren't specified
+  // use the libcurl defaults. See:
+  // https://curl.se/libcurl/c/CURLMOPT_MAXCONNECTS.html
+  // https://curl.se/libcurl/c/CURLMOPT_MAX_HOST_CONNECTIONS.html
+  // https://curl.se/libcurl/c/CURLMOPT_MAX_TOTAL_CONNECTIONS.html
+  struct Limits final {
+    // Maximum number of idle connections kept alive for reuse.
+    std::optional<long> max_idle_connections;
+
+    // Maximum number of simultaneous connections to a single host,
+    // any additional transfers are queued until a connection frees up.
+    std::optional<long> max_connections_per_host;
+
+    // Maximum number of simultaneous connections overall.
+    std::optional<long> max_connections;
+  };
+
+  Pool(EventLoop& loop, const Limits& limits);
+
+  Pool(const Pool&) = delete;
+  Pool(Pool&&) = delete;
+
+  ~Pool();
+
+  EventLoop& loop() {
+    return loop_;
+  }
+
+  // Adds the (fully configured) easy handle for 'transfer' to this
+  // pool, starting the transfer.
+  void Add(CURL* easy, Transfer* transfer);
+
+  // Removes the easy handle of a transfer that has not yet completed,
+  // e.g., because it was interrupted. 'Transfer::Completed()' will
+  // not be invoked.
+  void Remove(CURL* easy);
+
+  // Returns the number of outstanding transfers.
+  size_t transfers() const {
+    return transfers_;
+  }
+
+ private:
+  static int SocketFunction(
+      CURL* easy,
+      curl_socket_t socket,
+      int what,
+      void* data,
+      void* poll);
+
+  static int TimerFunction(CURLM* multi, long timeout_ms, void* data);
+
+  // Lets libcurl perform any work for 'socket' (or for all sockets if
+  // 'CURL_SOCKET_TIMEOUT') and then completes any finished transfers.
+  void Action(curl_socket_t socket, int flags);
+
+  // Removes 'easy' without closing any libuv handles.
+  void Detach(CURL* easy);
+
+  // Closes the timer if there aren't any outstanding transfers or
+  // polls.
+  void CloseIfIdle();
+
+  EventLoop& loop_;
+
+  // NOTE: 'share_' must be declared before 'multi_' so that it gets
+  // destructed _after_ 'multi_'.
+  std::unique_ptr<CURLSH, decltype(&curl_share_cleanup)> share_;
+  std::unique_ptr<CURLM, decltype(&curl_multi_cleanup)> multi_;
+
+  uv_timer_t* timer_ = nullptr;
+  std::vector<uv_poll_t*> polls_;
+
+  // Set while there are any polls so that we don't get destructed
+  // before libcurl is done with their sockets.
+  std::shared_ptr<Pool> self_;
+
+  size_t transfers_ = 0;
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -338,17 +543,58 @@ class Client final {
 
   [[nodiscard]] auto Do(Request&& request);
 
+  // Returns a stream of the chunks of the response body as they
+  // arrive rather than buffering the entire body in memory. The
+  // transfer is paused until the downstream asks for the next chunk.
+  //
+  // NOTE: fails with a 'ResponseError' that holds the response code
+  // and headers for any response code >= 400, the body of which is
+  // discarded rather than streamed.
+  [[nodiscard]] auto Stream(Request&& request);
+
+  // Returns an eventual that expects a stream of 'std::string' (or
+  // 'ByteBuffer') chunks which get sent as the body of a POST (using
+  // chunked transfer encoding) as they are produced and then results
+  // in the 'Response'. The next chunk is only requested from the
+  // stream once the previous one has been sent.
+  [[nodiscard]] auto Upload(Request&& request);
+
  private:
-  template <bool, bool>
+  template <bool, bool, bool, bool, bool>
   class _Builder;
 
+  // Applies any of this client's defaults to 'request'.
+  void Prepare(Request& request);
+
+  // Returns the pool to use for transfers on 'loop', creating it if
+  // this is the first transfer on 'loop'.
+  std::shared_ptr<Pool> pool(EventLoop& loop);
+
   std::optional<bool> verify_peer_;
   std::optional<x509::Certificate> certificate_;
+  Pool::Limits limits_;
+
+  // A pool per event loop that transfers have been done on, e.g., a
+  // client used from each loop of an 'EventLoopGroup' has a pool for
+  // each loop since a pool's handles belong to a single loop.
+  struct Pools final {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<Pool>> pools;
+  };
+
+  // NOTE: shared by all copies of this client (and any outstanding
+  // transfers) so that a client can be used from multiple threads.
+  std::shared_ptr<Pools> pools_ = std::make_shared<Pools>();
 };
 
 ////////////////////////////////////////////////////////////////////////
 
-template <bool has_verify_peer_, bool has_certificate_>
+template <
+    bool has_verify_peer_,
+    bool has_certificate_,
+    bool has_max_idle_connections_,
+    bool has_max_connections_per_host_,
+    bool has_max_connections_>
 class Client::_Builder final : public builder::Builder {
  public:
   ~_Builder() override = default;
@@ -358,7 +604,10 @@ class Client::_Builder final : public builder::Builder {
     // TODO(benh): consider checking that the scheme is 'https'.
     return Construct<_Builder>(
         verify_peer_.Set(verify_peer),
-        std::move(certificate_));
+        std::move(certificate_),
+        std::move(max_idle_connections_),
+        std::move(max_connections_per_host_),
+        std::move(max_connections_));
   }
 
   // Specify the certificate to use when doing verification. Same
@@ -372,7 +621,47 @@ class Client::_Builder final : public builder::Builder {
     // TODO(benh): consider checking that the scheme is 'https'.
     return Construct<_Builder>(
         std::move(verify_peer_),
-        certificate_.Set(std::move(certificate)));
+        certificate_.Set(std::move(certificate)),
+        std::move(max_idle_connections_),
+        std::move(max_connections_per_host_),
+        std::move(max_connections_));
+  }
+
+  // Maximum number of idle connections to keep alive for reuse.
+  auto max_idle_connections(long max_idle_connections) && {
+    static_assert(
+        !has_max_idle_connections_,
+        "Duplicate 'max_idle_connections'");
+    return Construct<_Builder>(
+        std::move(verify_peer_),
+        std::move(certificate_),
+        max_idle_connections_.Set(max_idle_connections),
+        std::move(max_connections_per_host_),
+        std::move(max_connections_));
+  }
+
+  // Maximum number of simultaneous connections to a single host.
+  auto max_connections_per_host(long max_connections_per_host) && {
+    static_assert(
+        !has_max_connections_per_host_,
+        "Duplicate 'max_connections_per_host'");
+    return Construct<_Builder>(
+        std::move(verify_peer_),
+        std::move(certificate_),
+        std::move(max_idle_connections_),
+        max_connections_per_host_.Set(max_connections_per_host),
+        std::move(max_connections_));
+  }
+
+  // Maximum number of simultaneous connections overall.
+  auto max_connections(long max_connections) && {
+    static_assert(!has_max_connections_, "Duplicate 'max_connections'");
+    return Construct<_Builder>(
+        std::move(verify_peer_),
+        std::move(certificate_),
+        std::move(max_idle_connections_),
+        std::move(max_connections_per_host_),
+        max_connections_.Set(max_connections));
   }
 
   Client Build() && {
@@ -386,6 +675,20 @@ class Client::_Builder final : public builder::Builder {
       client.certificate_ = std::move(certificate_).value();
     }
 
+    if constexpr (has_max_idle_connections_) {
+      client.limits_.max_idle_connections =
+          std::move(max_idle_connections_).value();
+    }
+
+    if constexpr (has_max_connections_per_host_) {
+      client.limits_.max_connections_per_host =
+          std::move(max_connections_per_host_).value();
+    }
+
+    if constexpr (has_max_connections_) {
+      client.limits_.max_connections = std::move(max_connections_).value();
+    }
+
     return client;
   }
 
@@ -397,18 +700,43 @@ class Client::_Builder final : public builder::Builder {
 
   _Builder(
       builder::Field<bool, has_verify_peer_> verify_peer,
-      builder::Field<x509::Certificate, has_certificate_> certificate)
+      builder::Field<x509::Certificate, has_certificate_> certificate,
+      builder::Field<long, has_max_idle_connections_> max_idle_connections,
+      builder::Field<long, has_max_connections_per_host_>
+          max_connections_per_host,
+      builder::Field<long, has_max_connections_> max_connections)
     : verify_peer_(std::move(verify_peer)),
-      certificate_(std::move(certificate)) {}
+      certificate_(std::move(certificate)),
+      max_idle_connections_(std::move(max_idle_connections)),
+      max_connections_per_host_(std::move(max_connections_per_host)),
+      max_connections_(std::move(max_connections)) {}
 
   builder::Field<bool, has_verify_peer_> verify_peer_;
   builder::Field<x509::Certificate, has_certificate_> certificate_;
+  builder::Field<long, has_max_idle_connections_> max_idle_connections_;
+  builder::Field<long, has_max_connections_per_host_>
+      max_connections_per_host_;
+  builder::Field<long, has_max_connections_> max_connections_;
 };
 
 ////////////////////////////////////////////////////////////////////////
 
 inline auto Client::Builder() {
-  return Client::_Builder<false, false>();
+  return Client::_Builder<false, false, false, false, false>();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+inline std::shared_ptr<Pool> Client::pool(EventLoop& loop) {
+  std::scoped_lock lock(pools_->mutex);
+
+  for (std::shared_ptr<Pool>& pool : pools_->pools) {
+    if (&pool->loop() == &loop) {
+      return pool;
+    }
+  }
+
+  return pools_->pools.emplace_back(std::make_shared<Pool>(loop, limits_));
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -416,51 +744,40 @@ inline auto Client::Builder() {
 // Our own eventual for using libcurl with the EventLoop.
 //
 // The general algorithm:
-// 1. Create easy and multi handles. Set options for them.
-//    Add easy handle to multi handle with curl_multi_add_handle.
-//    TIMERFUNCTION is called to set a timer which will tell us when
-//    to perform checks on libcurl handles.
-//    SOCKETFUNCTION is called by using curl_multi_socket_action.
-//    We can pass specific socket descriptor to work with that particular
-//    socket or we can pass CURL_SOCKET_TIMEOUT to let libcurl call a function
-//    for each socket that is currently in use.
-// 2. Whenever SOCKETFUNCTION is called we check for events and set a poll
-//    handle for the particular socket. This poll handle is created on heap
-//    and that's why we put its pointer inside vector so that we can stop it
-//    when we have to interrupt the transfer.
-// 3. Whenever curl_multi_socket_action is called we can get an amount of
-//    remaining running easy handles. If this value is 0 then we read info
-//    from multi handle using check_multi_info lambda and clean everything up.
+// 1. Create an easy handle and set options for it. Add the easy
+//    handle to the client's 'Pool' which adds it to the pool's
+//    shared multi handle (and thus shares connections, DNS lookups,
+//    and TLS sessions with all other transfers from the client).
+// 2. The pool drives the multi handle with a timer and a poll handle
+//    per socket (see 'Pool' in http.cc) and once the transfer is done
+//    calls back into 'Completed()'.
+// 3. 'Completed()' reads the response code, cleans up the easy handle,
+//    and either builds the 'Response' or fails with the libcurl error.
 struct _HTTP final {
   template <typename K_>
-  struct Continuation final {
-    Continuation(K_ k, EventLoop& loop, Request&& request)
-      : loop_(loop),
+  struct Continuation final : public Pool::Transfer {
+    Continuation(K_ k, std::shared_ptr<Pool> pool, Request&& request)
+      : pool_(std::move(pool)),
+        loop_(pool_->loop()),
         request_(std::move(request)),
-        fields_string_(nullptr, &curl_free),
-        easy_(curl_easy_init(), &curl_easy_cleanup),
-        multi_(curl_multi_init(), &curl_multi_cleanup),
-        curl_headers_(nullptr, &curl_slist_free_all),
-        context_(&loop, "HTTP (start/fail/stop)"),
+        context_(&loop_, "HTTP (start/fail/stop)"),
         interrupt_context_(&loop_, "HTTP (interrupt)"),
         k_(std::move(k)) {}
 
     Continuation(Continuation&& that) noexcept
-      : loop_(that.loop_),
+      : pool_(std::move(that.pool_)),
+        loop_(that.loop_),
         request_(std::move(that.request_)),
-        fields_string_(std::move(that.fields_string_)),
         easy_(std::move(that.easy_)),
-        multi_(std::move(that.multi_)),
-        curl_headers_(std::move(that.curl_headers_)),
         context_(&that.loop_, "HTTP (start/fail/stop)"),
         interrupt_context_(&that.loop_, "HTTP (interrupt)"),
         k_(std::move(that.k_)) {
-      CHECK(!that.started_ || !that.completed_) << "moving after starting";
+      CHECK(!that.started_) << "moving after starting";
       CHECK(!handler_);
     }
 
-    ~Continuation() {
-      CHECK(!started_ || closed_);
+    ~Continuation() override {
+      CHECK(!started_ || completed_);
     }
 
     void Start() {
@@ -482,365 +799,19 @@ struct _HTTP final {
               if (!completed_) {
                 started_ = true;
 
-                CHECK(!error_);
-
-                CHECK_NOTNULL(easy_);
-                CHECK_NOTNULL(multi_);
-
-                // If applicable, PEM encode any certificate now before we start
-                // anything and can easily propagate an error.
-                auto certificate = request_.certificate();
-                if (certificate) {
-                  auto pem_certificate = pem::Encode(
-                      x509::Certificate(*certificate));
-
-                  if (!pem_certificate) {
-                    completed_ = true;
-
-                    k_.Fail(RuntimeError(
-                        "Failed to PEM encode certificate"));
-
-                    curl_easy_cleanup(easy_.get());
-                    curl_multi_cleanup(multi_.get());
-
-                    return; // Don't do anything else!
-                  } else {
-                    curl_blob blob = {};
-                    blob.data = pem_certificate->data();
-                    blob.len = pem_certificate->size();
-                    blob.flags = CURL_BLOB_COPY;
-                    CHECK_EQ(
-                        curl_easy_setopt(
-                            easy_.get(),
-                            CURLOPT_CAINFO_BLOB,
-                            &blob),
-                        CURLE_OK);
-                  }
+                if (auto error = easy_.Initialize(request_)) {
+                  completed_ = true;
+                  k_.Fail(RuntimeError(std::move(*error)));
+                  return; // Don't do anything else!
                 }
 
-                CHECK_EQ(0, uv_timer_init(loop_, &timer_));
-                uv_handle_set_data((uv_handle_t*) &timer_, this);
-
-                // Called only one time to finish the transfer
-                // and clean everything up.
-                static auto check_multi_info = [](Continuation& continuation) {
-                  continuation.completed_ = true;
-
-                  // Stores the amount of remaining messages in multi handle.
-                  // Unused.
-                  int msgq = 0;
-                  CURLMsg* message = curl_multi_info_read(
-                      continuation.multi_.get(),
-                      &msgq);
-
-                  // Getting the response code and body.
-                  switch (message->msg) {
-                    case CURLMSG_DONE:
-                      if (message->data.result == CURLE_OK) {
-                        curl_easy_getinfo(
-                            continuation.easy_.get(),
-                            CURLINFO_RESPONSE_CODE,
-                            &continuation.code_);
-                      } else {
-                        continuation.error_ = message->data.result;
-                      }
-                      break;
-                    default:
-                      continuation.error_ = CURLE_ABORTED_BY_CALLBACK;
-                      break;
-                  }
-
-                  // Stop transfer completely.
-                  CHECK_EQ(
-                      curl_multi_remove_handle(
-                          continuation.multi_.get(),
-                          message->easy_handle),
-                      CURLM_OK);
-
-                  // Memory cleanup.
-                  for (uv_poll_t* poll : continuation.polls_) {
-                    if (uv_is_active((uv_handle_t*) poll)) {
-                      uv_poll_stop(poll);
-                    }
-                    uv_close(
-                        (uv_handle_t*) poll,
-                        [](uv_handle_t* handle) {
-                          delete handle;
-                        });
-                  }
-
-                  continuation.polls_.clear();
-
-                  // We don't have to check uv_is_active for timer since
-                  // libuv checks it by itself.
-                  // Return value is always 0.
-                  uv_timer_stop(&continuation.timer_);
-                  uv_close(
-                      (uv_handle_t*) &continuation.timer_,
-                      [](uv_handle_t* handle) {
-                        auto& continuation = *(Continuation*) handle->data;
-                        continuation.closed_ = true;
-
-                        if (!continuation.error_) {
-                          // Build headers map.
-                          std::stringstream headers_buffer_stringstream(
-                              continuation.headers_buffer_.Extract());
-                          std::map<std::string, std::string> headers;
-
-                          // Typical 'headers_buffer_stringstream'
-                          // looks like this:
-                          // --------------------------------
-                          // HTTP/1.1 200
-                          // SomeHeaderKey1: SomeHeaderValue1
-                          // SomeHeaderKey2: SomeHeaderValue2
-                          // --------------------------------
-                          while (!headers_buffer_stringstream.eof()) {
-                            std::string line;
-                            std::getline(headers_buffer_stringstream, line);
-
-                            // Find where ':' is.
-                            auto column_iterator = std::find(
-                                line.cbegin(),
-                                line.cend(),
-                                ':');
-
-                            // Skip lines like 'HTTP/1.1 200' that aren't
-                            // headers.
-                            if (column_iterator == line.cend()) {
-                              continue;
-                            }
-
-                            // Assign key and value.
-                            std::string key(line.cbegin(), column_iterator);
-                            std::string value(column_iterator + 1, line.cend());
-
-                            // Remove leading and trailing spaces.
-                            key = absl::StripAsciiWhitespace(key);
-                            value = absl::StripAsciiWhitespace(value);
-
-                            // Add key and value to the map.
-                            // RFC 7230, section 3.2.2:
-                            // A recipient MAY combine multiple header fields
-                            // with the same field name into one
-                            // "field-name: field-value" pair, without changing
-                            // the semantics of the message, by appending each
-                            // subsequent field value to the combined field
-                            // value in order, separated by a comma. The order
-                            // in which header fields with the same field name
-                            // are received is therefore significant to the
-                            // interpretation of the combined field value;
-                            // a proxy MUST NOT change the order of these field
-                            // values when forwarding a message.
-                            //
-                            // NOTE: If user tries to add an already
-                            // existing header, append the new one
-                            // to the old one using comma.
-                            // Example:
-                            // Cookie: cookie1=value1, cookie2=value2
-                            auto iterator = headers.find(key);
-                            if (iterator == headers.end()) {
-                              // Header doesn't exist yet.
-                              headers.emplace(std::move(key), std::move(value));
-                            } else {
-                              // Header already exists.
-                              headers[key] += ", ";
-                              headers[key] += value;
-                            }
-                          }
-
-                          continuation.k_.Start(Response{
-                              continuation.code_,
-                              std::move(headers),
-                              continuation.body_buffer_.Extract()});
-                        } else {
-                          continuation.k_.Fail(
-                              RuntimeError(
-                                  curl_easy_strerror(
-                                      (CURLcode) continuation.error_)));
-                        }
-                      });
-                };
-
-                static auto poll_callback = [](uv_poll_t* handle,
-                                               int status,
-                                               int events) {
-                  auto& continuation = *(Continuation*) handle->data;
-
-                  int flags = 0;
-                  if (status < 0) {
-                    flags = CURL_CSELECT_ERR;
-                  }
-                  if (status == 0 && (events & UV_READABLE)) {
-                    flags |= CURL_CSELECT_IN;
-                  }
-                  if (status == 0 && (events & UV_WRITABLE)) {
-                    flags |= CURL_CSELECT_OUT;
-                  }
-
-                  // Getting underlying socket desriptor from poll handle.
-                  uv_os_fd_t socket_descriptor;
-                  uv_fileno(
-                      (uv_handle_t*) handle,
-                      &socket_descriptor);
-
-                  // Stores the amount of running easy handles.
-                  // Set by curl_multi_socket_action.
-                  int running_handles = 0;
-
-                  // Perform an action for the particular socket
-                  // which is the one we are currently working with.
-                  // We don't want to perform an action on every socket inside
-                  // libcurl - only that one.
-                  curl_multi_socket_action(
-                      continuation.multi_.get(),
-                      (curl_socket_t) socket_descriptor,
-                      flags,
-                      &running_handles);
-
-                  // If 0 - finalize the transfer.
-                  if (running_handles == 0) {
-                    check_multi_info(continuation);
-                  }
-                };
-
-                static auto timer_callback = [](uv_timer_t* handle) {
-                  auto& continuation = *(Continuation*) handle->data;
-
-                  // Stores the amount of running easy handles.
-                  // Set by curl_multi_socket_action.
-                  int running_handles = 0;
-
-                  // Called with CURL_SOCKET_TIMEOUT to
-                  // perform an action with each and every socket
-                  // currently in use by libcurl.
-                  curl_multi_socket_action(
-                      continuation.multi_.get(),
-                      CURL_SOCKET_TIMEOUT,
-                      0,
-                      &running_handles);
-
-                  // If 0 - finalize the transfer.
-                  if (running_handles == 0) {
-                    check_multi_info(continuation);
-                  }
-                };
-
-                static auto socket_function = +[](CURL* easy,
-                                                  curl_socket_t sockfd,
-                                                  int what,
-                                                  Continuation* continuation,
-                                                  void* socket_poller) {
-                  int events = 0;
-
-                  switch (what) {
-                    case CURL_POLL_IN:
-                    case CURL_POLL_OUT:
-                    case CURL_POLL_INOUT:
-                      // Add poll handle for this particular socket.
-                      if (what & CURL_POLL_IN) {
-                        events |= UV_READABLE;
-                      }
-                      if (what & CURL_POLL_OUT) {
-                        events |= UV_WRITABLE;
-                      }
-
-                      // If no poll handle is assigned to this socket.
-                      if (socket_poller == nullptr) {
-                        socket_poller = new uv_poll_t();
-                        continuation->polls_.push_back(
-                            (uv_poll_t*) socket_poller);
-
-                        CHECK_EQ(
-                            uv_poll_init_socket(
-                                continuation->loop_,
-                                (uv_poll_t*) socket_poller,
-                                sockfd),
-                            0);
-
-                        uv_handle_set_data(
-                            (uv_handle_t*) socket_poller,
-                            continuation);
-
-                        // Assign created poll handle so that in the future
-                        // we can get it through socket_poller argument.
-                        // Useful to check if we already have a poll handle
-                        // for the socket currently in use.
-                        CHECK_EQ(
-                            curl_multi_assign(
-                                continuation->multi_.get(),
-                                sockfd,
-                                socket_poller),
-                            CURLM_OK);
-                      }
-
-                      // Stops poll handle if it was started.
-                      if (uv_is_active((uv_handle_t*) socket_poller)) {
-                        CHECK_EQ(
-                            uv_poll_stop(
-                                (uv_poll_t*) socket_poller),
-                            0);
-                      }
-
-                      CHECK_EQ(
-                          uv_poll_start(
-                              (uv_poll_t*) socket_poller,
-                              events,
-                              poll_callback),
-                          0);
-
-                      break;
-                    case CURL_POLL_REMOVE:
-                      // Remove poll handle for this particular socket.
-                      uv_poll_stop((uv_poll_t*) socket_poller);
-                      uv_close(
-                          (uv_handle_t*) socket_poller,
-                          [](uv_handle_t* handle) {
-                            delete (uv_poll_t*) handle;
-                          });
-
-                      // Remove this poll handle from vector.
-                      for (auto it = continuation->polls_.begin();
-                           it != continuation->polls_.end();
-                           it++) {
-                        if (*it == (uv_poll_t*) socket_poller) {
-                          continuation->polls_.erase(it);
-                          break;
-                        }
-                      }
-
-                      // Remove assignment of poll handle to this socket.
-                      CHECK_EQ(
-                          curl_multi_assign(
-                              continuation->multi_.get(),
-                              sockfd,
-                              nullptr),
-                          CURLM_OK);
-                      break;
-                  }
-                };
-
-                // Used by libcurl to set a timer after
-                // which we should start checking handles inside libcurl.
-                static auto timer_function = +[](CURLM* multi,
-                                                 long timeout_ms,
-                                                 Continuation* continuation) {
-                  if (timeout_ms < 0) {
-                    timeout_ms = 0;
-                  }
-
-                  uv_timer_start(
-                      &continuation->timer_,
-                      timer_callback,
-                      timeout_ms,
-                      0);
-                };
-
                 // https://curl.se/libcurl/c/CURLOPT_WRITEFUNCTION.html
                 static auto write_function = +[](char* data,
                                                  size_t size,
                                                  size_t nmemb,
                                                  Continuation* continuation) {
-                  continuation->body_buffer_ += std::string(data, size * nmemb);
+                  continuation->body_buffer_.Append(
+                      ByteBuffer::Slice(std::string(data, size * nmemb)));
 
                   return nmemb * size;
                 };
@@ -857,151 +828,6 @@ struct _HTTP final {
                   return nmemb * size;
                 };
 
-                using std::chrono::duration_cast;
-                using std::chrono::milliseconds;
-
-                // CURL multi options.
-                CHECK_EQ(
-                    curl_multi_setopt(
-                        multi_.get(),
-                        CURLMOPT_SOCKETDATA,
-                        this),
-                    CURLM_OK);
-                CHECK_EQ(
-                    curl_multi_setopt(
-                        multi_.get(),
-                        CURLMOPT_SOCKETFUNCTION,
-                        socket_function),
-                    CURLM_OK);
-                CHECK_EQ(
-                    curl_multi_setopt(
-                        multi_.get(),
-                        CURLMOPT_TIMERDATA,
-                        this),
-                    CURLM_OK);
-                CHECK_EQ(
-                    curl_multi_setopt(
-                        multi_.get(),
-                        CURLMOPT_TIMERFUNCTION,
-                        timer_function),
-                    CURLM_OK);
-
-                // CURL easy options.
-                if (request_.verify_peer()) {
-                  CHECK_EQ(
-                      curl_easy_setopt(
-                          easy_.get(),
-                          CURLOPT_SSL_VERIFYPEER,
-                          request_.verify_peer().value()),
-                      CURLE_OK);
-                }
-
-                switch (request_.method()) {
-                  case Method::GET:
-                    CHECK_EQ(
-                        curl_easy_setopt(
-                            easy_.get(),
-                            CURLOPT_HTTPGET,
-                            1),
-                        CURLE_OK);
-                    break;
-                  case Method::POST:
-                    // Converting PostFields.
-                    std::unique_ptr<
-                        CURLU,
-                        decltype(&curl_url_cleanup)>
-                        curl_url_handle(
-                            curl_url(),
-                            &curl_url_cleanup);
-                    CHECK_EQ(
-                        curl_url_set(
-                            curl_url_handle.get(),
-                            CURLUPART_URL,
-                            request_.uri().c_str(),
-                            0),
-                        CURLUE_OK);
-                    for (const auto& field : request_.fields()) {
-                      std::string combined =
-                          field.first
-                          + '='
-                          + field.second;
-                      CHECK_EQ(
-                          curl_url_set(
-                              curl_url_handle.get(),
-                              CURLUPART_QUERY,
-                              combined.c_str(),
-                              CURLU_APPENDQUERY | CURLU_URLENCODE),
-                          CURLUE_OK);
-                    }
-                    char* url_string = nullptr;
-                    CHECK_EQ(
-                        curl_url_get(
-                            curl_url_handle.get(),
-                            CURLUPART_QUERY,
-                            &url_string,
-                            0),
-                        CURLUE_OK);
-                    fields_string_ = std::unique_ptr<
-                        char,
-                        decltype(&curl_free)>(
-                        url_string,
-                        &curl_free);
-                    // End of conversion.
-
-                    CHECK_EQ(
-                        curl_easy_setopt(
-                            easy_.get(),
-                            CURLOPT_HTTPPOST,
-                            1),
-                        CURLE_OK);
-                    CHECK_EQ(
-                        curl_easy_setopt(
-                            easy_.get(),
-                            CURLOPT_POSTFIELDS,
-                            fields_string_.get()),
-                        CURLE_OK);
-
-                    break;
-                }
-
-                // Transform 'Request' headers to curl's linked list.
-                for (const auto& [key, value] : request_.headers()) {
-                  // TODO(folming): use fmt library to append strings.
-                  // https://github.com/fmtlib/fmt
-                  std::string header = key;
-                  header.append(": ");
-                  header.append(value);
-
-                  // We should only be adding the headers once, so they
-                  // shouldn't yet exist!
-                  CHECK(!curl_headers_)
-                      << "not expecting to have already allocated headers";
-
-                  curl_slist* list = nullptr;
-
-                  // 'curl_slist_append()' copies 'header' so we don't
-                  //  have to worry about its lifetime.
-                  list = curl_slist_append(list, header.c_str());
-
-                  curl_headers_ = std::unique_ptr<
-                      curl_slist,
-                      decltype(&curl_slist_free_all)>(
-                      CHECK_NOTNULL(list),
-                      &curl_slist_free_all);
-                }
-
-                CHECK_EQ(
-                    curl_easy_setopt(
-                        easy_.get(),
-                        CURLOPT_HTTPHEADER,
-                        curl_headers_.get()),
-                    CURLE_OK);
-                CHECK_EQ(
-                    curl_easy_setopt(
-                        easy_.get(),
-                        CURLOPT_URL,
-                        request_.uri().c_str()),
-                    CURLE_OK);
                 CHECK_EQ(
                     curl_easy_setopt(
                         easy_.get(),
@@ -1026,44 +852,9 @@ struct _HTTP final {
                         CURLOPT_HEADERFUNCTION,
                         header_function),
                     CURLE_OK);
-                // Option to follow redirects.
-                CHECK_EQ(
-                    curl_easy_setopt(
-                        easy_.get(),
-                        CURLOPT_FOLLOWLOCATION,
-                        1),
-                    CURLE_OK);
-                // The internal mechanism of libcurl to provide timeout
-                // support.
-                // Not accurate at very low values.
-                // 0 means that transfer can run indefinitely.
-                CHECK_EQ(
-                    curl_easy_setopt(
-                        easy_.get(),
-                        CURLOPT_TIMEOUT_MS,
-                        static_cast<long>(duration_cast<milliseconds>(
-                                              request_.timeout())
-                                              .count())),
-                    CURLE_OK);
-                // If onoff is 1, libcurl will not use any functions that
-                // install signal handlers or any functions that cause signals
-                // to be sent to the process. This option is here to allow
-                // multi-threaded unix applications to still set/use all
-                // timeout options etc, without risking getting signals.
-                // More here: https://curl.se/libcurl/c/CURLOPT_NOSIGNAL.html
-                CHECK_EQ(
-                    curl_easy_setopt(
-                        easy_.get(),
-                        CURLOPT_NOSIGNAL,
-                        1),
-                    CURLE_OK);
 
                 // Start handling connection.
-                CHECK_EQ(
-                    curl_multi_add_handle(
-                        multi_.get(),
-                        easy_.get()),
-                    CURLM_OK);
+                pool_->Add(easy_.get(), this);
               }
             },
             context_);
@@ -1108,74 +899,72 @@ struct _HTTP final {
         loop_.Submit(
             [this]() {
               if (!started_) {
-                CHECK(!completed_ && !error_);
+                CHECK(!completed_);
                 completed_ = true;
                 k_.Stop();
               } else if (!completed_) {
-                CHECK(started_ && !error_);
+                CHECK(started_);
                 completed_ = true;
 
-                for (uv_poll_t* poll : polls_) {
-                  if (uv_is_active((uv_handle_t*) poll)) {
-                    uv_poll_stop(poll);
-                  }
-                  uv_close(
-                      (uv_handle_t*) poll,
-                      [](uv_handle_t* handle) {
-                        delete handle;
-                      });
-                }
-                polls_.clear();
-
-                // We don't have to check uv_is_active for timer since
-                // libuv checks it by itself.
-                // Return value is always 0.
-                uv_timer_stop(&timer_);
-                uv_close(
-                    (uv_handle_t*) &timer_,
-                    [](uv_handle_t* handle) {
-                      auto& continuation = *(Continuation*) handle->data;
-                      continuation.closed_ = true;
+                // Stop the transfer, any connection it was using will
+                // be closed (or kept alive for reuse) by the pool.
+                pool_->Remove(easy_.get());
 
-                      continuation.k_.Stop();
-                    });
+                easy_.Reset();
 
-                CHECK_EQ(
-                    curl_multi_remove_handle(
-                        multi_.get(),
-                        easy_.get()),
-                    CURLM_OK);
+                k_.Stop();
               }
             },
             interrupt_context_);
       });
     }
 
+    // Invoked by the 'Pool' from within the event loop.
+    void Completed(CURLcode code) override {
+      CHECK(started_ && !completed_);
+      completed_ = true;
+
+      long response_code = 0;
+
+      if (code == CURLE_OK) {
+        curl_easy_getinfo(
+            easy_.get(),
+            CURLINFO_RESPONSE_CODE,
+            &response_code);
+      }
+
+      // NOTE: cleaning up the easy handle here, within the event
+      // loop, because it uses the pool's "share" handle which is not
+      // safe to access concurrently.
+      easy_.Reset();
+
+      if (code == CURLE_OK) {
+        k_.Start(Response{
+            response_code,
+            ParseHeaders(headers_buffer_.Extract()),
+            std::move(body_buffer_)});
+      } else {
+        k_.Fail(RuntimeError(curl_easy_strerror(code)));
+      }
+    }
+
    private:
+    // NOTE: 'pool_' must be declared before 'easy_' so that any easy
+    // handle gets cleaned up before the pool might be destructed.
+    std::shared_ptr<Pool> pool_;
+
     EventLoop& loop_;
 
     Request request_;
 
-    // Stores converted PostFields as a C string.
-    std::unique_ptr<char, decltype(&curl_free)> fields_string_;
-
-    std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> easy_;
-    std::unique_ptr<CURLM, decltype(&curl_multi_cleanup)> multi_;
-    std::unique_ptr<curl_slist, decltype(&curl_slist_free_all)> curl_headers_;
-
-    uv_timer_t timer_ = {};
-    std::vector<uv_poll_t*> polls_;
+    Easy easy_;
 
     // Response variables.
-    long code_ = 0;
     EventLoop::Buffer headers_buffer_;
-    EventLoop::Buffer body_buffer_;
+    ByteBuffer body_buffer_;
 
     bool started_ = false;
     bool completed_ = false;
-    bool closed_ = false;
-
-    int error_ = 0;
 
     // NOTE: we use 'context_' in each of 'Start()', 'Fail()', and
     // 'Stop()' because only one of them will called at runtime.
@@ -1202,7 +991,10 @@ struct _HTTP final {
 
     template <typename Arg, typename Errors, typename K>
     auto k(K k) && {
-      return Continuation<K>(std::move(k), loop_, std::move(request_));
+      return Continuation<K>(
+          std::move(k),
+          std::move(pool_),
+          std::move(request_));
     }
 
     template <typename Downstream>
@@ -1210,31 +1002,858 @@ struct _HTTP final {
 
     using Expects = SingleValue;
 
-    EventLoop& loop_;
+    std::shared_ptr<Pool> pool_;
     Request request_;
   };
 };
 
 ////////////////////////////////////////////////////////////////////////
 
-[[nodiscard]] inline auto Client::Do(Request&& request) {
-  // TODO(benh): need 'Client::Default()'.
-  EventLoop& loop = EventLoop::Default();
+// Eventual for 'Client::Stream()' which produces a stream of the
+// chunks of a response body as they arrive.
+//
+// Backpressure is provided by pausing the transfer (returning
+// 'CURL_WRITEFUNC_PAUSE' from the write function) whenever a chunk
+// arrives before the downstream has asked for the next one and
+// unpausing it once it does. libcurl will then hand us the same data
+// again so we never have to buffer more than a single chunk.
+struct _HTTPStream final {
+  template <typename K_, typename Errors_>
+  struct Continuation final
+    : public Pool::Transfer,
+      public TypeErasedStream {
+    Continuation(K_ k, std::shared_ptr<Pool> pool, Request&& request)
+      : pool_(std::move(pool)),
+        loop_(pool_->loop()),
+        request_(std::move(request)),
+        context_(&loop_, "HTTP stream (start/fail/stop/next/done)"),
+        interrupt_context_(&loop_, "HTTP stream (interrupt)"),
+        k_(std::move(k)) {}
 
-  if (verify_peer_.has_value() && !request.verify_peer().has_value()) {
-    request.verify_peer_ = verify_peer_;
-  }
+    Continuation(Continuation&& that) noexcept
+      : pool_(std::move(that.pool_)),
+        loop_(that.loop_),
+        request_(std::move(that.request_)),
+        easy_(std::move(that.easy_)),
+        context_(&that.loop_, "HTTP stream (start/fail/stop/next/done)"),
+        interrupt_context_(&that.loop_, "HTTP stream (interrupt)"),
+        k_(std::move(that.k_)) {
+      CHECK(!that.started_) << "moving after starting";
+      CHECK(!handler_);
+    }
 
-  if (certificate_.has_value() && !request.certificate().has_value()) {
-    request.certificate_ = certificate_;
-  }
+    ~Continuation() override {
+      CHECK(!started_ || completed_);
+    }
+
+    void Start() {
+      CHECK(!started_ && !completed_);
+
+      if (handler_.has_value() && !handler_->Install()) {
+        // Interrupt has already been triggered.
+        loop_.Submit(
+            [this]() {
+              if (!completed_) {
+                completed_ = true;
+                k_.Stop();
+              }
+            },
+            context_);
+      } else {
+        loop_.Submit(
+            [this]() {
+              if (!completed_) {
+                started_ = true;
+
+                if (auto error = easy_.Initialize(request_)) {
+                  completed_ = true;
+                  k_.Fail(RuntimeError(std::move(*error)));
+                  return; // Don't do anything else!
+                }
+
+                // https://curl.se/libcurl/c/CURLOPT_WRITEFUNCTION.html
+                static auto write_function = +[](char* data,
+                                                 size_t size,
+                                                 size_t nmemb,
+                                                 Continuation* continuation) {
+                  long code = 0;
+                  curl_easy_getinfo(
+                      continuation->easy_.get(),
+                      CURLINFO_RESPONSE_CODE,
+                      &code);
+
+                  if (code >= 400) {
+                    // Discard the body of an error response, we'll
+                    // fail with a 'ResponseError' once it completes.
+                    return nmemb * size;
+                  }
+
+                  if (!continuation->requested_) {
+                    continuation->paused_ = true;
+                    return size_t(CURL_WRITEFUNC_PAUSE);
+                  }
+
+                  continuation->requested_ = false;
+
+                  continuation->k_.Body(std::string(data, size * nmemb));
+
+                  return nmemb * size;
+                };
+
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_WRITEDATA,
+                        this),
+                    CURLE_OK);
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_WRITEFUNCTION,
+                        write_function),
+                    CURLE_OK);
+
+                // https://curl.se/libcurl/c/CURLOPT_HEADERFUNCTION.html
+                static auto header_function = +[](char* data,
+                                                  size_t size,
+                                                  size_t nmemb,
+                                                  Continuation* continuation) {
+                  continuation->headers_buffer_ += std::string(
+                      data,
+                      size * nmemb);
+
+                  return nmemb * size;
+                };
+
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_HEADERDATA,
+                        this),
+                    CURLE_OK);
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_HEADERFUNCTION,
+                        header_function),
+                    CURLE_OK);
+
+                // Start handling connection.
+                pool_->Add(easy_.get(), this);
+
+                k_.Begin(*this);
+              }
+            },
+            context_);
+      }
+    }
+
+    template <typename Error>
+    void Fail(Error&& error) {
+      error_.Emplace(std::forward<Error>(error));
+
+      // Submitting to event loop to avoid race with interrupt.
+      loop_.Submit(
+          [this]() {
+            k_.Fail(error_.template Extract<Error>());
+          },
+          context_);
+    }
+
+    void Stop() {
+      // Submitting to event loop to avoid race with interrupt.
+      loop_.Submit(
+          [this]() {
+            k_.Stop();
+          },
+          context_);
+    }
+
+    void Register(Interrupt& interrupt) {
+      k_.Register(interrupt);
+
+      handler_.emplace(&interrupt, [this]() {
+        loop_.Submit(
+            [this]() {
+              if (!started_) {
+                CHECK(!completed_);
+                completed_ = true;
+                k_.Stop();
+              } else if (!completed_) {
+                if (requested_) {
+                  Abort();
+                  k_.Stop();
+                } else {
+                  // The downstream is still handling a chunk so stop
+                  // the transfer now but wait until it asks for the
+                  // next one before stopping.
+                  Cancel();
+                  interrupted_ = true;
+                }
+              }
+            },
+            interrupt_context_);
+      });
+    }
+
+    void Next() override {
+      loop_.Submit(
+          [this]() {
+            if (completed_) {
+              return;
+            }
+
+            requested_ = true;
+
+            if (interrupted_) {
+              completed_ = true;
+              k_.Stop();
+            } else if (result_) {
+              // The transfer completed before the downstream asked
+              // for more, i.e., there isn't any more.
+              End();
+            } else if (paused_) {
+              // NOTE: unpausing might synchronously invoke the write
+              // function (and thus 'k_.Body()').
+              paused_ = false;
+              CHECK_EQ(
+                  curl_easy_pause(easy_.get(), CURLPAUSE_CONT),
+                  CURLE_OK);
+            }
+          },
+          context_);
+    }
+
+    void Done() override {
+      loop_.Submit(
+          [this]() {
+            if (!completed_) {
+              Abort();
+              k_.Ended();
+            }
+          },
+          context_);
+    }
+
+    // Invoked by the 'Pool' from within the event loop.
+    void Completed(CURLcode code) override {
+      CHECK(started_ && !completed_);
+
+      if (code == CURLE_OK) {
+        curl_easy_getinfo(
+            easy_.get(),
+            CURLINFO_RESPONSE_CODE,
+            &response_code_);
+      }
+
+      // NOTE: cleaning up the easy handle here, within the event
+      // loop, because it uses the pool's "share" handle which is not
+      // safe to access concurrently.
+      easy_.Reset();
+
+      result_ = code;
+
+      // NOTE: if the downstream is still handling a chunk we wait
+      // for it to ask for more before ending (or failing).
+      if (requested_) {
+        End();
+      }
+    }
+
+   private:
+    // Ends (or fails) the stream once the transfer has completed.
+    void End() {
+      CHECK(result_);
+      completed_ = true;
+      if (*result_ != CURLE_OK) {
+        k_.Fail(RuntimeError(curl_easy_strerror(*result_)));
+      } else if (response_code_ >= 400) {
+        k_.Fail(ResponseError(
+            response_code_,
+            ParseHeaders(headers_buffer_.Extract())));
+      } else {
+        k_.Ended();
+      }
+    }
+
+    void Abort() {
+      CHECK(started_ && !completed_);
+      completed_ = true;
+      Cancel();
+    }
+
+    // Stops the transfer if it's still outstanding, any connection it
+    // was using will be closed (or kept alive for reuse) by the pool.
+    void Cancel() {
+      if (easy_) {
+        pool_->Remove(easy_.get());
+        easy_.Reset();
+      }
+    }
+
+    // NOTE: 'pool_' must be declared before 'easy_' so that any easy
+    // handle gets cleaned up before the pool might be destructed.
+    std::shared_ptr<Pool> pool_;
+
+    EventLoop& loop_;
+
+    Request request_;
+
+    Easy easy_;
+
+    EventLoop::Buffer headers_buffer_;
+
+    long response_code_ = 0;
+
+    bool started_ = false;
+    bool completed_ = false;
+
+    // Whether or not the downstream has asked for the next chunk.
+    bool requested_ = false;
+
+    // Whether or not the transfer is paused because a chunk arrived
+    // before the downstream asked for it.
+    bool paused_ = false;
+
+    // Result of a transfer that completed before the downstream
+    // asked for more.
+    std::optional<CURLcode> result_;
+
+    // Whether or not we were interrupted while the downstream was
+    // handling a chunk, in which case we stop once it asks for more.
+    bool interrupted_ = false;
+
+    // NOTE: only one of 'Start()', 'Fail()', 'Stop()', 'Next()', or
+    // 'Done()' is ever outstanding at a time so they can all share
+    // 'context_'.
+    Scheduler::Context context_;
+    Scheduler::Context interrupt_context_;
+
+    std::optional<Interrupt::Handler> handler_;
+
+    // Used to hold on to an error while we hop to the event loop.
+    ErrorStorage<Errors_> error_;
+
+    // NOTE: we store 'k_' as the _last_ member so it will be
+    // destructed _first_ and thus we won't have any use-after-delete
+    // issues during destruction of 'k_' if it holds any references or
+    // pointers to any (or within any) of the above members.
+    K_ k_;
+  };
+
+  struct Composable final {
+    template <typename Arg, typename Errors>
+    using ValueFrom = std::string;
+
+    template <typename Arg, typename Errors>
+    using ErrorsFrom = tuple_types_union_t<
+        Errors,
+        std::tuple<RuntimeError, ResponseError>>;
+
+    template <typename Arg, typename Errors, typename K>
+    auto k(K k) && {
+      return Continuation<K, Errors>(
+          std::move(k),
+          std::move(pool_),
+          std::move(request_));
+    }
+
+    template <typename Downstream>
+    static constexpr bool CanCompose = Downstream::ExpectsStream;
+
+    using Expects = SingleValue;
+
+    std::shared_ptr<Pool> pool_;
+    Request request_;
+  };
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Eventual for 'Client::Upload()' which sends each chunk of an
+// upstream stream as the body of a request (using chunked transfer
+// encoding since the size isn't known up front) and then produces the
+// 'Response'.
+//
+// The transfer is paused (by returning 'CURL_READFUNC_PAUSE' from the
+// read function) whenever libcurl has sent everything we've been given
+// so far and unpaused once the upstream provides the next chunk, so we
+// only ever hold onto a single chunk at a time.
+struct _HTTPUpload final {
+  template <typename K_, typename Errors_>
+  struct Continuation final : public Pool::Transfer {
+    Continuation(K_ k, std::shared_ptr<Pool> pool, Request&& request)
+      : pool_(std::move(pool)),
+        loop_(pool_->loop()),
+        request_(std::move(request)),
+        context_(&loop_, "HTTP upload (begin/body/ended/fail/stop)"),
+        interrupt_context_(&loop_, "HTTP upload (interrupt)"),
+        k_(std::move(k)) {}
+
+    Continuation(Continuation&& that) noexcept
+      : pool_(std::move(that.pool_)),
+        loop_(that.loop_),
+        request_(std::move(that.request_)),
+        easy_(std::move(that.easy_)),
+        context_(&that.loop_, "HTTP upload (begin/body/ended/fail/stop)"),
+        interrupt_context_(&that.loop_, "HTTP upload (interrupt)"),
+        k_(std::move(that.k_)) {
+      CHECK(!that.started_) << "moving after starting";
+      CHECK(!handler_);
+    }
+
+    ~Continuation() override {
+      CHECK(!started_ || completed_);
+    }
+
+    void Begin(TypeErasedStream& stream) {
+      CHECK(!started_ && !completed_);
+
+      stream_ = &stream;
+
+      if (handler_.has_value() && !handler_->Install()) {
+        // Interrupt has already been triggered.
+        loop_.Submit(
+            [this]() {
+              if (!completed_) {
+                completed_ = true;
+                stream_->Done();
+              }
+            },
+            context_);
+      } else {
+        loop_.Submit(
+            [this]() {
+              if (!completed_) {
+                started_ = true;
+
+                CHECK(request_.fields().empty())
+                    << "'PostFields' can't be used with 'Upload()'";
+
+                if (auto error = easy_.Initialize(request_)) {
+                  completed_ = true;
+                  failure_ = std::move(*error);
+                  // We'll fail once the upstream has ended.
+                  stream_->Done();
+                  return; // Don't do anything else!
+                }
+
+                // https://curl.se/libcurl/c/CURLOPT_READFUNCTION.html
+                static auto read_function = +[](char* buffer,
+                                                size_t size,
+                                                size_t nitems,
+                                                Continuation* continuation) {
+                  ByteBuffer& chunk = continuation->chunk_;
+
+                  if (!chunk.empty()) {
+                    size_t bytes = chunk.CopyTo(buffer, size * nitems);
+                    chunk.Consume(bytes);
+                    return bytes;
+                  } else if (continuation->ended_) {
+                    return size_t(0); // EOF.
+                  }
+
+                  // Ask for the next chunk (unless we already have)
+                  // and pause until it arrives.
+                  if (!continuation->requested_) {
+                    continuation->requested_ = true;
+                    continuation->stream_->Next();
+                  }
+
+                  continuation->paused_ = true;
+                  return size_t(CURL_READFUNC_PAUSE);
+                };
+
+                // https://curl.se/libcurl/c/CURLOPT_WRITEFUNCTION.html
+                static auto write_function = +[](char* data,
+                                                 size_t size,
+                                                 size_t nmemb,
+                                                 Continuation* continuation) {
+                  continuation->body_buffer_.Append(
+                      ByteBuffer::Slice(std::string(data, size * nmemb)));
+
+                  return nmemb * size;
+                };
+
+                // https://curl.se/libcurl/c/CURLOPT_HEADERFUNCTION.html
+                static auto header_function = +[](char* data,
+                                                  size_t size,
+                                                  size_t nmemb,
+                                                  Continuation* continuation) {
+                  continuation->headers_buffer_ += std::string(
+                      data,
+                      size * nmemb);
+
+                  return nmemb * size;
+                };
+
+                // Always a POST with a body read via 'read_function'
+                // of unknown size (i.e., chunked).
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_POSTFIELDS,
+                        nullptr),
+                    CURLE_OK);
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_POST,
+                        1),
+                    CURLE_OK);
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_POSTFIELDSIZE,
+                        -1L),
+                    CURLE_OK);
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_READDATA,
+                        this),
+                    CURLE_OK);
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_READFUNCTION,
+                        read_function),
+                    CURLE_OK);
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_WRITEDATA,
+                        this),
+                    CURLE_OK);
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_WRITEFUNCTION,
+                        write_function),
+                    CURLE_OK);
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_HEADERDATA,
+                        this),
+                    CURLE_OK);
+                CHECK_EQ(
+                    curl_easy_setopt(
+                        easy_.get(),
+                        CURLOPT_HEADERFUNCTION,
+                        header_function),
+                    CURLE_OK);
+
+                // Start handling connection.
+                pool_->Add(easy_.get(), this);
+              }
+            },
+            context_);
+      }
+    }
+
+    template <typename Chunk>
+    void Body(Chunk&& chunk) {
+      // NOTE: the event loop won't touch 'chunk_' until after it has
+      // been unpaused below so it's safe to update it here.
+      if constexpr (std::is_convertible_v<Chunk, ByteBuffer>) {
+        chunk_ = std::forward<Chunk>(chunk);
+      } else {
+        chunk_ = ByteBuffer(std::string(std::forward<Chunk>(chunk)));
+      }
+
+      loop_.Submit(
+          [this]() {
+            requested_ = false;
+            if (!completed_) {
+              Unpause();
+            } else {
+              // We asked for this chunk before the transfer completed
+              // (or was interrupted), now we can tell the upstream
+              // that we're done.
+              stream_->Done();
+            }
+          },
+          context_);
+    }
+
+    void Ended() {
+      loop_.Submit(
+          [this]() {
+            ended_ = true;
+            if (!completed_) {
+              // NOTE: the read function will now return EOF.
+              Unpause();
+            } else {
+              Finish();
+            }
+          },
+          context_);
+    }
+
+    template <typename Error>
+    void Fail(Error&& error) {
+      error_.Emplace(std::forward<Error>(error));
+
+      // Submitting to event loop to avoid race with interrupt.
+      loop_.Submit(
+          [this]() {
+            Abort();
+            k_.Fail(error_.template Extract<Error>());
+          },
+          context_);
+    }
+
+    void Stop() {
+      // Submitting to event loop to avoid race with interrupt.
+      loop_.Submit(
+          [this]() {
+            Abort();
+            k_.Stop();
+          },
+          context_);
+    }
+
+    void Register(Interrupt& interrupt) {
+      k_.Register(interrupt);
+
+      handler_.emplace(&interrupt, [this]() {
+        loop_.Submit(
+            [this]() {
+              if (!completed_) {
+                Abort();
+
+                // Tell the upstream we're done (or that we will be
+                // once we get the chunk we asked for), we'll stop
+                // once it has ended.
+                if (!requested_) {
+                  stream_->Done();
+                }
+              }
+            },
+            interrupt_context_);
+      });
+    }
+
+    // Invoked by the 'Pool' from within the event loop.
+    void Completed(CURLcode code) override {
+      CHECK(started_ && !completed_);
+      completed_ = true;
+
+      long response_code = 0;
+
+      if (code == CURLE_OK) {
+        curl_easy_getinfo(
+            easy_.get(),
+            CURLINFO_RESPONSE_CODE,
+            &response_code);
+      }
+
+      // NOTE: cleaning up the easy handle here, within the event
+      // loop, because it uses the pool's "share" handle which is not
+      // safe to access concurrently.
+      easy_.Reset();
+
+      if (code == CURLE_OK) {
+        response_ = Response{
+            response_code,
+            ParseHeaders(headers_buffer_.Extract()),
+            std::move(body_buffer_)};
+      } else {
+        failure_ = curl_easy_strerror(code);
+      }
+
+      if (ended_) {
+        Finish();
+      } else if (!requested_) {
+        // The server responded before we sent the entire body, tell
+        // the upstream we're done and finish once it has ended.
+        stream_->Done();
+      }
+    }
+
+   private:
+    // Continues with the outcome of the transfer, only called once
+    // the transfer has completed _and_ the upstream has ended.
+    void Finish() {
+      CHECK(completed_ && ended_);
+      if (failure_) {
+        k_.Fail(RuntimeError(std::move(*failure_)));
+      } else if (response_) {
+        k_.Start(std::move(*response_));
+      } else {
+        k_.Stop();
+      }
+    }
+
+    // Unpauses the transfer if it was paused waiting for the upstream.
+    void Unpause() {
+      if (paused_) {
+        paused_ = false;
+        // NOTE: unpausing might synchronously invoke the read
+        // function.
+        CHECK_EQ(
+            curl_easy_pause(easy_.get(), CURLPAUSE_CONT),
+            CURLE_OK);
+      }
+    }
+
+    // Stops an outstanding transfer (if any), any connection it was
+    // using will be closed (or kept alive for reuse) by the pool.
+    void Abort() {
+      if (started_ && !completed_) {
+        pool_->Remove(easy_.get());
+        easy_.Reset();
+      }
+      completed_ = true;
+    }
+
+    // NOTE: 'pool_' must be declared before 'easy_' so that any easy
+    // handle gets cleaned up before the pool might be destructed.
+    std::shared_ptr<Pool> pool_;
+
+    EventLoop& loop_;
+
+    Request request_;
+
+    Easy easy_;
+
+    TypeErasedStream* stream_ = nullptr;
+
+    // What's left of the chunk currently being sent.
+    ByteBuffer chunk_;
+
+    // Whether or not we've asked the upstream for the next chunk.
+    bool requested_ = false;
+
+    // Whether or not the transfer is paused waiting for the upstream.
+    bool paused_ = false;
+
+    // Whether or not the upstream has ended.
+    bool ended_ = false;
+
+    // Response variables.
+    EventLoop::Buffer headers_buffer_;
+    ByteBuffer body_buffer_;
+
+    bool started_ = false;
+    bool completed_ = false;
+
+    // Outcome of the transfer, propagated once the upstream has
+    // ended. If neither is set the transfer was interrupted.
+    std::optional<Response> response_;
+    std::optional<std::string> failure_;
+
+    // NOTE: the upstream only ever has one of 'Begin()', 'Body()',
+    // 'Ended()', 'Fail()', or 'Stop()' outstanding at a time so they
+    // can all share 'context_'.
+    Scheduler::Context context_;
+    Scheduler::Context interrupt_context_;
+
+    std::optional<Interrupt::Handler> handler_;
+
+    // Used to hold on to an error from the upstream while we hop to
+    // the event loop.
+    ErrorStorage<Errors_> error_;
+
+    // NOTE: we store 'k_' as the _last_ member so it will be
+    // destructed _first_ and thus we won't have any use-after-delete
+    // issues during destruction of 'k_' if it holds any references or
+    // pointers to any (or within any) of the above members.
+    K_ k_;
+  };
+
+  struct Composable final {
+    template <typename Arg, typename Errors>
+    using ValueFrom = Response;
+
+    template <typename Arg, typename Errors>
+    using ErrorsFrom = tuple_types_union_t<
+        Errors,
+        std::tuple<RuntimeError>>;
+
+    template <typename Arg, typename Errors, typename K>
+    auto k(K k) && {
+      static_assert(
+          std::is_convertible_v<Arg, std::string>
+              || std::is_convertible_v<Arg, ByteBuffer>,
+          "'Upload()' expects a stream of 'std::string' or 'ByteBuffer' "
+          "chunks");
+
+      return Continuation<K, Errors>(
+          std::move(k),
+          std::move(pool_),
+          std::move(request_));
+    }
+
+    template <typename Downstream>
+    static constexpr bool CanCompose = Downstream::ExpectsValue;
+
+    using Expects = StreamOfValues;
+
+    std::shared_ptr<Pool> pool_;
+    Request request_;
+  };
+};
+
+////////////////////////////////////////////////////////////////////////
+
+inline void Client::Prepare(Request& request) {
+  if (verify_peer_.has_value() && !request.verify_peer().has_value()) {
+    request.verify_peer_ = verify_peer_;
+  }
+
+  if (certificate_.has_value() && !request.certificate().has_value()) {
+    request.certificate_ = certificate_;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+[[nodiscard]] inline auto Client::Do(Request&& request) {
+  // TODO(benh): need 'Client::Default()'.
+  EventLoop& loop = EventLoop::Current();
+
+  Prepare(request);
+
+  // NOTE: we use a 'RescheduleAfter()' to ensure we use current
+  // scheduling context to invoke the continuation after the transfer has
+  // completed (or was interrupted).
+  return RescheduleAfter(
+      // TODO(benh): borrow '&loop' so http call can't outlive a loop.
+      _HTTP::Composable{pool(loop), std::move(request)});
+}
+
+////////////////////////////////////////////////////////////////////////
+
+[[nodiscard]] inline auto Client::Stream(Request&& request) {
+  // TODO(benh): need 'Client::Default()'.
+  EventLoop& loop = EventLoop::Current();
+
+  Prepare(request);
+
+  // NOTE: we use a 'RescheduleAfter()' to ensure we use current
+  // scheduling context to invoke the continuation for each chunk
+  // (and after the transfer has completed or was interrupted).
+  return RescheduleAfter(
+      // TODO(benh): borrow '&loop' so http call can't outlive a loop.
+      _HTTPStream::Composable{pool(loop), std::move(request)});
+}
+
+////////////////////////////////////////////////////////////////////////
+
+[[nodiscard]] inline auto Client::Upload(Request&& request) {
+  // TODO(benh): need 'Client::Default()'.
+  EventLoop& loop = EventLoop::Current();
+
+  Prepare(request);
 
   // NOTE: we use a 'RescheduleAfter()' to ensure we use current
   // scheduling context to invoke the continuation after the transfer has
   // completed (or was interrupted).
   return RescheduleAfter(
       // TODO(benh): borrow '&loop' so http call can't outlive a loop.
-      _HTTP::Composable{loop, std::move(request)});
+      _HTTPUpload::Composable{pool(loop), std::move(request)});
 }
 
 ////////////////////////////////////////////////////////////////////////
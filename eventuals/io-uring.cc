@@ -0,0 +1,827 @@
+#include "eventuals/io-uring.h"
+
+#include <algorithm>
+#include <cstddef> // For 'offsetof'.
+#include <cstdlib> // For 'std::getenv'.
+#include <cstring> // For 'std::memset', 'std::strcmp'.
+
+#include "eventuals/compose.h" // For 'EVENTUALS_LOG'.
+#include "glog/logging.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif // defined(__linux__)
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<IoUring> IoUring::Create(uv_loop_t* loop) {
+  return Create(loop, Options());
+}
+
+////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<IoUring> IoUring::Create(
+    uv_loop_t* loop,
+    const Options& options) {
+  static const char* variable = std::getenv("EVENTUALS_IO_URING");
+  if (variable != nullptr && std::strcmp(variable, "0") == 0) {
+    return nullptr;
+  }
+
+  std::unique_ptr<IoUring> io_uring(new IoUring(options));
+
+  if (!io_uring->Initialize(loop)) {
+    return nullptr;
+  }
+
+  return io_uring;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+IoUring::IoUring(const Options& options)
+  : options_(options) {}
+
+////////////////////////////////////////////////////////////////////////
+
+#if defined(__linux__)
+
+////////////////////////////////////////////////////////////////////////
+
+// Opcodes that were added after 5.10, defined here so that we can
+// still compile against older headers (e.g., Debian bullseye). They
+// are part of the kernel ABI so the values never change, and whether
+// or not the running kernel supports them is probed at runtime.
+static constexpr uint8_t OP_RENAMEAT = 35; // Since 5.11.
+static constexpr uint8_t OP_UNLINKAT = 36; // Since 5.11.
+static constexpr uint8_t OP_MKDIRAT = 37; // Since 5.15.
+
+////////////////////////////////////////////////////////////////////////
+
+// Helper for 'io_uring_register(2)' since there isn't a libc wrapper.
+static int Register(int fd, unsigned int opcode, void* arg, unsigned int n) {
+  return syscall(__NR_io_uring_register, fd, opcode, arg, n);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+IoUring::~IoUring() {
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+
+  if (buffers_ != nullptr) {
+    munmap(buffers_, size_t(options_.buffers) * options_.buffer_size);
+  }
+
+  if (eventfd_ >= 0) {
+    close(eventfd_);
+  }
+
+  // NOTE: closing the ring also releases any registered buffers and
+  // fixed files.
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool IoUring::Initialize(uv_loop_t* loop) {
+  io_uring_params params = {};
+
+  fd_ = syscall(__NR_io_uring_setup, options_.entries, &params);
+
+  if (fd_ < 0) {
+    EVENTUALS_LOG(1) << "io_uring is not available: " << strerror(errno);
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+  // Since 5.4 both rings can be mapped with a single 'mmap()'.
+  bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+
+  if (single) {
+    sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    cq_ring_size_ = sq_ring_size_;
+  }
+
+  void* ring = mmap(
+      nullptr,
+      sq_ring_size_,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE,
+      fd_,
+      IORING_OFF_SQ_RING);
+
+  if (ring == MAP_FAILED) {
+    return false;
+  }
+
+  sq_ring_ = ring;
+
+  if (single) {
+    cq_ring_ = sq_ring_;
+  } else {
+    ring = mmap(
+        nullptr,
+        cq_ring_size_,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        fd_,
+        IORING_OFF_CQ_RING);
+
+    if (ring == MAP_FAILED) {
+      return false;
+    }
+
+    cq_ring_ = ring;
+  }
+
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+  ring = mmap(
+      nullptr,
+      sqes_size_,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE,
+      fd_,
+      IORING_OFF_SQES);
+
+  if (ring == MAP_FAILED) {
+    return false;
+  }
+
+  sqes_ = static_cast<io_uring_sqe*>(ring);
+
+  char* sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+  char* cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cq_entries_ = params.cq_entries;
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  // Determine which operations the kernel supports so that callers
+  // can fall back to libuv for the rest. Kernels without probing
+  // (before 5.6) don't support enough operations to bother with.
+  constexpr unsigned int OPS = 256;
+  std::vector<uint64_t> probe_storage(
+      (sizeof(io_uring_probe) + OPS * sizeof(io_uring_probe_op))
+          / sizeof(uint64_t)
+      + 1);
+  auto* probe = reinterpret_cast<io_uring_probe*>(probe_storage.data());
+
+  if (Register(fd_, IORING_REGISTER_PROBE, probe, OPS) < 0) {
+    EVENTUALS_LOG(1) << "io_uring probing failed: " << strerror(errno);
+    return false;
+  }
+
+  for (unsigned int i = 0; i < probe->ops_len && i < OPS; i++) {
+    if (probe->ops[i].flags & IO_URING_OP_SUPPORTED) {
+      supported_.set(probe->ops[i].op);
+    }
+  }
+
+  eventfd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+  if (eventfd_ < 0) {
+    return false;
+  }
+
+  if (Register(fd_, IORING_REGISTER_EVENTFD, &eventfd_, 1) < 0) {
+    return false;
+  }
+
+  // Registered buffers and fixed files are optimizations, e.g., the
+  // buffers count against 'RLIMIT_MEMLOCK' on older kernels, so we
+  // carry on without them if they can't be registered.
+  if (options_.buffers > 0 && options_.buffer_size > 0) {
+    size_t size = size_t(options_.buffers) * options_.buffer_size;
+
+    void* buffers = mmap(
+        nullptr,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0);
+
+    if (buffers != MAP_FAILED) {
+      std::vector<iovec> iovecs(options_.buffers);
+      for (unsigned int i = 0; i < options_.buffers; i++) {
+        iovecs[i].iov_base =
+            static_cast<char*>(buffers) + (size_t(i) * options_.buffer_size);
+        iovecs[i].iov_len = options_.buffer_size;
+      }
+
+      if (Register(
+              fd_,
+              IORING_REGISTER_BUFFERS,
+              iovecs.data(),
+              options_.buffers)
+          == 0) {
+        buffers_ = static_cast<char*>(buffers);
+        for (unsigned int i = options_.buffers; i > 0; i--) {
+          free_buffers_.push_back(i - 1);
+        }
+      } else {
+        EVENTUALS_LOG(1)
+            << "io_uring buffer registration failed: " << strerror(errno);
+        munmap(buffers, size);
+      }
+    }
+  }
+
+  if (options_.files > 0) {
+    // NOTE: a descriptor of -1 leaves a slot empty to be filled in
+    // later via 'IORING_REGISTER_FILES_UPDATE'.
+    std::vector<int> fds(options_.files, -1);
+
+    if (Register(fd_, IORING_REGISTER_FILES, fds.data(), options_.files)
+        == 0) {
+      for (unsigned int i = options_.files; i > 0; i--) {
+        free_files_.push_back(i - 1);
+      }
+    } else {
+      EVENTUALS_LOG(1)
+          << "io_uring file registration failed: " << strerror(errno);
+    }
+  }
+
+  uv_poll_init(loop, &poll_, eventfd_);
+
+  poll_.data = this;
+
+  uv_poll_start(&poll_, UV_READABLE, [](uv_poll_t* poll, int, int) {
+    static_cast<IoUring*>(poll->data)->Reap();
+  });
+
+  // NOTE: the poll handle only keeps the loop alive while there are
+  // outstanding operations, see 'Prepare()' and 'Reap()'.
+  uv_unref((uv_handle_t*) &poll_);
+
+  // NOTE: we use 'uv_prepare_t' so that everything prepared during
+  // an iteration of the loop gets submitted at once right before the
+  // loop polls for I/O.
+  uv_prepare_init(loop, &prepare_);
+
+  prepare_.data = this;
+
+  uv_prepare_start(&prepare_, [](uv_prepare_t* prepare) {
+    static_cast<IoUring*>(prepare->data)->Submit();
+  });
+
+  uv_unref((uv_handle_t*) &prepare_);
+
+  // NOTE: unlike the handles above the retry timer keeps the loop
+  // alive while it's active, see 'Submit()'.
+  uv_timer_init(loop, &retry_);
+
+  retry_.data = this;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void IoUring::CloseHandles() {
+  LOG_IF(WARNING, outstanding_ > 0)
+      << "closing io_uring with " << outstanding_ << " outstanding operations";
+
+  uv_poll_stop(&poll_);
+  uv_close((uv_handle_t*) &poll_, nullptr);
+
+  uv_prepare_stop(&prepare_);
+  uv_close((uv_handle_t*) &prepare_, nullptr);
+
+  uv_timer_stop(&retry_);
+  uv_close((uv_handle_t*) &retry_, nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+io_uring_sqe* IoUring::Prepare(Operation* operation, uint8_t opcode) {
+  if (!supported_.test(opcode)) {
+    return nullptr;
+  }
+
+  // Don't have more outstanding operations than the completion queue
+  // can hold so that completions never overflow.
+  if (outstanding_ == cq_entries_) {
+    return nullptr;
+  }
+
+  unsigned tail = *sq_tail_;
+
+  if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == sq_entries_) {
+    Submit();
+    if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == sq_entries_) {
+      return nullptr;
+    }
+  }
+
+  unsigned index = tail & sq_mask_;
+
+  io_uring_sqe* sqe = &sqes_[index];
+
+  std::memset(sqe, 0, sizeof(*sqe));
+
+  sqe->opcode = opcode;
+  sqe->user_data = reinterpret_cast<uintptr_t>(operation);
+
+  sq_array_[index] = index;
+
+  // NOTE: it's safe to publish the entry before the caller has filled
+  // it in since the kernel only reads entries in 'Submit()'.
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+  unsubmitted_++;
+
+  if (outstanding_++ == 0) {
+    uv_ref((uv_handle_t*) &poll_);
+  }
+
+  return sqe;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void IoUring::Submit() {
+  while (unsubmitted_ > 0) {
+    int submitted = syscall(
+        __NR_io_uring_enter,
+        fd_,
+        unsubmitted_,
+        0,
+        0,
+        nullptr,
+        0);
+
+    if (submitted < 0) {
+      if (errno == EINTR) {
+        continue;
+      } else if (errno == EAGAIN || errno == EBUSY) {
+        // The kernel is temporarily out of resources (or has too many
+        // completions pending) so try again shortly. We can't rely on
+        // 'prepare_' alone since it doesn't keep the loop alive and
+        // there might not be any other operations to wake it up.
+        if (!uv_is_active((uv_handle_t*) &retry_)) {
+          uv_timer_start(
+              &retry_,
+              [](uv_timer_t* timer) {
+                static_cast<IoUring*>(timer->data)->Submit();
+              },
+              /* timeout = */ 1,
+              /* repeat = */ 0);
+        }
+        break;
+      } else {
+        LOG(FATAL) << "io_uring submission failed: " << strerror(errno);
+      }
+    }
+
+    unsubmitted_ -= submitted;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void IoUring::Reap() {
+  uint64_t value = 0;
+  ssize_t bytes = read(eventfd_, &value, sizeof(value));
+  (void) bytes; // Nothing to read is fine, we check the ring anyway.
+
+  unsigned head = *cq_head_;
+
+  while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+    io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+
+    auto* operation = reinterpret_cast<Operation*>(cqe->user_data);
+    int result = cqe->res;
+
+    // Return the entry to the kernel before invoking the callback
+    // since the callback might prepare more operations.
+    __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+
+    if (--outstanding_ == 0) {
+      uv_unref((uv_handle_t*) &poll_);
+    }
+
+    CHECK(operation->callback);
+
+    Callback<void(int)> callback = std::move(operation->callback);
+
+    callback(result);
+
+    //////////////////////////////////////////////////////////
+    // NOTE: can't use 'operation' at this point in time    //
+    // because it might have been deallocated!              //
+    //////////////////////////////////////////////////////////
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool IoUring::Open(
+    Operation* operation,
+    const std::filesystem::path& path,
+    int flags,
+    int mode) {
+  io_uring_sqe* sqe = Prepare(operation, IORING_OP_OPENAT);
+
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->fd = AT_FDCWD;
+  sqe->addr = reinterpret_cast<uintptr_t>(path.c_str());
+  sqe->len = mode;
+  // NOTE: libuv always opens files with 'O_CLOEXEC' so we do too.
+  sqe->open_flags = flags | O_CLOEXEC;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool IoUring::Close(Operation* operation, int fd) {
+  io_uring_sqe* sqe = Prepare(operation, IORING_OP_CLOSE);
+
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->fd = fd;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool IoUring::Read(
+    Operation* operation,
+    int fd,
+    std::optional<unsigned int> fixed,
+    char* data,
+    unsigned int size,
+    uint64_t offset,
+    std::optional<unsigned int> buffer) {
+  io_uring_sqe* sqe = Prepare(
+      operation,
+      buffer ? IORING_OP_READ_FIXED : IORING_OP_READ);
+
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  if (fixed) {
+    sqe->fd = *fixed;
+    sqe->flags |= IOSQE_FIXED_FILE;
+  } else {
+    sqe->fd = fd;
+  }
+
+  sqe->addr = reinterpret_cast<uintptr_t>(data);
+  sqe->len = size;
+  sqe->off = offset;
+
+  if (buffer) {
+    sqe->buf_index = *buffer;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool IoUring::Write(
+    Operation* operation,
+    int fd,
+    std::optional<unsigned int> fixed,
+    const char* data,
+    unsigned int size,
+    uint64_t offset) {
+  io_uring_sqe* sqe = Prepare(operation, IORING_OP_WRITE);
+
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  if (fixed) {
+    sqe->fd = *fixed;
+    sqe->flags |= IOSQE_FIXED_FILE;
+  } else {
+    sqe->fd = fd;
+  }
+
+  sqe->addr = reinterpret_cast<uintptr_t>(data);
+  sqe->len = size;
+  sqe->off = offset;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// libuv guarantees this on Unix so that its buffers can be passed
+// directly to 'readv(2)' and 'writev(2)', as do we.
+static_assert(
+    sizeof(uv_buf_t) == sizeof(iovec)
+    && offsetof(uv_buf_t, base) == offsetof(iovec, iov_base)
+    && offsetof(uv_buf_t, len) == offsetof(iovec, iov_len));
+
+bool IoUring::Write(
+    Operation* operation,
+    int fd,
+    std::optional<unsigned int> fixed,
+    const uv_buf_t* buffers,
+    unsigned int count,
+    uint64_t offset) {
+  io_uring_sqe* sqe = Prepare(operation, IORING_OP_WRITEV);
+
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  if (fixed) {
+    sqe->fd = *fixed;
+    sqe->flags |= IOSQE_FIXED_FILE;
+  } else {
+    sqe->fd = fd;
+  }
+
+  sqe->addr = reinterpret_cast<uintptr_t>(buffers);
+  sqe->len = count;
+  sqe->off = offset;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool IoUring::Unlink(
+    Operation* operation,
+    const std::filesystem::path& path) {
+  io_uring_sqe* sqe = Prepare(operation, OP_UNLINKAT);
+
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->fd = AT_FDCWD;
+  sqe->addr = reinterpret_cast<uintptr_t>(path.c_str());
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool IoUring::MakeDirectory(
+    Operation* operation,
+    const std::filesystem::path& path,
+    int mode) {
+  io_uring_sqe* sqe = Prepare(operation, OP_MKDIRAT);
+
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->fd = AT_FDCWD;
+  sqe->addr = reinterpret_cast<uintptr_t>(path.c_str());
+  sqe->len = mode;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool IoUring::RemoveDirectory(
+    Operation* operation,
+    const std::filesystem::path& path) {
+  io_uring_sqe* sqe = Prepare(operation, OP_UNLINKAT);
+
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->fd = AT_FDCWD;
+  sqe->addr = reinterpret_cast<uintptr_t>(path.c_str());
+  // NOTE: 'unlink_flags' shares a union with 'open_flags' but only
+  // exists in 5.11+ headers.
+  sqe->open_flags = AT_REMOVEDIR;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool IoUring::Rename(
+    Operation* operation,
+    const std::filesystem::path& from,
+    const std::filesystem::path& to) {
+  io_uring_sqe* sqe = Prepare(operation, OP_RENAMEAT);
+
+  if (sqe == nullptr) {
+    return false;
+  }
+
+  sqe->fd = AT_FDCWD;
+  sqe->addr = reinterpret_cast<uintptr_t>(from.c_str());
+  sqe->len = AT_FDCWD;
+  sqe->addr2 = reinterpret_cast<uintptr_t>(to.c_str());
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+std::optional<unsigned int> IoUring::AcquireBuffer() {
+  if (free_buffers_.empty()) {
+    return std::nullopt;
+  }
+
+  unsigned int index = free_buffers_.back();
+  free_buffers_.pop_back();
+  return index;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void IoUring::ReleaseBuffer(unsigned int index) {
+  CHECK_LT(index, options_.buffers);
+  free_buffers_.push_back(index);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+std::optional<unsigned int> IoUring::RegisterFile(int fd) {
+  std::scoped_lock lock(files_mutex_);
+
+  if (free_files_.empty()) {
+    return std::nullopt;
+  }
+
+  unsigned int index = free_files_.back();
+
+  io_uring_files_update update = {};
+  update.offset = index;
+  update.fds = reinterpret_cast<uintptr_t>(&fd);
+
+  if (Register(fd_, IORING_REGISTER_FILES_UPDATE, &update, 1) < 0) {
+    return std::nullopt;
+  }
+
+  free_files_.pop_back();
+
+  return index;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void IoUring::UnregisterFile(unsigned int index) {
+  std::scoped_lock lock(files_mutex_);
+
+  int fd = -1;
+
+  io_uring_files_update update = {};
+  update.offset = index;
+  update.fds = reinterpret_cast<uintptr_t>(&fd);
+
+  CHECK_EQ(Register(fd_, IORING_REGISTER_FILES_UPDATE, &update, 1), 1)
+      << strerror(errno);
+
+  free_files_.push_back(index);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+#else // !defined(__linux__)
+
+////////////////////////////////////////////////////////////////////////
+
+// NOTE: io_uring is Linux only, 'Create()' always fails everywhere
+// else so none of these ever get called.
+
+IoUring::~IoUring() {}
+
+bool IoUring::Initialize(uv_loop_t* loop) {
+  return false;
+}
+
+void IoUring::CloseHandles() {}
+
+::io_uring_sqe* IoUring::Prepare(Operation* operation, uint8_t opcode) {
+  return nullptr;
+}
+
+void IoUring::Submit() {}
+
+void IoUring::Reap() {}
+
+bool IoUring::Open(Operation*, const std::filesystem::path&, int, int) {
+  return false;
+}
+
+bool IoUring::Close(Operation*, int) {
+  return false;
+}
+
+bool IoUring::Read(
+    Operation*,
+    int,
+    std::optional<unsigned int>,
+    char*,
+    unsigned int,
+    uint64_t,
+    std::optional<unsigned int>) {
+  return false;
+}
+
+bool IoUring::Write(
+    Operation*,
+    int,
+    std::optional<unsigned int>,
+    const char*,
+    unsigned int,
+    uint64_t) {
+  return false;
+}
+
+bool IoUring::Write(
+    Operation*,
+    int,
+    std::optional<unsigned int>,
+    const uv_buf_t*,
+    unsigned int,
+    uint64_t) {
+  return false;
+}
+
+bool IoUring::Unlink(Operation*, const std::filesystem::path&) {
+  return false;
+}
+
+bool IoUring::MakeDirectory(Operation*, const std::filesystem::path&, int) {
+  return false;
+}
+
+bool IoUring::RemoveDirectory(Operation*, const std::filesystem::path&) {
+  return false;
+}
+
+bool IoUring::Rename(
+    Operation*,
+    const std::filesystem::path&,
+    const std::filesystem::path&) {
+  return false;
+}
+
+std::optional<unsigned int> IoUring::AcquireBuffer() {
+  return std::nullopt;
+}
+
+void IoUring::ReleaseBuffer(unsigned int) {}
+
+std::optional<unsigned int> IoUring::RegisterFile(int) {
+  return std::nullopt;
+}
+
+void IoUring::UnregisterFile(unsigned int) {}
+
+////////////////////////////////////////////////////////////////////////
+
+#endif // defined(__linux__)
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef> // For 'size_t'.
+#include <cstdint> // For 'uint64_t'.
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "eventuals/callback.h"
+#include "uv.h"
+
+////////////////////////////////////////////////////////////////////////
+
+// Forward declarations, see <linux/io_uring.h>.
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+// An io_uring instance owned by an event loop which lets filesystem
+// operations be done by the kernel asynchronously rather than as
+// blocking calls on libuv's threadpool.
+//
+// Operations are prepared via the methods below (e.g., 'Read()'),
+// each of which returns false if the operation can't be done via
+// io_uring (e.g., the kernel doesn't support it) in which case the
+// caller should fall back to libuv. Prepared operations are batched
+// and submitted with a single system call right before the event
+// loop polls for I/O. Completions are signaled via an eventfd that
+// the event loop polls.
+//
+// Reads can use buffers registered with the kernel (see
+// 'AcquireBuffer()') and files can be registered as "fixed" files
+// (see 'RegisterFile()'), both of which save the kernel from having
+// to look them up for each operation.
+//
+// Only available on Linux, and can be disabled by setting the
+// environment variable 'EVENTUALS_IO_URING=0'.
+//
+// NOTE: except where noted, not thread-safe, expected to be used
+// from the event loop that owns it.
+class IoUring final {
+ public:
+  struct Options final {
+    // Number of submission queue entries.
+    unsigned int entries = 256;
+
+    // Number of registered buffers, and the size of each.
+    unsigned int buffers = 16;
+    unsigned int buffer_size = 64 * 1024;
+
+    // Number of slots for fixed files.
+    unsigned int files = 64;
+  };
+
+  // Storage for an outstanding operation which must remain valid
+  // until 'callback' is invoked with the result of the operation,
+  // i.e., a negative errno on failure.
+  struct Operation final {
+    Callback<void(int)> callback;
+  };
+
+  // Returns an instance for 'loop', or nothing if io_uring is not
+  // available or has been disabled.
+  static std::unique_ptr<IoUring> Create(uv_loop_t* loop);
+
+  static std::unique_ptr<IoUring> Create(
+      uv_loop_t* loop,
+      const Options& options);
+
+  IoUring(const IoUring&) = delete;
+  IoUring(IoUring&&) = delete;
+
+  ~IoUring();
+
+  // Stops and closes the handles this instance added to the event
+  // loop; must be called before destructing and the event loop must
+  // be run in order for the handles to be closed.
+  void CloseHandles();
+
+  // NOTE: paths are relative to the current working directory and
+  // must remain valid until the operation completes.
+  bool Open(
+      Operation* operation,
+      const std::filesystem::path& path,
+      int flags,
+      int mode);
+
+  bool Close(Operation* operation, int fd);
+
+  // Reads into 'data' from 'fd', or the fixed file 'fixed' if
+  // provided. If 'buffer' is provided then 'data' must be within
+  // that registered buffer.
+  bool Read(
+      Operation* operation,
+      int fd,
+      std::optional<unsigned int> fixed,
+      char* data,
+      unsigned int size,
+      uint64_t offset,
+      std::optional<unsigned int> buffer = std::nullopt);
+
+  bool Write(
+      Operation* operation,
+      int fd,
+      std::optional<unsigned int> fixed,
+      const char* data,
+      unsigned int size,
+      uint64_t offset);
+
+  // Gathers the writes from 'count' buffers, which must remain valid
+  // until the operation completes.
+  bool Write(
+      Operation* operation,
+      int fd,
+      std::optional<unsigned int> fixed,
+      const uv_buf_t* buffers,
+      unsigned int count,
+      uint64_t offset);
+
+  bool Unlink(Operation* operation, const std::filesystem::path& path);
+
+  bool MakeDirectory(
+      Operation* operation,
+      const std::filesystem::path& path,
+      int mode);
+
+  bool RemoveDirectory(
+      Operation* operation,
+      const std::filesystem::path& path);
+
+  bool Rename(
+      Operation* operation,
+      const std::filesystem::path& from,
+      const std::filesystem::path& to);
+
+  // Submits all prepared operations with a single system call. Done
+  // automatically before the event loop polls for I/O.
+  void Submit();
+
+  // Returns the index of an unused registered buffer, or nothing if
+  // there aren't any (or buffers couldn't be registered).
+  std::optional<unsigned int> AcquireBuffer();
+
+  void ReleaseBuffer(unsigned int index);
+
+  char* buffer(unsigned int index) {
+    return buffers_ + (size_t(index) * options_.buffer_size);
+  }
+
+  unsigned int buffer_size() const {
+    return options_.buffer_size;
+  }
+
+  // Registers 'fd' as a fixed file returning its index, or nothing
+  // if there aren't any free slots (or files couldn't be registered).
+  std::optional<unsigned int> RegisterFile(int fd);
+
+  // Unregisters a fixed file. Unlike other methods this may be called
+  // from any thread, e.g., when a 'filesystem::File' gets destructed.
+  void UnregisterFile(unsigned int index);
+
+  // Number of operations that have been prepared but not completed.
+  size_t outstanding() const {
+    return outstanding_;
+  }
+
+ private:
+  explicit IoUring(const Options& options);
+
+  bool Initialize(uv_loop_t* loop);
+
+  // Returns a zeroed submission queue entry for 'operation' if the
+  // kernel supports 'opcode' and the queue isn't full.
+  ::io_uring_sqe* Prepare(Operation* operation, uint8_t opcode);
+
+  // Invokes the callbacks of all completed operations.
+  void Reap();
+
+  Options options_;
+
+  int fd_ = -1;
+  int eventfd_ = -1;
+
+  // Memory shared with the kernel, see 'io_uring_setup(2)'.
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  ::io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+  unsigned* sq_array_ = nullptr;
+
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  unsigned cq_entries_ = 0;
+  ::io_uring_cqe* cqes_ = nullptr;
+
+  // Entries prepared but not yet submitted.
+  unsigned unsubmitted_ = 0;
+
+  size_t outstanding_ = 0;
+
+  // Opcodes supported by the kernel.
+  std::bitset<256> supported_;
+
+  uv_poll_t poll_ = {};
+  uv_prepare_t prepare_ = {};
+
+  // Used to retry submitting if the kernel couldn't accept all of
+  // the entries, see 'Submit()'.
+  uv_timer_t retry_ = {};
+
+  char* buffers_ = nullptr;
+  std::vector<unsigned int> free_buffers_;
+
+  std::mutex files_mutex_;
+  std::vector<unsigned int> free_files_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <functional> // For 'std::hash'.
 #include <memory>
 #include <optional>
 
 #include "eventuals/callback.h"
 #include "eventuals/compose.h"
+#include "eventuals/errors.h"
 #include "eventuals/scheduler.h"
 #include "eventuals/stream.h"
 #include "eventuals/then.h"
@@ -141,7 +144,7 @@ class Lock final {
 ////////////////////////////////////////////////////////////////////////
 
 struct _Acquire final {
-  template <typename K_, typename Arg_>
+  template <typename K_, typename Arg_, typename Errors_>
   struct Continuation final {
     Continuation(K_ k, Lock* lock)
       : lock_(lock),
@@ -231,30 +234,17 @@ struct _Acquire final {
 
         k_.Fail(std::move(error));
       } else {
-        // TODO(benh): avoid allocating on heap by storing args in
-        // pre-allocated buffer based on composing with Errors.
-        using Tuple = std::tuple<decltype(this), Error>;
-        auto tuple = std::make_unique<Tuple>(
-            this,
-            std::forward<Error>(error));
-
-        waiter_.f = [tuple = std::move(tuple)]() mutable {
-          auto* acquire = std::get<0>(*tuple);
-          acquire->waiter_.context->Unblock(
-              [tuple = std::move(tuple)]() mutable {
-                std::apply(
-                    [](auto* acquire, auto&&... args) {
-                      // NOTE: need to relinquish borrow of context to
-                      // avoid this continuation causing a deadlock
-                      // when trying to destruct the context.
-                      auto& context = acquire->waiter_.context;
-                      context.relinquish();
-
-                      auto& k_ = acquire->k_;
-                      k_.Fail(std::forward<decltype(args)>(args)...);
-                    },
-                    std::move(*tuple));
-              });
+        error_.Emplace(std::forward<Error>(error));
+
+        waiter_.f = [this]() mutable {
+          waiter_.context->Unblock([this]() mutable {
+            // NOTE: need to relinquish borrow of context to avoid
+            // this continuation causing a deadlock when trying to
+            // destruct the context.
+            waiter_.context.relinquish();
+
+            k_.Fail(error_.template Extract<Error>());
+          });
         };
 
         if (lock_->AcquireSlow(&waiter_)) {
@@ -461,6 +451,7 @@ struct _Acquire final {
     std::optional<
         std::conditional_t<!std::is_void_v<Arg_>, Arg_, Undefined>>
         arg_;
+    ErrorStorage<Errors_> error_;
     TypeErasedStream* stream_ = nullptr;
 
     // NOTE: we store 'k_' as the _last_ member so it will be
@@ -489,7 +480,7 @@ struct _Acquire final {
 
     template <typename Arg, typename Errors, typename K>
     auto k(K k) && {
-      return Continuation<K, Arg>(std::move(k), lock_);
+      return Continuation<K, Arg, Errors>(std::move(k), lock_);
     }
 
     Lock* lock_;
@@ -899,6 +890,93 @@ class Synchronizable {
 
 ////////////////////////////////////////////////////////////////////////
 
+// A fixed number of locks ("shards") that state can be partitioned
+// across by key so that operations on state with different keys don't
+// contend with one another, e.g.:
+//
+//   ShardedLock<16> locks;
+//
+//   locks.Synchronized(locks.Shard(key), Then([&]() { ... }));
+//
+// NOTE: each lock is aligned to its own cache line so that acquiring
+// one shard doesn't slow down acquiring a neighbouring shard.
+template <size_t N>
+class ShardedLock final {
+ public:
+  static_assert(N > 0, "ShardedLock expects at least one shard");
+
+  static constexpr size_t shards() {
+    return N;
+  }
+
+  // Returns the shard that 'key' belongs to.
+  template <typename Key, typename Hash = std::hash<Key>>
+  static size_t Shard(const Key& key) {
+    return Hash()(key) % N;
+  }
+
+  template <typename E>
+  [[nodiscard]] auto Synchronized(size_t shard, E e) {
+    return _Synchronized::Composable<E>{&lock(shard), std::move(e)};
+  }
+
+  template <typename F>
+  [[nodiscard]] auto Wait(size_t shard, F f) {
+    return eventuals::Wait(&lock(shard), std::move(f));
+  }
+
+  Lock& lock(size_t shard) {
+    CHECK_LT(shard, N);
+    return shards_[shard].lock;
+  }
+
+ private:
+  struct alignas(64) AlignedLock {
+    Lock lock;
+  };
+
+  std::array<AlignedLock, N> shards_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Like 'Synchronizable' except with a 'ShardedLock' of 'N' shards for
+// classes that partition their state by key, e.g., a map that keeps
+// 'N' maps each synchronized by a different lock.
+template <size_t N>
+class StripedSynchronizable {
+ public:
+  virtual ~StripedSynchronizable() = default;
+
+  static constexpr size_t shards() {
+    return N;
+  }
+
+  template <typename Key, typename Hash = std::hash<Key>>
+  static size_t Shard(const Key& key) {
+    return ShardedLock<N>::template Shard<Key, Hash>(key);
+  }
+
+  template <typename E>
+  [[nodiscard]] auto Synchronized(size_t shard, E e) {
+    return locks_.Synchronized(shard, std::move(e));
+  }
+
+  template <typename F>
+  [[nodiscard]] auto Wait(size_t shard, F f) {
+    return locks_.Wait(shard, std::move(f));
+  }
+
+  Lock& lock(size_t shard) {
+    return locks_.lock(shard);
+  }
+
+ private:
+  ShardedLock<N> locks_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
 class ConditionVariable final {
  public:
   ConditionVariable(Lock* lock)
@@ -0,0 +1,393 @@
+#include "eventuals/mapped-file.h"
+
+#include <algorithm>
+#include <cstdint> // For 'uintptr_t'.
+#include <cstring> // For 'std::memchr', 'std::strerror'.
+#include <string>
+
+#include "glog/logging.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+namespace filesystem {
+
+////////////////////////////////////////////////////////////////////////
+
+#if defined(_WIN32)
+
+////////////////////////////////////////////////////////////////////////
+
+expected<MappedFile> MappedFile::Open(
+    const std::filesystem::path& path,
+    const Options& options) {
+  HANDLE file = CreateFileW(
+      path.c_str(),
+      GENERIC_READ,
+      FILE_SHARE_READ,
+      nullptr,
+      OPEN_EXISTING,
+      options.advice == Advice::Random
+          ? FILE_FLAG_RANDOM_ACCESS
+          : FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+
+  if (file == INVALID_HANDLE_VALUE) {
+    return make_unexpected(
+        "Failed to open '" + path.string() + "': error "
+        + std::to_string(GetLastError()));
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    return make_unexpected(
+        "Failed to get size of '" + path.string() + "': error "
+        + std::to_string(GetLastError()));
+  }
+
+  MappedFile mapped;
+
+  if (size.QuadPart > 0) {
+    HANDLE mapping = CreateFileMappingW(
+        file,
+        nullptr,
+        PAGE_READONLY,
+        0,
+        0,
+        nullptr);
+
+    if (mapping == nullptr) {
+      CloseHandle(file);
+      return make_unexpected(
+          "Failed to map '" + path.string() + "': error "
+          + std::to_string(GetLastError()));
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    // NOTE: the view keeps the mapping (and the file) open.
+    CloseHandle(mapping);
+
+    if (view == nullptr) {
+      CloseHandle(file);
+      return make_unexpected(
+          "Failed to map '" + path.string() + "': error "
+          + std::to_string(GetLastError()));
+    }
+
+    mapped.data_ = static_cast<const char*>(view);
+    mapped.size_ = size.QuadPart;
+    mapped.mapping_ = view;
+    mapped.mapping_size_ = size.QuadPart;
+  }
+
+  CloseHandle(file);
+
+  return std::move(mapped);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool MappedFile::Advise(Advice advice, size_t offset, size_t size) {
+  if (advice != Advice::WillNeed || offset >= size_) {
+    return false;
+  }
+
+  WIN32_MEMORY_RANGE_ENTRY range;
+  range.VirtualAddress = const_cast<char*>(data_) + offset;
+  range.NumberOfBytes = std::min(size, size_ - offset);
+
+  return PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void MappedFile::Unmap() {
+  if (mapping_ != nullptr) {
+    UnmapViewOfFile(mapping_);
+    mapping_ = nullptr;
+  }
+  data_ = nullptr;
+  size_ = 0;
+  mapping_size_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+#else // !defined(_WIN32)
+
+////////////////////////////////////////////////////////////////////////
+
+static int MadviseFrom(MappedFile::Advice advice) {
+  switch (advice) {
+    case MappedFile::Advice::Normal:
+      return MADV_NORMAL;
+    case MappedFile::Advice::Sequential:
+      return MADV_SEQUENTIAL;
+    case MappedFile::Advice::Random:
+      return MADV_RANDOM;
+    case MappedFile::Advice::WillNeed:
+      return MADV_WILLNEED;
+    case MappedFile::Advice::DontNeed:
+      return MADV_DONTNEED;
+  }
+  return MADV_NORMAL;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+#if defined(__linux__)
+// Size of a transparent huge page on the platforms we care about.
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Returns a mapping of 'size' bytes of 'fd' that is aligned to a huge
+// page boundary, or 'MAP_FAILED'.
+static void* MapAligned(int fd, size_t size, int flags) {
+  // Reserve enough address space that we're guaranteed to find an
+  // aligned address within it, then map the file over the aligned
+  // part of the reservation and give back the rest.
+  size_t reserved = size + HUGE_PAGE_SIZE;
+
+  void* reservation = mmap(
+      nullptr,
+      reserved,
+      PROT_NONE,
+      MAP_PRIVATE | MAP_ANONYMOUS,
+      -1,
+      0);
+
+  if (reservation == MAP_FAILED) {
+    return MAP_FAILED;
+  }
+
+  uintptr_t start = reinterpret_cast<uintptr_t>(reservation);
+  uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+  void* mapping = mmap(
+      reinterpret_cast<void*>(aligned),
+      size,
+      PROT_READ,
+      flags | MAP_FIXED,
+      fd,
+      0);
+
+  if (mapping == MAP_FAILED) {
+    munmap(reservation, reserved);
+    return MAP_FAILED;
+  }
+
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  uintptr_t end = aligned + ((size + page_size - 1) & ~(page_size - 1));
+
+  if (aligned > start) {
+    munmap(reservation, aligned - start);
+  }
+
+  if (start + reserved > end) {
+    munmap(reinterpret_cast<void*>(end), start + reserved - end);
+  }
+
+  madvise(mapping, size, MADV_HUGEPAGE);
+
+  return mapping;
+}
+#endif // defined(__linux__)
+
+////////////////////////////////////////////////////////////////////////
+
+expected<MappedFile> MappedFile::Open(
+    const std::filesystem::path& path,
+    const Options& options) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0) {
+    return make_unexpected(
+        "Failed to open '" + path.string() + "': "
+        + std::strerror(errno));
+  }
+
+  struct stat stat;
+  if (fstat(fd, &stat) != 0) {
+    int error = errno;
+    close(fd);
+    return make_unexpected(
+        "Failed to stat '" + path.string() + "': "
+        + std::strerror(error));
+  }
+
+  MappedFile mapped;
+
+  // NOTE: 'mmap()' fails for zero bytes so an empty file doesn't get
+  // mapped at all.
+  if (stat.st_size > 0) {
+    size_t size = stat.st_size;
+
+    int flags = MAP_SHARED;
+
+#if defined(__linux__)
+    if (options.populate) {
+      flags |= MAP_POPULATE;
+    }
+#endif
+
+    void* mapping = MAP_FAILED;
+
+#if defined(__linux__)
+    if (options.huge_pages) {
+      mapping = MapAligned(fd, size, flags);
+    }
+#endif
+
+    if (mapping == MAP_FAILED) {
+      mapping = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+    }
+
+    if (mapping == MAP_FAILED) {
+      int error = errno;
+      close(fd);
+      return make_unexpected(
+          "Failed to map '" + path.string() + "': "
+          + std::strerror(error));
+    }
+
+    mapped.data_ = static_cast<const char*>(mapping);
+    mapped.size_ = size;
+    mapped.mapping_ = mapping;
+    mapped.mapping_size_ = size;
+
+    if (options.advice != Advice::Normal) {
+      mapped.Advise(options.advice);
+    }
+  }
+
+  // NOTE: the mapping keeps the file open.
+  close(fd);
+
+  return std::move(mapped);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool MappedFile::Advise(Advice advice, size_t offset, size_t size) {
+  if (offset >= size_) {
+    return false;
+  }
+
+  size = std::min(size, size_ - offset);
+
+  // 'madvise()' requires a page aligned address.
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t aligned = offset & ~(page_size - 1);
+
+  return madvise(
+             const_cast<char*>(data_) + aligned,
+             size + (offset - aligned),
+             MadviseFrom(advice))
+      == 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void MappedFile::Unmap() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+    mapping_ = nullptr;
+  }
+  data_ = nullptr;
+  size_ = 0;
+  mapping_size_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+#endif // defined(_WIN32)
+
+////////////////////////////////////////////////////////////////////////
+
+expected<MappedFile> MappedFile::Open(const std::filesystem::path& path) {
+  return Open(path, Options());
+}
+
+////////////////////////////////////////////////////////////////////////
+
+MappedFile& MappedFile::operator=(MappedFile&& that) noexcept {
+  if (this != &that) {
+    Unmap();
+
+    data_ = that.data_;
+    size_ = that.size_;
+    mapping_ = that.mapping_;
+    mapping_size_ = that.mapping_size_;
+
+    that.data_ = nullptr;
+    that.size_ = 0;
+    that.mapping_ = nullptr;
+    that.mapping_size_ = 0;
+  }
+  return *this;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string_view> MappedFile::Chunks(
+    size_t size,
+    char delimiter) const {
+  CHECK_GT(size, 0u);
+
+  std::vector<std::string_view> chunks;
+
+  size_t offset = 0;
+  while (offset < size_) {
+    size_t end = offset + size;
+    if (end >= size_) {
+      end = size_;
+    } else {
+      // Extend the chunk to include the rest of the record it ends in,
+      // starting with its last byte in case that's a delimiter.
+      const void* found = std::memchr(
+          data_ + end - 1,
+          delimiter,
+          size_ - end + 1);
+      end = found != nullptr
+          ? static_cast<const char*>(found) - data_ + 1
+          : size_;
+    }
+    chunks.emplace_back(data_ + offset, end - offset);
+    offset = end;
+  }
+
+  return chunks;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string_view> MappedFile::Chunks(size_t size) const {
+  CHECK_GT(size, 0u);
+
+  std::vector<std::string_view> chunks;
+  chunks.reserve((size_ + size - 1) / size);
+
+  for (size_t offset = 0; offset < size_; offset += size) {
+    chunks.emplace_back(data_ + offset, std::min(size, size_ - offset));
+  }
+
+  return chunks;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace filesystem
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
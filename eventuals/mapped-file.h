@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef> // For 'size_t'.
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+#include "eventuals/expected.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+namespace filesystem {
+
+////////////////////////////////////////////////////////////////////////
+
+// A read-only memory mapping of an entire file whose contents can be
+// accessed without any system calls or copies (beyond the page cache)
+// which works well for files that are read a lot more than they are
+// written, e.g., indexes.
+//
+// The contents are exposed as 'std::string_view's, either all at once
+// via 'data()' or split into record-aligned chunks via 'Chunks()' that
+// can be passed to 'Iterate()' and then processed in parallel with
+// 'Concurrent()', e.g.:
+//
+//   MappedFile::Open(path)
+//       >> Then([](MappedFile&& file) {
+//            return Closure([file = std::move(file)]() {
+//              return Iterate(file.Chunks(1024 * 1024, '\n'))
+//                  >> Concurrent([]() {
+//                       return Map([](std::string_view chunk) {
+//                         ...
+//                       });
+//                     })
+//                  >> Collect<std::vector>();
+//            });
+//          });
+//
+// NOTE: any views must not outlive the mapping, and a file that gets
+// truncated while mapped will raise 'SIGBUS' when the truncated pages
+// are accessed.
+//
+// Moveable, not Copyable.
+class MappedFile final {
+ public:
+  // Hints about how the mapping will be accessed, see 'madvise(2)'.
+  enum class Advice {
+    Normal,
+    Sequential,
+    Random,
+    WillNeed,
+    DontNeed,
+  };
+
+  struct Options final {
+    Advice advice = Advice::Normal;
+
+    // Whether or not to read all of the pages in up front rather than
+    // faulting them in on first access.
+    bool populate = false;
+
+    // Whether or not to align the mapping to a huge page boundary and
+    // ask for it to be backed by transparent huge pages, which reduces
+    // TLB misses for big files. Only has an effect on Linux when the
+    // filesystem supports it (e.g., tmpfs) and is otherwise ignored.
+    bool huge_pages = false;
+  };
+
+  static expected<MappedFile> Open(const std::filesystem::path& path);
+
+  static expected<MappedFile> Open(
+      const std::filesystem::path& path,
+      const Options& options);
+
+  MappedFile() = default;
+
+  MappedFile(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& that) noexcept
+    : data_(that.data_),
+      size_(that.size_),
+      mapping_(that.mapping_),
+      mapping_size_(that.mapping_size_) {
+    that.data_ = nullptr;
+    that.size_ = 0;
+    that.mapping_ = nullptr;
+    that.mapping_size_ = 0;
+  }
+
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile& operator=(MappedFile&& that) noexcept;
+
+  ~MappedFile() {
+    Unmap();
+  }
+
+  std::string_view data() const {
+    return std::string_view(data_, size_);
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  // Applies 'advice' to 'size' bytes starting at 'offset' (rounded out
+  // to page boundaries), returning false if it couldn't be applied.
+  bool Advise(Advice advice, size_t offset = 0, size_t size = size_t(-1));
+
+  // Splits the contents into chunks of at least 'size' bytes (except
+  // for the last chunk) each of which ends right after a 'delimiter'
+  // so that no record spans two chunks.
+  std::vector<std::string_view> Chunks(size_t size, char delimiter) const;
+
+  // Splits the contents into chunks of exactly 'size' bytes (except
+  // for the last chunk), e.g., for fixed size records.
+  std::vector<std::string_view> Chunks(size_t size) const;
+
+ private:
+  void Unmap();
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+
+  // The actual mapping, which may be larger than the file, e.g., when
+  // it was aligned for huge pages.
+  void* mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace filesystem
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <thread>
+#include <vector>
 
 #include "glog/logging.h" // NOTE: must be included before <windows.h>.
 #include "stout/bytes.h"
@@ -66,6 +67,69 @@ inline void SetAffinity(std::thread& thread, const size_t cpu) {
 
 ////////////////////////////////////////////////////////////////////////
 
+// Returns the CPUs this process is allowed to run on, e.g., as
+// restricted by 'taskset' or a cpuset in a container. Falls back to
+// all CPUs on platforms where we can't determine this, and to just
+// CPU 0 if we can't even determine how many CPUs there are. Never
+// returns an empty vector.
+inline std::vector<unsigned int> GetAllowedCPUs() {
+  std::vector<unsigned int> cpus;
+#if !defined(__MACH__) && !defined(_WIN32)
+  cpu_set_t cpuset = {};
+  CPU_ZERO(&cpuset);
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &cpuset) == 0) {
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &cpuset)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif // !defined(__MACH__) && !defined(_WIN32)
+  if (cpus.empty()) {
+    for (unsigned int cpu = 0; cpu < std::thread::hardware_concurrency();
+         cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  // NOTE: 'std::thread::hardware_concurrency()' returns 0 if it's not
+  // computable.
+  if (cpus.empty()) {
+    cpus.push_back(0);
+  }
+  return cpus;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Returns 'count' of the allowed CPUs, wrapping around if there are
+// not enough of them.
+inline std::vector<unsigned int> GetAllowedCPUs(unsigned int count) {
+  std::vector<unsigned int> allowed = GetAllowedCPUs();
+  std::vector<unsigned int> cpus;
+  cpus.reserve(count);
+  for (unsigned int i = 0; i < count; i++) {
+    cpus.push_back(allowed[i % allowed.size()]);
+  }
+  return cpus;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Hints to the CPU that we're in a spin loop, e.g., via 'pause' on
+// x86, which reduces power and lets a sibling hyperthread make
+// progress.
+inline void CPURelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#else
+  std::this_thread::yield();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////
+
 namespace os {
 
 ////////////////////////////////////////////////////////////////////////
@@ -1,9 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef> // For 'size_t'.
+#include <cstdint> // For 'intptr_t'.
 #include <deque>
+#include <memory>
 #include <optional>
+#include <vector>
 
 #include "eventuals/callback.h"
+#include "eventuals/if.h"
 #include "eventuals/just.h"
 #include "eventuals/lock.h"
 #include "eventuals/map.h"
@@ -40,6 +47,26 @@ class Pipe final : public Synchronizable {
     }));
   }
 
+  // Writes all of 'values' to the pipe while only acquiring the lock
+  // once, unless the pipe is closed in which case the values are
+  // silently dropped.
+  [[nodiscard]] auto WriteBatch(std::vector<T>&& values) {
+    return Synchronized(Then([this, values = std::move(values)]() mutable {
+      if (!is_closed_ && !values.empty()) {
+        for (T& value : values) {
+          values_.emplace_back(std::move(value));
+        }
+        // NOTE: notifying everyone since more than one reader may be
+        // able to make progress.
+        if (values.size() == 1) {
+          has_values_or_closed_.Notify();
+        } else {
+          has_values_or_closed_.NotifyAll();
+        }
+      }
+    }));
+  }
+
   // Reads the next value from the pipe.
   [[nodiscard]] auto Read() {
     return Repeat()
@@ -74,6 +101,41 @@ class Pipe final : public Synchronizable {
            });
   }
 
+  // Reads values from the pipe in batches of at most 'max' values at a
+  // time, i.e., a stream of non-empty 'std::vector<T>', so that each
+  // batch only requires acquiring the lock once.
+  [[nodiscard]] auto ReadBatch(size_t max) {
+    CHECK_GT(max, 0u);
+    return Repeat()
+        >> Synchronized(
+               Map([this]() {
+                 return has_values_or_closed_.Wait([this]() {
+                   // Check the condition again in case of spurious wakeups.
+                   return values_.empty() && !is_closed_;
+                 });
+               })
+               >> Map([this, max]() {
+                   std::vector<T> values;
+                   if (!values_.empty()) {
+                     size_t size = std::min(max, values_.size());
+                     values.reserve(size);
+                     for (size_t i = 0; i < size; i++) {
+                       values.emplace_back(std::move(values_.front()));
+                       values_.pop_front();
+                     }
+                     if (is_closed_ && values_.empty()) {
+                       closed_and_empty_.NotifyAll();
+                     }
+                   } else {
+                     CHECK(is_closed_);
+                   }
+                   return values;
+                 }))
+        >> Until([](std::vector<T>& values) {
+             return values.empty();
+           });
+  }
+
   // Closes the pipe. Idempotent.
   [[nodiscard]] auto Close() {
     return Synchronized(Then([this]() {
@@ -121,6 +183,289 @@ class Pipe final : public Synchronizable {
 
 ////////////////////////////////////////////////////////////////////////
 
+// A pipe that holds at most 'capacity' values, where writing to a full
+// pipe waits until a reader makes room, i.e., it applies backpressure
+// to writers rather than letting the pipe grow without bound when the
+// readers can't keep up.
+//
+// Values are stored in a lock-free ring buffer so reads and writes
+// don't need to acquire the lock unless the pipe is empty or full
+// respectively, or there is someone waiting to be notified.
+//
+// Otherwise has the same semantics as 'Pipe', e.g., values written
+// after the pipe has been closed are silently dropped.
+template <typename T>
+class BoundedPipe final : public Synchronizable {
+ public:
+  // NOTE: 'capacity' gets rounded up to a power of two (and at least
+  // two since the ring buffer can't distinguish an empty cell from a
+  // full cell with only one cell).
+  explicit BoundedPipe(size_t capacity)
+    : capacity_(RoundUpToPowerOfTwo(capacity)),
+      cells_(new Cell[capacity_]),
+      not_empty_or_closed_(&lock()),
+      not_full_or_closed_(&lock()),
+      closed_and_empty_(&lock()) {
+    for (size_t i = 0; i < capacity_; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~BoundedPipe() override = default;
+
+  // Writes a value to the pipe, waiting for room if the pipe is full,
+  // unless the pipe is closed in which case the value is silently
+  // dropped.
+  [[nodiscard]] auto Write(T&& value) {
+    return Then([this, value = std::move(value)]() mutable {
+      return If(TryWrite(value))
+          .yes([this]() {
+            return NotifyIfWaiting();
+          })
+          .no([this, &value]() {
+            return Synchronized(
+                Then([this]() {
+                  waiting_.fetch_add(1);
+                  std::atomic_thread_fence(std::memory_order_seq_cst);
+                })
+                >> not_full_or_closed_.Wait([this, &value]() {
+                    return /* while */ !TryWrite(value);
+                  })
+                >> Then([this]() {
+                    waiting_.fetch_sub(1);
+                    Notify();
+                  }));
+          });
+    });
+  }
+
+  // Reads the next value from the pipe.
+  [[nodiscard]] auto Read() {
+    return Repeat()
+        >> Map([this, value = std::optional<T>()]() mutable {
+             value = TryRead();
+             return If(value.has_value() || IsClosedAndEmpty())
+                        .yes([this]() {
+                          return NotifyIfWaiting();
+                        })
+                        .no([this, &value]() {
+                          return Synchronized(
+                              Then([this]() {
+                                waiting_.fetch_add(1);
+                                std::atomic_thread_fence(
+                                    std::memory_order_seq_cst);
+                              })
+                              >> not_empty_or_closed_.Wait([this, &value]() {
+                                  value = TryRead();
+                                  return /* while */ !value.has_value()
+                                      && !IsClosedAndEmpty();
+                                })
+                              >> Then([this]() {
+                                  waiting_.fetch_sub(1);
+                                  Notify();
+                                }));
+                        })
+                 >> Then([&value]() {
+                      return std::move(value);
+                    });
+           })
+        >> Until([](std::optional<T>& value) {
+             return !value.has_value();
+           })
+        >> Map([](std::optional<T>&& value) {
+             CHECK(value);
+             // NOTE: need to use 'Just' here in case 'T' is an
+             // eventual otherwise we'll try and compose with it here!
+             return Just(std::move(*value));
+           });
+  }
+
+  // Closes the pipe. Idempotent.
+  [[nodiscard]] auto Close() {
+    return Synchronized(Then([this]() {
+      enqueue_.fetch_or(CLOSED);
+      not_empty_or_closed_.NotifyAll();
+      not_full_or_closed_.NotifyAll();
+      if (IsClosedAndEmpty()) {
+        closed_and_empty_.NotifyAll();
+      }
+    }));
+  }
+
+  // Returns the number of values currently in the pipe.
+  [[nodiscard]] auto Size() {
+    return Then([this]() {
+      size_t enqueued = enqueue_.load() & ~CLOSED;
+      size_t dequeued = dequeue_.load();
+      // NOTE: a reader may have dequeued a value that a writer hasn't
+      // finished enqueuing yet.
+      return enqueued > dequeued ? enqueued - dequeued : size_t(0);
+    });
+  }
+
+  // Returns whether the pipe is closed.
+  [[nodiscard]] auto IsClosed() {
+    return Then([this]() {
+      return (enqueue_.load() & CLOSED) != 0;
+    });
+  }
+
+  // Blocks until the pipe is closed and drained of values.
+  // Postcondition: IsClosed() == true && Size() == 0.
+  [[nodiscard]] auto WaitForClosedAndEmpty() {
+    return TypeCheck<void>(Synchronized(
+        Then([this]() {
+          waiting_.fetch_add(1);
+        })
+        >> closed_and_empty_.Wait([this]() {
+            return /* while */ !IsClosedAndEmpty();
+          })
+        >> Then([this]() {
+            waiting_.fetch_sub(1);
+          })));
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+ private:
+  // Set in 'enqueue_' once the pipe has been closed so that writers
+  // can atomically check that the pipe is still open as they enqueue.
+  static constexpr size_t CLOSED = ~(~size_t(0) >> 1);
+
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    CHECK_GT(n, 0u) << "capacity must be positive";
+    size_t power = 2;
+    while (power < n) {
+      power <<= 1;
+    }
+    return power;
+  }
+
+  // A slot in the ring buffer, see Dmitry Vyukov's bounded MPMC queue
+  // for how 'sequence' is used to coordinate readers and writers.
+  struct Cell final {
+    std::atomic<size_t> sequence;
+    std::optional<T> value;
+  };
+
+  // Tries to enqueue 'value' without blocking, returning false if the
+  // pipe is full. Returns true if the pipe is closed since the value
+  // gets dropped.
+  bool TryWrite(T& value) {
+    size_t position = enqueue_.load(std::memory_order_relaxed);
+    while (true) {
+      if (position & CLOSED) {
+        return true;
+      }
+      Cell& cell = cells_[position & (capacity_ - 1)];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t difference = intptr_t(sequence) - intptr_t(position);
+      if (difference == 0) {
+        // NOTE: this fails if the pipe has been closed in the meantime
+        // since 'CLOSED' gets set in 'enqueue_'.
+        if (enqueue_.compare_exchange_weak(
+                position,
+                position + 1,
+                std::memory_order_relaxed)) {
+          cell.value.emplace(std::move(value));
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = enqueue_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Tries to dequeue a value without blocking, returning nothing if
+  // the pipe is empty.
+  std::optional<T> TryRead() {
+    size_t position = dequeue_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell& cell = cells_[position & (capacity_ - 1)];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t difference = intptr_t(sequence) - intptr_t(position + 1);
+      if (difference == 0) {
+        if (dequeue_.compare_exchange_weak(
+                position,
+                position + 1,
+                std::memory_order_relaxed)) {
+          std::optional<T> value = std::move(cell.value);
+          cell.value.reset();
+          cell.sequence.store(
+              position + capacity_,
+              std::memory_order_release);
+          return value;
+        }
+      } else if (difference < 0) {
+        return std::nullopt;
+      } else {
+        position = dequeue_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool IsClosedAndEmpty() {
+    size_t enqueued = enqueue_.load();
+    return (enqueued & CLOSED) != 0 && (enqueued & ~CLOSED) == dequeue_.load();
+  }
+
+  // Notifies anyone waiting that the pipe has changed. Must be called
+  // with the lock held.
+  void Notify() {
+    not_empty_or_closed_.Notify();
+    not_full_or_closed_.Notify();
+    if (IsClosedAndEmpty()) {
+      closed_and_empty_.NotifyAll();
+    }
+  }
+
+  // Acquires the lock to notify anyone waiting if (and only if) there
+  // is anyone waiting, which keeps the lock off of the fast path.
+  auto NotifyIfWaiting() {
+    // NOTE: pairs with waiters incrementing 'waiting_' before they
+    // check the ring buffer again so that either they'll see our
+    // change or we'll see them waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return If(waiting_.load() > 0)
+        .yes([this]() {
+          return Synchronized(Then([this]() {
+            Notify();
+          }));
+        })
+        .no([]() {
+          return Just();
+        });
+  }
+
+  const size_t capacity_;
+  std::unique_ptr<Cell[]> cells_;
+
+  // NOTE: keeping the positions on separate cache lines so readers
+  // and writers don't contend with each other.
+  alignas(64) std::atomic<size_t> enqueue_ = 0;
+  alignas(64) std::atomic<size_t> dequeue_ = 0;
+
+  // Number of readers and writers waiting (or about to wait) on one of
+  // the condition variables below.
+  alignas(64) std::atomic<size_t> waiting_ = 0;
+
+  // Notified whenever we either have new values or the pipe has been closed.
+  ConditionVariable not_empty_or_closed_;
+  // Notified whenever we either have room for values or the pipe has
+  // been closed.
+  ConditionVariable not_full_or_closed_;
+  // Notified once the pipe is closed and is emptied of all values, after which
+  // the pipe will never again contain values.
+  ConditionVariable closed_and_empty_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
 } // namespace eventuals
 
 ////////////////////////////////////////////////////////////////////////
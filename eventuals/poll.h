@@ -15,7 +15,7 @@ namespace eventuals {
 ////////////////////////////////////////////////////////////////////////
 
 [[nodiscard]] inline auto Poll(int fd, PollEvents events) {
-  return EventLoop::Default().Poll(fd, events);
+  return EventLoop::Current().Poll(fd, events);
 }
 
 ////////////////////////////////////////////////////////////////////////
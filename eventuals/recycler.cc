@@ -0,0 +1,121 @@
+#include "eventuals/recycler.h"
+
+#include <array>
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////
+
+struct Block final {
+  Block* next = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+struct Cache final {
+  ~Cache() {
+    for (Block*& head : heads) {
+      while (head != nullptr) {
+        ::operator delete(std::exchange(head, head->next));
+      }
+    }
+
+    // Any deallocations that happen after this thread's cache has
+    // been destructed (e.g., from the destructor of some other
+    // 'thread_local') go directly to the system allocator.
+    destructed = true;
+  }
+
+  std::array<Block*, Recycler::CLASSES> heads = {};
+  std::array<std::size_t, Recycler::CLASSES> sizes = {};
+
+  Recycler::Statistics statistics;
+
+  // NOTE: trivially destructible so that it is still valid to read
+  // after 'Cache' has been destructed.
+  static inline thread_local bool destructed = false;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+Cache* GetCache() {
+  static thread_local Cache cache;
+  return Cache::destructed ? nullptr : &cache;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////
+
+void* Recycler::Allocate(std::size_t size, std::size_t alignment) {
+  if (!Recyclable(size, alignment)) {
+    return ::operator new(size, std::align_val_t(alignment));
+  }
+
+  std::size_t index = ClassOf(size);
+
+  Cache* cache = GetCache();
+
+  if (cache != nullptr) {
+    if (cache->heads[index] != nullptr) {
+      cache->statistics.hits++;
+      cache->statistics.cached--;
+      cache->sizes[index]--;
+      Block* block = cache->heads[index];
+      cache->heads[index] = block->next;
+      return block;
+    }
+
+    cache->statistics.misses++;
+  }
+
+  // Always allocate the full size class so any block within a class
+  // can be reused for any allocation of that class.
+  return ::operator new((index + 1) * CLASS_SIZE);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void Recycler::Deallocate(
+    void* block,
+    std::size_t size,
+    std::size_t alignment) {
+  if (!Recyclable(size, alignment)) {
+    ::operator delete(block, std::align_val_t(alignment));
+    return;
+  }
+
+  std::size_t index = ClassOf(size);
+
+  Cache* cache = GetCache();
+
+  if (cache != nullptr && cache->sizes[index] < BLOCKS_PER_CLASS) {
+    cache->statistics.cached++;
+    cache->sizes[index]++;
+    cache->heads[index] = new (block) Block{cache->heads[index]};
+    return;
+  }
+
+  ::operator delete(block);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+Recycler::Statistics Recycler::statistics() {
+  Cache* cache = GetCache();
+  return cache != nullptr ? cache->statistics : Statistics();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef> // For 'std::max_align_t', 'std::size_t'.
+#include <new>
+#include <type_traits>
+#include <utility> // For 'std::exchange', 'std::forward'.
+
+#include "glog/logging.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+// Per-thread free lists of memory blocks bucketed into size classes
+// so that repeatedly allocating and deallocating objects of similar
+// sizes (e.g., the heap allocated continuations of type-erased
+// eventuals like 'Task' and 'Generator') doesn't hit the system
+// allocator once a thread has warmed up.
+//
+// A block that gets deallocated on a different thread than it was
+// allocated on is cached on the deallocating thread, which is fine
+// because blocks are never associated with a thread, just a size
+// class. Each size class caches at most 'BLOCKS_PER_CLASS' blocks and
+// anything beyond that (or any allocation larger than 'MAX_SIZE' or
+// with extended alignment) goes directly to the system allocator.
+class Recycler final {
+ public:
+  static constexpr std::size_t CLASS_SIZE = 64;
+  static constexpr std::size_t MAX_SIZE = 4096;
+  static constexpr std::size_t CLASSES = MAX_SIZE / CLASS_SIZE;
+  static constexpr std::size_t BLOCKS_PER_CLASS = 64;
+
+  // Returns a block of memory that is at least 'size' bytes and
+  // aligned to at least 'alignment'.
+  static void* Allocate(
+      std::size_t size,
+      std::size_t alignment = alignof(std::max_align_t));
+
+  // Returns a block previously returned from 'Allocate()' with the
+  // same 'size' and 'alignment'.
+  static void Deallocate(
+      void* block,
+      std::size_t size,
+      std::size_t alignment = alignof(std::max_align_t));
+
+  template <typename T, typename... Args>
+  static T* New(Args&&... args) {
+    void* block = Allocate(sizeof(T), alignof(T));
+    try {
+      return new (block) T(std::forward<Args>(args)...);
+    } catch (...) {
+      Deallocate(block, sizeof(T), alignof(T));
+      throw;
+    }
+  }
+
+  template <typename T>
+  static void Delete(T* t) {
+    t->~T();
+    Deallocate(t, sizeof(T), alignof(T));
+  }
+
+  // Counters for the calling thread, helpful for tests and for
+  // determining whether or not the size classes are a good fit.
+  struct Statistics {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t cached = 0;
+  };
+
+  static Statistics statistics();
+
+ private:
+  static bool Recyclable(std::size_t size, std::size_t alignment) {
+    return size <= MAX_SIZE && alignment <= alignof(std::max_align_t);
+  }
+
+  static std::size_t ClassOf(std::size_t size) {
+    return size == 0 ? 0 : (size - 1) / CLASS_SIZE;
+  }
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Storage for the continuation of a type-erased eventual. Objects
+// that fit within 'SIZE' bytes are stored inline and anything else is
+// allocated from the 'Recycler'.
+//
+// NOTE: the storage can only be moved while it is empty since the
+// object stored within might hold pointers into itself, which is fine
+// for type-erased eventuals because their continuation is only
+// emplaced after they have been started (at which point they can no
+// longer be moved).
+class TypeErasedStorage final {
+ public:
+  static constexpr std::size_t SIZE = 256;
+
+  TypeErasedStorage() = default;
+
+  TypeErasedStorage(TypeErasedStorage&& that) noexcept {
+    CHECK(!that) << "moving non-empty 'TypeErasedStorage'";
+  }
+
+  TypeErasedStorage& operator=(TypeErasedStorage&& that) noexcept {
+    CHECK(!that) << "moving non-empty 'TypeErasedStorage'";
+    Reset();
+    return *this;
+  }
+
+  ~TypeErasedStorage() {
+    Reset();
+  }
+
+  template <typename T, typename... Args>
+  T* Emplace(Args&&... args) {
+    Reset();
+
+    T* t = nullptr;
+
+    if constexpr (Inline<T>()) {
+      t = new (&storage_) T(std::forward<Args>(args)...);
+      destroy_ = [](void* t) {
+        static_cast<T*>(t)->~T();
+      };
+    } else {
+      t = Recycler::New<T>(std::forward<Args>(args)...);
+      destroy_ = [](void* t) {
+        Recycler::Delete(static_cast<T*>(t));
+      };
+    }
+
+    object_ = t;
+
+    return t;
+  }
+
+  template <typename T>
+  static constexpr bool Inline() {
+    return sizeof(T) <= SIZE && alignof(T) <= alignof(std::max_align_t);
+  }
+
+  void* get() const {
+    return object_;
+  }
+
+  explicit operator bool() const {
+    return object_ != nullptr;
+  }
+
+  void Reset() {
+    if (object_ != nullptr) {
+      std::exchange(destroy_, nullptr)(std::exchange(object_, nullptr));
+    }
+  }
+
+ private:
+  void* object_ = nullptr;
+  void (*destroy_)(void*) = nullptr;
+  std::aligned_storage_t<SIZE, alignof(std::max_align_t)> storage_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -10,6 +10,7 @@
 #include "eventuals/callback.h"
 #include "eventuals/closure.h"
 #include "eventuals/compose.h"
+#include "eventuals/errors.h"
 #include "eventuals/interrupt.h"
 #include "eventuals/lazy.h"
 #include "eventuals/terminal.h"
@@ -164,7 +165,7 @@ class Scheduler {
 ////////////////////////////////////////////////////////////////////////
 
 struct _Reschedule final {
-  template <typename K_, typename Arg_>
+  template <typename K_, typename Arg_, typename Errors_>
   struct Continuation final {
     Continuation(K_ k, stout::borrowed_ref<Scheduler::Context> context)
       : context_(std::move(context)),
@@ -207,19 +208,10 @@ struct _Reschedule final {
             k_.Fail(std::forward<Error>(error));
           },
           [&]() {
-            // TODO(benh): avoid allocating on heap by storing args in
-            // pre-allocated buffer based on composing with Errors.
-            using Tuple = std::tuple<decltype(&k_), Error>;
-            auto tuple = std::make_unique<Tuple>(
-                &k_,
-                std::forward<Error>(error));
-
-            return [tuple = std::move(tuple)]() mutable {
-              std::apply(
-                  [](auto* k_, auto&&... args) {
-                    k_->Fail(std::forward<decltype(args)>(args)...);
-                  },
-                  std::move(*tuple));
+            error_.Emplace(std::forward<Error>(error));
+
+            return [this]() {
+              k_.Fail(error_.template Extract<Error>());
             };
           });
     }
@@ -300,6 +292,8 @@ struct _Reschedule final {
             Undefined>>
         arg_;
 
+    ErrorStorage<Errors_> error_;
+
     TypeErasedStream* stream_ = nullptr;
 
     // NOTE: we store 'k_' as the _last_ member so it will be
@@ -328,7 +322,7 @@ struct _Reschedule final {
 
     template <typename Arg, typename Errors, typename K>
     auto k(K k) && {
-      return Continuation<K, Arg>(std::move(k), std::move(context_));
+      return Continuation<K, Arg, Errors>(std::move(k), std::move(context_));
     }
 
     stout::borrowed_ref<Scheduler::Context> context_;
@@ -0,0 +1,735 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include "eventuals/callback.h"
+#include "eventuals/compose.h"
+#include "eventuals/errors.h"
+#include "eventuals/scheduler.h"
+#include "eventuals/stream.h"
+#include "eventuals/undefined.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+// A reader-writer lock for state that is read a lot more than it is
+// written, e.g., lookup tables, configuration snapshots, caches, etc.
+// Any number of readers can hold the lock at the same time (see
+// 'AcquireShared()') while a writer holds it exclusively (see
+// 'Acquire()').
+//
+// Acquiring the lock when it isn't contended is a single "compare
+// and swap" for both readers and writers. Otherwise the waiter gets
+// queued and is continued (on its scheduler context) once it has
+// been granted the lock, which is decided by the lock's 'Policy':
+//
+//   'WriterPreference': a queued writer gets the lock before any
+//   readers, even readers that were queued before it, and no new
+//   readers get the lock while a writer is queued. This keeps
+//   writers from starving at the expense of readers.
+//
+//   'Fair': waiters get the lock in the order they were queued, and
+//   no new readers get the lock while anybody is queued.
+class SharedLock final {
+ public:
+  enum class Policy {
+    WriterPreference,
+    Fair,
+  };
+
+  struct Waiter final {
+    Callback<void()> f;
+    Waiter* next = nullptr;
+    bool shared = false;
+    stout::borrowed_ptr<Scheduler::Context> context;
+  };
+
+  explicit SharedLock(Policy policy = Policy::WriterPreference)
+    : policy_(policy) {}
+
+  SharedLock(const SharedLock&) = delete;
+
+  // Returns true if 'waiter' acquired the lock without having to be
+  // queued, otherwise false (and 'waiter' was _not_ queued).
+  bool AcquireFast(Waiter* waiter) {
+    CHECK(waiter->next == nullptr);
+
+    uint64_t state = state_.load(std::memory_order_relaxed);
+
+    if (waiter->shared) {
+      while (CanAcquireShared(state)) {
+        if (state_.compare_exchange_weak(
+                state,
+                state + 1,
+                std::memory_order_acquire,
+                std::memory_order_relaxed)) {
+          return true;
+        }
+      }
+      return false;
+    } else {
+      state = 0;
+      if (state_.compare_exchange_strong(
+              state,
+              WRITER,
+              std::memory_order_acquire,
+              std::memory_order_relaxed)) {
+        owner_.store(CHECK_NOTNULL(waiter->context.get()));
+        return true;
+      }
+      return false;
+    }
+  }
+
+  // Returns true if 'waiter' acquired the lock, otherwise 'waiter'
+  // has been queued and 'waiter->f' will be invoked once it has been
+  // granted the lock.
+  bool AcquireSlow(Waiter* waiter) {
+    CHECK(waiter->next == nullptr);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    uint64_t state = state_.load(std::memory_order_relaxed);
+
+    for (;;) {
+      if (waiter->shared ? CanAcquireShared(state) : state == 0) {
+        if (state_.compare_exchange_weak(
+                state,
+                waiter->shared ? state + 1 : WRITER,
+                std::memory_order_acquire,
+                std::memory_order_relaxed)) {
+          if (!waiter->shared) {
+            owner_.store(CHECK_NOTNULL(waiter->context.get()));
+          }
+          return true;
+        }
+      } else {
+        // NOTE: we need to mark that we're queued with a "compare and
+        // swap" so that if the lock gets released between loading
+        // 'state' and now we'll try and acquire it again rather than
+        // queue ourselves after whoever released it has already
+        // checked for waiters.
+        uint64_t queued = state | QUEUED;
+        if (!waiter->shared) {
+          queued |= WRITER_WAITING;
+        }
+
+        if (state_.compare_exchange_weak(
+                state,
+                queued,
+                std::memory_order_relaxed,
+                std::memory_order_relaxed)) {
+          break;
+        }
+      }
+    }
+
+    if (tail_ == nullptr) {
+      head_ = waiter;
+    } else {
+      tail_->next = waiter;
+    }
+
+    tail_ = waiter;
+
+    if (!waiter->shared) {
+      writers_++;
+    }
+
+    return false;
+  }
+
+  void ReleaseShared() {
+    uint64_t state = state_.fetch_sub(1, std::memory_order_release);
+
+    CHECK_GT(state & READERS, 0u) << "releasing without being acquired";
+
+    // Only the last reader can let a writer in.
+    if ((state & READERS) == 1 && (state & QUEUED)) {
+      Grant();
+    }
+  }
+
+  void Release() {
+    // Unset owner _before_ releasing to avoid racing with the next
+    // writer setting the owner.
+    owner_.store(nullptr);
+
+    uint64_t state = state_.fetch_and(~WRITER, std::memory_order_release);
+
+    CHECK(state & WRITER) << "releasing without being acquired";
+
+    if (state & QUEUED) {
+      Grant();
+    }
+  }
+
+  bool Available() {
+    return state_.load(std::memory_order_relaxed) == 0;
+  }
+
+  // Returns true if the lock is held exclusively by the current
+  // scheduler context (there is no owner when it's held shared).
+  bool OwnedByCurrentSchedulerContext() {
+    // NOTE: using 'CHECK_NOTNULL' because the intention here is that
+    // the caller expects to have a current scheduler context.
+    return owner_.load() == CHECK_NOTNULL(Scheduler::Context::Get().get());
+  }
+
+  Policy policy() const {
+    return policy_;
+  }
+
+ private:
+  // Bits of 'state_': whether or not a writer holds the lock, whether
+  // or not any writers are queued, whether or not anybody is queued,
+  // and the rest are the number of readers holding the lock.
+  static constexpr uint64_t WRITER = uint64_t(1) << 63;
+  static constexpr uint64_t WRITER_WAITING = uint64_t(1) << 62;
+  static constexpr uint64_t QUEUED = uint64_t(1) << 61;
+  static constexpr uint64_t READERS = QUEUED - 1;
+
+  bool CanAcquireShared(uint64_t state) const {
+    return !(state & WRITER)
+        && !(state & (policy_ == Policy::Fair ? QUEUED : WRITER_WAITING));
+  }
+
+  // Returns the link to the waiter that should be granted the lock
+  // next based on our policy (and sets 'previous' to the waiter
+  // before it, if any), or nullptr if nobody is queued.
+  //
+  // NOTE: expects 'mutex_' to be held.
+  Waiter** Next(Waiter** previous) {
+    *previous = nullptr;
+
+    if (head_ == nullptr) {
+      return nullptr;
+    }
+
+    Waiter** link = &head_;
+
+    if (policy_ == Policy::WriterPreference && writers_ > 0) {
+      while ((*link)->shared) {
+        *previous = *link;
+        link = &(*link)->next;
+      }
+    }
+
+    return link;
+  }
+
+  // Grants the lock to as many queued waiters as possible (a writer
+  // or consecutive readers) and then continues them.
+  void Grant() {
+    Waiter* granted = nullptr;
+    Waiter* granted_tail = nullptr;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      Waiter* previous = nullptr;
+      Waiter** link = nullptr;
+
+      while ((link = Next(&previous)) != nullptr) {
+        Waiter* waiter = *link;
+
+        uint64_t state = state_.load(std::memory_order_relaxed);
+
+        bool acquired = false;
+
+        uint64_t held = waiter->shared ? WRITER : (WRITER | READERS);
+
+        while (!(state & held)) {
+          if (state_.compare_exchange_weak(
+                  state,
+                  waiter->shared ? state + 1 : state | WRITER,
+                  std::memory_order_acquire,
+                  std::memory_order_relaxed)) {
+            acquired = true;
+            break;
+          }
+        }
+
+        if (!acquired) {
+          break;
+        }
+
+        // Dequeue 'waiter'.
+        *link = waiter->next;
+
+        if (tail_ == waiter) {
+          tail_ = previous;
+        }
+
+        waiter->next = nullptr;
+
+        if (granted_tail == nullptr) {
+          granted = waiter;
+        } else {
+          granted_tail->next = waiter;
+        }
+
+        granted_tail = waiter;
+
+        if (!waiter->shared) {
+          CHECK_GT(writers_, 0u);
+          writers_--;
+          owner_.store(CHECK_NOTNULL(waiter->context.get()));
+          break;
+        }
+      }
+
+      // Update whether or not anybody (and any writers) are still
+      // queued now that we've dequeued everyone we granted.
+      uint64_t state = state_.load(std::memory_order_relaxed);
+
+      uint64_t queued = (head_ != nullptr ? QUEUED : 0)
+          | (writers_ > 0 ? WRITER_WAITING : 0);
+
+      while (!state_.compare_exchange_weak(
+          state,
+          (state & ~(QUEUED | WRITER_WAITING)) | queued,
+          std::memory_order_relaxed,
+          std::memory_order_relaxed)) {}
+    }
+
+    // NOTE: continuing waiters _after_ releasing 'mutex_' since they
+    // might try to acquire (or release) the lock again.
+    while (granted != nullptr) {
+      Waiter* waiter = granted;
+      granted = waiter->next;
+      waiter->next = nullptr;
+
+      Callback<void()> f = std::move(waiter->f);
+
+      f();
+    }
+  }
+
+  const Policy policy_;
+
+  std::atomic<uint64_t> state_ = 0;
+
+  // Queue of waiters, and how many of them are writers, which is only
+  // accessed while holding 'mutex_' (i.e., on the slow path).
+  std::mutex mutex_;
+  Waiter* head_ = nullptr;
+  Waiter* tail_ = nullptr;
+  size_t writers_ = 0;
+
+  // NOTE: like 'Lock' we store the owning scheduler context pointer
+  // of the writer rather than looking it up from a waiter that might
+  // have since been deleted.
+  std::atomic<Scheduler::Context*> owner_ = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+template <bool shared_>
+struct _SharedLockAcquire final {
+  template <typename K_, typename Arg_, typename Errors_>
+  struct Continuation final {
+    Continuation(K_ k, SharedLock* lock)
+      : lock_(lock),
+        k_(std::move(k)) {
+      waiter_.shared = shared_;
+    }
+
+    Continuation(Continuation&& that) noexcept
+      : lock_(that.lock_),
+        k_(std::move(that.k_)) {
+      CHECK(!that.waiter_.context) << "moving after starting";
+      waiter_.shared = shared_;
+    }
+
+    ~Continuation() {
+      CHECK(!waiter_.f) << "continuation still waiting for lock";
+    }
+
+    template <typename... Args>
+    void Start(Args&&... args) {
+      static_assert(
+          sizeof...(args) == 0 || sizeof...(args) == 1,
+          "Acquire only supports 0 or 1 argument, but found > 1");
+
+      static_assert(std::is_void_v<Arg_> || sizeof...(args) == 1);
+
+      if (AcquireFast()) {
+        k_.Start(std::forward<Args>(args)...);
+      } else {
+        if constexpr (!std::is_void_v<Arg_>) {
+          arg_.emplace(std::forward<Args>(args)...);
+        }
+
+        AcquireSlow([this]() {
+          if constexpr (!std::is_void_v<Arg_>) {
+            k_.Start(std::move(*arg_));
+          } else {
+            k_.Start();
+          }
+        });
+      }
+    }
+
+    template <typename Error>
+    void Fail(Error&& error) {
+      if (AcquireFast()) {
+        k_.Fail(std::forward<Error>(error));
+      } else {
+        error_.Emplace(std::forward<Error>(error));
+
+        AcquireSlow([this]() {
+          k_.Fail(error_.template Extract<Error>());
+        });
+      }
+    }
+
+    void Stop() {
+      if (AcquireFast()) {
+        k_.Stop();
+      } else {
+        AcquireSlow([this]() {
+          k_.Stop();
+        });
+      }
+    }
+
+    void Begin(TypeErasedStream& stream) {
+      CHECK(stream_ == nullptr);
+      stream_ = &stream;
+
+      if (AcquireFast()) {
+        k_.Begin(*CHECK_NOTNULL(stream_));
+      } else {
+        AcquireSlow([this]() {
+          k_.Begin(*CHECK_NOTNULL(stream_));
+        });
+      }
+    }
+
+    template <typename... Args>
+    void Body(Args&&... args) {
+      static_assert(
+          sizeof...(args) == 0 || sizeof...(args) == 1,
+          "Acquire only supports 0 or 1 argument, but found > 1");
+
+      static_assert(std::is_void_v<Arg_> || sizeof...(args) == 1);
+
+      if (AcquireFast()) {
+        k_.Body(std::forward<Args>(args)...);
+      } else {
+        if constexpr (!std::is_void_v<Arg_>) {
+          arg_.emplace(std::forward<Args>(args)...);
+        }
+
+        AcquireSlow([this]() {
+          if constexpr (!std::is_void_v<Arg_>) {
+            k_.Body(std::move(*arg_));
+          } else {
+            k_.Body();
+          }
+        });
+      }
+    }
+
+    void Ended() {
+      if (AcquireFast()) {
+        k_.Ended();
+      } else {
+        AcquireSlow([this]() {
+          k_.Ended();
+        });
+      }
+    }
+
+    void Register(Interrupt& interrupt) {
+      k_.Register(interrupt);
+    }
+
+    bool AcquireFast() {
+      waiter_.context = Scheduler::Context::Get();
+
+      EVENTUALS_LOG(2)
+          << "'" << waiter_.context->name() << "' acquiring"
+          << (shared_ ? " shared" : "");
+
+      if (lock_->AcquireFast(&waiter_)) {
+        EVENTUALS_LOG(2)
+            << "'" << waiter_.context->name() << "' (fast) acquired";
+
+        // NOTE: need to relinquish borrow of context to avoid this
+        // continuation causing a deadlock when trying to destruct the
+        // context.
+        waiter_.context.relinquish();
+
+        return true;
+      }
+
+      return false;
+    }
+
+    void AcquireSlow(Callback<void()>&& acquired) {
+      acquired_ = std::move(acquired);
+
+      waiter_.f = [this]() mutable {
+        EVENTUALS_LOG(2)
+            << "'" << waiter_.context->name() << "' (very slow) acquired";
+
+        waiter_.context->Unblock([this]() mutable {
+          // NOTE: need to relinquish borrow of context to avoid
+          // this continuation causing a deadlock when trying to
+          // destruct the context.
+          waiter_.context.relinquish();
+
+          Callback<void()> acquired = std::move(acquired_);
+
+          acquired();
+        });
+      };
+
+      if (lock_->AcquireSlow(&waiter_)) {
+        EVENTUALS_LOG(2)
+            << "'" << waiter_.context->name() << "' (slow) acquired";
+
+        // NOTE: like 'Acquire()' for a 'Lock' this defers continued
+        // execution via 'Context::Unblock()'.
+        Callback<void()> f = std::move(waiter_.f);
+
+        f();
+      }
+    }
+
+    SharedLock* lock_;
+    SharedLock::Waiter waiter_;
+    Callback<void()> acquired_;
+    std::optional<
+        std::conditional_t<!std::is_void_v<Arg_>, Arg_, Undefined>>
+        arg_;
+    ErrorStorage<Errors_> error_;
+    TypeErasedStream* stream_ = nullptr;
+
+    // NOTE: we store 'k_' as the _last_ member so it will be
+    // destructed _first_ and thus we won't have any use-after-delete
+    // issues during destruction of 'k_' if it holds any references or
+    // pointers to any (or within any) of the above members.
+    K_ k_;
+  };
+
+  struct Composable final {
+    template <typename Arg, typename Errors>
+    using ValueFrom = Arg;
+
+    template <typename Arg, typename Errors>
+    using ErrorsFrom = Errors;
+
+    // NOTE: see comment in 'Acquire()' for a 'Lock' for why this can
+    // compose with anything.
+    template <typename Downstream>
+    static constexpr bool CanCompose = true;
+
+    using Expects = StreamOrValue;
+
+    template <typename Arg, typename Errors, typename K>
+    auto k(K k) && {
+      return Continuation<K, Arg, Errors>(std::move(k), lock_);
+    }
+
+    SharedLock* lock_;
+  };
+};
+
+////////////////////////////////////////////////////////////////////////
+
+template <bool shared_>
+struct _SharedLockRelease final {
+  template <typename K_>
+  struct Continuation final {
+    Continuation(K_ k, SharedLock* lock)
+      : lock_(lock),
+        k_(std::move(k)) {}
+
+    template <typename... Args>
+    void Start(Args&&... args) {
+      Release();
+      k_.Start(std::forward<decltype(args)>(args)...);
+    }
+
+    template <typename Error>
+    void Fail(Error&& error) {
+      Release();
+      k_.Fail(std::forward<Error>(error));
+    }
+
+    void Stop() {
+      Release();
+      k_.Stop();
+    }
+
+    void Begin(TypeErasedStream& stream) {
+      Release();
+      k_.Begin(stream);
+    }
+
+    template <typename... Args>
+    void Body(Args&&... args) {
+      Release();
+      k_.Body(std::forward<decltype(args)>(args)...);
+    }
+
+    void Ended() {
+      Release();
+      k_.Ended();
+    }
+
+    void Register(Interrupt& interrupt) {
+      k_.Register(interrupt);
+    }
+
+    void Release() {
+      CHECK(!lock_->Available());
+      if constexpr (shared_) {
+        lock_->ReleaseShared();
+      } else {
+        lock_->Release();
+      }
+    }
+
+    SharedLock* lock_;
+
+    // NOTE: we store 'k_' as the _last_ member so it will be
+    // destructed _first_ and thus we won't have any use-after-delete
+    // issues during destruction of 'k_' if it holds any references or
+    // pointers to any (or within any) of the above members.
+    K_ k_;
+  };
+
+  struct Composable final {
+    template <typename Arg, typename Errors>
+    using ValueFrom = Arg;
+
+    template <typename Arg, typename Errors>
+    using ErrorsFrom = Errors;
+
+    template <typename Downstream>
+    static constexpr bool CanCompose = true;
+
+    using Expects = StreamOrValue;
+
+    template <typename Arg, typename Errors, typename K>
+    auto k(K k) && {
+      return Continuation<K>(std::move(k), lock_);
+    }
+
+    SharedLock* lock_;
+  };
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Acquires 'lock' exclusively.
+[[nodiscard]] inline auto Acquire(SharedLock* lock) {
+  return _SharedLockAcquire<false>::Composable{lock};
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Acquires 'lock' shared with any other readers.
+[[nodiscard]] inline auto AcquireShared(SharedLock* lock) {
+  return _SharedLockAcquire<true>::Composable{lock};
+}
+
+////////////////////////////////////////////////////////////////////////
+
+[[nodiscard]] inline auto Release(SharedLock* lock) {
+  return _SharedLockRelease<false>::Composable{lock};
+}
+
+////////////////////////////////////////////////////////////////////////
+
+[[nodiscard]] inline auto ReleaseShared(SharedLock* lock) {
+  return _SharedLockRelease<true>::Composable{lock};
+}
+
+////////////////////////////////////////////////////////////////////////
+
+template <bool shared_>
+struct _SharedSynchronized final {
+  template <typename E_>
+  struct Composable final {
+    // NOTE: declaring these here to use them to make type aliases.
+    SharedLock* lock_;
+    E_ e_;
+
+    using Acquire_ = typename _SharedLockAcquire<shared_>::Composable;
+    using Release_ = typename _SharedLockRelease<shared_>::Composable;
+
+    using Composed_ =
+        decltype(Acquire_{lock_} >> std::move(e_) >> Release_{lock_});
+
+    template <typename Arg, typename Errors>
+    using ValueFrom = typename Composed_::template ValueFrom<Arg, Errors>;
+
+    template <typename Arg, typename Errors>
+    using ErrorsFrom = typename Composed_::template ErrorsFrom<Arg, Errors>;
+
+    template <typename Downstream>
+    static constexpr bool CanCompose = E_::template CanCompose<Downstream>;
+
+    using Expects = typename E_::Expects;
+
+    template <typename Arg, typename Errors, typename K>
+    auto k(K k) && {
+      return Build<Arg, Errors>(
+          Acquire_{lock_} >> std::move(e_) >> Release_{lock_},
+          std::move(k));
+    }
+  };
+};
+
+////////////////////////////////////////////////////////////////////////
+
+// Like 'Synchronizable' except with a 'SharedLock' so that operations
+// which only read state can use 'SharedSynchronized()' and proceed
+// concurrently with one another, while operations that write state
+// use 'Synchronized()' as usual.
+class SharedSynchronizable {
+ public:
+  explicit SharedSynchronizable(
+      SharedLock::Policy policy = SharedLock::Policy::WriterPreference)
+    : lock_(policy) {}
+
+  virtual ~SharedSynchronizable() = default;
+
+  template <typename E>
+  [[nodiscard]] auto Synchronized(E e) {
+    return typename _SharedSynchronized<false>::template Composable<E>{
+        &lock_,
+        std::move(e)};
+  }
+
+  template <typename E>
+  [[nodiscard]] auto SharedSynchronized(E e) {
+    return typename _SharedSynchronized<true>::template Composable<E>{
+        &lock_,
+        std::move(e)};
+  }
+
+  SharedLock& lock() {
+    return lock_;
+  }
+
+ private:
+  SharedLock lock_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -20,7 +20,7 @@ namespace eventuals {
 ////////////////////////////////////////////////////////////////////////
 
 [[nodiscard]] inline auto WaitForSignal(int signum) {
-  return EventLoop::Default().WaitForSignal(signum);
+  return EventLoop::Current().WaitForSignal(signum);
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -10,109 +10,270 @@ namespace eventuals {
 ////////////////////////////////////////////////////////////////////////
 
 StaticThreadPool::StaticThreadPool()
-  : concurrency(std::thread::hardware_concurrency()) {
-  semaphores_.reserve(concurrency);
-  heads_.reserve(concurrency);
+  : StaticThreadPool(GetAllowedCPUs()) {}
+
+////////////////////////////////////////////////////////////////////////
+
+StaticThreadPool::StaticThreadPool(unsigned int concurrency)
+  : StaticThreadPool(GetAllowedCPUs(concurrency)) {}
+
+////////////////////////////////////////////////////////////////////////
+
+StaticThreadPool::StaticThreadPool(std::vector<unsigned int> cpus)
+  : concurrency(cpus.size()),
+    cpus_(std::move(cpus)) {
+  CHECK_GT(concurrency, 0u) << "a pool requires at least one CPU";
+  workers_.resize(concurrency);
   threads_.reserve(concurrency);
   for (size_t cpu = 0; cpu < concurrency; cpu++) {
-    semaphores_.emplace_back();
-    heads_.emplace_back();
     ready_.emplace_back();
     threads_.emplace_back(
         [this, cpu]() {
-          StaticThreadPool::member = true;
+          StaticThreadPool::member = this;
           StaticThreadPool::cpu = cpu;
 
-          SetAffinity(threads_[cpu], cpu);
+          SetAffinity(threads_[cpu], cpus_[cpu]);
 
           EVENTUALS_LOG(3)
               << "Thread " << cpu << " (id=" << std::this_thread::get_id()
               << ") is running on core " << GetRunningCPU();
 
-          // NOTE: we store each 'semaphore' and 'head' in each thread
-          // so as to hopefully get less false sharing when other
-          // threads are trying to enqueue a waiter.
-          Semaphore semaphore;
-          std::atomic<Waiter*> head = nullptr;
+          // NOTE: we allocate each 'Worker' from its own thread so as
+          // to hopefully get memory local to the CPU, but the pool
+          // owns it so that it outlives any threads that might still
+          // be trying to steal from it.
+          workers_[cpu] = std::make_unique<Worker>();
 
-          semaphores_[cpu] = &semaphore;
-          heads_[cpu] = &head;
+          Worker& worker = *workers_[cpu];
 
           ready_[cpu].Signal();
 
           do {
-            semaphore.Wait();
-
-          load:
-            Waiter* waiter = head.load(std::memory_order_relaxed);
-
-            if (waiter != nullptr) {
-              if (waiter->next == nullptr) {
-                if (!head.compare_exchange_weak(
-                        waiter,
-                        nullptr,
-                        std::memory_order_release,
-                        std::memory_order_relaxed)) {
-                  goto load; // Try again.
-                }
-              } else {
-                while (waiter->next->next != nullptr) {
-                  waiter = waiter->next;
-                }
+            Idle(worker, cpu);
+
+            // NOTE: we keep draining until there is nothing left,
+            // including anything submitted while we were running, so
+            // we only idle once per batch rather than once per
+            // waiter. See 'Idle()' for why we can't miss a wakeup.
+            Waiter* waiters = nullptr;
 
-                assert(waiter->next != nullptr);
+            while ((waiters = Dequeue(worker)) != nullptr) {
+              Run(waiters, worker);
+            }
 
-                auto* next = waiter->next;
-                waiter->next = nullptr;
-                waiter = next;
+            if (work_stealing()) {
+              // Keep stealing until there is nothing left to steal or
+              // until something has been submitted to us.
+              while ((waiters = Steal(cpu)) != nullptr) {
+                Run(waiters, worker);
+                if (worker.head.load(std::memory_order_relaxed) != nullptr
+                    || worker.stealable.load(std::memory_order_relaxed)
+                        != nullptr) {
+                  break;
+                }
               }
+            }
+          } while (!shutdown_.load());
+        });
+  }
 
-              CHECK_NOTNULL(waiter);
+  for (size_t core = 0; core < concurrency; core++) {
+    ready_[core].Wait();
+  }
+}
 
-              CHECK_EQ(nullptr, waiter->next);
+////////////////////////////////////////////////////////////////////////
 
-              Context* context = CHECK_NOTNULL(waiter->context.get());
+StaticThreadPool::~StaticThreadPool() {
+  shutdown_.store(true);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  for (auto& worker : workers_) {
+    Wake(*worker);
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
 
-              EVENTUALS_LOG(1) << "Resuming '" << context->name() << "'";
+////////////////////////////////////////////////////////////////////////
 
-              context->unblock();
+void StaticThreadPool::Idle(Worker& worker, unsigned int cpu) {
+  size_t spins = spins_before_parking();
 
-              stout::borrowed_ref<Context> previous =
-                  Context::Switch(std::move(waiter->context).reference());
+  for (size_t i = 0; i < spins; i++) {
+    if (Runnable(worker, cpu)) {
+      worker.spins.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    CPURelax();
+  }
 
-              CHECK(waiter->callback);
+  // NOTE: to avoid a missed wakeup we set 'sleeping' _before_ we
+  // check if there is anything to run while 'Submit()' enqueues
+  // _before_ it checks 'sleeping' and the fences ensure that at
+  // least one of us will see what the other did.
+  worker.sleeping.store(true, std::memory_order_relaxed);
 
-              Callback<void()> callback = std::move(waiter->callback);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
 
-              callback();
+  if (Runnable(worker, cpu)
+      && worker.sleeping.exchange(false, std::memory_order_acq_rel)) {
+    return;
+  }
 
-              ////////////////////////////////////////////////////
-              // NOTE: can't use 'waiter' at this point in time //
-              // because it might have been deallocated!        //
-              ////////////////////////////////////////////////////
+  // Either there is nothing to run or a submitter has already unset
+  // 'sleeping' and will signal us so we need to consume the signal.
+  worker.parks.fetch_add(1, std::memory_order_relaxed);
 
-              CHECK_EQ(context, Context::Switch(std::move(previous)).get());
-            }
-          } while (!shutdown_.load());
-        });
+  worker.semaphore.Wait();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool StaticThreadPool::Runnable(Worker& worker, unsigned int cpu) {
+  if (worker.head.load(std::memory_order_relaxed) != nullptr
+      || worker.stealable.load(std::memory_order_relaxed) != nullptr
+      || shutdown_.load(std::memory_order_relaxed)) {
+    return true;
   }
 
-  for (size_t core = 0; core < concurrency; core++) {
-    ready_[core].Wait();
+  if (work_stealing()) {
+    for (unsigned int i = 1; i < concurrency; i++) {
+      Worker& victim = *workers_[(cpu + i) % concurrency];
+      if (victim.stealable.load(std::memory_order_relaxed) != nullptr) {
+        return true;
+      }
+    }
   }
+
+  return false;
 }
 
 ////////////////////////////////////////////////////////////////////////
 
-StaticThreadPool::~StaticThreadPool() {
-  shutdown_.store(true);
-  while (!threads_.empty()) {
-    Semaphore* semaphore = semaphores_.back();
-    semaphore->Signal();
-    semaphores_.pop_back();
-    std::thread& thread = threads_.back();
-    thread.join();
-    threads_.pop_back();
+bool StaticThreadPool::Wake(Worker& worker) {
+  if (worker.sleeping.load(std::memory_order_relaxed)
+      && worker.sleeping.exchange(false, std::memory_order_acq_rel)) {
+    worker.wakeups.fetch_add(1, std::memory_order_relaxed);
+    worker.semaphore.Signal();
+    return true;
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Removes every waiter from the intrusive stack at 'head' with a
+// single exchange and returns them in FIFO order, i.e., the order in
+// which they were enqueued, or 'nullptr' if the stack is empty. Any
+// number of threads may be concurrently enqueueing and dequeuing.
+static Scheduler::Waiter* DequeueAll(std::atomic<Scheduler::Waiter*>& head) {
+  Scheduler::Waiter* waiter = head.exchange(
+      nullptr,
+      std::memory_order_acquire);
+
+  Scheduler::Waiter* waiters = nullptr;
+
+  while (waiter != nullptr) {
+    auto* next = waiter->next;
+    waiter->next = waiters;
+    waiters = waiter;
+    waiter = next;
+  }
+
+  return waiters;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+Scheduler::Waiter* StaticThreadPool::Dequeue(Worker& worker) {
+  // Waiters that must run on this CPU go first since no other CPU can
+  // run them for us.
+  Waiter* waiters = DequeueAll(worker.head);
+
+  Waiter* stealable = DequeueAll(worker.stealable);
+
+  if (waiters == nullptr) {
+    return stealable;
+  }
+
+  Waiter* tail = waiters;
+  while (tail->next != nullptr) {
+    tail = tail->next;
+  }
+
+  tail->next = stealable;
+
+  return waiters;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+Scheduler::Waiter* StaticThreadPool::Steal(unsigned int cpu) {
+  for (unsigned int i = 1; i < concurrency; i++) {
+    Worker& victim = *workers_[(cpu + i) % concurrency];
+
+    if (victim.stealable.load(std::memory_order_relaxed) == nullptr) {
+      continue;
+    }
+
+    Waiter* waiters = DequeueAll(victim.stealable);
+
+    if (waiters != nullptr) {
+      size_t count = 0;
+      for (Waiter* waiter = waiters; waiter != nullptr; waiter = waiter->next) {
+        count++;
+      }
+
+      // Move the load of the waiters from the victim to us.
+      victim.load.fetch_sub(count, std::memory_order_relaxed);
+      workers_[cpu]->load.fetch_add(count, std::memory_order_relaxed);
+
+      EVENTUALS_LOG(1)
+          << "Stole " << count << " waiter(s) from CPU "
+          << (cpu + i) % concurrency << " for CPU " << cpu;
+
+      return waiters;
+    }
+  }
+
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void StaticThreadPool::Run(Waiter* waiters, Worker& worker) {
+  while (waiters != nullptr) {
+    Waiter* waiter = waiters;
+
+    // NOTE: need to unlink 'waiter' _before_ running it since it
+    // might get submitted again (or deallocated) while running.
+    waiters = waiter->next;
+    waiter->next = nullptr;
+
+    Context* context = CHECK_NOTNULL(waiter->context.get());
+
+    EVENTUALS_LOG(1) << "Resuming '" << context->name() << "'";
+
+    context->unblock();
+
+    stout::borrowed_ref<Context> previous =
+        Context::Switch(std::move(waiter->context).reference());
+
+    CHECK(waiter->callback);
+
+    Callback<void()> callback = std::move(waiter->callback);
+
+    callback();
+
+    ////////////////////////////////////////////////////
+    // NOTE: can't use 'waiter' at this point in time //
+    // because it might have been deallocated!        //
+    ////////////////////////////////////////////////////
+
+    CHECK_EQ(context, Context::Switch(std::move(previous)).get());
+
+    worker.load.fetch_sub(1, std::memory_order_relaxed);
   }
 }
 
@@ -134,7 +295,7 @@ void StaticThreadPool::Submit(Callback<void()> callback, Context& context) {
 
   unsigned int cpu = pinned.cpu().value();
 
-  assert(cpu < concurrency);
+  CHECK_LT(cpu, concurrency) << context.name();
 
   context.block();
 
@@ -144,7 +305,13 @@ void StaticThreadPool::Submit(Callback<void()> callback, Context& context) {
 
   waiter->callback = std::move(callback);
 
-  auto* head = heads_[cpu];
+  Worker& worker = *workers_[cpu];
+
+  bool stealable = !pinned.exact() && work_stealing();
+
+  auto* head = stealable ? &worker.stealable : &worker.head;
+
+  worker.load.fetch_add(1, std::memory_order_relaxed);
 
   CHECK(waiter->next == nullptr) << context.name();
 
@@ -156,9 +323,77 @@ void StaticThreadPool::Submit(Callback<void()> callback, Context& context) {
       std::memory_order_release,
       std::memory_order_relaxed)) {}
 
-  auto* semaphore = semaphores_[cpu];
+  // See 'Idle()' for why we need this fence.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  // If the CPU we submitted to is not parked it is either running
+  // (i.e., busy) or spinning. In either case we wake up a parked CPU
+  // (if there is one) so that it can steal the waiter.
+  if (!Wake(worker) && stealable) {
+    for (unsigned int i = 1; i < concurrency; i++) {
+      if (Wake(*workers_[(cpu + i) % concurrency])) {
+        break;
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+Pinned StaticThreadPool::Place() {
+  switch (placement()) {
+    case Placement::Random:
+      return Pinned::RandomCPU(std::vector<unsigned int>(), *this);
+    case Placement::RoundRobin:
+      return Pinned(
+          next_.fetch_add(1, std::memory_order_relaxed) % concurrency);
+    case Placement::LeastLoaded: {
+      // Start from a different CPU each time so that ties are broken
+      // in a round robin fashion.
+      unsigned int start = next_.fetch_add(1, std::memory_order_relaxed);
+      unsigned int cpu = start % concurrency;
+      size_t least = load(cpu);
+      for (unsigned int i = 1; i < concurrency && least > 0; i++) {
+        unsigned int candidate = (start + i) % concurrency;
+        size_t candidate_load = load(candidate);
+        if (candidate_load < least) {
+          cpu = candidate;
+          least = candidate_load;
+        }
+      }
+      return Pinned(cpu);
+    }
+    case Placement::PowerOfTwoChoices: {
+      std::uniform_int_distribution<unsigned int> distribution(
+          0,
+          concurrency - 1);
+      unsigned int first = distribution(Pinned::Engine());
+      unsigned int second = distribution(Pinned::Engine());
+      return Pinned(load(second) < load(first) ? second : first);
+    }
+  }
+
+  LOG(FATAL) << "Unreachable";
+  return Pinned();
+}
+
+////////////////////////////////////////////////////////////////////////
+
+StaticThreadPool::Statistics StaticThreadPool::statistics() const {
+  Statistics statistics;
+  for (auto& worker : workers_) {
+    statistics.spins += worker->spins.load(std::memory_order_relaxed);
+    statistics.parks += worker->parks.load(std::memory_order_relaxed);
+    statistics.wakeups += worker->wakeups.load(std::memory_order_relaxed);
+  }
+  return statistics;
+}
+
+////////////////////////////////////////////////////////////////////////
 
-  semaphore->Signal();
+size_t StaticThreadPool::load(unsigned int cpu) const {
+  CHECK_LT(cpu, concurrency);
+  return workers_[cpu]->load.load(std::memory_order_relaxed);
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -179,7 +414,7 @@ bool StaticThreadPool::Continuable(const Context& context) {
 
   unsigned int cpu = pinned.cpu().value();
 
-  return StaticThreadPool::member && StaticThreadPool::cpu == cpu;
+  return StaticThreadPool::member == this && StaticThreadPool::cpu == cpu;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -23,58 +23,74 @@ namespace eventuals {
 
 ////////////////////////////////////////////////////////////////////////
 
+// Forward declaration.
+class StaticThreadPool;
+
+////////////////////////////////////////////////////////////////////////
+
+// NOTE: CPUs are relative to a pool, i.e., CPU 'i' is the i'th CPU
+// that a pool was created with (see 'StaticThreadPool::cpus()'), and
+// unless a pool is passed explicitly they are relative to the default
+// pool, i.e., 'StaticThreadPool::Scheduler()'.
 struct Pinned {
-  static Pinned ModuloTotalCPUs(unsigned int cpu) {
-    return Pinned(cpu % std::thread::hardware_concurrency());
-  }
+  static Pinned ModuloTotalCPUs(unsigned int cpu);
+
+  static Pinned ModuloTotalCPUs(
+      unsigned int cpu,
+      const StaticThreadPool& pool);
 
   static Pinned Any() {
     return Pinned();
   }
 
-  static Pinned ExactCPU(unsigned int cpu) {
-    CHECK(cpu < std::thread::hardware_concurrency())
-        << "specified CPU is not valid";
-    return Pinned(cpu);
-  }
+  static Pinned ExactCPU(unsigned int cpu);
+
+  static Pinned ExactCPU(unsigned int cpu, const StaticThreadPool& pool);
 
   template <typename Iterable = std::vector<unsigned int>>
   static Pinned RandomCPU(
-      const Iterable& cpu_mask = std::vector<unsigned int>()) {
-    static std::random_device* device = new std::random_device();
-    static std::mt19937* engine = new std::mt19937((*device)());
-    static std::uniform_int_distribution<>* distribution =
-        new std::uniform_int_distribution<>(
-            0,
-            std::thread::hardware_concurrency() - 1);
-
-    unsigned int cpu = 0;
-    do {
-      cpu = (*distribution)(*engine);
-    } while (std::find(
-                 cpu_mask.begin(),
-                 cpu_mask.end(),
-                 cpu)
-             != cpu_mask.end());
-
-    CHECK_LT(cpu, std::thread::hardware_concurrency());
-    return Pinned(cpu);
-  }
+      const Iterable& cpu_mask = std::vector<unsigned int>());
+
+  template <typename Iterable>
+  static Pinned RandomCPU(
+      const Iterable& cpu_mask,
+      const StaticThreadPool& pool);
 
   std::optional<unsigned int> cpu() {
     return cpu_;
   }
 
+  // Whether or not a context _must_ run on 'cpu()', i.e., it was
+  // pinned via 'ExactCPU()' or 'ModuloTotalCPUs()' and therefore can
+  // never be stolen by another CPU when work stealing is enabled.
+  bool exact() const {
+    return exact_;
+  }
+
   Pinned(const Pinned& that)
-    : cpu_(that.cpu_) {}
+    : cpu_(that.cpu_),
+      exact_(that.exact_) {}
+
+  Pinned& operator=(const Pinned& that) = default;
 
  private:
+  friend class StaticThreadPool;
+
+  // Each thread gets its own engine since 'std::mt19937' is not
+  // thread-safe.
+  static std::mt19937& Engine() {
+    static thread_local std::mt19937 engine(std::random_device{}());
+    return engine;
+  }
+
   Pinned() = default;
 
-  Pinned(unsigned int cpu)
-    : cpu_(cpu) {}
+  Pinned(unsigned int cpu, bool exact = false)
+    : cpu_(cpu),
+      exact_(exact) {}
 
   std::optional<unsigned int> cpu_;
+  bool exact_ = false;
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -101,6 +117,13 @@ class StaticThreadPool final : public Scheduler {
     Schedulable(Pinned pinned)
       : Schedulable(Requirements("[anonymous]", pinned)) {}
 
+    // Schedules on 'pool' instead of the default pool.
+    Schedulable(
+        StaticThreadPool& pool,
+        Requirements requirements = Requirements("[anonymous]"))
+      : requirements_(std::move(requirements)),
+        pool_(&pool) {}
+
     virtual ~Schedulable() = default;
 
     template <typename E>
@@ -113,8 +136,13 @@ class StaticThreadPool final : public Scheduler {
       return &requirements_;
     }
 
+    auto& pool() {
+      return pool_ != nullptr ? *pool_ : StaticThreadPool::Scheduler();
+    }
+
    private:
     Requirements requirements_;
+    StaticThreadPool* pool_ = nullptr;
   };
 
   static StaticThreadPool& Scheduler() {
@@ -122,24 +150,125 @@ class StaticThreadPool final : public Scheduler {
     return pool;
   }
 
-  // Is thread a member of the static pool?
-  static inline thread_local bool member = false;
+  // Which pool, if any, is this thread a member of?
+  static inline thread_local StaticThreadPool* member = nullptr;
 
-  // If 'member', for which cpu?
+  // If 'member', for which cpu (relative to the pool, see 'Pinned')?
   static inline thread_local unsigned int cpu = 0;
 
   const unsigned int concurrency;
 
+  // Creates a pool with a worker for each CPU this process is allowed
+  // to run on, e.g., as restricted by a cpuset in a container (see
+  // 'GetAllowedCPUs()' in 'eventuals/os.h').
   StaticThreadPool();
 
+  // Creates a pool with 'concurrency' workers pinned to the CPUs this
+  // process is allowed to run on (wrapping around if 'concurrency' is
+  // larger than the number of allowed CPUs).
+  explicit StaticThreadPool(unsigned int concurrency);
+
+  // Creates a pool with a worker for each of 'cpus' where worker 'i'
+  // is pinned to 'cpus[i]'.
+  explicit StaticThreadPool(std::vector<unsigned int> cpus);
+
   ~StaticThreadPool() override;
 
+  // Returns the (host) CPUs of this pool.
+  const std::vector<unsigned int>& cpus() const {
+    return cpus_;
+  }
+
   bool Continuable(const Context& context) override;
 
   void Submit(Callback<void()> callback, Context& context) override;
 
   void Clone(Context& child) override;
 
+  // Enables (or disables) work stealing: idle CPUs will run waiters
+  // that have been submitted to busy CPUs as long as those waiters
+  // were not pinned to an exact CPU (see 'Pinned::exact()').
+  //
+  // NOTE: this is opt-in because with work stealing enabled a
+  // 'Schedulable' that uses 'Pinned::Any()' may now run on more than
+  // one CPU, so any code relying on always running on the same CPU
+  // for mutual exclusion must use 'Pinned::ExactCPU()' instead.
+  void EnableWorkStealing(bool enable = true) {
+    work_stealing_.store(enable, std::memory_order_relaxed);
+  }
+
+  bool work_stealing() const {
+    return work_stealing_.load(std::memory_order_relaxed);
+  }
+
+  // Policies for picking a CPU for a context that was not pinned,
+  // i.e., 'Pinned::Any()'. The "load" of a CPU is the number of
+  // waiters that have been submitted to it that have not yet
+  // finished running.
+  enum class Placement {
+    // Picks a CPU uniformly at random.
+    Random,
+
+    // Picks each CPU in turn.
+    RoundRobin,
+
+    // Picks the CPU with the least load, breaking ties in a round
+    // robin fashion so idle pools spread contexts out.
+    LeastLoaded,
+
+    // Picks two CPUs at random and then the one with the least load,
+    // which approximates 'LeastLoaded' without reading the load of
+    // every CPU.
+    PowerOfTwoChoices,
+  };
+
+  void SetPlacement(Placement placement) {
+    placement_.store(placement, std::memory_order_relaxed);
+  }
+
+  Placement placement() const {
+    return placement_.load(std::memory_order_relaxed);
+  }
+
+  // Returns a CPU picked based on the current placement policy. This
+  // is lock-free and may be called from any thread.
+  //
+  // NOTE: a 'Schedule()' only places a context once and then stores
+  // the CPU in its 'Requirements', thus every 'Schedule()' using the
+  // same 'Requirements' will use the same CPU.
+  Pinned Place();
+
+  // Returns the current load of 'cpu', see 'Placement'.
+  size_t load(unsigned int cpu) const;
+
+  // Sets how many times an idle worker checks for something to run
+  // (executing a "pause" instruction in between) before it parks
+  // itself. Spinning trades CPU for latency: a worker that is still
+  // spinning when something is submitted to it doesn't need to be
+  // woken up by the kernel. Defaults to 0, i.e., park immediately.
+  void SetSpinsBeforeParking(size_t spins) {
+    spins_.store(spins, std::memory_order_relaxed);
+  }
+
+  size_t spins_before_parking() const {
+    return spins_.load(std::memory_order_relaxed);
+  }
+
+  struct Statistics final {
+    // Number of times an idle worker found something to run while
+    // spinning, i.e., without having to park.
+    size_t spins = 0;
+
+    // Number of times an idle worker parked.
+    size_t parks = 0;
+
+    // Number of times a parked worker had to be woken up.
+    size_t wakeups = 0;
+  };
+
+  // Returns the statistics summed across all workers.
+  Statistics statistics() const;
+
   template <typename E>
   [[nodiscard]] auto Schedule(Requirements* requirements, E e);
 
@@ -168,18 +297,119 @@ class StaticThreadPool final : public Scheduler {
   [[nodiscard]] static auto Spawn(Requirements&& requirements, E e);
 
  private:
-  // NOTE: we use a semaphore instead of something like eventfd for
-  // "signalling" the thread because it should be faster/less overhead
-  // in the kernel: https://stackoverflow.com/q/9826919
-  std::vector<Semaphore*> semaphores_;
-  std::vector<std::atomic<Waiter*>*> heads_;
+  // State for each CPU, aligned so that workers don't false share.
+  struct alignas(64) Worker final {
+    // NOTE: we use a semaphore instead of something like eventfd for
+    // parking the thread because it should be faster/less overhead
+    // in the kernel: https://stackoverflow.com/q/9826919 (and on
+    // Linux it is just a futex).
+    Semaphore semaphore;
+
+    // Set by the owning thread before it parks on 'semaphore', a
+    // submitter only signals 'semaphore' if it is the one that
+    // atomically unsets it so we avoid a syscall for each submit when
+    // the worker is running or spinning.
+    std::atomic<bool> sleeping = false;
+
+    // Intrusive stack of waiters that must run on this CPU.
+    std::atomic<Waiter*> head = nullptr;
+
+    // Intrusive stack of waiters that may be stolen by other CPUs.
+    std::atomic<Waiter*> stealable = nullptr;
+
+    // Number of waiters submitted to this CPU that have not finished
+    // running yet (including any that were stolen), see 'Placement'.
+    std::atomic<size_t> load = 0;
+
+    // See 'Statistics'.
+    std::atomic<size_t> spins = 0;
+    std::atomic<size_t> parks = 0;
+    std::atomic<size_t> wakeups = 0;
+  };
+
+  // Helper that spins and then parks until there might be something
+  // to run for the worker of 'cpu' (or we're shutting down).
+  void Idle(Worker& worker, unsigned int cpu);
+
+  // Helper that returns true if there is something to run for the
+  // worker of 'cpu' (or we're shutting down).
+  bool Runnable(Worker& worker, unsigned int cpu);
+
+  // Helper that wakes up 'worker' if it is parked, returning true if
+  // this call is the one that woke it up.
+  bool Wake(Worker& worker);
+
+  // Helpers for dequeuing every waiter from our own CPU or stealing
+  // them from another CPU, both return the waiters in FIFO order.
+  Waiter* Dequeue(Worker& worker);
+  Waiter* Steal(unsigned int cpu);
+
+  // Helper that runs a FIFO list of dequeued (or stolen) waiters,
+  // removing each one from the load of 'worker' after it has run.
+  void Run(Waiter* waiters, Worker& worker);
+
+  std::vector<unsigned int> cpus_;
+  std::vector<std::unique_ptr<Worker>> workers_;
   std::deque<Semaphore> ready_;
   std::vector<std::thread> threads_;
+  std::atomic<bool> work_stealing_ = false;
+  std::atomic<Placement> placement_ = Placement::LeastLoaded;
+  std::atomic<unsigned int> next_ = 0;
+  std::atomic<size_t> spins_ = 0;
   std::atomic<bool> shutdown_ = false;
 };
 
 ////////////////////////////////////////////////////////////////////////
 
+inline Pinned Pinned::ModuloTotalCPUs(unsigned int cpu) {
+  return ModuloTotalCPUs(cpu, StaticThreadPool::Scheduler());
+}
+
+inline Pinned Pinned::ModuloTotalCPUs(
+    unsigned int cpu,
+    const StaticThreadPool& pool) {
+  return Pinned(cpu % pool.concurrency, /* exact = */ true);
+}
+
+inline Pinned Pinned::ExactCPU(unsigned int cpu) {
+  return ExactCPU(cpu, StaticThreadPool::Scheduler());
+}
+
+inline Pinned Pinned::ExactCPU(
+    unsigned int cpu,
+    const StaticThreadPool& pool) {
+  CHECK(cpu < pool.concurrency) << "specified CPU is not valid";
+  return Pinned(cpu, /* exact = */ true);
+}
+
+template <typename Iterable>
+Pinned Pinned::RandomCPU(const Iterable& cpu_mask) {
+  return RandomCPU(cpu_mask, StaticThreadPool::Scheduler());
+}
+
+template <typename Iterable>
+Pinned Pinned::RandomCPU(
+    const Iterable& cpu_mask,
+    const StaticThreadPool& pool) {
+  std::uniform_int_distribution<unsigned int> distribution(
+      0,
+      pool.concurrency - 1);
+
+  unsigned int cpu = 0;
+  do {
+    cpu = distribution(Engine());
+  } while (std::find(
+               cpu_mask.begin(),
+               cpu_mask.end(),
+               cpu)
+           != cpu_mask.end());
+
+  CHECK_LT(cpu, pool.concurrency);
+  return Pinned(cpu);
+}
+
+////////////////////////////////////////////////////////////////////////
+
 struct _StaticThreadPoolSchedule final {
   template <typename K_, typename E_, typename Arg_, typename Errors_>
   struct Continuation final
@@ -230,16 +460,13 @@ struct _StaticThreadPoolSchedule final {
       Pinned& pinned = requirements()->pinned;
 
       if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::RandomCPU();
+        pinned = pool()->Place();
       }
 
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(pinned.cpu().value(), pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member == pool()
+          && StaticThreadPool::cpu == pinned.cpu()) {
         Adapt();
         auto previous = Scheduler::Context::Switch(context_->Borrow());
         adapted_->Start(std::forward<Args>(args)...);
@@ -278,41 +505,28 @@ struct _StaticThreadPoolSchedule final {
       Pinned& pinned = requirements()->pinned;
 
       if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::RandomCPU();
+        pinned = pool()->Place();
       }
 
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(pinned.cpu().value(), pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member == pool()
+          && StaticThreadPool::cpu == pinned.cpu()) {
         Adapt();
         auto previous = Scheduler::Context::Switch(context_->Borrow());
         adapted_->Fail(std::forward<Error>(error));
         previous = Scheduler::Context::Switch(std::move(previous));
         CHECK_EQ(previous.get(), context_.get());
       } else {
-        // TODO(benh): avoid allocating on heap by storing args in
-        // pre-allocated buffer based on composing with Errors.
-        using Tuple = std::tuple<decltype(this), Error>;
-        auto tuple = std::make_unique<Tuple>(
-            this,
-            std::forward<Error>(error));
+        error_.Emplace(std::forward<Error>(error));
 
         EVENTUALS_LOG(1)
             << "Schedule submitting '" << context_->name() << "'";
 
         pool()->Submit(
-            this->Borrow([tuple = std::move(tuple)]() mutable {
-              std::apply(
-                  [](auto* schedule, auto&&... args) {
-                    schedule->Adapt();
-                    schedule->adapted_->Fail(
-                        std::forward<decltype(args)>(args)...);
-                  },
-                  std::move(*tuple));
+            this->Borrow([this]() {
+              Adapt();
+              adapted_->Fail(error_.template Extract<Error>());
             }),
             *context_);
       }
@@ -329,16 +543,13 @@ struct _StaticThreadPoolSchedule final {
       Pinned& pinned = requirements()->pinned;
 
       if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::RandomCPU();
+        pinned = pool()->Place();
       }
 
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(pinned.cpu().value(), pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member == pool()
+          && StaticThreadPool::cpu == pinned.cpu()) {
         Adapt();
         auto previous = Scheduler::Context::Switch(context_->Borrow());
         adapted_->Stop();
@@ -366,16 +577,13 @@ struct _StaticThreadPoolSchedule final {
       Pinned& pinned = requirements()->pinned;
 
       if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::RandomCPU();
+        pinned = pool()->Place();
       }
 
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(pinned.cpu().value(), pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member == pool()
+          && StaticThreadPool::cpu == pinned.cpu()) {
         Adapt();
         auto previous = Scheduler::Context::Switch(context_->Borrow());
         adapted_->Begin(*CHECK_NOTNULL(stream_));
@@ -405,16 +613,13 @@ struct _StaticThreadPoolSchedule final {
       Pinned& pinned = requirements()->pinned;
 
       if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::RandomCPU();
+        pinned = pool()->Place();
       }
 
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(pinned.cpu().value(), pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member == pool()
+          && StaticThreadPool::cpu == pinned.cpu()) {
         Adapt();
         auto previous = Scheduler::Context::Switch(context_->Borrow());
         adapted_->Body(std::forward<Args>(args)...);
@@ -452,16 +657,13 @@ struct _StaticThreadPoolSchedule final {
       Pinned& pinned = requirements()->pinned;
 
       if (!pinned.cpu()) {
-        // TODO(benh): pick the least loaded cpu. This will require
-        // iterating through and checking the sizes of all the "queues"
-        // and then atomically incrementing which ever queue we pick
-        // since we don't want to hold a lock here.
-        pinned = Pinned::RandomCPU();
+        pinned = pool()->Place();
       }
 
-      CHECK(pinned.cpu() <= pool()->concurrency);
+      CHECK_LT(pinned.cpu().value(), pool()->concurrency);
 
-      if (StaticThreadPool::member && StaticThreadPool::cpu == pinned.cpu()) {
+      if (StaticThreadPool::member == pool()
+          && StaticThreadPool::cpu == pinned.cpu()) {
         Adapt();
         auto previous = Scheduler::Context::Switch(context_->Borrow());
         adapted_->Ended();
@@ -523,6 +725,9 @@ struct _StaticThreadPoolSchedule final {
         std::conditional_t<!std::is_void_v<Arg_>, Arg_, Undefined>>
         arg_;
 
+    // Used to hold on to an error while we hop to 'pool()'.
+    ErrorStorage<Errors_> error_;
+
     TypeErasedStream* stream_ = nullptr;
 
     Interrupt* interrupt_ = nullptr;
@@ -610,7 +815,7 @@ template <typename E>
 
 template <typename E>
 [[nodiscard]] auto StaticThreadPool::Schedulable::Schedule(E e) {
-  return StaticThreadPool::Scheduler().Schedule(
+  return pool().Schedule(
       &requirements_,
       std::move(e));
 }
@@ -619,7 +824,7 @@ template <typename E>
 [[nodiscard]] auto StaticThreadPool::Schedulable::Schedule(
     std::string&& name,
     E e) {
-  return StaticThreadPool::Scheduler().Schedule(
+  return pool().Schedule(
       std::move(name),
       &requirements_,
       std::move(e));
@@ -635,16 +840,13 @@ template <typename F, typename InsertableContainer>
     F f) {
   // TODO(benh): static_assert can insert an 'unsigned int' into 'cpu_mask'.
 
-  static unsigned int hardware_concurrency =
-      std::thread::hardware_concurrency();
-
   // TODO(benh): propagate errors instead of using 'CHECK'?
   for (unsigned int cpu : cpu_mask) {
-    CHECK(cpu <= hardware_concurrency) << "CPU mask includes invalid CPUs";
+    CHECK(cpu < concurrency) << "CPU mask includes invalid CPUs";
   }
 
-  CHECK(forks <= (hardware_concurrency - cpu_mask.size()))
-      << "Insufficient hardware concurrency (" << hardware_concurrency
+  CHECK(forks <= (concurrency - cpu_mask.size()))
+      << "Insufficient concurrency (" << concurrency
       << ") given CPU mask (" << cpu_mask.size()
       << ") and forks (" << forks << ")";
 
@@ -654,7 +856,7 @@ template <typename F, typename InsertableContainer>
       [this, name, f = std::move(f), cpu_mask = std::move(cpu_mask)](
           size_t index,
           auto&&... arg) mutable {
-        Pinned pinned = Pinned::RandomCPU(cpu_mask);
+        Pinned pinned = Pinned::RandomCPU(cpu_mask, *this);
 
         // Add selected CPU to our mask so we won't use again.
         CHECK(pinned.cpu().has_value());
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <functional> // For 'std::reference_wrapper'.
-#include <memory> // For 'std::unique_ptr'.
+#include <memory> // For 'std::make_unique'.
 #include <optional>
 #include <tuple>
 #include <variant>
@@ -10,6 +10,7 @@
 #include "eventuals/finally.h"
 #include "eventuals/just.h"
 #include "eventuals/raise.h"
+#include "eventuals/recycler.h"
 #include "eventuals/terminal.h"
 #include "eventuals/type-traits.h"
 #include "stout/stringify.h"
@@ -231,7 +232,7 @@ struct _TaskFromToWith final {
                   std::is_void_v<From>,
                   std::monostate,
                   From>>&&,
-          std::unique_ptr<void, Callback<void(void*)>>&,
+          TypeErasedStorage&,
           Interrupt&,
           TaskStartCallback<To>&&,
           TaskFailCallback<Raises>&&,
@@ -359,7 +360,7 @@ struct _TaskFromToWith final {
         DispatchCallback<From_, To_, Catches_, Raises_, Args_...>>
         value_or_dispatch_;
 
-    std::unique_ptr<void, Callback<void(void*)>> e_;
+    TypeErasedStorage e_;
     Interrupt* interrupt_ = nullptr;
 
     // NOTE: we store 'k_' as the _last_ member so it will be
@@ -458,28 +459,21 @@ struct _TaskFromToWith final {
                                        Catches_>::type>&& error,
                                Args_&... args,
                                std::optional<MonostateIfVoidOr<From_>>&& arg,
-                               std::unique_ptr<void, Callback<void(void*)>>& e_,
+                               TypeErasedStorage& e_,
                                Interrupt& interrupt,
                                TaskStartCallback<To_>&& start,
                                TaskFailCallback<Raises_>&& fail,
                                TaskStopCallback&& stop) mutable {
         if (!e_) {
-          e_ = std::unique_ptr<void, Callback<void(void*)>>(
-              new HeapTask<
+          // NOTE: the continuation is stored inline within 'e_' if it
+          // fits, otherwise it's allocated from the 'Recycler'.
+          e_.template Emplace<
+              HeapTask<
                   E,
                   From_,
                   To_,
                   Catches_,
-                  Raises_>(f(args...)),
-              [](void* e) {
-                delete static_cast<
-                    HeapTask<
-                        E,
-                        From_,
-                        To_,
-                        Catches_,
-                        Raises_>*>(e);
-              });
+                  Raises_>>(f(args...));
         }
 
         auto* e = static_cast<
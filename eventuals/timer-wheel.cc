@@ -0,0 +1,270 @@
+#include "eventuals/timer-wheel.h"
+
+#include "glog/logging.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+static_assert(
+    TimerWheel::SLOTS == 64,
+    "'TimerWheel::occupied_' assumes 64 slots per level");
+
+////////////////////////////////////////////////////////////////////////
+
+TimerWheel::TimerWheel() {
+  for (auto& level : slots_) {
+    for (Link& slot : level) {
+      Initialize(&slot);
+    }
+  }
+
+  Initialize(&expired_);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+TimerWheel::~TimerWheel() {
+  CHECK_EQ(size_, 0u) << "destructing a timer wheel with timeouts";
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::Initialize(Link* list) {
+  list->prev = list;
+  list->next = list;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+bool TimerWheel::Empty(const Link* list) {
+  return list->next == list;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::Append(Link* list, Link* link) {
+  link->prev = list->prev;
+  link->next = list;
+  list->prev->next = link;
+  list->prev = link;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::Unlink(Link* link) {
+  link->prev->next = link->next;
+  link->next->prev = link->prev;
+  link->prev = nullptr;
+  link->next = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+// Moves all links in 'from' to the (empty) list 'to'.
+void TimerWheel::Splice(Link* from, Link* to) {
+  CHECK(Empty(to));
+  if (!Empty(from)) {
+    to->next = from->next;
+    to->prev = from->prev;
+    to->next->prev = to;
+    to->prev->next = to;
+    Initialize(from);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::Insert(Timeout* timeout, uint64_t tick) {
+  CHECK(!timeout->inserted()) << "timeout is already inserted";
+
+  timeout->expiry_ = tick;
+
+  size_++;
+
+  if (tick <= now_) {
+    Append(&expired_, timeout);
+  } else {
+    Place(timeout);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::Cancel(Timeout* timeout) {
+  if (timeout->inserted()) {
+    Unlink(timeout);
+    size_--;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::Place(Timeout* timeout) {
+  CHECK_GT(timeout->expiry_, now_);
+
+  // Timeouts beyond the span of the wheel get parked in the furthest
+  // slot and will be placed again once they get cascaded.
+  uint64_t delta = timeout->expiry_ - now_;
+  if (delta >= SPAN) {
+    delta = SPAN - 1;
+  }
+
+  std::size_t level = 0;
+  while (delta >= (uint64_t(1) << ((level + 1) * SLOT_BITS))) {
+    level++;
+  }
+
+  std::size_t index = ((now_ + delta) >> (level * SLOT_BITS)) & (SLOTS - 1);
+
+  Append(&slots_[level][index], timeout);
+
+  occupied_[level] |= uint64_t(1) << index;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+std::optional<uint64_t> TimerWheel::NextTick() const {
+  std::optional<uint64_t> next;
+
+  for (std::size_t level = 0; level < LEVELS; level++) {
+    uint64_t occupied = occupied_[level];
+
+    if (occupied == 0) {
+      continue;
+    }
+
+    // Find the first occupied slot _after_ the current one, wrapping
+    // around to the current one last since anything in it now was
+    // placed there for the next rotation.
+    std::size_t shift = level * SLOT_BITS;
+    uint64_t block = now_ >> shift;
+    std::size_t start = (block + 1) & (SLOTS - 1);
+
+    uint64_t rotated = start == 0
+        ? occupied
+        : (occupied >> start) | (occupied << (SLOTS - start));
+
+    uint64_t tick = (block + 1 + __builtin_ctzll(rotated)) << shift;
+
+    if (!next || tick < *next) {
+      next = tick;
+    }
+  }
+
+  return next;
+}
+
+////////////////////////////////////////////////////////////////////////
+
+std::optional<uint64_t> TimerWheel::Next() const {
+  if (!Empty(&expired_)) {
+    return now_;
+  } else if (size_ == 0) {
+    return std::nullopt;
+  } else {
+    return NextTick();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::Advance(uint64_t tick) {
+  CHECK_GE(tick, now_) << "timer wheel can't go backwards";
+
+  // Expire anything inserted at or before 'now_' first, but only what
+  // was there before we started so callbacks that keep inserting
+  // expired timeouts can't keep us here forever.
+  Link expired;
+  Initialize(&expired);
+  Splice(&expired_, &expired);
+  Expire(&expired);
+
+  // Jump directly to each tick that has something to do rather than
+  // stepping through every tick in between.
+  std::optional<uint64_t> next = NextTick();
+  while (next && *next <= tick) {
+    now_ = *next;
+    Tick();
+    next = NextTick();
+  }
+
+  // NOTE: a callback might have already advanced the wheel further
+  // (e.g., by inserting into a wheel that had become empty).
+  if (tick > now_) {
+    now_ = tick;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::Tick() {
+  // Cascade down each level whose slot boundary we're at, i.e., level
+  // 'n' if 'now_' is a multiple of 'SLOTS^n'.
+  for (std::size_t level = 1; level < LEVELS; level++) {
+    std::size_t shift = level * SLOT_BITS;
+
+    if ((now_ & ((uint64_t(1) << shift) - 1)) != 0) {
+      break;
+    }
+
+    std::size_t index = (now_ >> shift) & (SLOTS - 1);
+
+    occupied_[level] &= ~(uint64_t(1) << index);
+
+    Link cascading;
+    Initialize(&cascading);
+    Splice(&slots_[level][index], &cascading);
+
+    while (!Empty(&cascading)) {
+      auto* timeout = static_cast<Timeout*>(cascading.next);
+      Unlink(timeout);
+      if (timeout->expiry_ <= now_) {
+        Append(&expired_, timeout);
+      } else {
+        Place(timeout);
+      }
+    }
+  }
+
+  std::size_t index = now_ & (SLOTS - 1);
+
+  occupied_[0] &= ~(uint64_t(1) << index);
+
+  // Everything cascaded into level 0 gets placed in a slot after the
+  // current one, so the only timeouts expiring now are the ones that
+  // were already in this slot plus any that expired while cascading.
+  Link expired;
+  Initialize(&expired);
+  Splice(&slots_[0][index], &expired);
+
+  while (!Empty(&expired_)) {
+    Link* link = expired_.next;
+    Unlink(link);
+    Append(&expired, link);
+  }
+
+  Expire(&expired);
+}
+
+////////////////////////////////////////////////////////////////////////
+
+void TimerWheel::Expire(Link* expired) {
+  // NOTE: a callback might cancel (or even reinsert) a timeout that
+  // is still in 'expired' which is fine since it'll just get unlinked
+  // (and possibly relinked elsewhere).
+  while (!Empty(expired)) {
+    auto* timeout = static_cast<Timeout*>(expired->next);
+    Unlink(timeout);
+    size_--;
+    timeout->callback_();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <array>
+#include <cstddef> // For 'std::size_t'.
+#include <cstdint> // For 'uint64_t'.
+#include <optional>
+
+#include "eventuals/callback.h"
+#include "glog/logging.h"
+
+////////////////////////////////////////////////////////////////////////
+
+namespace eventuals {
+
+////////////////////////////////////////////////////////////////////////
+
+// A hierarchical timer wheel (see "Hashed and Hierarchical Timing
+// Wheels" by Varghese and Lauck) which lets lots of timers share a
+// single underlying timer, e.g., one 'uv_timer_t' per event loop.
+//
+// Time is measured in "ticks" whose length is up to the user of the
+// wheel. Each of the 'LEVELS' levels has 'SLOTS' slots, a slot in
+// level 'n' covering 'SLOTS^n' ticks, and a timeout gets put in the
+// slot of the lowest level that can hold it. Inserting and cancelling
+// a timeout are O(1). As time advances the timeouts of a slot in a
+// higher level are "cascaded" down into the lower levels until they
+// land in level 0 and expire.
+//
+// Timeouts further than 'SPAN' ticks away get parked in the highest
+// level and get cascaded (and parked again) until they're within
+// reach.
+//
+// NOTE: not thread-safe, expected to be used from a single thread
+// (e.g., the event loop).
+class TimerWheel final {
+ public:
+  static constexpr std::size_t LEVELS = 4;
+  static constexpr std::size_t SLOT_BITS = 6;
+  static constexpr std::size_t SLOTS = 1 << SLOT_BITS;
+  static constexpr uint64_t SPAN = uint64_t(1) << (LEVELS * SLOT_BITS);
+
+ private:
+  // Intrusive doubly-linked list node, each slot is a circular list
+  // with the slot itself as the sentinel.
+  struct Link {
+    Link* prev = nullptr;
+    Link* next = nullptr;
+  };
+
+ public:
+  // A timeout that can be inserted into a wheel. It is intended to be
+  // stored within the object that is waiting for it (e.g., the
+  // continuation of a timer) so that inserting doesn't allocate.
+  //
+  // NOTE: must not be moved or destructed while it is inserted.
+  class Timeout final : private Link {
+   public:
+    explicit Timeout(Callback<void()> callback)
+      : callback_(std::move(callback)) {}
+
+    Timeout(const Timeout&) = delete;
+    Timeout(Timeout&&) = delete;
+
+    ~Timeout() {
+      CHECK(!inserted()) << "destructing an inserted timeout";
+    }
+
+    bool inserted() const {
+      return next != nullptr;
+    }
+
+    // The tick the timeout expires at, only valid while inserted.
+    uint64_t expiry() const {
+      return expiry_;
+    }
+
+   private:
+    friend class TimerWheel;
+
+    uint64_t expiry_ = 0;
+    Callback<void()> callback_;
+  };
+
+  TimerWheel();
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel(TimerWheel&&) = delete;
+
+  ~TimerWheel();
+
+  // Inserts 'timeout' to expire at 'tick'. If 'tick' is not after
+  // 'now()' the timeout will expire on the next call to 'Advance()'.
+  void Insert(Timeout* timeout, uint64_t tick);
+
+  // Removes 'timeout' if it is inserted (i.e., it hasn't expired).
+  void Cancel(Timeout* timeout);
+
+  // Advances the wheel to 'tick' (which must not be before 'now()')
+  // invoking the callback of each timeout that expired along the way.
+  //
+  // Callbacks may insert or cancel timeouts, including timeouts that
+  // would have expired in this same call.
+  void Advance(uint64_t tick);
+
+  // Returns the earliest tick at which 'Advance()' needs to be called
+  // for timeouts to expire on time, or nothing if there aren't any
+  // timeouts. This is conservative: after a cancellation it might
+  // return a tick at which nothing expires.
+  std::optional<uint64_t> Next() const;
+
+  uint64_t now() const {
+    return now_;
+  }
+
+  std::size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+ private:
+  static void Initialize(Link* list);
+  static bool Empty(const Link* list);
+  static void Append(Link* list, Link* link);
+  static void Unlink(Link* link);
+  static void Splice(Link* from, Link* to);
+
+  // Puts 'timeout' (which must expire after 'now_') in its slot.
+  void Place(Timeout* timeout);
+
+  // Earliest tick after 'now_' at which a slot needs processing.
+  std::optional<uint64_t> NextTick() const;
+
+  // Cascades and then expires the slots for the tick 'now_'.
+  void Tick();
+
+  // Invokes the callback for each timeout in 'expired'.
+  void Expire(Link* expired);
+
+  uint64_t now_ = 0;
+  std::size_t size_ = 0;
+
+  std::array<std::array<Link, SLOTS>, LEVELS> slots_;
+
+  // Bitmap per level of slots that (might) have timeouts, allowing
+  // 'Next()' to be O(LEVELS) rather than O(LEVELS * SLOTS). Bits are
+  // cleared lazily when a slot gets processed, not when its last
+  // timeout gets cancelled.
+  std::array<uint64_t, LEVELS> occupied_ = {};
+
+  // Timeouts inserted at or before 'now_'.
+  Link expired_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+} // namespace eventuals
+
+////////////////////////////////////////////////////////////////////////
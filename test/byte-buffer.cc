@@ -0,0 +1,170 @@
+#include "eventuals/byte-buffer.h"
+
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace eventuals::test {
+namespace {
+
+TEST(ByteBufferTest, TakesOwnershipWithoutCopying) {
+  std::string data(1024, 'x');
+  const char* pointer = data.data();
+
+  ByteBuffer buffer(std::move(data));
+
+  ASSERT_EQ(1, buffer.slices().size());
+  EXPECT_EQ(pointer, buffer.slices()[0].data());
+  EXPECT_EQ(1024, buffer.size());
+}
+
+
+TEST(ByteBufferTest, AppendSharesSlices) {
+  ByteBuffer hello = ByteBuffer::Copy("hello ");
+  ByteBuffer world = ByteBuffer::Copy("world");
+
+  ByteBuffer buffer;
+  buffer.Append(hello);
+  buffer.Append(world);
+  buffer.Append(ByteBuffer());
+
+  ASSERT_EQ(2, buffer.slices().size());
+  EXPECT_EQ(hello.slices()[0].data(), buffer.slices()[0].data());
+  EXPECT_EQ(world.slices()[0].data(), buffer.slices()[1].data());
+  EXPECT_EQ("hello world", buffer);
+  EXPECT_EQ(11, buffer.size());
+
+  ByteBuffer moved;
+  moved.Append(std::move(buffer));
+
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ("hello world", moved);
+}
+
+
+TEST(ByteBufferTest, AppendSelf) {
+  ByteBuffer buffer = ByteBuffer::Copy("hello ");
+  buffer.Append(ByteBuffer::Copy("world "));
+
+  buffer.Append(buffer);
+
+  ASSERT_EQ(4, buffer.slices().size());
+  EXPECT_EQ(buffer.slices()[0].data(), buffer.slices()[2].data());
+  EXPECT_EQ(buffer.slices()[1].data(), buffer.slices()[3].data());
+  EXPECT_EQ("hello world hello world ", buffer);
+  EXPECT_EQ(24, buffer.size());
+
+  buffer.Append(std::move(buffer));
+
+  EXPECT_EQ(8, buffer.slices().size());
+  EXPECT_EQ(48, buffer.size());
+}
+
+
+TEST(ByteBufferTest, Sub) {
+  ByteBuffer buffer = ByteBuffer::Copy("hello ");
+  buffer.Append(ByteBuffer::Copy("world"));
+
+  ByteBuffer sub = buffer.Sub(4, 4);
+
+  ASSERT_EQ(2, sub.slices().size());
+  EXPECT_EQ(buffer.slices()[0].data() + 4, sub.slices()[0].data());
+  EXPECT_EQ("o wo", sub);
+
+  EXPECT_EQ("world", buffer.Sub(6));
+  EXPECT_EQ("", buffer.Sub(11));
+  EXPECT_EQ("", buffer.Sub(100, 5));
+}
+
+
+TEST(ByteBufferTest, Consume) {
+  ByteBuffer buffer = ByteBuffer::Copy("hello ");
+  buffer.Append(ByteBuffer::Copy("world"));
+
+  buffer.Consume(3);
+
+  EXPECT_EQ("lo world", buffer);
+  EXPECT_EQ(2, buffer.slices().size());
+
+  buffer.Consume(3);
+
+  EXPECT_EQ("world", buffer);
+  EXPECT_EQ(1, buffer.slices().size());
+
+  buffer.Consume(100);
+
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_EQ(0, buffer.slices().size());
+}
+
+
+TEST(ByteBufferTest, CopyTo) {
+  ByteBuffer buffer = ByteBuffer::Copy("hello ");
+  buffer.Append(ByteBuffer::Copy("world"));
+
+  char data[8] = {};
+
+  EXPECT_EQ(8, buffer.CopyTo(data, sizeof(data)));
+  EXPECT_EQ("hello wo", std::string(data, 8));
+
+  EXPECT_EQ(3, buffer.CopyTo(data, sizeof(data), 8));
+  EXPECT_EQ("rld", std::string(data, 3));
+
+  EXPECT_EQ("hello world", buffer.ToString());
+}
+
+
+TEST(ByteBufferTest, Equality) {
+  ByteBuffer left = ByteBuffer::Copy("hel");
+  left.Append(ByteBuffer::Copy("lo"));
+
+  ByteBuffer right = ByteBuffer::Copy("h");
+  right.Append(ByteBuffer::Copy("ello"));
+
+  EXPECT_EQ(left, right);
+  EXPECT_NE(left, ByteBuffer::Copy("hellO"));
+  EXPECT_NE(left, ByteBuffer::Copy("hell"));
+
+  std::ostringstream stream;
+  stream << left;
+  EXPECT_EQ("hello", stream.str());
+}
+
+
+TEST(ByteBufferPoolTest, RecyclesBlocks) {
+  auto pool = ByteBufferPool::Create(1024, 1);
+
+  std::shared_ptr<char> block = pool->Acquire();
+  char* data = block.get();
+
+  ByteBuffer buffer(ByteBuffer::Slice(std::move(block), data, 5));
+
+  // The pool stays alive as long as any of its blocks.
+  std::weak_ptr<ByteBufferPool> weak = pool;
+  pool.reset();
+
+  EXPECT_FALSE(weak.expired());
+
+  pool = weak.lock();
+
+  EXPECT_EQ(0, pool->cached());
+
+  buffer = ByteBuffer();
+
+  EXPECT_EQ(1, pool->cached());
+
+  EXPECT_EQ(data, pool->Acquire().get());
+
+  // At most 'capacity' blocks are cached.
+  std::shared_ptr<char> first = pool->Acquire();
+  std::shared_ptr<char> second = pool->Acquire();
+
+  first.reset();
+  second.reset();
+
+  EXPECT_EQ(1, pool->cached());
+}
+
+} // namespace
+} // namespace eventuals::test
@@ -109,7 +109,7 @@ TEST(CanCompose, ConcurrentOrderedAdaptor) {
 }
 
 TEST(CanCompose, ReorderAdaptor) {
-  auto reorder = ReorderAdaptor();
+  auto reorder = ReorderAdaptor(std::make_shared<_ReorderWindow>(1));
   auto then = Then([]() { return false; });
   auto map = Map([]() { return 0; });
 
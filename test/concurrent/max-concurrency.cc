@@ -0,0 +1,133 @@
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "eventuals/callback.h"
+#include "eventuals/collect.h"
+#include "eventuals/concurrent.h"
+#include "eventuals/eventual.h"
+#include "eventuals/iterate.h"
+#include "eventuals/let.h"
+#include "eventuals/map.h"
+#include "eventuals/scheduler.h"
+#include "gmock/gmock.h"
+#include "test/promisify-for-test.h"
+
+namespace eventuals::test {
+namespace {
+
+using testing::UnorderedElementsAre;
+
+// Tests that at most 'max_concurrency' eventuals are started before
+// one of them finishes and that finished fibers get reused rather than
+// creating new ones.
+TEST(ConcurrentMaxConcurrencyTest, Backpressure) {
+  std::deque<Callback<void()>> callbacks;
+
+  // Each fiber has its own scheduler context which is emplaced in the
+  // same place every time the fiber is reused, so the number of
+  // distinct contexts is the number of fibers that were created.
+  std::set<Scheduler::Context*> fibers;
+
+  auto e = [&]() {
+    return Iterate({1, 2, 3, 4, 5})
+        >> Concurrent(2, [&]() {
+             struct Data {
+               void* k;
+               int i;
+             };
+             return Map(Let([&](int& i) {
+               return Eventual<std::string>(
+                   [&, data = Data()](auto& k) mutable {
+                     using K = std::decay_t<decltype(k)>;
+                     fibers.insert(Scheduler::Context::Get().get());
+                     data.k = &k;
+                     data.i = i;
+                     callbacks.emplace_back([&data]() {
+                       static_cast<K*>(data.k)->Start(std::to_string(data.i));
+                     });
+                   });
+             }));
+           })
+        >> Collect<std::vector>();
+  };
+
+  auto [future, k] = PromisifyForTest(e());
+
+  k.Start();
+
+  ASSERT_EQ(2, callbacks.size());
+
+  // Finishing one eventual lets us start the next one, reusing the
+  // finished fiber.
+  size_t started = 0;
+  while (!callbacks.empty()) {
+    Callback<void()> callback = std::move(callbacks.front());
+    callbacks.pop_front();
+    callback();
+    started++;
+    EXPECT_GE(2, callbacks.size());
+  }
+
+  EXPECT_EQ(5, started);
+
+  EXPECT_EQ(2, fibers.size());
+
+  EXPECT_THAT(future.get(), UnorderedElementsAre("1", "2", "3", "4", "5"));
+}
+
+// Tests that the stream is done once the eventuals finish even when
+// we're waiting to start another one.
+TEST(ConcurrentMaxConcurrencyTest, Fail) {
+  std::deque<Callback<void()>> callbacks;
+
+  auto e = [&]() {
+    return Iterate({1, 2, 3, 4, 5})
+        >> Concurrent(1, [&]() {
+             struct Data {
+               void* k;
+               int i;
+             };
+             return Map(Let([&](int& i) {
+               return Eventual<std::string>()
+                   .raises<RuntimeError>()
+                   .start([&, data = Data()](auto& k) mutable {
+                     using K = std::decay_t<decltype(k)>;
+                     data.k = &k;
+                     data.i = i;
+                     callbacks.emplace_back([&data]() {
+                       if (data.i == 2) {
+                         static_cast<K*>(data.k)->Fail(RuntimeError("error"));
+                       } else {
+                         static_cast<K*>(data.k)->Start(
+                             std::to_string(data.i));
+                       }
+                     });
+                   });
+             }));
+           })
+        >> Collect<std::vector>();
+  };
+
+  auto [future, k] = PromisifyForTest(e());
+
+  k.Start();
+
+  size_t started = 0;
+  while (!callbacks.empty()) {
+    ASSERT_EQ(1, callbacks.size());
+    Callback<void()> callback = std::move(callbacks.front());
+    callbacks.pop_front();
+    callback();
+    started++;
+  }
+
+  // No more eventuals are started after the failure.
+  EXPECT_EQ(2, started);
+
+  EXPECT_THROW(future.get(), RuntimeError);
+}
+
+} // namespace
+} // namespace eventuals::test
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "eventuals/collect.h"
+#include "eventuals/concurrent.h"
+#include "eventuals/eventual.h"
+#include "eventuals/iterate.h"
+#include "eventuals/let.h"
+#include "eventuals/map.h"
+#include "eventuals/promisify.h"
+#include "eventuals/static-thread-pool.h"
+#include "eventuals/then.h"
+#include "gmock/gmock.h"
+
+namespace eventuals::test {
+namespace {
+
+using testing::StrEq;
+using testing::ThrowsMessage;
+using testing::UnorderedElementsAreArray;
+
+// Tests that every fiber runs on the pool.
+TEST(ParallelConcurrentTest, RunsOnPool) {
+  StaticThreadPool pool(4);
+
+  std::vector<int> values(32);
+  std::iota(values.begin(), values.end(), 0);
+
+  std::atomic<size_t> on_pool = 0;
+
+  auto e = [&]() {
+    return Iterate(std::vector<int>(values))
+        >> ParallelConcurrent(pool, 4, [&]() {
+             return Map([&](int i) {
+               if (StaticThreadPool::member == &pool) {
+                 on_pool++;
+               }
+               return i * 2;
+             });
+           })
+        >> Collect<std::vector>();
+  };
+
+  std::vector<int> expected;
+  for (int i : values) {
+    expected.push_back(i * 2);
+  }
+
+  EXPECT_THAT(*e(), UnorderedElementsAreArray(expected));
+
+  EXPECT_EQ(values.size(), on_pool.load());
+}
+
+
+// Tests that 'max_in_flight' fibers run at a time, but no more.
+TEST(ParallelConcurrentTest, MaxInFlight) {
+  StaticThreadPool pool(4);
+
+  std::atomic<int> in_flight = 0;
+  std::atomic<int> most_in_flight = 0;
+
+  // Used to make the first two fibers wait for each other so that
+  // they must overlap.
+  std::atomic<int> arrived = 0;
+
+  auto e = [&]() {
+    return Iterate(std::vector<int>(16, 1))
+        >> ParallelConcurrent(pool, 2, [&]() {
+             return Map([&](int i) {
+               int n = ++in_flight;
+               int most = most_in_flight.load();
+               while (n > most
+                      && !most_in_flight.compare_exchange_weak(most, n)) {}
+               if (++arrived <= 2) {
+                 // NOTE: giving up eventually so that we fail rather
+                 // than hang if the fibers can't run at the same time.
+                 auto deadline = std::chrono::steady_clock::now()
+                     + std::chrono::seconds(10);
+                 while (arrived.load() < 2
+                        && std::chrono::steady_clock::now() < deadline) {
+                   std::this_thread::yield();
+                 }
+               }
+               std::this_thread::sleep_for(std::chrono::milliseconds(1));
+               in_flight--;
+               return i;
+             });
+           })
+        >> Collect<std::vector>();
+  };
+
+  EXPECT_EQ(16, (*e()).size());
+
+  EXPECT_EQ(2, most_in_flight.load());
+}
+
+
+// Tests that a failure from one of the fibers propagates downstream.
+TEST(ParallelConcurrentTest, Fail) {
+  StaticThreadPool pool(2);
+
+  auto e = [&]() {
+    return Iterate({1, 2, 3, 4})
+        >> ParallelConcurrent(pool, 2, []() {
+             return Map(Let([](int& i) {
+               return Eventual<int>()
+                   .raises<RuntimeError>()
+                   .start([&i](auto& k) {
+                     if (i == 3) {
+                       k.Fail(RuntimeError("error"));
+                     } else {
+                       k.Start(i);
+                     }
+                   });
+             }));
+           })
+        >> Collect<std::vector>();
+  };
+
+  static_assert(
+      eventuals::tuple_types_unordered_equals_v<
+          typename decltype(e())::template ErrorsFrom<void, std::tuple<>>,
+          std::tuple<RuntimeError>>);
+
+  EXPECT_THAT(
+      [&]() { *e(); },
+      ThrowsMessage<RuntimeError>(StrEq("error")));
+}
+
+} // namespace
+} // namespace eventuals::test
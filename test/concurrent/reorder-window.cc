@@ -0,0 +1,129 @@
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "eventuals/callback.h"
+#include "eventuals/collect.h"
+#include "eventuals/concurrent-ordered.h"
+#include "eventuals/eventual.h"
+#include "eventuals/iterate.h"
+#include "eventuals/let.h"
+#include "eventuals/map.h"
+#include "gmock/gmock.h"
+#include "test/promisify-for-test.h"
+
+namespace eventuals::test {
+namespace {
+
+using testing::ElementsAre;
+
+// Tests that 'ConcurrentOrdered()' stops asking upstream for values
+// while the oldest value is still being handled and the window is
+// full, even though later values have already been handled.
+TEST(ConcurrentOrderedWindowTest, Backpressure) {
+  std::deque<Callback<void()>> callbacks;
+
+  auto e = [&]() {
+    return Iterate({1, 2, 3, 4, 5})
+        >> ConcurrentOrdered(2, [&]() {
+             struct Data {
+               void* k;
+               int i;
+             };
+             return Map(Let([&](int& i) {
+               return Eventual<std::string>(
+                   [&, data = Data()](auto& k) mutable {
+                     using K = std::decay_t<decltype(k)>;
+                     data.k = &k;
+                     data.i = i;
+                     callbacks.emplace_back([&data]() {
+                       static_cast<K*>(data.k)->Start(std::to_string(data.i));
+                     });
+                   });
+             }));
+           })
+        >> Collect<std::vector>();
+  };
+
+  auto [future, k] = PromisifyForTest(e());
+
+  k.Start();
+
+  ASSERT_EQ(2, callbacks.size());
+
+  // Finishing the newest value doesn't make any room in the window.
+  Callback<void()> callback = std::move(callbacks.back());
+  callbacks.pop_back();
+  callback();
+
+  EXPECT_EQ(1, callbacks.size());
+
+  // Always finishing the newest value so that every value other than
+  // the oldest gets buffered.
+  while (!callbacks.empty()) {
+    callback = std::move(callbacks.back());
+    callbacks.pop_back();
+    callback();
+    EXPECT_GE(2, callbacks.size());
+  }
+
+  EXPECT_THAT(future.get(), ElementsAre("1", "2", "3", "4", "5"));
+}
+
+// Tests that a failure of the oldest value while the window is full
+// doesn't leave upstream waiting for room that will never be made.
+TEST(ConcurrentOrderedWindowTest, FailWhenFull) {
+  std::deque<Callback<void()>> callbacks;
+
+  auto e = [&]() {
+    return Iterate({1, 2, 3, 4, 5})
+        >> ConcurrentOrdered(2, [&]() {
+             struct Data {
+               void* k;
+               int i;
+             };
+             return Map(Let([&](int& i) {
+               return Eventual<std::string>()
+                   .raises<RuntimeError>()
+                   .start([&, data = Data()](auto& k) mutable {
+                     using K = std::decay_t<decltype(k)>;
+                     data.k = &k;
+                     data.i = i;
+                     callbacks.emplace_back([&data]() {
+                       if (data.i == 1) {
+                         static_cast<K*>(data.k)->Fail(RuntimeError("error"));
+                       } else {
+                         static_cast<K*>(data.k)->Start(
+                             std::to_string(data.i));
+                       }
+                     });
+                   });
+             }));
+           })
+        >> Collect<std::vector>();
+  };
+
+  auto [future, k] = PromisifyForTest(e());
+
+  k.Start();
+
+  ASSERT_EQ(2, callbacks.size());
+
+  Callback<void()> callback = std::move(callbacks.back());
+  callbacks.pop_back();
+  callback();
+
+  ASSERT_EQ(1, callbacks.size());
+
+  callback = std::move(callbacks.back());
+  callbacks.pop_back();
+  callback();
+
+  // No more values are handled after the failure.
+  EXPECT_TRUE(callbacks.empty());
+
+  EXPECT_THROW(future.get(), RuntimeError);
+}
+
+} // namespace
+} // namespace eventuals::test
@@ -1,8 +1,13 @@
 #include "eventuals/dns-resolver.h"
 
+#include <map>
 #include <regex>
+#include <string>
+#include <vector>
 
+#include "eventuals/do-all.h"
 #include "eventuals/event-loop.h"
+#include "eventuals/interrupt.h"
 #include "eventuals/then.h"
 #include "eventuals/type-traits.h"
 #include "gmock/gmock.h"
@@ -13,6 +18,7 @@
 namespace eventuals::test {
 namespace {
 
+using testing::ElementsAre;
 using testing::MockFunction;
 using testing::StrEq;
 using testing::ThrowsMessage;
@@ -108,5 +114,430 @@ TEST_F(DomainNameResolveTest, Raises) {
       ThrowsMessage<MyError>(StrEq("child error")));
 }
 
+////////////////////////////////////////////////////////////////////////
+
+// A stand-in DNS server on the default event loop that answers A and
+// AAAA queries for the names it knows about and NXDOMAIN otherwise.
+class FakeDnsServer final {
+ public:
+  struct Record final {
+    std::vector<std::string> ipv4;
+    std::vector<std::string> ipv6;
+    uint32_t ttl = 30;
+
+    // Response codes to answer A and AAAA queries with respectively,
+    // e.g., 2 for SERVFAIL, which leaves out any addresses.
+    uint8_t ipv4_rcode = 0;
+    uint8_t ipv6_rcode = 0;
+  };
+
+  explicit FakeDnsServer(const std::string& ip = "127.0.0.1") {
+    CHECK_EQ(uv_udp_init(EventLoop::Default(), &udp_), 0);
+
+    udp_.data = this;
+
+    sockaddr_storage address = {};
+    if (uv_ip4_addr(
+            ip.c_str(),
+            0,
+            reinterpret_cast<sockaddr_in*>(&address))
+        != 0) {
+      CHECK_EQ(
+          uv_ip6_addr(
+              ip.c_str(),
+              0,
+              reinterpret_cast<sockaddr_in6*>(&address)),
+          0);
+    }
+
+    CHECK_EQ(
+        uv_udp_bind(&udp_, reinterpret_cast<sockaddr*>(&address), 0),
+        0);
+
+    int length = sizeof(address);
+    CHECK_EQ(
+        uv_udp_getsockname(
+            &udp_,
+            reinterpret_cast<sockaddr*>(&address),
+            &length),
+        0);
+
+    // NOTE: the port is at the same offset for IPv4 and IPv6.
+    port_ = ntohs(reinterpret_cast<sockaddr_in*>(&address)->sin_port);
+
+    CHECK_EQ(
+        uv_udp_recv_start(
+            &udp_,
+            [](uv_handle_t* handle, size_t, uv_buf_t* buffer) {
+              auto* server = static_cast<FakeDnsServer*>(handle->data);
+              *buffer = uv_buf_init(server->buffer_, sizeof(server->buffer_));
+            },
+            [](uv_udp_t* udp,
+               ssize_t nread,
+               const uv_buf_t* buffer,
+               const sockaddr* addr,
+               unsigned flags) {
+              if (nread > 0) {
+                static_cast<FakeDnsServer*>(udp->data)
+                    ->Answer(std::string(buffer->base, nread), addr);
+              }
+            }),
+        0);
+  }
+
+  ~FakeDnsServer() {
+    bool closed = false;
+    udp_.data = &closed;
+    uv_close(reinterpret_cast<uv_handle_t*>(&udp_), [](uv_handle_t* handle) {
+      *static_cast<bool*>(handle->data) = true;
+    });
+    while (!closed) {
+      EventLoop::Default().RunUntilIdle();
+    }
+  }
+
+  int port() const {
+    return port_;
+  }
+
+  size_t queries() const {
+    return queries_;
+  }
+
+  std::map<std::string, Record> records;
+
+ private:
+  void Answer(std::string query, const sockaddr* addr) {
+    queries_++;
+
+    // Decode the name from the question.
+    std::string name;
+    size_t offset = 12;
+    while (query[offset] != '\0') {
+      size_t length = query[offset];
+      if (!name.empty()) {
+        name += '.';
+      }
+      name += query.substr(offset + 1, length);
+      offset += length + 1;
+    }
+
+    uint16_t type = (uint8_t(query[offset + 1]) << 8)
+        | uint8_t(query[offset + 2]);
+
+    std::string response = query.substr(0, offset + 5);
+
+    auto record = records.find(name);
+
+    uint8_t rcode = 3; // NXDOMAIN.
+
+    std::vector<std::string> addresses;
+    if (record != records.end()) {
+      rcode = type == 1 ? record->second.ipv4_rcode : record->second.ipv6_rcode;
+      if (rcode == 0) {
+        addresses = type == 1 ? record->second.ipv4 : record->second.ipv6;
+      }
+    }
+
+    auto append = [&response](uint16_t value) {
+      response.push_back(static_cast<char>(value >> 8));
+      response.push_back(static_cast<char>(value & 0xFF));
+    };
+
+    // Flags (response, recursion available, and the response code).
+    response[2] = static_cast<char>(0x81);
+    response[3] = static_cast<char>(0x80 | rcode);
+
+    // Answers.
+    response[6] = 0;
+    response[7] = static_cast<char>(addresses.size());
+
+    for (const std::string& address : addresses) {
+      append(0xC00C); // Pointer to the name in the question.
+      append(type);
+      append(1); // Class IN.
+      append(record->second.ttl >> 16);
+      append(record->second.ttl & 0xFFFF);
+
+      char data[16];
+      CHECK_EQ(
+          uv_inet_pton(type == 1 ? AF_INET : AF_INET6, address.c_str(), data),
+          0);
+
+      append(type == 1 ? 4 : 16);
+      response.append(data, type == 1 ? 4 : 16);
+    }
+
+    uv_buf_t buffer = uv_buf_init(response.data(), response.size());
+    CHECK_EQ(uv_udp_try_send(&udp_, &buffer, 1, addr), response.size());
+  }
+
+  uv_udp_t udp_;
+  int port_ = 0;
+  size_t queries_ = 0;
+  char buffer_[512];
+};
+
+////////////////////////////////////////////////////////////////////////
+
+class DnsResolverTest : public EventLoopTest {
+ protected:
+  DnsResolver::Options Options() {
+    DnsResolver::Options options;
+    options.server = "127.0.0.1";
+    options.port = server_->port();
+    return options;
+  }
+
+  void SetUp() override {
+    EventLoopTest::SetUp();
+    server_.emplace();
+  }
+
+  void TearDown() override {
+    server_.reset();
+    EventLoopTest::TearDown();
+  }
+
+  std::optional<FakeDnsServer> server_;
+};
+
+////////////////////////////////////////////////////////////////////////
+
+TEST_F(DnsResolverTest, ResolvesAllAddresses) {
+  server_->records["example.com"] = {
+      {"10.0.0.1", "10.0.0.2"},
+      {"::1", "fe80::1"}};
+
+  DnsResolver resolver(EventLoop::Default(), Options());
+
+  auto e = resolver.Resolve("example.com");
+
+  static_assert(
+      eventuals::tuple_types_unordered_equals_v<
+          typename decltype(e)::template ErrorsFrom<void, std::tuple<>>,
+          std::tuple<RuntimeError>>);
+
+  EXPECT_THAT(
+      *std::move(e),
+      ElementsAre("10.0.0.1", "10.0.0.2", "::1", "fe80::1"));
+
+  // Both an A and a AAAA query.
+  EXPECT_EQ(2, server_->queries());
+}
+
+
+TEST_F(DnsResolverTest, Cache) {
+  server_->records["example.com"] = {{"10.0.0.1"}, {}, 30};
+
+  DnsResolver resolver(EventLoop::Default(), Options());
+
+  Clock().Pause();
+
+  EXPECT_THAT(*resolver.Resolve("example.com"), ElementsAre("10.0.0.1"));
+  EXPECT_THAT(*resolver.Resolve("example.com"), ElementsAre("10.0.0.1"));
+
+  EXPECT_EQ(2, server_->queries());
+  EXPECT_EQ(1, resolver.statistics().hits);
+  EXPECT_EQ(1, resolver.statistics().misses);
+
+  // Expires after the TTL of the answers.
+  server_->records["example.com"] = {{"10.0.0.2"}, {}, 30};
+
+  Clock().Advance(std::chrono::seconds(29));
+
+  EXPECT_THAT(*resolver.Resolve("example.com"), ElementsAre("10.0.0.1"));
+
+  Clock().Advance(std::chrono::seconds(1));
+
+  EXPECT_THAT(*resolver.Resolve("example.com"), ElementsAre("10.0.0.2"));
+
+  EXPECT_EQ(4, server_->queries());
+  EXPECT_EQ(2, resolver.statistics().hits);
+  EXPECT_EQ(2, resolver.statistics().misses);
+
+  resolver.Clear();
+
+  EXPECT_THAT(*resolver.Resolve("example.com"), ElementsAre("10.0.0.2"));
+
+  EXPECT_EQ(6, server_->queries());
+
+  Clock().Resume();
+}
+
+
+TEST_F(DnsResolverTest, SweepExpired) {
+  DnsResolver resolver(EventLoop::Default(), Options());
+
+  Clock().Pause();
+
+  // Every name expires before the next one is resolved, so the cache
+  // shouldn't keep growing even though none of them are looked up
+  // again.
+  for (size_t i = 0; i < 200; i++) {
+    std::string name = std::to_string(i) + ".example.com";
+    server_->records[name] = {{"10.0.0.1"}, {}, 30};
+
+    EXPECT_THAT(*resolver.Resolve(name), ElementsAre("10.0.0.1"));
+
+    Clock().Advance(std::chrono::seconds(30));
+  }
+
+  EXPECT_EQ(200, resolver.statistics().misses);
+  EXPECT_GE(64, resolver.size());
+
+  Clock().Resume();
+}
+
+
+TEST_F(DnsResolverTest, Interrupt) {
+  DnsResolver::Options options = Options();
+  options.port = 1; // Nothing should be listening here.
+  options.timeout = std::chrono::milliseconds(100);
+
+  DnsResolver resolver(EventLoop::Default(), options);
+
+  auto [future, k] = PromisifyForTest(resolver.Resolve("example.com"));
+
+  Interrupt interrupt;
+
+  k.Register(interrupt);
+
+  k.Start();
+
+  // Wait until the lookup has been sent before interrupting.
+  while (resolver.statistics().misses == 0) {
+    EventLoop::Default().RunUntilIdle();
+  }
+
+  interrupt.Trigger();
+
+  RunUntil(future);
+
+  EXPECT_THROW(future.get(), eventuals::Stopped);
+
+  // The lookup is still outstanding until it times out, after which
+  // the resolver can be destructed.
+  EXPECT_THROW(*resolver.Resolve("example.com"), RuntimeError);
+
+  EXPECT_EQ(1, resolver.statistics().misses);
+  EXPECT_EQ(1, resolver.statistics().coalesced);
+}
+
+
+TEST_F(DnsResolverTest, Coalesce) {
+  server_->records["example.com"] = {{"10.0.0.1"}, {"::1"}};
+
+  DnsResolver resolver(EventLoop::Default(), Options());
+
+  auto e = DoAll(
+      resolver.Resolve("example.com"),
+      resolver.Resolve("example.com"),
+      resolver.Resolve("example.com"));
+
+  auto [first, second, third] = *std::move(e);
+
+  EXPECT_THAT(first, ElementsAre("10.0.0.1", "::1"));
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(first, third);
+
+  EXPECT_EQ(2, server_->queries());
+  EXPECT_EQ(1, resolver.statistics().misses);
+  EXPECT_EQ(2, resolver.statistics().coalesced);
+}
+
+
+TEST_F(DnsResolverTest, NoName) {
+  DnsResolver resolver(EventLoop::Default(), Options());
+
+  EXPECT_THAT(
+      [&]() { *resolver.Resolve("unknown.example.com"); },
+      ThrowsMessage<RuntimeError>(StrEq("EAI_NONAME")));
+
+  // Failures aren't cached.
+  server_->records["unknown.example.com"] = {{"10.0.0.1"}};
+
+  EXPECT_THAT(
+      *resolver.Resolve("unknown.example.com"),
+      ElementsAre("10.0.0.1"));
+}
+
+
+TEST_F(DnsResolverTest, FailedQuery) {
+  // A SERVFAIL for the AAAA query, e.g., from an IPv4 only resolver,
+  // doesn't fail the lookup if the A query has addresses.
+  server_->records["example.com"] = {{"10.0.0.1"}, {"::1"}, 30, 0, 2};
+
+  DnsResolver resolver(EventLoop::Default(), Options());
+
+  EXPECT_THAT(*resolver.Resolve("example.com"), ElementsAre("10.0.0.1"));
+
+  EXPECT_EQ(2, server_->queries());
+
+  // But it does if neither query has any addresses.
+  server_->records["fail.example.com"] = {{"10.0.0.1"}, {"::1"}, 30, 2, 2};
+
+  EXPECT_THAT(
+      [&]() { *resolver.Resolve("fail.example.com"); },
+      ThrowsMessage<RuntimeError>(StrEq("EAI_FAIL")));
+}
+
+
+TEST_F(DnsResolverTest, Timeout) {
+  DnsResolver::Options options = Options();
+  options.port = 1; // Nothing should be listening here.
+  options.timeout = std::chrono::milliseconds(10);
+
+  DnsResolver resolver(EventLoop::Default(), options);
+
+  EXPECT_THROW(*resolver.Resolve("example.com"), RuntimeError);
+}
+
+
+TEST_F(DnsResolverTest, IPv6Server) {
+  FakeDnsServer server("::1");
+
+  server.records["example.com"] = {{"10.0.0.1"}, {"::1"}};
+
+  DnsResolver::Options options;
+  options.server = "::1";
+  options.port = server.port();
+
+  DnsResolver resolver(EventLoop::Default(), options);
+
+  EXPECT_THAT(
+      *resolver.Resolve("example.com"),
+      ElementsAre("10.0.0.1", "::1"));
+
+  EXPECT_EQ(2, server.queries());
+}
+
+
+TEST_F(DnsResolverTest, Address) {
+  DnsResolver resolver(EventLoop::Default(), Options());
+
+  EXPECT_THAT(*resolver.Resolve("10.0.0.1"), ElementsAre("10.0.0.1"));
+  EXPECT_THAT(*resolver.Resolve("::1"), ElementsAre("::1"));
+
+  EXPECT_EQ(0, server_->queries());
+}
+
+
+TEST_F(DnsResolverTest, GetAddrInfo) {
+  DnsResolver resolver(EventLoop::Default());
+
+  auto addresses = *resolver.Resolve("localhost");
+
+  ASSERT_FALSE(addresses.empty());
+
+  for (const std::string& address : addresses) {
+    EXPECT_TRUE(address == "127.0.0.1" || address == "::1") << address;
+  }
+
+  EXPECT_THAT(
+      [&]() { *resolver.Resolve(";;!(*#!()%$%*(#*!~_+"); },
+      ThrowsMessage<RuntimeError>(StrEq("EAI_NONAME")));
+}
+
 } // namespace
 } // namespace eventuals::test
@@ -0,0 +1,104 @@
+#include "eventuals/event-loop-group.h"
+
+#include <set>
+#include <string>
+#include <thread>
+
+#include "eventuals/promisify.h"
+#include "eventuals/then.h"
+#include "eventuals/timer.h"
+#include "gtest/gtest.h"
+
+namespace eventuals::test {
+namespace {
+
+TEST(EventLoopGroupTest, Schedule) {
+  EventLoopGroup group(2);
+
+  ASSERT_EQ(2u, group.size());
+
+  auto e = [&]() {
+    return group.Schedule(Then([id = std::this_thread::get_id()]() {
+      EXPECT_NE(id, std::this_thread::get_id());
+      EXPECT_TRUE(EventLoop::InEventLoop());
+      return &EventLoop::Current();
+    }));
+  };
+
+  EventLoop* loop = *e();
+
+  EXPECT_TRUE(loop == &group[0] || loop == &group[1]);
+}
+
+
+TEST(EventLoopGroupTest, Hashed) {
+  EventLoopGroup group(4);
+
+  EventLoop& loop = group.Hashed(std::string("connection"));
+
+  EXPECT_EQ(&loop, &group.Hashed(std::string("connection")));
+
+  auto e = [&]() {
+    return group.Schedule(
+        loop,
+        Then([]() {
+          return &EventLoop::Current();
+        }));
+  };
+
+  EXPECT_EQ(&loop, *e());
+  EXPECT_EQ(&loop, *e());
+}
+
+
+TEST(EventLoopGroupTest, LeastLoaded) {
+  EventLoopGroup group(4);
+
+  // With nothing scheduled every loop is tied so consecutive calls
+  // should spread out across all of them.
+  std::set<EventLoop*> loops;
+  for (size_t i = 0; i < group.size(); i++) {
+    loops.insert(&group.LeastLoaded());
+  }
+
+  EXPECT_EQ(group.size(), loops.size());
+
+  // While an eventual is running on a loop it counts towards that
+  // loop's load and is no longer counted once it has completed.
+  EventLoop& loop = group[0];
+
+  auto e = [&]() {
+    return group.Schedule(
+        loop,
+        Then([&]() {
+          return group.load(loop);
+        }));
+  };
+
+  EXPECT_EQ(1u, *e());
+  EXPECT_EQ(0u, group.load(loop));
+}
+
+
+TEST(EventLoopGroupTest, TimerFollowsLoop) {
+  EventLoopGroup group(2);
+
+  EventLoop& loop = group[1];
+
+  auto e = [&]() {
+    return group.Schedule(
+        loop,
+        Then([&]() {
+          EXPECT_EQ(&loop.clock(), &Clock());
+          return Timer(std::chrono::milliseconds(10))
+              >> Then([]() {
+                   return &EventLoop::Current();
+                 });
+        }));
+  };
+
+  EXPECT_EQ(&loop, *e());
+}
+
+} // namespace
+} // namespace eventuals::test
@@ -0,0 +1,98 @@
+#include "eventuals/event-loop.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "event-loop-test.h"
+#include "gtest/gtest.h"
+
+namespace eventuals::test {
+namespace {
+
+TEST_F(EventLoopTest, SubmitRunsInOrderInOneBatch) {
+  EventLoop& loop = EventLoop::Default();
+
+  struct Submission {
+    std::unique_ptr<Scheduler::Context> context;
+    std::vector<int>* order = nullptr;
+    int i = 0;
+  };
+
+  constexpr int N = 100;
+
+  std::vector<int> order;
+
+  std::vector<Submission> submissions(N);
+  for (int i = 0; i < N; i++) {
+    submissions[i].context =
+        std::make_unique<Scheduler::Context>(&loop, "submit");
+    submissions[i].order = &order;
+    submissions[i].i = i;
+  }
+
+  for (Submission& submission : submissions) {
+    loop.Submit(
+        [submission = &submission]() {
+          submission->order->push_back(submission->i);
+        },
+        *submission.context);
+  }
+
+  RunUntil([&]() {
+    return order.size() == N;
+  });
+
+  for (int i = 0; i < N; i++) {
+    EXPECT_EQ(i, order[i]);
+  }
+
+  EventLoop::Statistics statistics = loop.statistics();
+
+  EXPECT_EQ(1u, statistics.batches);
+  EXPECT_EQ(size_t(N), statistics.waiters);
+  EXPECT_EQ(size_t(N), statistics.largest);
+  EXPECT_EQ(1u, statistics.wakeups);
+  EXPECT_EQ(size_t(N - 1), statistics.coalesced);
+}
+
+
+TEST_F(EventLoopTest, SubmitFromAnotherThread) {
+  EventLoop& loop = EventLoop::Default();
+
+  constexpr int N = 1000;
+
+  std::vector<std::unique_ptr<Scheduler::Context>> contexts;
+  for (int i = 0; i < N; i++) {
+    contexts.push_back(std::make_unique<Scheduler::Context>(&loop, "submit"));
+  }
+
+  std::atomic<int> count = 0;
+
+  std::thread thread([&]() {
+    for (auto& context : contexts) {
+      loop.Submit(
+          [count = &count]() {
+            count->fetch_add(1);
+          },
+          *context);
+    }
+  });
+
+  // NOTE: using 'RunOnce()' which blocks until woken up to make sure
+  // no wakeups get lost when they're coalesced.
+  while (count.load() < N) {
+    loop.RunOnce();
+  }
+
+  thread.join();
+
+  EventLoop::Statistics statistics = loop.statistics();
+
+  EXPECT_EQ(size_t(N), statistics.waiters);
+  EXPECT_EQ(size_t(N), statistics.wakeups + statistics.coalesced);
+}
+
+} // namespace
+} // namespace eventuals::test
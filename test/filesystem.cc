@@ -5,7 +5,12 @@
 
 #include "event-loop-test.h"
 #include "eventuals/closure.h"
+#include "eventuals/collect.h"
+#include "eventuals/iterate.h"
+#include "eventuals/map.h"
 #include "eventuals/promisify.h"
+#include "eventuals/raise.h"
+#include "eventuals/stream.h"
 #include "eventuals/then.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -131,6 +136,64 @@ TEST_F(FilesystemTest, ReadFileFail) {
 }
 
 
+TEST_F(FilesystemTest, ReadFileLessThanRequested) {
+  const std::filesystem::path path = "test_readfile_less_than_requested";
+  const std::string test_string = "Hello GTest!";
+
+  std::ofstream ofs(path);
+
+  ofs << test_string;
+  ofs.close();
+
+  auto e = [&]() {
+    return OpenFile(path, UV_FS_O_RDONLY, 0)
+        >> Then([&](File&& file) {
+             return Closure([&, file = std::move(file)]() mutable {
+               return ReadFile(file, 1024, 0)
+                   >> Then([&](std::string&& data) {
+                        EXPECT_EQ(test_string, data);
+                        return CloseFile(std::move(file));
+                      });
+             });
+           });
+  };
+
+  *e();
+
+  std::filesystem::remove(path);
+}
+
+
+// Bigger than what fits in one of the io_uring's registered buffers
+// (if io_uring is available).
+TEST_F(FilesystemTest, ReadFileLarge) {
+  const std::filesystem::path path = "test_readfile_large";
+  const std::string test_string(1024 * 1024, 'x');
+
+  std::ofstream ofs(path);
+
+  ofs << test_string;
+  ofs.close();
+
+  auto e = [&]() {
+    return OpenFile(path, UV_FS_O_RDONLY, 0)
+        >> Then([&](File&& file) {
+             return Closure([&, file = std::move(file)]() mutable {
+               return ReadFile(file, test_string.size(), 0)
+                   >> Then([&](std::string&& data) {
+                        EXPECT_EQ(test_string, data);
+                        return CloseFile(std::move(file));
+                      });
+             });
+           });
+  };
+
+  *e();
+
+  std::filesystem::remove(path);
+}
+
+
 TEST_F(FilesystemTest, WriteFileSucceed) {
   const std::filesystem::path path = "test_writefile_succeed";
   const std::string test_string = "Hello GTest!";
@@ -170,6 +233,38 @@ TEST_F(FilesystemTest, WriteFileSucceed) {
 }
 
 
+TEST_F(FilesystemTest, WriteFileByteBuffer) {
+  const std::filesystem::path path = "test_writefile_bytebuffer";
+
+  std::ofstream ofs(path);
+  ofs.close();
+
+  ByteBuffer buffer = ByteBuffer::Copy("Hello ");
+  buffer.Append(ByteBuffer::Copy("GTest"));
+  buffer.Append(ByteBuffer::Copy("!"));
+
+  auto e = [&]() {
+    return OpenFile(path, UV_FS_O_RDWR, 0)
+        >> Then([&](File&& file) {
+             return Closure([&, file = std::move(file)]() mutable {
+               return WriteFile(file, buffer, 0)
+                   >> Then([&]() {
+                        return ReadFileBuffer(file, 100, 6);
+                      })
+                   >> Then([&](ByteBuffer&& data) {
+                        EXPECT_EQ("GTest!", data);
+                        return CloseFile(std::move(file));
+                      });
+             });
+           });
+  };
+
+  *e();
+
+  std::filesystem::remove(path);
+}
+
+
 TEST_F(FilesystemTest, WriteFileFail) {
   const std::filesystem::path path = "test_writefile_fail";
   const std::string test_string = "Hello GTest!";
@@ -201,6 +296,287 @@ TEST_F(FilesystemTest, WriteFileFail) {
 }
 
 
+TEST_F(FilesystemTest, ReadFileStream) {
+  const std::filesystem::path path = "test_readfilestream";
+
+  std::string contents;
+  for (size_t i = 0; contents.size() < 10 * 4096 + 100; i++) {
+    contents += std::to_string(i) + "\n";
+  }
+  contents.resize(10 * 4096 + 100);
+
+  std::ofstream ofs(path);
+  ofs << contents;
+  ofs.close();
+
+  ReadFileStreamOptions options;
+  options.chunk_size = 4096;
+  options.read_ahead = 3;
+
+  auto e = [&]() {
+    return OpenFile(path, UV_FS_O_RDONLY, 0)
+        >> Then([&](File&& file) {
+             return Closure([&, file = std::move(file)]() mutable {
+               return ReadFileStream(file, 0, options)
+                   >> Map([](ByteBuffer&& chunk) {
+                        return chunk.ToString();
+                      })
+                   >> Collect<std::vector>()
+                   >> Then([&](std::vector<std::string>&& chunks) {
+                        return CloseFile(std::move(file))
+                            >> Then([chunks = std::move(chunks)]() {
+                                 return chunks;
+                               });
+                      });
+             });
+           });
+  };
+
+  auto chunks = *e();
+
+  ASSERT_EQ(11, chunks.size());
+  EXPECT_EQ(100, chunks.back().size());
+
+  std::string read;
+  for (const std::string& chunk : chunks) {
+    read += chunk;
+  }
+
+  EXPECT_EQ(contents, read);
+
+  std::filesystem::remove(path);
+}
+
+
+TEST_F(FilesystemTest, ReadFileStreamRange) {
+  const std::filesystem::path path = "test_readfilestream_range";
+
+  std::ofstream ofs(path);
+  ofs << "Hello GTest!";
+  ofs.close();
+
+  ReadFileStreamOptions options;
+  options.chunk_size = 2;
+  options.bytes = 5;
+
+  auto e = [&]() {
+    return OpenFile(path, UV_FS_O_RDONLY, 0)
+        >> Then([&](File&& file) {
+             return Closure([&, file = std::move(file)]() mutable {
+               return ReadFileStream(file, 6, options)
+                   >> Map([](ByteBuffer&& chunk) {
+                        return chunk.ToString();
+                      })
+                   >> Collect<std::vector>()
+                   >> Then([&](std::vector<std::string>&& chunks) {
+                        EXPECT_THAT(
+                            chunks,
+                            testing::ElementsAre("GT", "es", "t"));
+                        return CloseFile(std::move(file));
+                      });
+             });
+           });
+  };
+
+  *e();
+
+  std::filesystem::remove(path);
+}
+
+
+TEST_F(FilesystemTest, ReadFileStreamFail) {
+  const std::filesystem::path path = "test_readfilestream_fail";
+
+  std::ofstream ofs(path);
+  ofs << "Hello GTest!";
+  ofs.close();
+
+  // Try to read from a File opened with WriteOnly flag.
+  auto e = [&]() {
+    return OpenFile(path, UV_FS_O_WRONLY, 0)
+        >> Then([&](File&& file) {
+             return Closure([&, file = std::move(file)]() mutable {
+               return ReadFileStream(file)
+                   >> Collect<std::vector>()
+                   >> Then([&](std::vector<ByteBuffer>&&) {
+                        return CloseFile(std::move(file));
+                      });
+             });
+           });
+  };
+
+  EXPECT_THAT(
+      [&]() { *e(); },
+      ThrowsMessage<RuntimeError>(StrEq("bad file descriptor")));
+
+  std::filesystem::remove(path);
+}
+
+
+TEST_F(FilesystemTest, ReadFileStreamUpstreamFail) {
+  const std::filesystem::path path = "test_readfilestream_upstream_fail";
+
+  std::ofstream ofs(path);
+  ofs << "Hello GTest!";
+  ofs.close();
+
+  auto e = [&]() {
+    return OpenFile(path, UV_FS_O_RDONLY, 0)
+        >> Then([&](File&& file) {
+             return Closure([&, file = std::move(file)]() mutable {
+               return Raise(RuntimeError("upstream failed"))
+                   >> ReadFileStream(file)
+                   >> Collect<std::vector>()
+                   >> Then([&](std::vector<ByteBuffer>&&) {
+                        return CloseFile(std::move(file));
+                      });
+             });
+           });
+  };
+
+  EXPECT_THAT(
+      [&]() { *e(); },
+      ThrowsMessage<RuntimeError>(StrEq("upstream failed")));
+
+  std::filesystem::remove(path);
+}
+
+
+TEST_F(FilesystemTest, WriteFileStream) {
+  const std::filesystem::path path = "test_writefilestream";
+
+  std::ofstream ofs(path);
+  ofs.close();
+
+  WriteFileStreamOptions options;
+  options.writes_in_flight = 2;
+
+  auto e = [&]() {
+    return OpenFile(path, UV_FS_O_WRONLY, 0)
+        >> Then([&](File&& file) {
+             return Closure([&, file = std::move(file)]() mutable {
+               return Iterate(std::vector<std::string>{
+                          "Hello ",
+                          "",
+                          "GTest",
+                          "!"})
+                   >> WriteFileStream(file, 0, options)
+                   >> Then([&](size_t written) {
+                        EXPECT_EQ(12, written);
+                        return CloseFile(std::move(file));
+                      });
+             });
+           });
+  };
+
+  *e();
+
+  std::ifstream ifs(path);
+  std::string contents(
+      (std::istreambuf_iterator<char>(ifs)),
+      std::istreambuf_iterator<char>());
+
+  EXPECT_EQ("Hello GTest!", contents);
+
+  std::filesystem::remove(path);
+}
+
+
+TEST_F(FilesystemTest, WriteFileStreamFail) {
+  const std::filesystem::path path = "test_writefilestream_fail";
+
+  std::ofstream ofs(path);
+  ofs.close();
+
+  auto e = [&]() {
+    return OpenFile(path, UV_FS_O_WRONLY, 0)
+        >> Then([&](File&& file) {
+             return Closure([&, file = std::move(file)]() mutable {
+               return Stream<std::string>()
+                          .context(0)
+                          .raises<RuntimeError>()
+                          .next([](int& chunks, auto& k) {
+                            if (chunks++ == 0) {
+                              k.Emit("Hello ");
+                            } else {
+                              k.Fail(RuntimeError("upstream failed"));
+                            }
+                          })
+                   >> WriteFileStream(file)
+                   >> Then([&](size_t) {
+                        return CloseFile(std::move(file));
+                      });
+             });
+           });
+  };
+
+  EXPECT_THAT(
+      [&]() { *e(); },
+      ThrowsMessage<RuntimeError>(StrEq("upstream failed")));
+
+  // The failure only gets propagated after the outstanding write
+  // has completed.
+  std::ifstream ifs(path);
+  std::string contents(
+      (std::istreambuf_iterator<char>(ifs)),
+      std::istreambuf_iterator<char>());
+
+  EXPECT_EQ("Hello ", contents);
+
+  std::filesystem::remove(path);
+}
+
+
+TEST_F(FilesystemTest, CopyWithFileStreams) {
+  const std::filesystem::path from = "test_filestreams_from";
+  const std::filesystem::path to = "test_filestreams_to";
+
+  std::string contents(1024 * 1024 + 7, 'x');
+  for (size_t i = 0; i < contents.size(); i += 4099) {
+    contents[i] = 'a' + (i % 26);
+  }
+
+  std::ofstream ofs(from);
+  ofs << contents;
+  ofs.close();
+
+  ofs.open(to);
+  ofs.close();
+
+  auto e = [&]() {
+    return OpenFile(from, UV_FS_O_RDONLY, 0)
+        >> Then([&](File&& from) {
+             return OpenFile(to, UV_FS_O_WRONLY, 0)
+                 >> Then([&, from = std::move(from)](File&& to) mutable {
+                      return Closure([&,
+                                      from = std::move(from),
+                                      to = std::move(to)]() mutable {
+                        return ReadFileStream(from)
+                            >> WriteFileStream(to)
+                            >> Then([&](size_t written) {
+                                 EXPECT_EQ(contents.size(), written);
+                                 return CloseFile(std::move(from))
+                                     >> CloseFile(std::move(to));
+                               });
+                      });
+                    });
+           });
+  };
+
+  *e();
+
+  std::ifstream ifs(to);
+  std::string copied(
+      (std::istreambuf_iterator<char>(ifs)),
+      std::istreambuf_iterator<char>());
+
+  EXPECT_EQ(contents, copied);
+
+  std::filesystem::remove(from);
+  std::filesystem::remove(to);
+}
+
+
 TEST_F(FilesystemTest, UnlinkFileSucceed) {
   const std::filesystem::path path = "test_unlinkfile_succeed";
 
@@ -0,0 +1,57 @@
+#include "eventuals/grpc/byte-buffer.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace eventuals::grpc::test {
+namespace {
+
+TEST(ByteBufferTest, RoundTrip) {
+  ByteBuffer buffer = ByteBuffer::Copy("Hello ");
+  buffer.Append(ByteBuffer::Copy("World!"));
+
+  ::grpc::ByteBuffer grpc = ToGrpcByteBuffer(buffer);
+
+  EXPECT_EQ(buffer.size(), grpc.Length());
+
+  // The slices given to gRPC point at the same memory.
+  std::vector<::grpc::Slice> slices;
+  ASSERT_TRUE(grpc.Dump(&slices).ok());
+  ASSERT_EQ(2, slices.size());
+  EXPECT_EQ(
+      buffer.slices()[0].data(),
+      reinterpret_cast<const char*>(slices[0].begin()));
+
+  ByteBuffer result = FromGrpcByteBuffer(grpc);
+
+  EXPECT_EQ("Hello World!", result);
+  EXPECT_EQ(buffer.slices()[1].data(), result.slices()[1].data());
+}
+
+
+TEST(ByteBufferTest, OutlivesOriginal) {
+  ::grpc::ByteBuffer grpc;
+
+  {
+    ByteBuffer buffer(std::string(1024, 'x'));
+    bool own = false;
+    ASSERT_TRUE(
+        ::grpc::SerializationTraits<ByteBuffer>::Serialize(
+            buffer,
+            &grpc,
+            &own)
+            .ok());
+  }
+
+  ByteBuffer result;
+  ASSERT_TRUE(
+      ::grpc::SerializationTraits<ByteBuffer>::Deserialize(&grpc, &result)
+          .ok());
+
+  EXPECT_EQ(std::string(1024, 'x'), result);
+}
+
+} // namespace
+} // namespace eventuals::grpc::test
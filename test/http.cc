@@ -1,9 +1,13 @@
 #include "eventuals/http.h"
 
 #include "event-loop-test.h"
+#include "eventuals/collect.h"
 #include "eventuals/interrupt.h"
+#include "eventuals/iterate.h"
 #include "eventuals/let.h"
+#include "eventuals/loop.h"
 #include "eventuals/scheduler.h"
+#include "eventuals/stream.h"
 #include "eventuals/then.h"
 #include "eventuals/type-traits.h"
 #include "gmock/gmock.h"
@@ -14,6 +18,9 @@
 namespace eventuals::http::test {
 namespace {
 
+using testing::StrEq;
+using testing::ThrowsMessage;
+
 class HttpTest
   : public ::eventuals::test::EventLoopTest,
     public ::testing::WithParamInterface<const char*> {};
@@ -124,6 +131,460 @@ TEST_P(HttpTest, GetGet) {
 }
 
 
+TEST_P(HttpTest, GetGetKeepAlive) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  Client client = server.Client();
+
+  size_t connections = 0;
+
+  // NOTE: the server keeps the connection alive so the second
+  // transfer should reuse it rather than opening a new connection
+  // (which would never get accepted while this one is handled).
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([&](auto socket, const std::string& data) {
+        connections++;
+
+        for (size_t i = 0; i < 2; i++) {
+          if (i > 0) {
+            // Receive the headers of the next request.
+            std::string headers;
+            do {
+              std::string buffer = socket->Receive();
+              if (buffer.empty()) {
+                return;
+              }
+              headers += buffer;
+            } while (headers.find("\r\n\r\n") == std::string::npos);
+          }
+
+          socket->Send(
+              "HTTP/1.1 200 OK\r\n"
+              "Content-Length: 25\r\n"
+              "\r\n"
+              "<html>Hello World!</html>");
+        }
+
+        socket->Close();
+      });
+
+  auto e = [&]() {
+    return client.Get(server.uri())
+        >> Then(Let([&](Response& response1) {
+             return client.Get(server.uri())
+                 >> Then([&](Response&& response2) {
+                      return std::tuple{response1, response2};
+                    });
+           }));
+  };
+
+  auto [response1, response2] = *e();
+
+  EXPECT_EQ(200, response1.code());
+  EXPECT_EQ("<html>Hello World!</html>", response1.body());
+
+  EXPECT_EQ(200, response2.code());
+  EXPECT_EQ("<html>Hello World!</html>", response2.body());
+
+  EXPECT_EQ(1, connections);
+}
+
+
+TEST_P(HttpTest, GetGetConnectionLimits) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: only allowing a single connection to the server so the
+  // second transfer has to wait for the first one to complete and
+  // then reuse its connection.
+  Client client = scheme == "https://"
+      ? Client::Builder()
+            .certificate(x509::Certificate(*server.certificate()))
+            .max_idle_connections(1)
+            .max_connections_per_host(1)
+            .Build()
+      : Client::Builder()
+            .max_idle_connections(1)
+            .max_connections_per_host(1)
+            .Build();
+
+  size_t connections = 0;
+
+  // NOTE: the server keeps the connection alive and expects both
+  // requests on it, which would never happen if the client opened a
+  // second connection while the first one was still in use (since
+  // the server only handles one connection at a time).
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([&](auto socket, const std::string& data) {
+        connections++;
+
+        for (size_t i = 0; i < 2; i++) {
+          if (i > 0) {
+            // Receive the headers of the next request.
+            std::string headers;
+            do {
+              std::string buffer = socket->Receive();
+              if (buffer.empty()) {
+                return;
+              }
+              headers += buffer;
+            } while (headers.find("\r\n\r\n") == std::string::npos);
+          }
+
+          socket->Send(
+              "HTTP/1.1 200 OK\r\n"
+              "Content-Length: 25\r\n"
+              "\r\n"
+              "<html>Hello World!</html>");
+        }
+
+        socket->Close();
+      });
+
+  auto [future1, k1] = PromisifyForTest(client.Get(server.uri()));
+  auto [future2, k2] = PromisifyForTest(client.Get(server.uri()));
+
+  k1.Start();
+  k2.Start();
+
+  RunUntil(future1);
+  RunUntil(future2);
+
+  auto response1 = future1.get();
+  auto response2 = future2.get();
+
+  EXPECT_EQ(200, response1.code());
+  EXPECT_EQ("<html>Hello World!</html>", response1.body());
+
+  EXPECT_EQ(200, response2.code());
+  EXPECT_EQ("<html>Hello World!</html>", response2.body());
+
+  EXPECT_EQ(1, connections);
+}
+
+
+TEST_P(HttpTest, Stream) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  Client client = server.Client();
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([](auto socket, const std::string& data) {
+        socket->Send(
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 25\r\n"
+            "\r\n"
+            "<html>Hello World!</html>\r\n"
+            "\r\n");
+
+        socket->Close();
+      });
+
+  auto e = [&]() {
+    return client.Stream(
+               Request::Builder()
+                   .uri(server.uri())
+                   .method(GET)
+                   .Build())
+        >> Collect<std::vector<std::string>>();
+  };
+
+  static_assert(
+      eventuals::tuple_types_unordered_equals_v<
+          typename decltype(e())::template ErrorsFrom<void, std::tuple<>>,
+          std::tuple<RuntimeError, ResponseError>>);
+
+  std::string body;
+  for (std::string& chunk : *e()) {
+    body += chunk;
+  }
+
+  EXPECT_EQ("<html>Hello World!</html>", body);
+}
+
+
+TEST_P(HttpTest, StreamFailResponseCode) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  Client client = server.Client();
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([](auto socket, const std::string& data) {
+        socket->Send(
+            "HTTP/1.1 404 Not Found\r\n"
+            "Content-Length: 9\r\n"
+            "Foo: Bar\r\n"
+            "\r\n"
+            "Not Found");
+
+        socket->Close();
+      });
+
+  auto e = client.Stream(
+               Request::Builder()
+                   .uri(server.uri())
+                   .method(GET)
+                   .Build())
+      >> Collect<std::vector<std::string>>();
+
+  try {
+    *std::move(e);
+    ADD_FAILURE() << "expected a 'ResponseError'";
+  } catch (const ResponseError& error) {
+    EXPECT_EQ(404, error.code());
+    EXPECT_EQ("Bar", error.headers().at("Foo"));
+    EXPECT_STREQ("HTTP response code 404", error.what());
+  }
+}
+
+
+TEST_P(HttpTest, StreamFailPartialBody) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  Client client = server.Client();
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([](auto socket, const std::string& data) {
+        socket->Send(
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 100\r\n"
+            "\r\n"
+            "<html>");
+
+        socket->Close();
+      });
+
+  auto e = client.Stream(
+               Request::Builder()
+                   .uri(server.uri())
+                   .method(GET)
+                   .Build())
+      >> Collect<std::vector<std::string>>();
+
+  EXPECT_THROW(*std::move(e), RuntimeError);
+}
+
+
+TEST_P(HttpTest, StreamInterruptDuringBody) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  Client client = server.Client();
+
+  std::promise<void> stopped;
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([&](auto socket, const std::string& data) {
+        socket->Send(
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 100\r\n"
+            "\r\n"
+            "<html>");
+
+        // Keep the connection open until the stream has stopped.
+        stopped.get_future().wait();
+
+        socket->Close();
+      });
+
+  Interrupt interrupt;
+
+  auto e = client.Stream(
+               Request::Builder()
+                   .uri(server.uri())
+                   .method(GET)
+                   .Build())
+      >> Loop()
+             .body([&](auto& stream, auto&& chunk) {
+               // The stream shouldn't stop while we're still handling
+               // a chunk but only once we ask for the next one.
+               interrupt.Trigger();
+               stream.Next();
+             })
+             .ended([](auto& k) {
+               k.Start();
+             });
+
+  auto [future, k] = PromisifyForTest(std::move(e));
+
+  k.Register(interrupt);
+
+  k.Start();
+
+  RunUntil(future);
+
+  EXPECT_THROW(future.get(), eventuals::Stopped);
+
+  stopped.set_value();
+}
+
+
+TEST_P(HttpTest, Upload) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  Client client = server.Client();
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([](auto socket, const std::string& data) {
+        EXPECT_THAT(
+            data,
+            testing::HasSubstr("Transfer-Encoding: chunked"));
+
+        // Don't make libcurl wait before sending the body.
+        if (data.find("Expect: 100-continue") != std::string::npos) {
+          socket->Send("HTTP/1.1 100 Continue\r\n\r\n");
+        }
+
+        // Receive the rest of the (chunked) body, which ends with
+        // an empty chunk.
+        std::string received = data;
+        while (received.find("0\r\n\r\n") == std::string::npos) {
+          std::string more = socket->Receive();
+          if (more.empty()) {
+            break;
+          }
+          received += more;
+        }
+
+        EXPECT_THAT(received, testing::HasSubstr("Hello "));
+        EXPECT_THAT(received, testing::HasSubstr("World!"));
+
+        socket->Send(
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 25\r\n"
+            "\r\n"
+            "<html>Hello World!</html>\r\n"
+            "\r\n");
+
+        socket->Close();
+      });
+
+  auto e = [&]() {
+    return Iterate(std::vector<std::string>{"Hello ", "World!"})
+        >> client.Upload(
+               Request::Builder()
+                   .uri(server.uri())
+                   .method(POST)
+                   .Build());
+  };
+
+  auto response = *e();
+
+  EXPECT_EQ(200, response.code());
+  EXPECT_EQ("<html>Hello World!</html>", response.body());
+}
+
+
+TEST_P(HttpTest, UploadByteBuffer) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  Client client = server.Client();
+
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillOnce([](auto socket, const std::string& data) {
+        // Don't make libcurl wait before sending the body.
+        if (data.find("Expect: 100-continue") != std::string::npos) {
+          socket->Send("HTTP/1.1 100 Continue\r\n\r\n");
+        }
+
+        std::string received = data;
+        while (received.find("0\r\n\r\n") == std::string::npos) {
+          std::string more = socket->Receive();
+          if (more.empty()) {
+            break;
+          }
+          received += more;
+        }
+
+        // Each chunk gets sent contiguously even though it is made up
+        // of multiple slices.
+        EXPECT_THAT(received, testing::HasSubstr("Hello World!"));
+
+        socket->Send(
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 25\r\n"
+            "\r\n"
+            "<html>Hello World!</html>\r\n"
+            "\r\n");
+
+        socket->Close();
+      });
+
+  ByteBuffer chunk = ByteBuffer::Copy("Hello ");
+  chunk.Append(ByteBuffer::Copy("World!"));
+
+  auto e = [&]() {
+    return Iterate(std::vector<ByteBuffer>{chunk})
+        >> client.Upload(
+               Request::Builder()
+                   .uri(server.uri())
+                   .method(POST)
+                   .Build());
+  };
+
+  auto response = *e();
+
+  EXPECT_EQ(200, response.code());
+  EXPECT_EQ("<html>Hello World!</html>", response.body());
+}
+
+
+TEST_P(HttpTest, UploadFail) {
+  std::string scheme = GetParam();
+
+  HttpMockServer server(scheme);
+
+  // NOTE: using an 'http::Client' configured to work for the server.
+  Client client = server.Client();
+
+  // The transfer gets aborted once the upstream fails so there's
+  // nothing to respond with.
+  EXPECT_CALL(server, ReceivedHeaders)
+      .WillRepeatedly([](auto socket, const std::string& data) {});
+
+  auto e = [&]() {
+    return Stream<std::string>()
+               .raises<RuntimeError>()
+               .next([](auto& k) {
+                 k.Fail(RuntimeError("upstream failed"));
+               })
+        >> client.Upload(
+               Request::Builder()
+                   .uri(server.uri())
+                   .method(POST)
+                   // Don't make libcurl wait for the server before
+                   // asking the upstream for the body.
+                   .header("Expect", "")
+                   .Build());
+  };
+
+  EXPECT_THAT(
+      [&]() { *e(); },
+      ThrowsMessage<RuntimeError>(StrEq("upstream failed")));
+}
+
+
 TEST_P(HttpTest, GetFailTimeout) {
   std::string scheme = GetParam();
 
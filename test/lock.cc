@@ -6,6 +6,7 @@
 #include "eventuals/iterate.h"
 #include "eventuals/just.h"
 #include "eventuals/map.h"
+#include "eventuals/raise.h"
 #include "eventuals/reduce.h"
 #include "eventuals/terminal.h"
 #include "eventuals/then.h"
@@ -103,6 +104,49 @@ TEST(LockTest, Fail) {
 }
 
 
+TEST(LockTest, FailWhileWaiting) {
+  Lock lock;
+
+  Callback<void()> resume;
+
+  auto e1 = [&]() {
+    return Acquire(&lock)
+        >> Eventual<void>()
+               .start([&](auto& k) {
+                 resume = [&k]() {
+                   k.Start();
+                 };
+               })
+        >> Release(&lock);
+  };
+
+  auto e2 = [&]() {
+    return Just()
+        >> Raise(RuntimeError("error"))
+        >> Acquire(&lock)
+        >> Release(&lock);
+  };
+
+  auto [future1, k1] = PromisifyForTest(e1());
+
+  k1.Start();
+
+  // Failing while 'e1' holds the lock means 'e2' has to hold on to
+  // the error until it acquires the lock.
+  auto [future2, k2] = PromisifyForTest(e2());
+
+  k2.Start();
+
+  resume();
+
+  future1.get();
+
+  EXPECT_THAT(
+      [&]() { future2.get(); },
+      ThrowsMessage<RuntimeError>(StrEq("error")));
+}
+
+
 TEST(LockTest, Stop) {
   // Using mocks to ensure start is only called once.
   MockFunction<void()> start;
@@ -413,5 +457,45 @@ TEST(LockTest, ConditionVariable_UseAfterFree) {
   *foo.NotifyAll();
 }
 
+
+TEST(LockTest, StripedSynchronizable) {
+  struct Foo : public StripedSynchronizable<4> {
+    auto Operation(const std::string& key) {
+      size_t shard = Shard(key);
+      return Synchronized(
+          shard,
+          Then([this, shard]() {
+            if (!lock(shard).OwnedByCurrentSchedulerContext()) {
+              ADD_FAILURE() << "lock should be owned";
+            }
+            return shard;
+          }));
+    }
+  };
+
+  Foo foo;
+
+  EXPECT_EQ(4, foo.shards());
+
+  // Find two keys that belong to different shards.
+  std::string first = "0";
+  std::string second = "1";
+  while (Foo::Shard(first) == Foo::Shard(second)) {
+    second = std::to_string(std::stoi(second) + 1);
+  }
+
+  EXPECT_EQ(Foo::Shard(first), *foo.Operation(first));
+
+  // Holding the lock for the first shard doesn't stop operations on
+  // the second shard from proceeding.
+  *Acquire(&foo.lock(Foo::Shard(first)));
+
+  EXPECT_EQ(Foo::Shard(second), *foo.Operation(second));
+
+  *Release(&foo.lock(Foo::Shard(first)));
+
+  EXPECT_EQ(Foo::Shard(first), *foo.Operation(first));
+}
+
 } // namespace
 } // namespace eventuals::test
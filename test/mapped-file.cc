@@ -0,0 +1,154 @@
+#include "eventuals/mapped-file.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <string>
+
+#include "eventuals/collect.h"
+#include "eventuals/concurrent.h"
+#include "eventuals/iterate.h"
+#include "eventuals/map.h"
+#include "eventuals/promisify.h"
+#include "eventuals/then.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace eventuals::filesystem::test {
+namespace {
+
+using testing::ElementsAre;
+using testing::StartsWith;
+
+class MappedFileTest : public testing::Test {
+ protected:
+  void Write(const std::string& contents) {
+    std::ofstream ofs(path_, std::ios::binary);
+    ofs << contents;
+  }
+
+  void TearDown() override {
+    std::filesystem::remove(path_);
+  }
+
+  const std::filesystem::path path_ = "test_mappedfile";
+};
+
+TEST_F(MappedFileTest, Open) {
+  Write("Hello GTest!");
+
+  MappedFile::Options options;
+  options.advice = MappedFile::Advice::Sequential;
+  options.populate = true;
+
+  auto file = MappedFile::Open(path_, options);
+
+  ASSERT_TRUE(file.has_value()) << file.error();
+
+  EXPECT_EQ("Hello GTest!", file->data());
+  EXPECT_EQ(12, file->size());
+
+  EXPECT_TRUE(file->Advise(MappedFile::Advice::WillNeed, 6));
+
+  // Moving keeps the mapping.
+  MappedFile moved = std::move(file.value());
+
+  EXPECT_TRUE(file->empty());
+  EXPECT_EQ("Hello GTest!", moved.data());
+}
+
+
+TEST_F(MappedFileTest, OpenEmpty) {
+  Write("");
+
+  auto file = MappedFile::Open(path_);
+
+  ASSERT_TRUE(file.has_value()) << file.error();
+
+  EXPECT_TRUE(file->empty());
+  EXPECT_TRUE(file->Chunks(10, '\n').empty());
+}
+
+
+TEST_F(MappedFileTest, OpenHugePages) {
+  std::string contents(3 * 1024 * 1024, 'x');
+  Write(contents);
+
+  MappedFile::Options options;
+  options.huge_pages = true;
+
+  auto file = MappedFile::Open(path_, options);
+
+  ASSERT_TRUE(file.has_value()) << file.error();
+
+  EXPECT_EQ(contents, file->data());
+}
+
+
+TEST_F(MappedFileTest, OpenFail) {
+  auto file = MappedFile::Open("test_mappedfile_nonexistent");
+
+  ASSERT_FALSE(file.has_value());
+
+  EXPECT_THAT(
+      file.error(),
+      StartsWith("Failed to open 'test_mappedfile_nonexistent'"));
+}
+
+
+TEST_F(MappedFileTest, Chunks) {
+  Write("one\ntwo\nthree\nfour\nfive");
+
+  auto file = MappedFile::Open(path_);
+
+  ASSERT_TRUE(file.has_value()) << file.error();
+
+  EXPECT_THAT(
+      file->Chunks(4, '\n'),
+      ElementsAre("one\n", "two\n", "three\n", "four\n", "five"));
+
+  EXPECT_THAT(
+      file->Chunks(6, '\n'),
+      ElementsAre("one\ntwo\n", "three\n", "four\nfive"));
+
+  EXPECT_THAT(
+      file->Chunks(100, '\n'),
+      ElementsAre("one\ntwo\nthree\nfour\nfive"));
+
+  EXPECT_THAT(
+      file->Chunks(10),
+      ElementsAre("one\ntwo\nth", "ree\nfour\nf", "ive"));
+}
+
+
+TEST_F(MappedFileTest, IterateConcurrent) {
+  std::string contents;
+  for (int i = 0; i < 1000; i++) {
+    contents += std::to_string(i) + "\n";
+  }
+  Write(contents);
+
+  auto file = MappedFile::Open(path_);
+
+  ASSERT_TRUE(file.has_value()) << file.error();
+
+  // Count the records in each chunk in parallel.
+  auto e = [&]() {
+    return Iterate(file->Chunks(512, '\n'))
+        >> Concurrent([]() {
+             return Map([](std::string_view chunk) {
+               EXPECT_EQ('\n', chunk.back());
+               return std::count(chunk.begin(), chunk.end(), '\n');
+             });
+           })
+        >> Collect<std::vector>();
+  };
+
+  auto counts = *e();
+
+  EXPECT_EQ(1000, std::accumulate(counts.begin(), counts.end(), 0));
+}
+
+} // namespace
+} // namespace eventuals::filesystem::test
@@ -1,11 +1,14 @@
 #include "eventuals/pipe.h"
 
+#include <algorithm>
 #include <chrono>
 #include <future>
+#include <numeric>
 #include <string>
 #include <thread>
 
 #include "eventuals/collect.h"
+#include "eventuals/head.h"
 #include "eventuals/promisify.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -120,5 +123,220 @@ TEST(Pipe, WaitForClosedAndEmpty) {
       future.wait_for(std::chrono::seconds(0)));
 }
 
+TEST(Pipe, WriteBatchAndReadBatch) {
+  Pipe<int> pipe;
+
+  *pipe.WriteBatch({1, 2, 3, 4, 5});
+  *pipe.WriteBatch({});
+  *pipe.Write(6);
+  *pipe.Close();
+
+  // Values written to a closed pipe are silently dropped.
+  *pipe.WriteBatch({7, 8});
+  EXPECT_EQ(*pipe.Size(), 6);
+
+  auto e = [&pipe]() {
+    return pipe.ReadBatch(4)
+        >> Collect<std::vector>();
+  };
+
+  EXPECT_THAT(
+      *e(),
+      ElementsAre(ElementsAre(1, 2, 3, 4), ElementsAre(5, 6)));
+}
+
+TEST(Pipe, ReadBatchFromDifferentThreads) {
+  Pipe<int> pipe;
+
+  std::thread t([&pipe]() {
+    for (int i = 0; i < 100; i += 10) {
+      std::vector<int> values(10);
+      std::iota(values.begin(), values.end(), i);
+      *pipe.WriteBatch(std::move(values));
+    }
+    *pipe.Close();
+  });
+
+  auto e = [&pipe]() {
+    return pipe.ReadBatch(16)
+        >> Collect<std::vector>();
+  };
+
+  std::vector<int> values;
+  for (auto& batch : *e()) {
+    EXPECT_LE(batch.size(), 16);
+    values.insert(values.end(), batch.begin(), batch.end());
+  }
+
+  t.join();
+
+  std::vector<int> expected(100);
+  std::iota(expected.begin(), expected.end(), 0);
+
+  EXPECT_EQ(expected, values);
+}
+
+TEST(BoundedPipe, Capacity) {
+  EXPECT_EQ(2, BoundedPipe<int>(1).capacity());
+  EXPECT_EQ(4, BoundedPipe<int>(3).capacity());
+  EXPECT_EQ(64, BoundedPipe<int>(64).capacity());
+}
+
+TEST(BoundedPipe, WriteWaitsWhenFull) {
+  BoundedPipe<int> pipe(2);
+
+  *pipe.Write(1);
+  *pipe.Write(2);
+  ASSERT_EQ(*pipe.Size(), 2);
+
+  auto [future, k] = PromisifyForTest(pipe.Write(3));
+  k.Start();
+
+  EXPECT_EQ(
+      std::future_status::timeout,
+      future.wait_for(std::chrono::seconds(0)));
+
+  // Reading a value makes room for the waiting write.
+  EXPECT_EQ(1, *(pipe.Read() >> Head()));
+
+  EXPECT_EQ(
+      std::future_status::ready,
+      future.wait_for(std::chrono::seconds(0)));
+
+  *pipe.Close();
+
+  auto e = [&pipe]() {
+    return pipe.Read()
+        >> Collect<std::vector>();
+  };
+
+  EXPECT_THAT(*e(), ElementsAre(2, 3));
+}
+
+TEST(BoundedPipe, CloseWakesWaitingWrite) {
+  BoundedPipe<int> pipe(2);
+
+  *pipe.Write(1);
+  *pipe.Write(2);
+
+  auto [future, k] = PromisifyForTest(pipe.Write(3));
+  k.Start();
+
+  EXPECT_EQ(
+      std::future_status::timeout,
+      future.wait_for(std::chrono::seconds(0)));
+
+  *pipe.Close();
+
+  EXPECT_EQ(
+      std::future_status::ready,
+      future.wait_for(std::chrono::seconds(0)));
+
+  // Values written to a closed pipe are silently dropped.
+  *pipe.Write(4);
+  EXPECT_EQ(*pipe.Size(), 2);
+
+  auto e = [&pipe]() {
+    return pipe.Read()
+        >> Collect<std::vector>();
+  };
+
+  EXPECT_THAT(*e(), ElementsAre(1, 2));
+}
+
+TEST(BoundedPipe, ReadWaitsWhenEmpty) {
+  BoundedPipe<std::string> pipe(4);
+
+  auto [future, k] = PromisifyForTest(
+      pipe.Read()
+      >> Collect<std::vector>());
+  k.Start();
+
+  EXPECT_EQ(
+      std::future_status::timeout,
+      future.wait_for(std::chrono::seconds(0)));
+
+  *pipe.Write("Hello");
+  *pipe.Write(" world!");
+  *pipe.Close();
+
+  EXPECT_THAT(future.get(), ElementsAre("Hello", " world!"));
+}
+
+TEST(BoundedPipe, ManyWritersAndReaders) {
+  BoundedPipe<int> pipe(8);
+
+  constexpr int kWriters = 4;
+  constexpr int kValues = 1000;
+
+  std::vector<std::thread> writers;
+  for (int i = 0; i < kWriters; i++) {
+    writers.emplace_back([&pipe, i]() {
+      for (int j = 0; j < kValues; j++) {
+        *pipe.Write(i * kValues + j);
+      }
+    });
+  }
+
+  auto e = [&pipe]() {
+    return pipe.Read()
+        >> Collect<std::vector>();
+  };
+
+  auto reader = std::async(std::launch::async, [&e]() {
+    return *e();
+  });
+
+  std::thread closer([&pipe, &writers]() {
+    for (auto& writer : writers) {
+      writer.join();
+    }
+    *pipe.Close();
+  });
+
+  auto values = *e();
+
+  closer.join();
+
+  auto others = reader.get();
+  values.insert(values.end(), others.begin(), others.end());
+
+  std::sort(values.begin(), values.end());
+
+  ASSERT_EQ(kWriters * kValues, values.size());
+  for (int i = 0; i < kWriters * kValues; i++) {
+    EXPECT_EQ(i, values[i]);
+  }
+}
+
+TEST(BoundedPipe, WaitForClosedAndEmpty) {
+  BoundedPipe<int> pipe(2);
+
+  *pipe.Write(1);
+  *pipe.Write(2);
+  *pipe.Close();
+  ASSERT_EQ(*pipe.Size(), 2);
+  ASSERT_TRUE(*pipe.IsClosed());
+
+  auto [future, k] = PromisifyForTest(pipe.WaitForClosedAndEmpty());
+  k.Start();
+
+  EXPECT_EQ(
+      std::future_status::timeout,
+      future.wait_for(std::chrono::seconds(0)));
+
+  // Drain the pipe of values.
+  auto e = [&pipe]() {
+    return pipe.Read()
+        >> Collect<std::vector>();
+  };
+  EXPECT_THAT(*e(), ElementsAre(1, 2));
+
+  // WaitForClosedAndEmpty now returns.
+  EXPECT_EQ(
+      std::future_status::ready,
+      future.wait_for(std::chrono::seconds(0)));
+}
+
 } // namespace
 } // namespace eventuals::test
@@ -0,0 +1,101 @@
+#include "eventuals/recycler.h"
+
+#include <array>
+
+#include "eventuals/just.h"
+#include "eventuals/task.h"
+#include "eventuals/terminal.h"
+#include "eventuals/then.h"
+#include "gtest/gtest.h"
+
+namespace eventuals::test {
+namespace {
+
+TEST(RecyclerTest, ReusesBlocks) {
+  void* block = Recycler::Allocate(100);
+
+  Recycler::Deallocate(block, 100);
+
+  auto statistics = Recycler::statistics();
+
+  // Any size within the same size class gets the same block.
+  EXPECT_EQ(block, Recycler::Allocate(128));
+
+  EXPECT_EQ(statistics.hits + 1, Recycler::statistics().hits);
+
+  Recycler::Deallocate(block, 128);
+}
+
+
+TEST(RecyclerTest, BypassesLargeBlocks) {
+  auto statistics = Recycler::statistics();
+
+  void* block = Recycler::Allocate(Recycler::MAX_SIZE + 1);
+
+  Recycler::Deallocate(block, Recycler::MAX_SIZE + 1);
+
+  EXPECT_EQ(statistics.hits, Recycler::statistics().hits);
+  EXPECT_EQ(statistics.misses, Recycler::statistics().misses);
+  EXPECT_EQ(statistics.cached, Recycler::statistics().cached);
+}
+
+
+TEST(RecyclerTest, TypeErasedStorage) {
+  struct Small {
+    int i = 42;
+  };
+
+  struct Large {
+    std::array<char, TypeErasedStorage::SIZE + 1> bytes = {};
+  };
+
+  static_assert(TypeErasedStorage::Inline<Small>());
+  static_assert(!TypeErasedStorage::Inline<Large>());
+
+  TypeErasedStorage storage;
+
+  EXPECT_FALSE(storage);
+
+  auto* small = storage.Emplace<Small>();
+
+  EXPECT_TRUE(storage);
+  EXPECT_EQ(small, storage.get());
+  EXPECT_EQ(42, small->i);
+
+  auto statistics = Recycler::statistics();
+
+  storage.Emplace<Large>();
+
+  storage.Reset();
+
+  EXPECT_FALSE(storage);
+
+  // Reusing the storage for another large object should now be
+  // served from the recycler.
+  storage.Emplace<Large>();
+
+  EXPECT_EQ(statistics.hits + 1, Recycler::statistics().hits);
+}
+
+
+TEST(RecyclerTest, Task) {
+  auto e = []() -> Task::Of<int> {
+    return []() {
+      return Just(std::array<char, 1024>())
+          >> Then([](auto&& bytes) {
+               return static_cast<int>(bytes.size());
+             });
+    };
+  };
+
+  EXPECT_EQ(1024, *e());
+
+  auto statistics = Recycler::statistics();
+
+  EXPECT_EQ(1024, *e());
+
+  EXPECT_LT(statistics.hits, Recycler::statistics().hits);
+}
+
+} // namespace
+} // namespace eventuals::test
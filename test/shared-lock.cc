@@ -0,0 +1,192 @@
+#include "eventuals/shared-lock.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eventuals/then.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "test/promisify-for-test.h"
+
+namespace eventuals::test {
+namespace {
+
+using testing::ElementsAre;
+
+TEST(SharedLockTest, ReadersShare) {
+  SharedLock lock;
+
+  *AcquireShared(&lock);
+  *AcquireShared(&lock);
+
+  auto e = [&]() {
+    return Acquire(&lock)
+        >> Then([]() { return 42; })
+        >> Release(&lock);
+  };
+
+  auto [future, k] = PromisifyForTest(e());
+
+  k.Start();
+
+  EXPECT_EQ(
+      std::future_status::timeout,
+      future.wait_for(std::chrono::seconds(0)));
+
+  *ReleaseShared(&lock);
+
+  EXPECT_EQ(
+      std::future_status::timeout,
+      future.wait_for(std::chrono::seconds(0)));
+
+  *ReleaseShared(&lock);
+
+  EXPECT_EQ(42, future.get());
+
+  EXPECT_TRUE(lock.Available());
+}
+
+
+// Returns the order in which a reader and then a writer that are both
+// waiting for a writer to release 'lock' end up acquiring it.
+std::vector<std::string> ReaderThenWriter(SharedLock& lock) {
+  std::vector<std::string> order;
+
+  *Acquire(&lock);
+
+  auto reader = [&]() {
+    return AcquireShared(&lock)
+        >> Then([&]() { order.push_back("reader"); })
+        >> ReleaseShared(&lock);
+  };
+
+  auto writer = [&]() {
+    return Acquire(&lock)
+        >> Then([&]() { order.push_back("writer"); })
+        >> Release(&lock);
+  };
+
+  auto [reader_future, r] = PromisifyForTest(reader());
+  auto [writer_future, w] = PromisifyForTest(writer());
+
+  r.Start();
+  w.Start();
+
+  EXPECT_TRUE(order.empty());
+
+  *Release(&lock);
+
+  reader_future.get();
+  writer_future.get();
+
+  EXPECT_TRUE(lock.Available());
+
+  return order;
+}
+
+
+TEST(SharedLockTest, WriterPreference) {
+  SharedLock lock(SharedLock::Policy::WriterPreference);
+
+  EXPECT_THAT(ReaderThenWriter(lock), ElementsAre("writer", "reader"));
+}
+
+
+TEST(SharedLockTest, Fair) {
+  SharedLock lock(SharedLock::Policy::Fair);
+
+  EXPECT_THAT(ReaderThenWriter(lock), ElementsAre("reader", "writer"));
+}
+
+
+TEST(SharedLockTest, ReaderWaitsForQueuedWriter) {
+  SharedLock lock;
+
+  *AcquireShared(&lock);
+
+  auto writer = [&]() {
+    return Acquire(&lock)
+        >> Then([]() { return "writer"; })
+        >> Release(&lock);
+  };
+
+  auto reader = [&]() {
+    return AcquireShared(&lock)
+        >> Then([]() { return "reader"; })
+        >> ReleaseShared(&lock);
+  };
+
+  auto [writer_future, w] = PromisifyForTest(writer());
+  auto [reader_future, r] = PromisifyForTest(reader());
+
+  w.Start();
+  r.Start();
+
+  // The new reader doesn't get the lock even though it's only held
+  // by other readers because a writer is waiting.
+  EXPECT_EQ(
+      std::future_status::timeout,
+      reader_future.wait_for(std::chrono::seconds(0)));
+
+  *ReleaseShared(&lock);
+
+  EXPECT_STREQ("writer", writer_future.get());
+  EXPECT_STREQ("reader", reader_future.get());
+}
+
+
+TEST(SharedLockTest, SharedSynchronizable) {
+  struct Foo : public SharedSynchronizable {
+    auto Read() {
+      return SharedSynchronized(Then([this]() {
+        if (lock().OwnedByCurrentSchedulerContext()) {
+          ADD_FAILURE() << "lock should not be owned exclusively";
+        }
+        return value;
+      }));
+    }
+
+    auto Increment() {
+      return Synchronized(Then([this]() {
+        if (!lock().OwnedByCurrentSchedulerContext()) {
+          ADD_FAILURE() << "lock should be owned";
+        }
+        value++;
+      }));
+    }
+
+    int value = 0;
+  };
+
+  Foo foo;
+
+  *foo.Increment();
+
+  EXPECT_EQ(1, *foo.Read());
+
+  std::vector<std::thread> threads;
+
+  for (size_t i = 0; i < 4; i++) {
+    threads.emplace_back([&foo]() {
+      for (size_t j = 0; j < 1000; j++) {
+        if (j % 4 == 0) {
+          *foo.Increment();
+        } else {
+          EXPECT_LE(1, *foo.Read());
+        }
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(1001, *foo.Read());
+
+  EXPECT_TRUE(foo.lock().Available());
+}
+
+} // namespace
+} // namespace eventuals::test
@@ -10,6 +10,7 @@
 #include "eventuals/let.h"
 #include "eventuals/loop.h"
 #include "eventuals/map.h"
+#include "eventuals/os.h"
 #include "eventuals/promisify.h"
 #include "eventuals/repeat.h"
 #include "eventuals/scheduler.h"
@@ -17,6 +18,7 @@
 #include "eventuals/until.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "test/promisify-for-test.h"
 
 namespace eventuals::test {
 namespace {
@@ -27,7 +29,7 @@ TEST(StaticThreadPoolTest, Schedulable) {
   struct Foo : public StaticThreadPool::Schedulable {
     Foo()
       : StaticThreadPool::Schedulable(Pinned::ExactCPU(
-          std::thread::hardware_concurrency() - 1)) {}
+          StaticThreadPool::Scheduler().concurrency - 1)) {}
 
     auto Operation() {
       return Schedule(
@@ -123,6 +125,244 @@ TEST(StaticThreadPoolTest, PingPong) {
 }
 
 
+TEST(StaticThreadPoolTest, WorkStealing) {
+  // NOTE: using our own pool rather than the default one so that
+  // enabling work stealing doesn't affect any other tests.
+  StaticThreadPool pool;
+
+  if (pool.concurrency < 2) {
+    GTEST_SKIP() << "requires at least 2 CPUs";
+  }
+
+  pool.EnableWorkStealing();
+
+  // Keep CPU 0 busy until the stealable eventual below has run.
+  std::atomic<bool> started = false;
+  std::atomic<bool> stolen = false;
+
+  StaticThreadPool::Requirements busy("busy", Pinned::ExactCPU(0, pool));
+
+  auto [future, k] = PromisifyForTest(
+      pool.Schedule(
+          &busy,
+          Then([&]() {
+            started.store(true);
+            while (!stolen.load()) {}
+          })));
+
+  k.Start();
+
+  while (!started.load()) {}
+
+  // Place the eventual on CPU 0 without requiring that it run there
+  // by masking out every other CPU.
+  std::vector<unsigned int> cpu_mask;
+  for (unsigned int cpu = 1; cpu < pool.concurrency; cpu++) {
+    cpu_mask.push_back(cpu);
+  }
+
+  StaticThreadPool::Requirements stealable(
+      "stealable",
+      Pinned::RandomCPU(cpu_mask, pool));
+
+  ASSERT_EQ(0, stealable.pinned.cpu());
+  ASSERT_FALSE(stealable.pinned.exact());
+
+  auto e = [&]() {
+    return pool.Schedule(
+        &stealable,
+        Then([&]() {
+          stolen.store(true);
+          return StaticThreadPool::cpu;
+        }));
+  };
+
+  EXPECT_NE(0, *e());
+
+  future.get();
+}
+
+
+// Restores the placement policy of 'pool' when it goes out of scope,
+// even if an assertion fails, so that it doesn't leak into any later
+// tests.
+class PlacementGuard final {
+ public:
+  PlacementGuard(StaticThreadPool& pool)
+    : pool_(pool),
+      placement_(pool.placement()) {}
+
+  ~PlacementGuard() {
+    pool_.SetPlacement(placement_);
+  }
+
+ private:
+  StaticThreadPool& pool_;
+  StaticThreadPool::Placement placement_;
+};
+
+
+TEST(StaticThreadPoolTest, Placement) {
+  StaticThreadPool& pool = StaticThreadPool::Scheduler();
+
+  if (pool.concurrency < 2) {
+    GTEST_SKIP() << "requires at least 2 CPUs";
+  }
+
+  PlacementGuard guard(pool);
+
+  pool.SetPlacement(StaticThreadPool::Placement::RoundRobin);
+
+  unsigned int first = pool.Place().cpu().value();
+  unsigned int second = pool.Place().cpu().value();
+
+  EXPECT_EQ((first + 1) % pool.concurrency, second);
+
+  pool.SetPlacement(StaticThreadPool::Placement::LeastLoaded);
+
+  // Keep CPU 0 busy so that it is never the least loaded.
+  std::atomic<bool> started = false;
+  std::atomic<bool> done = false;
+
+  StaticThreadPool::Requirements busy("busy", Pinned::ExactCPU(0));
+
+  auto [future, k] = PromisifyForTest(
+      pool.Schedule(
+          &busy,
+          Then([&]() {
+            started.store(true);
+            while (!done.load()) {}
+          })));
+
+  k.Start();
+
+  while (!started.load()) {}
+
+  EXPECT_EQ(1, pool.load(0));
+
+  for (unsigned int i = 0; i < pool.concurrency; i++) {
+    Pinned pinned = pool.Place();
+    EXPECT_NE(0, pinned.cpu().value());
+    EXPECT_FALSE(pinned.exact());
+  }
+
+  done.store(true);
+
+  future.get();
+}
+
+
+// Sets how many times the workers of 'pool' spin before parking and
+// restores it when it goes out of scope, even if an assertion fails,
+// so that workers don't keep spinning during any later tests.
+class SpinsBeforeParkingGuard final {
+ public:
+  SpinsBeforeParkingGuard(StaticThreadPool& pool, size_t spins)
+    : pool_(pool),
+      spins_(pool.spins_before_parking()) {
+    pool_.SetSpinsBeforeParking(spins);
+  }
+
+  ~SpinsBeforeParkingGuard() {
+    pool_.SetSpinsBeforeParking(spins_);
+  }
+
+ private:
+  StaticThreadPool& pool_;
+  size_t spins_;
+};
+
+
+TEST(StaticThreadPoolTest, SpinThenPark) {
+  StaticThreadPool& pool = StaticThreadPool::Scheduler();
+
+  StaticThreadPool::Requirements requirements("spin", Pinned::ExactCPU(0));
+
+  auto e = [&]() {
+    return pool.Schedule(
+        &requirements,
+        Then([]() {
+          return 42;
+        }));
+  };
+
+  // Spin long enough that the worker should still be spinning when
+  // we schedule again.
+  SpinsBeforeParkingGuard guard(pool, 1000000);
+
+  EXPECT_EQ(42, *e());
+
+  StaticThreadPool::Statistics before = pool.statistics();
+  StaticThreadPool::Statistics after = before;
+
+  // NOTE: whether or not the worker is spinning when we schedule
+  // depends on timing, e.g., it might not have gone idle yet or we
+  // might have been descheduled long enough for it to park, so we
+  // try a bunch of times rather than expecting it the first time.
+  for (size_t i = 0; i < 100 && after.spins == before.spins; i++) {
+    EXPECT_EQ(42, *e());
+    after = pool.statistics();
+  }
+
+  EXPECT_GT(after.spins, before.spins);
+}
+
+
+TEST(StaticThreadPoolTest, MultiplePools) {
+  std::vector<unsigned int> cpus = GetAllowedCPUs();
+
+  StaticThreadPool io(std::vector<unsigned int>{cpus.front()});
+  StaticThreadPool compute(2);
+
+  EXPECT_EQ(1, io.concurrency);
+  EXPECT_THAT(io.cpus(), testing::ElementsAre(cpus.front()));
+  EXPECT_EQ(2, compute.concurrency);
+
+  // 'Pinned' is relative to a pool.
+  EXPECT_EQ(0, Pinned::ModuloTotalCPUs(3, io).cpu());
+  EXPECT_EQ(1, Pinned::ModuloTotalCPUs(3, compute).cpu());
+
+  struct Foo : public StaticThreadPool::Schedulable {
+    Foo(StaticThreadPool& pool)
+      : StaticThreadPool::Schedulable(
+          pool,
+          StaticThreadPool::Requirements(
+              "foo",
+              Pinned::ExactCPU(1, pool))) {}
+
+    auto Operation() {
+      return Schedule(Then([this]() {
+        return StaticThreadPool::member == &pool()
+            && StaticThreadPool::cpu == 1;
+      }));
+    }
+  };
+
+  Foo foo(compute);
+
+  EXPECT_TRUE(*foo.Operation());
+
+  // Scheduling from one pool onto another must hop threads even
+  // though both pools have a CPU 0.
+  StaticThreadPool::Requirements first("first", Pinned::ExactCPU(0, io));
+  StaticThreadPool::Requirements second("second", Pinned::ExactCPU(0, compute));
+
+  auto e = [&]() {
+    return io.Schedule(
+        &first,
+        Then([&]() {
+          return compute.Schedule(
+              &second,
+              Then([&]() {
+                return StaticThreadPool::member == &compute;
+              }));
+        }));
+  };
+
+  EXPECT_TRUE(*e());
+}
+
+
 TEST(StaticThreadPoolTest, Spawn) {
   auto e = [&]() {
     return StaticThreadPool::Spawn(
@@ -225,7 +465,9 @@ TEST(StaticThreadPoolTest, Concurrent) {
 
 
 TEST(StaticThreadPoolTest, ForkJoin) {
-  ASSERT_GE(std::thread::hardware_concurrency(), 2);
+  if (StaticThreadPool::Scheduler().concurrency < 2) {
+    GTEST_SKIP() << "requires at least 2 CPUs";
+  }
 
   auto e = []() {
     return StaticThreadPool::Scheduler().ForkJoin(
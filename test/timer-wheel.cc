@@ -0,0 +1,195 @@
+#include "eventuals/timer-wheel.h"
+
+#include <deque>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace eventuals::test {
+namespace {
+
+using testing::ElementsAre;
+
+// NOTE: 'Callback' only fits a single pointer so each timeout's
+// callback captures just a pointer to one of these.
+struct Expired {
+  TimerWheel wheel;
+  std::vector<uint64_t> ticks;
+};
+
+TEST(TimerWheelTest, Expire) {
+  Expired expired;
+
+  TimerWheel::Timeout timeout1([&expired]() {
+    expired.ticks.push_back(expired.wheel.now());
+  });
+
+  TimerWheel::Timeout timeout2([&expired]() {
+    expired.ticks.push_back(expired.wheel.now());
+  });
+
+  TimerWheel::Timeout timeout3([&expired]() {
+    expired.ticks.push_back(expired.wheel.now());
+  });
+
+  expired.wheel.Insert(&timeout3, 30);
+  expired.wheel.Insert(&timeout1, 10);
+  expired.wheel.Insert(&timeout2, 20);
+
+  EXPECT_EQ(3, expired.wheel.size());
+  EXPECT_EQ(10, expired.wheel.Next());
+
+  expired.wheel.Advance(9);
+
+  EXPECT_TRUE(expired.ticks.empty());
+
+  expired.wheel.Advance(20);
+
+  EXPECT_THAT(expired.ticks, ElementsAre(10, 20));
+  EXPECT_EQ(30, expired.wheel.Next());
+
+  expired.wheel.Advance(100);
+
+  EXPECT_THAT(expired.ticks, ElementsAre(10, 20, 30));
+  EXPECT_TRUE(expired.wheel.empty());
+  EXPECT_EQ(std::nullopt, expired.wheel.Next());
+}
+
+
+TEST(TimerWheelTest, Cancel) {
+  Expired expired;
+
+  TimerWheel::Timeout timeout1([]() {
+    ADD_FAILURE() << "cancelled timeout expired";
+  });
+
+  TimerWheel::Timeout timeout2([&expired]() {
+    expired.ticks.push_back(expired.wheel.now());
+  });
+
+  expired.wheel.Insert(&timeout1, 10);
+  expired.wheel.Insert(&timeout2, 10);
+
+  expired.wheel.Cancel(&timeout1);
+
+  EXPECT_FALSE(timeout1.inserted());
+  EXPECT_EQ(1, expired.wheel.size());
+
+  expired.wheel.Advance(10);
+
+  EXPECT_THAT(expired.ticks, ElementsAre(10));
+
+  // Cancelling after expiring is a no-op.
+  expired.wheel.Cancel(&timeout2);
+
+  EXPECT_TRUE(expired.wheel.empty());
+}
+
+
+TEST(TimerWheelTest, AlreadyExpired) {
+  Expired expired;
+
+  expired.wheel.Advance(100);
+
+  TimerWheel::Timeout timeout([&expired]() {
+    expired.ticks.push_back(expired.wheel.now());
+  });
+
+  expired.wheel.Insert(&timeout, 50);
+
+  EXPECT_EQ(100, expired.wheel.Next());
+
+  expired.wheel.Advance(100);
+
+  EXPECT_THAT(expired.ticks, ElementsAre(100));
+}
+
+
+// Timeouts in every level of the wheel, and beyond its span, should
+// still expire at exactly their tick.
+TEST(TimerWheelTest, Cascade) {
+  Expired expired;
+
+  std::vector<uint64_t> ticks = {
+      1,
+      63,
+      64,
+      65,
+      4095,
+      4096,
+      4097,
+      262143,
+      262144,
+      TimerWheel::SPAN - 1,
+      TimerWheel::SPAN,
+      TimerWheel::SPAN * 3 + 17,
+  };
+
+  std::deque<TimerWheel::Timeout> timeouts;
+
+  for (uint64_t tick : ticks) {
+    timeouts.emplace_back([&expired]() {
+      expired.ticks.push_back(expired.wheel.now());
+    });
+    expired.wheel.Insert(&timeouts.back(), tick);
+  }
+
+  while (std::optional<uint64_t> next = expired.wheel.Next()) {
+    expired.wheel.Advance(*next);
+  }
+
+  EXPECT_EQ(ticks, expired.ticks);
+}
+
+
+TEST(TimerWheelTest, InsertFromCallback) {
+  struct {
+    Expired expired;
+    std::optional<TimerWheel::Timeout> timeout;
+  } state;
+
+  state.timeout.emplace([&state]() {
+    state.expired.ticks.push_back(state.expired.wheel.now());
+  });
+
+  TimerWheel::Timeout timeout([&state]() {
+    state.expired.ticks.push_back(state.expired.wheel.now());
+    state.expired.wheel.Insert(
+        &state.timeout.value(),
+        state.expired.wheel.now() + 100);
+  });
+
+  state.expired.wheel.Insert(&timeout, 10);
+
+  state.expired.wheel.Advance(1000);
+
+  EXPECT_THAT(state.expired.ticks, ElementsAre(10, 110));
+}
+
+
+TEST(TimerWheelTest, CancelFromCallback) {
+  struct {
+    Expired expired;
+    std::optional<TimerWheel::Timeout> timeout;
+  } state;
+
+  state.timeout.emplace([]() {
+    ADD_FAILURE() << "cancelled timeout expired";
+  });
+
+  TimerWheel::Timeout timeout([&state]() {
+    state.expired.wheel.Cancel(&state.timeout.value());
+  });
+
+  // Both expire on the same tick.
+  state.expired.wheel.Insert(&timeout, 10);
+  state.expired.wheel.Insert(&state.timeout.value(), 10);
+
+  state.expired.wheel.Advance(10);
+
+  EXPECT_TRUE(state.expired.wheel.empty());
+}
+
+} // namespace
+} // namespace eventuals::test